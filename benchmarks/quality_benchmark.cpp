@@ -0,0 +1,322 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/*	Benchmark of the public quality evaluations of the ElementQualityStatistics plugin.
+ *
+ *	Creates synthetic meshes (see synthetic_meshes.h), times every evaluation and
+ *	writes the timings and throughputs (elements per second) as json, so that runs
+ *	can be compared over time. Usage:
+ *
+ *	quality_benchmark [-mesh tet|hex|prism|mixed|all] [-cells n] [-distortion d]
+ *					  [-slivers fraction] [-reps r] [-threads t] [-seed s]
+ *					  [-o results.json] [-verbose]
+ *
+ *	The evaluations log their results. Terminal output is disabled while timing,
+ *	unless -verbose is given.*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "ug.h"
+#include "common/log.h"
+#include "lib_grid/lib_grid.h"
+#include "../element_quality_statistics.h"
+#include "../elem_stat_util.h"
+#include "../quality_threading.h"
+#include "synthetic_meshes.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+using namespace ug;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	BenchmarkResult
+///	timings of one evaluation on one mesh
+struct BenchmarkResult
+{
+	string name;
+	string elementType;		///< elements the throughput refers to
+	size_t numElements;
+	vector<double> seconds;	///< one entry per repetition
+
+	double best() const		{return *min_element(seconds.begin(), seconds.end());}
+	double mean() const
+	{
+		double sum = 0;
+		for(size_t i = 0; i < seconds.size(); ++i)
+			sum += seconds[i];
+		return sum / seconds.size();
+	}
+	double elements_per_second() const
+	{
+		return best() > 0 ? numElements / best() : 0;
+	}
+};
+
+///	timings of all evaluations on one mesh
+struct MeshBenchmark
+{
+	SyntheticMeshParams params;
+	size_t numVertices, numEdges, numFaces, numVolumes;
+	vector<BenchmarkResult> results;
+};
+
+
+///	runs func 'reps' times and records the wall clock time of each run
+template <class TFunc>
+static BenchmarkResult RunBenchmark(const char* name, const char* elementType,
+									size_t numElements, int reps, bool verbose, TFunc func)
+{
+	BenchmarkResult res;
+	res.name = name;
+	res.elementType = elementType;
+	res.numElements = numElements;
+
+	for(int i = 0; i < reps; ++i)
+	{
+		if(!verbose)
+			GetLogAssistant().enable_terminal_output(false);
+
+		#ifdef UG_PARALLEL
+			pcl::SynchronizeProcesses();
+		#endif
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		func();
+		chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+
+		GetLogAssistant().enable_terminal_output(true);
+		res.seconds.push_back(chrono::duration<double>(stop - start).count());
+	}
+
+	UG_LOG("  " << name << ": best " << res.best() << " s, mean " << res.mean()
+		   << " s, " << res.elements_per_second() << " " << elementType << "/s" << endl);
+	return res;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	BenchmarkMesh
+static MeshBenchmark BenchmarkMesh(const SyntheticMeshParams& params, int reps, bool verbose)
+{
+	MeshBenchmark bench;
+	bench.params = params;
+
+	MultiGrid mg(GRIDOPT_STANDARD_INTERCONNECTION | GRIDOPT_AUTOGENERATE_SIDES);
+	MGSubsetHandler sh(mg);
+	CreateSyntheticMesh(mg, sh, params);
+
+	bench.numVertices = mg.num<Vertex>();
+	bench.numEdges = mg.num<Edge>();
+	bench.numFaces = mg.num<Face>();
+	bench.numVolumes = mg.num<Volume>();
+
+	UG_LOG("mesh '" << SyntheticMeshTypeName(params.type) << "', " << params.numCells
+		   << "^3 cells: " << bench.numVertices << " vertices, " << bench.numEdges
+		   << " edges, " << bench.numFaces << " faces, " << bench.numVolumes << " volumes" << endl);
+
+	const size_t numVols = bench.numVolumes;
+	const size_t numSubsetEdges = sh.num<Edge>(0, 0);
+	const size_t numSubsetFaces = sh.num<Face>(0, 0);
+	const size_t numSubsetVols = sh.num<Volume>(0, 0);
+	vector<BenchmarkResult>& res = bench.results;
+
+	res.push_back(RunBenchmark("ElementQualityStatistics3d", "volumes", numVols, reps, verbose,
+		[&]{ElementQualityStatistics3d(mg, mg.get_grid_objects(), 10.0, 0.1, false);}));
+	res.push_back(RunBenchmark("ComputeQualityReport(min_dihedral)", "volumes", numVols, reps, verbose,
+		[&]{ComputeQualityReport(mg, 3, "min_dihedral");}));
+
+	MGSubsetHandler shQuality(mg);
+	res.push_back(RunBenchmark("AssignSubsetsByElementQuality3d", "volumes", numVols, reps, verbose,
+		[&]{AssignSubsetsByElementQuality3d(mg, shQuality, 10);}));
+
+	MGSubsetHandler shBounds(mg);
+	res.push_back(RunBenchmark("FindBoundsForStiffnesMatrixMaxEigenvalue", "volumes", numVols, reps, verbose,
+		[&]{FindBoundsForStiffnesMatrixMaxEigenvalue(mg, shBounds);}));
+
+	res.push_back(RunBenchmark("CountNumberOfEdgesInSubset", "edges", numSubsetEdges, reps, verbose,
+		[&]{CountNumberOfEdgesInSubset(mg, 0, sh);}));
+	res.push_back(RunBenchmark("ComputeTotalEdgeLengthInSubset", "edges", numSubsetEdges, reps, verbose,
+		[&]{ComputeTotalEdgeLengthInSubset(mg, 0, sh);}));
+	res.push_back(RunBenchmark("ComputeAverageEdgeLengthInSubset", "edges", numSubsetEdges, reps, verbose,
+		[&]{ComputeAverageEdgeLengthInSubset(mg, 0, sh, numSubsetEdges);}));
+	res.push_back(RunBenchmark("ComputeLongestEdgeInSubset", "edges", numSubsetEdges, reps, verbose,
+		[&]{ComputeLongestEdgeInSubset(mg, 0, sh);}));
+	res.push_back(RunBenchmark("ComputeShortestEdgeInSubset", "edges", numSubsetEdges, reps, verbose,
+		[&]{ComputeShortestEdgeInSubset(mg, 0, sh);}));
+	res.push_back(RunBenchmark("ComputeEdgeStatisticsInSubset", "edges", numSubsetEdges, reps, verbose,
+		[&]{ComputeEdgeStatisticsInSubset(mg, 0, sh);}));
+	res.push_back(RunBenchmark("CalculateSubsetSurfaceArea", "faces", numSubsetFaces, reps, verbose,
+		[&]{CalculateSubsetSurfaceArea(mg, 0, sh);}));
+	res.push_back(RunBenchmark("CalculateSubsetVolume", "volumes", numSubsetVols, reps, verbose,
+		[&]{CalculateSubsetVolume(mg, 0, sh);}));
+
+	return bench;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	WriteBenchmarkJSON
+static void WriteBenchmarkJSON(const char* filename, const vector<MeshBenchmark>& benches,
+							   int reps, int numProcs)
+{
+	ofstream out(filename);
+	UG_COND_THROW(!out, "Couldn't open file " << filename << " for writing.");
+
+	char date[32];
+	time_t now = time(NULL);
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+	out.precision(9);
+	out << "{\n";
+	out << "  \"benchmark\": \"ElementQualityStatistics\",\n";
+	out << "  \"date\": \"" << date << "\",\n";
+	out << "  \"repetitions\": " << reps << ",\n";
+	out << "  \"threads\": " << GetQualityStatisticsNumThreads() << ",\n";
+	out << "  \"processes\": " << numProcs << ",\n";
+	out << "  \"meshes\": [\n";
+	for(size_t m = 0; m < benches.size(); ++m)
+	{
+		const MeshBenchmark& b = benches[m];
+		out << "    {\n";
+		out << "      \"type\": \"" << SyntheticMeshTypeName(b.params.type) << "\",\n";
+		out << "      \"cells\": " << b.params.numCells << ",\n";
+		out << "      \"distortion\": " << b.params.distortion << ",\n";
+		out << "      \"sliver_fraction\": " << b.params.sliverFraction << ",\n";
+		out << "      \"seed\": " << b.params.seed << ",\n";
+		out << "      \"vertices\": " << b.numVertices << ",\n";
+		out << "      \"edges\": " << b.numEdges << ",\n";
+		out << "      \"faces\": " << b.numFaces << ",\n";
+		out << "      \"volumes\": " << b.numVolumes << ",\n";
+		out << "      \"results\": [\n";
+		for(size_t i = 0; i < b.results.size(); ++i)
+		{
+			const BenchmarkResult& r = b.results[i];
+			out << "        {\"name\": \"" << r.name << "\", \"element_type\": \"" << r.elementType
+				<< "\", \"elements\": " << r.numElements
+				<< ", \"best_seconds\": " << r.best() << ", \"mean_seconds\": " << r.mean()
+				<< ", \"elements_per_second\": " << r.elements_per_second() << ", \"seconds\": [";
+			for(size_t j = 0; j < r.seconds.size(); ++j)
+				out << (j ? ", " : "") << r.seconds[j];
+			out << "]}" << (i + 1 < b.results.size() ? "," : "") << "\n";
+		}
+		out << "      ]\n";
+		out << "    }" << (m + 1 < benches.size() ? "," : "") << "\n";
+	}
+	out << "  ]\n";
+	out << "}\n";
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	main
+static const char* ArgValue(int argc, char** argv, int& i)
+{
+	UG_COND_THROW(i + 1 >= argc, "Missing value of argument " << argv[i]);
+	return argv[++i];
+}
+
+int main(int argc, char** argv)
+{
+	UGInit(&argc, &argv);
+
+	int retVal = 0;
+	try
+	{
+		SyntheticMeshParams params;
+		string meshName = "all";
+		string outFile = "quality_benchmark.json";
+		int reps = 3;
+		bool verbose = false;
+
+		for(int i = 1; i < argc; ++i)
+		{
+			if(strcmp(argv[i], "-mesh") == 0)				meshName = ArgValue(argc, argv, i);
+			else if(strcmp(argv[i], "-cells") == 0)			params.numCells = atoi(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-distortion") == 0)	params.distortion = atof(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-slivers") == 0)		params.sliverFraction = atof(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-reps") == 0)			reps = atoi(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-threads") == 0)		SetQualityStatisticsNumThreads(atoi(ArgValue(argc, argv, i)));
+			else if(strcmp(argv[i], "-seed") == 0)			params.seed = atoi(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-o") == 0)				outFile = ArgValue(argc, argv, i);
+			else if(strcmp(argv[i], "-verbose") == 0)		verbose = true;
+			else UG_THROW("Unknown argument " << argv[i]);
+		}
+		UG_COND_THROW(reps < 1, "-reps has to be positive.");
+
+		vector<SyntheticMeshType> types;
+		if(meshName == "all"){
+			for(int i = 0; i < NUM_SYNTHETIC_MESH_TYPES; ++i)
+				types.push_back((SyntheticMeshType)i);
+		}
+		else
+			types.push_back(SyntheticMeshTypeFromName(meshName));
+
+		vector<MeshBenchmark> benches;
+		for(size_t i = 0; i < types.size(); ++i)
+		{
+			params.type = types[i];
+			benches.push_back(BenchmarkMesh(params, reps, verbose));
+		}
+
+	//	every process evaluates its own copy of the meshes
+		int procRank = 0;
+		int numProcs = 1;
+		#ifdef UG_PARALLEL
+			procRank = pcl::ProcRank();
+			numProcs = pcl::NumProcs();
+		#endif
+
+		if(procRank == 0){
+			WriteBenchmarkJSON(outFile.c_str(), benches, reps, numProcs);
+			UG_LOG("results written to " << outFile << endl);
+		}
+	}
+	catch(UGError& err)
+	{
+		UG_LOG("ERROR in quality_benchmark: " << err.get_msg() << endl);
+		retVal = 1;
+	}
+
+	UGFinalize();
+	return retVal;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+/*	Checks that both entry points of the spatial map bin the same elements:
+ *	ComputeQualitySpatialMap, which only evaluates the measure of the map, and
+ *	ComputeQualityReport(mg, dim, lvl, map), which evaluates all metrics including
+ *	the faces of the volume mesh (QM_LOWER_DIM). For every cell the counts have to
+ *	be equal and the minima have to agree up to the tolerance of the tetrahedron
+ *	kernels (see tet_kernels.h). The meshes are the synthetic tetrahedral and mixed
+ *	meshes of the benchmark, distorted and with slivers. Usage:
+ *
+ *	spatial_map_test [-cells n] [-resolution r] [-seed s]
+ *
+ *	Returns 0 if the maps agree and 1 otherwise.*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "ug.h"
+#include "common/log.h"
+#include "lib_grid/lib_grid.h"
+#include "synthetic_meshes.h"
+#include "../element_quality_statistics.h"
+#include "../quality_snapshot.h"
+#include "../quality_spatial_map.h"
+
+using namespace std;
+using namespace ug;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CompareMaps
+///	returns the number of cells in which count or minimum differ
+static size_t CompareMaps(const QualitySpatialMap& map, const QualitySpatialMap& reportMap,
+						  const char* name)
+{
+	size_t numErrors = 0;
+	for(size_t c = 0; c < map.num_cells(); ++c)
+	{
+		const number min = map.min(c);
+		const number reportMin = reportMap.min(c);
+		const bool bCountDiffers = (map.count(c) != reportMap.count(c));
+	//	the measure alone may be evaluated by a cheaper kernel variant, see tet_kernels.h
+		const bool bMinDiffers = fabs(min - reportMin) > 1e-6 * std::max(fabs(min), (number)1.0);
+		if(!bCountDiffers && !bMinDiffers)
+			continue;
+
+		if(numErrors < 10)
+		{
+			UG_LOG("  " << name << ", cell " << c << ": count " << map.count(c) << " vs. "
+				   << reportMap.count(c) << ", min " << min << " vs. " << reportMin << endl);
+		}
+		++numErrors;
+	}
+	return numErrors;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	main
+static const char* ArgValue(int argc, char** argv, int& i)
+{
+	UG_COND_THROW(i + 1 >= argc, "Missing value of argument " << argv[i]);
+	return argv[++i];
+}
+
+int main(int argc, char** argv)
+{
+	UGInit(&argc, &argv);
+
+	int retVal = 0;
+	try
+	{
+		SyntheticMeshParams params;
+		params.numCells = 8;
+		params.distortion = 0.4;
+		params.sliverFraction = 0.02;
+		int resolution = 4;
+
+		for(int i = 1; i < argc; ++i)
+		{
+			if(strcmp(argv[i], "-cells") == 0)				params.numCells = atoi(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-resolution") == 0)	resolution = atoi(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-seed") == 0)			params.seed = atoi(ArgValue(argc, argv, i));
+			else UG_THROW("Unknown argument " << argv[i]);
+		}
+
+		const SyntheticMeshType types[] = {SMT_TETRAHEDRA, SMT_MIXED};
+		const char* measures[] = {"min_angle", "aspect_ratio"};
+		const number thresholds[] = {20.0, 0.3};
+		const bool initialUseSnapshot = GetQualityStatisticsUseSnapshot();
+		size_t numErrors = 0;
+
+		for(size_t t = 0; t < sizeof(types) / sizeof(types[0]); ++t)
+		{
+			params.type = types[t];
+			MultiGrid mg(GRIDOPT_STANDARD_INTERCONNECTION | GRIDOPT_AUTOGENERATE_SIDES);
+			MGSubsetHandler sh(mg);
+			CreateSyntheticMesh(mg, sh, params);
+
+			for(size_t m = 0; m < sizeof(measures) / sizeof(measures[0]); ++m)
+			{
+				for(int useSnapshot = 0; useSnapshot < 2; ++useSnapshot)
+				{
+					SetQualityStatisticsUseSnapshot(useSnapshot != 0);
+
+					SmartPtr<QualitySpatialMap> map =
+						ComputeQualitySpatialMap(mg, 3, 0, measures[m], thresholds[m], resolution);
+					SmartPtr<QualitySpatialMap> reportMap =
+						CreateQualitySpatialMap(mg, 3, 0, measures[m], thresholds[m], resolution);
+					ComputeQualityReport(mg, 3, 0, reportMap);
+
+					string name = string(SyntheticMeshTypeName(types[t])) + ", " + measures[m]
+								  + (useSnapshot ? ", snapshot" : "");
+					size_t numMapErrors = CompareMaps(*map, *reportMap, name.c_str());
+					UG_LOG(name << ": " << map->num_cells() << " cells, "
+						   << numMapErrors << " deviations" << endl);
+					numErrors += numMapErrors;
+				}
+			}
+		}
+		SetQualityStatisticsUseSnapshot(initialUseSnapshot);
+
+		if(numErrors > 0)
+		{
+			UG_LOG("FAILED: " << numErrors << " cells differ" << endl);
+			retVal = 1;
+		}
+		else
+			UG_LOG("PASSED" << endl);
+	}
+	catch(UGError& err)
+	{
+		UG_LOG("ERROR in spatial_map_test: " << err.get_msg() << endl);
+		retVal = 1;
+	}
+
+	UGFinalize();
+	return retVal;
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "synthetic_meshes.h"
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	SyntheticMeshType
+const char* SyntheticMeshTypeName(SyntheticMeshType type)
+{
+	switch(type)
+	{
+		case SMT_TETRAHEDRA:	return "tet";
+		case SMT_HEXAHEDRA:		return "hex";
+		case SMT_PRISMS:		return "prism";
+		case SMT_MIXED:			return "mixed";
+		default:				return "unknown";
+	}
+}
+
+SyntheticMeshType SyntheticMeshTypeFromName(const std::string& name)
+{
+	for(int i = 0; i < NUM_SYNTHETIC_MESH_TYPES; ++i)
+		if(name == SyntheticMeshTypeName((SyntheticMeshType)i))
+			return (SyntheticMeshType)i;
+	UG_THROW("Unknown synthetic mesh type '" << name << "'. Use 'tet', 'hex', 'prism' or 'mixed'.");
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CreateSyntheticMesh
+typedef Grid::VertexAttachmentAccessor<APosition> SyntheticAAPos;
+
+///	creates a tetrahedron with positive orientation
+static void CreatePositiveTetrahedron(MultiGrid& mg, SyntheticAAPos& aaPos,
+									  Vertex* v0, Vertex* v1, Vertex* v2, Vertex* v3)
+{
+	vector3 a, b, c, n;
+	VecSubtract(a, aaPos[v1], aaPos[v0]);
+	VecSubtract(b, aaPos[v2], aaPos[v0]);
+	VecSubtract(c, aaPos[v3], aaPos[v0]);
+	VecCross(n, a, b);
+	if(VecDot(n, c) < 0)
+		swap(v2, v3);
+	mg.create<Tetrahedron>(TetrahedronDescriptor(v0, v1, v2, v3));
+}
+
+///	creates the elements of one cube. 'v' holds the corners, bit i of the index is the
+///	offset in direction i.
+static void CreateCubeElements(MultiGrid& mg, SyntheticAAPos& aaPos,
+							   SyntheticMeshType type, Vertex* const* v)
+{
+	switch(type)
+	{
+		case SMT_HEXAHEDRA:
+			mg.create<Hexahedron>(HexahedronDescriptor(v[0], v[1], v[3], v[2],
+													   v[4], v[5], v[7], v[6]));
+			break;
+
+		case SMT_PRISMS:
+			mg.create<Prism>(PrismDescriptor(v[0], v[1], v[3], v[4], v[5], v[7]));
+			mg.create<Prism>(PrismDescriptor(v[0], v[3], v[2], v[4], v[7], v[6]));
+			break;
+
+		case SMT_TETRAHEDRA:
+		{
+		//	Kuhn triangulation: one tetrahedron per path from corner 0 to corner 7
+			const int perms[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2},
+									 {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+			for(int i = 0; i < 6; ++i)
+			{
+				int c1 = 1 << perms[i][0];
+				int c2 = c1 | (1 << perms[i][1]);
+				CreatePositiveTetrahedron(mg, aaPos, v[0], v[c1], v[c2], v[7]);
+			}
+		}break;
+
+		default:
+			UG_THROW("CreateCubeElements: Unsupported mesh type " << type);
+	}
+}
+
+void CreateSyntheticMesh(MultiGrid& mg, MGSubsetHandler& sh, const SyntheticMeshParams& params)
+{
+	UG_COND_THROW(params.numCells < 1, "CreateSyntheticMesh: numCells has to be positive.");
+	UG_COND_THROW(params.distortion < 0 || params.distortion >= 1,
+				  "CreateSyntheticMesh: distortion has to be in [0, 1).");
+
+	if(!mg.has_vertex_attachment(aPosition))
+		mg.attach_to_vertices(aPosition);
+	SyntheticAAPos aaPos(mg, aPosition);
+
+	const int n = params.numCells;
+	const number h = 1.0 / n;
+	mt19937 rng(params.seed);
+	uniform_real_distribution<number> offset(-0.5 * params.distortion * h,
+											 0.5 * params.distortion * h);
+
+//	all elements of the mesh and their sides go to subset 0
+	sh.set_default_subset_index(0);
+	sh.subset_info(0).name = "inner";
+
+//	vertices of the (n+1)^3 lattice, inner ones are moved randomly
+	const int numVrtsPerDir = n + 1;
+	vector<Vertex*> vrts(numVrtsPerDir * numVrtsPerDir * numVrtsPerDir);
+	for(int k = 0; k <= n; ++k){
+		for(int j = 0; j <= n; ++j){
+			for(int i = 0; i <= n; ++i){
+				Vertex* vrt = *mg.create<RegularVertex>();
+				vector3& p = aaPos[vrt];
+				p = vector3(i * h, j * h, k * h);
+				if(i > 0 && i < n)	p.x() += offset(rng);
+				if(j > 0 && j < n)	p.y() += offset(rng);
+				if(k > 0 && k < n)	p.z() += offset(rng);
+				vrts[(k * numVrtsPerDir + j) * numVrtsPerDir + i] = vrt;
+			}
+		}
+	}
+
+	Vertex* v[8];
+	for(int k = 0; k < n; ++k){
+		for(int j = 0; j < n; ++j){
+			for(int i = 0; i < n; ++i){
+				for(int c = 0; c < 8; ++c){
+					int ci = i + (c & 1);
+					int cj = j + ((c >> 1) & 1);
+					int ck = k + ((c >> 2) & 1);
+					v[c] = vrts[(ck * numVrtsPerDir + cj) * numVrtsPerDir + ci];
+				}
+
+				SyntheticMeshType type = params.type;
+				if(type == SMT_MIXED){
+					const SyntheticMeshType cycle[3] = {SMT_HEXAHEDRA, SMT_PRISMS, SMT_TETRAHEDRA};
+					type = cycle[(i + j + k) % 3];
+				}
+				CreateCubeElements(mg, aaPos, type, v);
+			}
+		}
+	}
+
+//	slivers: 4 corners close to the diagonal plane of a cube
+	size_t numSlivers = (size_t)floor(params.sliverFraction * mg.num<Volume>() + 0.5);
+	if(numSlivers > 0)
+	{
+		sh.set_default_subset_index(1);
+		sh.subset_info(1).name = "slivers";
+
+		uniform_int_distribution<int> cell(0, n - 1);
+		const number eps = 0.01 * h;
+		for(size_t s = 0; s < numSlivers; ++s)
+		{
+			vector3 o(cell(rng) * h, cell(rng) * h, (cell(rng) + 0.5) * h);
+			const vector3 corners[4] = {vector3(o.x(), o.y(), o.z()),
+										vector3(o.x() + h, o.y() + h, o.z()),
+										vector3(o.x() + h, o.y(), o.z() + eps),
+										vector3(o.x(), o.y() + h, o.z() + eps)};
+			Vertex* sv[4];
+			for(int c = 0; c < 4; ++c){
+				sv[c] = *mg.create<RegularVertex>();
+				aaPos[sv[c]] = corners[c];
+			}
+			CreatePositiveTetrahedron(mg, aaPos, sv[0], sv[1], sv[2], sv[3]);
+		}
+	}
+
+	sh.set_default_subset_index(-1);
+}
+
+}
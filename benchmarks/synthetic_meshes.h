@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __SYNTHETIC_MESHES_H__
+#define __SYNTHETIC_MESHES_H__
+
+/* system includes */
+#include <stddef.h>
+#include <string>
+
+#include "lib_grid/lib_grid.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	SyntheticMesh
+///	element types of the synthetic benchmark meshes
+enum SyntheticMeshType
+{
+	SMT_TETRAHEDRA,		///< every cube is split into 6 tetrahedra (Kuhn triangulation)
+	SMT_HEXAHEDRA,		///< one hexahedron per cube
+	SMT_PRISMS,			///< every cube is split into 2 prisms
+	SMT_MIXED,			///< hexahedra, prisms and tetrahedra in alternating cubes
+	NUM_SYNTHETIC_MESH_TYPES
+};
+
+///	returns the name of a mesh type ("tet", "hex", "prism" or "mixed")
+const char* SyntheticMeshTypeName(SyntheticMeshType type);
+
+///	returns the mesh type for a name as returned by SyntheticMeshTypeName
+SyntheticMeshType SyntheticMeshTypeFromName(const std::string& name);
+
+
+///	parameters of a synthetic benchmark mesh
+struct SyntheticMeshParams
+{
+	SyntheticMeshParams() :
+		type(SMT_TETRAHEDRA), numCells(16), distortion(0.0),
+		sliverFraction(0.0), seed(1)	{}
+
+	SyntheticMeshType type;
+///	number of cubes in each direction of the unit cube
+	int numCells;
+///	inner vertices are moved randomly by up to distortion * h / 2 in each direction
+	number distortion;
+///	number of additional slivers relative to the number of volumes of the mesh
+	number sliverFraction;
+	unsigned int seed;
+};
+
+
+///	creates a structured volume mesh of the unit cube on level 0 of an empty grid
+/**	All elements of the mesh (including the sides generated by the grid) are assigned
+ *	to subset 0 ("inner"). The injected slivers are separate tetrahedra with almost
+ *	coplanar corners inside randomly chosen cubes. They are assigned to subset 1
+ *	("slivers"). The mesh doesn't have to be conforming for the quality evaluations,
+ *	e.g. the mixed mesh has quadrilaterals and triangles on the same cube sides.*/
+void CreateSyntheticMesh(MultiGrid& mg, MGSubsetHandler& sh, const SyntheticMeshParams& params);
+
+}
+#endif  //__SYNTHETIC_MESHES_H__
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+/*	Compares the batched tetrahedron kernels (see tet_kernels.h) with the lib_grid
+ *	functions CalculateVolume, CalculateMinAngle, CalculateMaxAngle, CalculateAngles,
+ *	CalculateAspectRatio and CalculateVolToRMSFaceAreaRatio.
+ *
+ *	Every kernel variant which is compiled in and supported by the CPU ("scalar",
+ *	"avx2", "avx512") is evaluated for all combinations of the volume metrics on
+ *	random tetrahedra and on a set of degenerate ones (slivers, caps, needles, wedges,
+ *	translated and scaled copies). The number of tetrahedra is no multiple of the SIMD
+ *	widths, so that the scalar remainders are covered, too. The tolerances are those
+ *	documented in tet_kernels.h. Usage:
+ *
+ *	tet_kernel_test [-num n] [-seed s] [-verbose]
+ *
+ *	Returns 0 if all kernels agree with lib_grid and 1 otherwise.*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ug.h"
+#include "common/log.h"
+#include "lib_grid/lib_grid.h"
+#include "lib_grid/algorithms/element_angles.h"
+#include "lib_grid/algorithms/element_aspect_ratios.h"
+#include "../quality_metrics.h"
+#include "../tet_kernels.h"
+
+using namespace std;
+using namespace ug;
+
+typedef Grid::VertexAttachmentAccessor<APosition> TestAAPos;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TetSet
+///	tetrahedra in the packed layout of the kernels and as lib_grid elements
+struct TetSet
+{
+	TetSet() : aaPos(grid, aPosition, true)	{}
+
+	void add(const vector3& p0, const vector3& p1, const vector3& p2, const vector3& p3)
+	{
+		const vector3* p[4] = {&p0, &p1, &p2, &p3};
+		Vertex* vrts[4];
+		for(int i = 0; i < 4; ++i)
+		{
+			vrts[i] = *grid.create<RegularVertex>();
+			aaPos[vrts[i]] = *p[i];
+			corners.push_back((int)x.size());
+			x.push_back(p[i]->x());
+			y.push_back(p[i]->y());
+			z.push_back(p[i]->z());
+		}
+		tets.push_back(*grid.create<Tetrahedron>(TetrahedronDescriptor(vrts[0], vrts[1],
+																		 vrts[2], vrts[3])));
+	}
+
+	size_t size() const		{return tets.size();}
+
+	Grid grid;
+	TestAAPos aaPos;
+	vector<number> x, y, z;
+	vector<int> corners;
+	vector<Tetrahedron*> tets;
+};
+
+
+///	reference values of one tetrahedron, evaluated by lib_grid
+struct TetReference
+{
+	number volume, minDihedral, maxDihedral, sumDihedral, m2Dihedral;
+	number aspectRatio, volToRMSFaceAreaRatio;
+///	scale of the volume, the cube of the longest edge
+	number volumeScale;
+///	tolerance of the dihedrals in degrees
+	number dihedralTol;
+};
+
+static TetReference EvaluateReference(TetSet& tets, size_t i)
+{
+	Grid& grid = tets.grid;
+	Tetrahedron* tet = tets.tets[i];
+
+	TetReference ref;
+	ref.volume = CalculateVolume(tet, tets.aaPos);
+	ref.minDihedral = CalculateMinAngle(grid, tet, tets.aaPos);
+	ref.maxDihedral = CalculateMaxAngle(grid, tet, tets.aaPos);
+	ref.aspectRatio = CalculateAspectRatio(grid, tet, tets.aaPos);
+	ref.volToRMSFaceAreaRatio = CalculateVolToRMSFaceAreaRatio(grid, tet, tets.aaPos);
+
+	vector<number> dihedrals;
+	CalculateAngles(dihedrals, grid, tet, tets.aaPos);
+	ref.sumDihedral = 0;
+	for(size_t j = 0; j < dihedrals.size(); ++j)
+		ref.sumDihedral += dihedrals[j];
+	ref.m2Dihedral = 0;
+	for(size_t j = 0; j < dihedrals.size(); ++j)
+		ref.m2Dihedral += (dihedrals[j] - ref.sumDihedral / 6.0) * (dihedrals[j] - ref.sumDihedral / 6.0);
+
+	number maxEdge = 0;
+	for(int a = 0; a < 4; ++a)
+		for(int b = a + 1; b < 4; ++b)
+			maxEdge = max(maxEdge, VecDistance(tets.aaPos[tet->vertex(a)],
+											   tets.aaPos[tet->vertex(b)]));
+	ref.volumeScale = maxEdge * maxEdge * maxEdge;
+
+//	arccos is ill-conditioned close to 0 and 180 degrees (see tet_kernels.h)
+	if(ref.minDihedral >= 1.0 && ref.maxDihedral <= 179.0)
+		ref.dihedralTol = 1e-10;
+	else
+		ref.dihedralTol = 1e-6;
+	return ref;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	test tetrahedra
+static vector3 Scaled(const vector3& p, number s, const vector3& offset)
+{
+	return vector3(p.x() * s + offset.x(), p.y() * s + offset.y(), p.z() * s + offset.z());
+}
+
+///	adds a tetrahedron together with a reflected, a translated and a scaled copy
+static void AddWithCopies(TetSet& tets, const vector3& p0, const vector3& p1,
+						  const vector3& p2, const vector3& p3)
+{
+	const vector3 zero(0, 0, 0);
+	tets.add(p0, p1, p2, p3);
+	tets.add(p1, p0, p2, p3);
+	tets.add(Scaled(p0, 1, vector3(1e3, -2e3, 5e2)), Scaled(p1, 1, vector3(1e3, -2e3, 5e2)),
+			 Scaled(p2, 1, vector3(1e3, -2e3, 5e2)), Scaled(p3, 1, vector3(1e3, -2e3, 5e2)));
+	tets.add(Scaled(p0, 1e-3, zero), Scaled(p1, 1e-3, zero),
+			 Scaled(p2, 1e-3, zero), Scaled(p3, 1e-3, zero));
+}
+
+static void AddDegenerateTetrahedra(TetSet& tets)
+{
+//	regular and right-angled tetrahedron
+	AddWithCopies(tets, vector3(1, 1, 1), vector3(1, -1, -1), vector3(-1, 1, -1), vector3(-1, -1, 1));
+	AddWithCopies(tets, vector3(0, 0, 0), vector3(1, 0, 0), vector3(0, 1, 0), vector3(0, 0, 1));
+
+	for(number eps = 1e-1; eps >= 1e-5; eps *= 0.1)
+	{
+	//	sliver: the corners of a square, two of them slightly lifted
+		AddWithCopies(tets, vector3(0, 0, 0), vector3(1, 0, eps), vector3(1, 1, 0), vector3(0, 1, eps));
+	//	cap: the fourth corner close to the center of the opposite face
+		AddWithCopies(tets, vector3(0, 0, 0), vector3(1, 0, 0), vector3(0.5, 1, 0),
+					  vector3(0.5, 0.4, eps));
+	//	needle: the fourth corner far away from a small face
+		AddWithCopies(tets, vector3(0, 0, 0), vector3(eps, 0, 0), vector3(0, eps, 0),
+					  vector3(0.3 * eps, 0.2 * eps, 1));
+	//	wedge: a short edge opposite to a long one
+		AddWithCopies(tets, vector3(0, 0, 0), vector3(1, 0, 0), vector3(0.5, 0.5, 1),
+					  vector3(0.5, 0.5 + eps, 1));
+	//	spindle: a long edge with the other corners close to its center
+		AddWithCopies(tets, vector3(0, 0, 0), vector3(1, 0, 0), vector3(0.5, eps, 0),
+					  vector3(0.5, 0, eps));
+	}
+}
+
+static void AddRandomTetrahedra(TetSet& tets, size_t num, unsigned int seed)
+{
+	mt19937 rng(seed);
+	uniform_real_distribution<number> coord(-1.0, 1.0);
+	vector3 p[4];
+	while(num > 0)
+	{
+		for(int i = 0; i < 4; ++i)
+			p[i] = vector3(coord(rng), coord(rng), coord(rng));
+
+	//	exactly flat tetrahedra have no defined dihedrals
+		if(fabs(CalculateTetrahedronVolume(p[0], p[1], p[2], p[3])) < 1e-12)
+			continue;
+
+		tets.add(p[0], p[1], p[2], p[3]);
+		--num;
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ErrorCounter
+///	deviation check of the kernel outputs, logs the first failures
+class ErrorCounter
+{
+	public:
+		ErrorCounter(bool verbose) : m_num(0), m_verbose(verbose)	{}
+
+		void check(const string& kernel, unsigned int metrics, const char* name, size_t tet,
+				   number val, number ref, number tol)
+		{
+			if(fabs(val - ref) <= tol)
+				return;
+			if(m_num < 20 || m_verbose)
+				UG_LOG("  " << kernel << ", metrics " << metrics << ", tet " << tet << ": "
+					   << name << " = " << val << ", lib_grid: " << ref
+					   << " (tolerance " << tol << ")" << endl);
+			++m_num;
+		}
+
+		size_t num() const	{return m_num;}
+
+	private:
+		size_t m_num;
+		bool m_verbose;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CompareKernel
+///	evaluates all metric combinations with one kernel and compares them to the references
+static void CompareKernel(const string& kernel, TetSet& tets, const vector<TetReference>& refs,
+						  ErrorCounter& errors)
+{
+	SetQualityTetKernel(kernel);
+
+	TetKernelResults res;
+	for(unsigned int metrics = 1; metrics <= QM_VOLUME_METRICS; ++metrics)
+	{
+		res.evaluate_selected(tets.x.data(), tets.y.data(), tets.z.data(), tets.corners.data(),
+							  tets.size(), metrics);
+
+		const bool bMinDihedral = (metrics & (QM_MIN_DIHEDRAL | QM_DIHEDRAL_DEVIATION)) != 0;
+		const bool bMaxDihedral = (metrics & (QM_MAX_DIHEDRAL | QM_DIHEDRAL_DEVIATION)) != 0;
+		const bool bSums = (metrics & QM_DIHEDRAL_DEVIATION) != 0;
+
+		for(size_t i = 0; i < tets.size(); ++i)
+		{
+			const TetReference& ref = refs[i];
+			const number tol = ref.dihedralTol;
+			const number relTol = 1e-10;
+
+			if(metrics & QM_VOLUME)
+				errors.check(kernel, metrics, "volume", i, res.volume[i], ref.volume,
+							 relTol * max(fabs(ref.volume), ref.volumeScale));
+			if(bMinDihedral)
+				errors.check(kernel, metrics, "min dihedral", i, res.minDihedral[i],
+							 ref.minDihedral, tol);
+			if(bMaxDihedral)
+				errors.check(kernel, metrics, "max dihedral", i, res.maxDihedral[i],
+							 ref.maxDihedral, tol);
+			if(bSums)
+			{
+				errors.check(kernel, metrics, "dihedral sum", i, res.sumDihedral[i],
+							 ref.sumDihedral, 6 * tol);
+			//	d/dd (d - mean)^2 is at most 2 * 180 in magnitude
+				errors.check(kernel, metrics, "dihedral m2", i, res.m2Dihedral[i],
+							 ref.m2Dihedral, 6 * 360 * tol + relTol * ref.m2Dihedral);
+			}
+			if(metrics & QM_ASPECT_RATIO)
+				errors.check(kernel, metrics, "aspect ratio", i, res.aspectRatio[i],
+							 ref.aspectRatio, relTol * max(fabs(ref.aspectRatio), (number)1.0));
+			if(metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+				errors.check(kernel, metrics, "vol to rms face area ratio", i,
+							 res.volToRMSFaceAreaRatio[i], ref.volToRMSFaceAreaRatio,
+							 relTol * max(fabs(ref.volToRMSFaceAreaRatio), (number)1.0));
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	main
+static const char* ArgValue(int argc, char** argv, int& i)
+{
+	UG_COND_THROW(i + 1 >= argc, "Missing value of argument " << argv[i]);
+	return argv[++i];
+}
+
+int main(int argc, char** argv)
+{
+	UGInit(&argc, &argv);
+
+	int retVal = 0;
+	try
+	{
+	//	no multiple of 4 or 8, so that the kernels evaluate remainders
+		size_t numRandom = 10003;
+		unsigned int seed = 1;
+		bool verbose = false;
+
+		for(int i = 1; i < argc; ++i)
+		{
+			if(strcmp(argv[i], "-num") == 0)			numRandom = atoi(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-seed") == 0)		seed = atoi(ArgValue(argc, argv, i));
+			else if(strcmp(argv[i], "-verbose") == 0)	verbose = true;
+			else UG_THROW("Unknown argument " << argv[i]);
+		}
+
+		TetSet tets;
+		AddDegenerateTetrahedra(tets);
+		AddRandomTetrahedra(tets, numRandom, seed);
+
+		vector<TetReference> refs(tets.size());
+		for(size_t i = 0; i < tets.size(); ++i)
+			refs[i] = EvaluateReference(tets, i);
+
+		const char* kernels[] = {"scalar", "avx2", "avx512"};
+		const string initialKernel = GetQualityTetKernel();
+		size_t numTested = 0;
+		ErrorCounter errors(verbose);
+
+		for(size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+		{
+			try{
+				SetQualityTetKernel(kernels[k]);
+			}
+			catch(UGError& err)
+			{
+				UG_LOG(kernels[k] << ": skipped, " << err.get_msg() << endl);
+				continue;
+			}
+
+			size_t numErrorsBefore = errors.num();
+			CompareKernel(kernels[k], tets, refs, errors);
+			UG_LOG(kernels[k] << ": " << tets.size() << " tetrahedra, "
+				   << errors.num() - numErrorsBefore << " deviations" << endl);
+			++numTested;
+		}
+		SetQualityTetKernel(initialKernel);
+
+		UG_COND_THROW(numTested == 0, "No tetrahedron kernel available.");
+		if(errors.num() > 0)
+		{
+			UG_LOG("FAILED: " << errors.num() << " deviations from lib_grid" << endl);
+			retVal = 1;
+		}
+		else
+			UG_LOG("PASSED" << endl);
+	}
+	catch(UGError& err)
+	{
+		UG_LOG("ERROR in tet_kernel_test: " << err.get_msg() << endl);
+		retVal = 1;
+	}
+
+	UGFinalize();
+	return retVal;
+}
@@ -31,7 +31,12 @@
  */
 
 
+#include <limits>
+
 #include "elem_stat_util.h"
+#include "element_quality_kernels.h"
+#include "quality_threading.h"
+#include "common/util/table.h"
 
 
 namespace ug
@@ -43,32 +48,25 @@ namespace ug
 number CalculateSubsetSurfaceArea(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh)
 {
 	Grid::VertexAttachmentAccessor<APosition> aaPos(mg, aPosition);
-	number subsetSurfaceArea = 0.0;
-
-	DistributedGridManager* dgm = mg.distributed_grid_manager();
-	for(FaceIterator fIter = sh.begin<Face>(subsetIndex, 0); fIter != sh.end<Face>(subsetIndex, 0); ++fIter)
-	{
-		Face* f = *fIter;
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical slaves) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-				continue;
-		#endif
-		subsetSurfaceArea += FaceArea(f, aaPos);
-	}
-
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the volumes of all involved processes. Since we ignored ghosts,
-		//	each process contributes the volume of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			subsetSurfaceArea = pc.allreduce(subsetSurfaceArea, PCL_RO_SUM);
-		}
-	#endif
 
-	return subsetSurfaceArea;
+//	ghosts and horizontal slaves are skipped by ElementsByType, since they have a
+//	copy on another process and since we already consider that copy...
+	GridObjectCollection goc = sh.get_grid_objects_in_subset(subsetIndex);
+	ElementsByType<Face> faces;
+	faces.collect(mg, goc, 0);
+
+//	only the areas are evaluated, the sum is part of the packed reduction
+	ElementQualityData data;
+	data.metrics = 0;
+	AccumulateElementQualityInChunks(data, faces.size(), NumQualityThreadsFor(faces.size()),
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{
+			for(size_t i = from; i < to; ++i)
+				d.add_face_area(FaceArea(faces[i], aaPos));
+		});
+
+	ReduceElementQualityData(data);
+	return data.totalFaceArea;
 }
 
 
@@ -77,235 +75,237 @@ number CalculateSubsetSurfaceArea(MultiGrid& mg, int subsetIndex, MGSubsetHandle
 number CalculateSubsetVolume(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh)
 {
 	Grid::VertexAttachmentAccessor<APosition> aaPos(mg, aPosition);
-	number subsetVolume = 0.0;
 
-	DistributedGridManager* dgm = mg.distributed_grid_manager();//NULL if not parallel
-	for(VolumeIterator vIter = sh.begin<Volume>(subsetIndex, 0); vIter != sh.end<Volume>(subsetIndex, 0); ++vIter)
-	{
-		Volume* v = *vIter;
-		#ifdef UG_PARALLEL
-		//	ghosts have to be ignored, since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(v))
-				continue;
-		#endif
-		subsetVolume += CalculateVolume(v, aaPos);
-	}
+	GridObjectCollection goc = sh.get_grid_objects_in_subset(subsetIndex);
+	ElementsByType<Volume> vols;
+	vols.collect(mg, goc, 0);
 
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the volumes of all involved processes. Since we ignored ghosts,
-		//	each process contributes the volume of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			subsetVolume = pc.allreduce(subsetVolume, PCL_RO_SUM);
-		}
-	#endif
+//	the volume kernels of the quality statistics, restricted to the volumes
+	ElementQualityData data;
+	data.metrics = QM_VOLUME;
+	AccumulateElementQualityInChunks(data, vols.size(), NumQualityThreadsFor(vols.size()),
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{AccumulateVolumeQuality(d, mg, vols, from, to, aaPos);});
 
-	return subsetVolume;
+	ReduceElementQualityData(data);
+	return data.totalVolume;
 }
 
 
-number CountNumberOfEdgesInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh){
-	number totalEdges = 0;
+////////////////////////////////////////////////////////////////////////////////////////////
+//	EdgeStatistics
+EdgeStatistics::
+EdgeStatistics(int binsPerOctave) :
+	m_sum(0.0),
+	m_moments(true)
+{
+	UG_COND_THROW(binsPerOctave < 1, "EdgeStatistics: binsPerOctave has to be positive.");
 
-	Grid::VertexAttachmentAccessor<APosition> aaPos(mg, aPosition);
-	DistributedGridManager* dgm = mg.distributed_grid_manager();
+//	lengths from 2^-64 to 2^64
+	m_logHist.init(-64.0, 1.0 / (number)binsPerOctave, 128 * binsPerOctave);
+}
 
-	for(EdgeIterator fIter = sh.begin<Edge>(subsetIndex, mg.top_level()); fIter != sh.end<Edge>(subsetIndex, mg.top_level()); ++fIter)
-	{
-		Edge* f = *fIter;
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical slaves) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-				continue;
-		#endif
-		totalEdges++;
-	
-	}
+void EdgeStatistics::
+merge(const EdgeStatistics& stats)
+{
+	m_sum += stats.m_sum;
+	m_moments.merge(stats.m_moments);
+	m_logHist.merge(stats.m_logHist);
+}
 
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the volumes of all involved processes. Since we ignored ghosts,
-		//	each process contributes the volume of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			totalEdges = pc.allreduce(totalEdges, PCL_RO_SUM);
-		}
-	#endif
+void EdgeStatistics::
+clear()
+{
+	m_sum = 0.0;
+	m_moments.clear();
+	m_logHist.clear();
+}
 
+void EdgeStatistics::
+pack(vector<number>& sums, vector<number>& mins) const
+{
+	sums.push_back(m_sum);
+	m_logHist.pack(sums, mins);
+}
 
-	return totalEdges;
+void EdgeStatistics::
+unpack(const vector<number>& sums, size_t& sumOffset,
+	   const vector<number>& mins, size_t& minOffset)
+{
+	m_sum = sums[sumOffset++];
+	m_logHist.unpack(sums, sumOffset, mins, minOffset);
 }
 
-//compute total edges only once...
-number ComputeTotalEdgeLengthInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh){
-	number totalLength = 0;
+number EdgeStatistics::
+mean() const
+{
+	return m_moments.mean;
+}
 
-	Grid::VertexAttachmentAccessor<APosition2> aaPos(mg, aPosition2);
+number EdgeStatistics::
+min() const
+{
+	if(m_moments.empty()) return 0.0;
+	return m_moments.min;
+}
 
+number EdgeStatistics::
+max() const
+{
+	if(m_moments.empty()) return 0.0;
+	return m_moments.max;
+}
 
-	DistributedGridManager* dgm = mg.distributed_grid_manager();
+number EdgeStatistics::
+variance() const
+{
+	return m_moments.variance();
+}
 
-	for(ConstEdgeIterator fIter = sh.begin<Edge>(subsetIndex, mg.top_level()); fIter != sh.end<Edge>(subsetIndex, mg.top_level()); ++fIter)
-	{
-		Edge* f = *fIter;
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical slaves) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-				continue;
-		#endif
-		totalLength += EdgeLength(*fIter,aaPos);
-	
-	}
+number EdgeStatistics::
+standard_deviation() const
+{
+	return m_moments.standard_deviation();
+}
 
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the volumes of all involved processes. Since we ignored ghosts,
-		//	each process contributes the volume of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			totalLength = pc.allreduce(totalLength, PCL_RO_SUM);
-		}
-	#endif
+size_t EdgeStatistics::
+first_histogram_bin() const
+{
+	for(size_t i = 0; i < m_logHist.num_bins(); ++i)
+		if(m_logHist.count(i) > 0)
+			return i;
+	return 0;
+}
 
+size_t EdgeStatistics::
+num_histogram_bins() const
+{
+	if(m_logHist.num_binned() == 0) return 0;
 
-	return totalLength;
+	size_t last = m_logHist.num_bins() - 1;
+	while(m_logHist.count(last) == 0)
+		--last;
+
+	return last + 1 - first_histogram_bin();
 }
 
-//compute total edges only once...
-number ComputeAverageEdgeLengthInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh, number totalEdges){
-	number averageLength = 0;
+number EdgeStatistics::
+histogram_bin_lower(size_t i) const
+{
+	return pow(2.0, m_logHist.bin_lower(first_histogram_bin() + i));
+}
 
-	Grid::VertexAttachmentAccessor<APosition2> aaPos(mg, aPosition2);
+number EdgeStatistics::
+histogram_bin_upper(size_t i) const
+{
+	return pow(2.0, m_logHist.bin_upper(first_histogram_bin() + i));
+}
 
-	DistributedGridManager* dgm = mg.distributed_grid_manager();
+size_t EdgeStatistics::
+histogram_count(size_t i) const
+{
+	return m_logHist.count(first_histogram_bin() + i);
+}
 
-	for(EdgeIterator fIter = sh.begin<Edge>(subsetIndex, mg.top_level()); fIter != sh.end<Edge>(subsetIndex, mg.top_level()); ++fIter)
+void EdgeStatistics::
+print() const
+{
+	ug::Table<std::stringstream> table(3, 4);
+	table(0, 0) << "Number of edges";	table(0, 1) << count();
+	table(0, 2) << "Total length";		table(0, 3) << sum();
+	table(1, 0) << "Shortest edge";		table(1, 1) << min();
+	table(1, 2) << "Longest edge";		table(1, 3) << max();
+	table(2, 0) << "Mean length";		table(2, 1) << mean();
+	table(2, 2) << "Std. deviation";	table(2, 3) << standard_deviation();
+	UG_LOG(table);
+
+	if(num_histogram_bins() == 0)
+		return;
+
+	ug::Table<std::stringstream> histTable(num_histogram_bins() + 1, 2);
+	histTable(0, 0) << "Edge length";	histTable(0, 1) << "Number of edges";
+	for(size_t i = 0; i < num_histogram_bins(); ++i)
 	{
-		number currentLength = 0.0;
-		Edge* f = *fIter;
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical slaves) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-				continue;
-		#endif
-		currentLength = EdgeLength(*fIter,aaPos);
-		averageLength +=currentLength;
-	
+		histTable(i + 1, 0) << "[" << histogram_bin_lower(i) << ", " << histogram_bin_upper(i) << ")";
+		histTable(i + 1, 1) << histogram_count(i);
 	}
-
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the volumes of all involved processes. Since we ignored ghosts,
-		//	each process contributes the volume of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			averageLength = pc.allreduce(averageLength, PCL_RO_SUM);
-		}
-	#endif
-
-
-	return averageLength/totalEdges;
+	UG_LOG(endl << histTable);
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeEdgeStatisticsInSubset
+template <class TAAPosVRT>
+static void AccumulateEdgeStatisticsInSubset(ElementQualityData& data, MultiGrid& mg,
+											 int subsetIndex, MGSubsetHandler& sh,
+											 TAAPosVRT& aaPos)
+{
+	vector<Edge*> edges;
+	CollectElementPointers(edges, sh.begin<Edge>(subsetIndex, mg.top_level()),
+						   sh.end<Edge>(subsetIndex, mg.top_level()),
+						   sh.num<Edge>(subsetIndex, mg.top_level()));
+
+//	AccumulateEdgeQuality ignores ghosts and horizontal slaves
+	typedef vector<Edge*>::iterator EdgeIter;
+	AccumulateElementQualityThreaded(data, edges, NumQualityThreadsFor(edges.size()),
+		[&](ElementQualityData& d, EdgeIter begin, EdgeIter end)
+		{AccumulateEdgeQuality(d, mg, begin, end, aaPos);});
+}
 
-number ComputeLongestEdgeInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh){
-	Grid::VertexAttachmentAccessor<APosition2> aaPos(mg, aPosition2);
-	DistributedGridManager* dgm = mg.distributed_grid_manager();
-
-	number longest_length = -1.0;
+SmartPtr<EdgeStatistics> ComputeEdgeStatisticsInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh,
+													   int binsPerOctave)
+{
+//	only the edges are evaluated, the statistics are part of the packed reduction
+	ElementQualityData data;
+	data.metrics = 0;
+	data.edgeStatistics = EdgeStatistics(binsPerOctave);
 
-	for(EdgeIterator fIter = sh.begin<Edge>(subsetIndex, mg.top_level()); fIter != sh.end<Edge>(subsetIndex, mg.top_level()); ++fIter)
+	if(mg.has_vertex_attachment(aPosition))
 	{
-		number currentLength = 0.0;
-		Edge* f = *fIter;
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical slaves) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-				continue;
-		#endif
-
-		currentLength = EdgeLengthSq(*fIter,aaPos);
-		if(currentLength > longest_length){
-			longest_length = currentLength;
-		}
-		
-	
+		Grid::VertexAttachmentAccessor<APosition> aaPos(mg, aPosition);
+		AccumulateEdgeStatisticsInSubset(data, mg, subsetIndex, sh, aaPos);
 	}
+	else if(mg.has_vertex_attachment(aPosition2))
+	{
+		Grid::VertexAttachmentAccessor<APosition2> aaPos(mg, aPosition2);
+		AccumulateEdgeStatisticsInSubset(data, mg, subsetIndex, sh, aaPos);
+	}
+	else
+		UG_THROW("ComputeEdgeStatisticsInSubset: No position attachment (aPosition or aPosition2) found.");
 
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the volumes of all involved processes. Since we ignored ghosts,
-		//	each process contributes the volume of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			longest_length = pc.allreduce(longest_length, PCL_RO_MAX);
-		}
-	#endif
+	ReduceElementQualityData(data);
+	return make_sp(new EdgeStatistics(data.edgeStatistics));
+}
 
-	return longest_length;
+SmartPtr<EdgeStatistics> ComputeEdgeStatisticsInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh)
+{
+	return ComputeEdgeStatisticsInSubset(mg, subsetIndex, sh, 4);
 }
-number ComputeShortestEdgeInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh){
-	Grid::VertexAttachmentAccessor<APosition2> aaPos(mg, aPosition2);
-	DistributedGridManager* dgm = mg.distributed_grid_manager();
-
-	number shortest_length = 1.0;
-
-	//std::cout<<"The initial edge length "<<EdgeLengthSq(*fIter);
-	//#ifdef UG_PARALLEL
-	//	//	ghosts (vertical slaves) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-	//	//	since they have a copy on another process and
-	//	//	since we already consider that copy...
-	//		if(dgm->is_ghost(pInitialedge) || dgm->contains_status(pInitialedge, ES_H_SLAVE))
-	//		{
-//
-	//		}
-	//		else{
-	//			shortest_length =  EdgeLengthSq(*fIter, aaPos);
-	//		}
-	//#endif
-
-	//shortest_length =  EdgeLengthSq(*fIter, aaPos);
-
-	for(EdgeIterator fIter = sh.begin<Edge>(subsetIndex, mg.top_level()); fIter != sh.end<Edge>(subsetIndex, mg.top_level()); ++fIter)
-	{
-		number currentLength = 0.0;
-		Edge* f = *fIter;
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical slaves) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-				continue;
-		#endif
-
-		currentLength = EdgeLengthSq(*fIter,aaPos);
-		if(currentLength < shortest_length){
-			shortest_length = currentLength;
-		}
-		
-	
-	}
 
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the volumes of all involved processes. Since we ignored ghosts,
-		//	each process contributes the volume of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			shortest_length = pc.allreduce(shortest_length, PCL_RO_MIN);
-		}
-	#endif
 
-	return shortest_length;
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Single edge measures
+//	(kept for existing scripts, each one runs ComputeEdgeStatisticsInSubset. Scripts
+//	which need several of them should call that once instead.)
+number CountNumberOfEdgesInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh){
+	return (number)ComputeEdgeStatisticsInSubset(mg, subsetIndex, sh)->count();
+}
+
+number ComputeTotalEdgeLengthInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh){
+	return ComputeEdgeStatisticsInSubset(mg, subsetIndex, sh)->sum();
 }
 
+number ComputeAverageEdgeLengthInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh, number totalEdges){
+	return ComputeEdgeStatisticsInSubset(mg, subsetIndex, sh)->sum() / totalEdges;
+}
 
+number ComputeLongestEdgeInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh){
+	return ComputeEdgeStatisticsInSubset(mg, subsetIndex, sh)->max();
+}
 
+number ComputeShortestEdgeInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh){
+	return ComputeEdgeStatisticsInSubset(mg, subsetIndex, sh)->min();
+}
 
 
 }
@@ -51,6 +51,9 @@
 
 #include "lib_grid/lib_grid.h"
 #include "lib_grid/algorithms/geom_obj_util/edge_util.h"
+#include "common/util/smart_pointer.h"
+#include "quality_accumulators.h"
+#include "quality_histogram.h"
 
 using namespace std;
 
@@ -66,6 +69,87 @@ number CalculateSubsetSurfaceArea(MultiGrid& mg, int subsetIndex, MGSubsetHandle
 //	CalculateSubsetVolume
 number CalculateSubsetVolume(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh);
 
+////////////////////////////////////////////////////////////////////////////////////////////
+//	EdgeStatistics
+///	Length statistics of the top level edges of a subset
+/**	Part of ElementQualityData, so that it is gathered in the same traversal as the
+ *	other edge measures and summed up over all processes in the packed reduction of
+ *	ReduceElementQualityData (see ComputeEdgeStatisticsInSubset). The length histogram has
+ *	logarithmic bins, 'binsPerOctave' per power of two. Only the bins between the
+ *	shortest and the longest edge are exposed. Edges of zero length are counted,
+ *	but are not contained in any bin.*/
+class EdgeStatistics
+{
+	public:
+		EdgeStatistics(int binsPerOctave = 4);
+
+	///	adds the length of one edge
+		void add(number length)
+		{
+			m_sum += length;
+			m_moments.add(length);
+			m_logHist.add(log2(length));
+		}
+
+	///	adds the statistics of another part of the same subset (e.g. of another thread)
+		void merge(const EdgeStatistics& stats);
+
+	///	removes all lengths, the histogram bins are kept
+		void clear();
+
+	///	appends the values to be summed up and to be minimized over all processes
+	/**	Used by ReduceElementQualityData, the moments are reduced separately.*/
+		void pack(vector<number>& sums, vector<number>& mins) const;
+
+	///	reads the reduced values in the order of pack, advancing the offsets
+		void unpack(const vector<number>& sums, size_t& sumOffset,
+					const vector<number>& mins, size_t& minOffset);
+
+	///	count, mean, variance and extremal lengths
+		MomentAccumulator& moments()	{return m_moments;}
+
+		size_t count() const			{return m_moments.num;}
+		number sum() const				{return m_sum;}
+		number mean() const;
+		number min() const;
+		number max() const;
+
+	///	population variance of the edge lengths
+		number variance() const;
+		number standard_deviation() const;
+
+	///	number of histogram bins from the one of the shortest to the one of the longest edge
+		size_t num_histogram_bins() const;
+		number histogram_bin_lower(size_t i) const;
+		number histogram_bin_upper(size_t i) const;
+		size_t histogram_count(size_t i) const;
+
+	///	logs the statistics and the histogram
+		void print() const;
+
+	protected:
+	///	index of the first exposed bin in m_logHist
+		size_t first_histogram_bin() const;
+
+	protected:
+		number m_sum;
+
+	///	count, mean, variance and extremal lengths
+		MomentAccumulator m_moments;
+
+	///	histogram of log2(length)
+		QualityHistogram m_logHist;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeEdgeStatisticsInSubset
+///	computes the EdgeStatistics of the top level edges of a subset (collective)
+/**	Ghosts and horizontal slaves are ignored, so that each edge is counted once.
+ *	3d positions (aPosition) are used if attached, else 2d positions (aPosition2).*/
+SmartPtr<EdgeStatistics> ComputeEdgeStatisticsInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh);
+SmartPtr<EdgeStatistics> ComputeEdgeStatisticsInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh, int binsPerOctave);
+
 number CountNumberOfEdgesInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh);
 number ComputeTotalEdgeLengthInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh);
 number ComputeAverageEdgeLengthInSubset(MultiGrid& mg, int subsetIndex, MGSubsetHandler& sh, number totalEdges);
@@ -0,0 +1,572 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "element_quality_cache.h"
+#include "element_quality_statistics.h"
+#include "quality_threading.h"
+#include "common/util/table.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+static const char* s_qualityCacheMeasureNames[NUM_QUALITY_CACHE_MEASURES] =
+{
+	"face_area", "face_min_angle", "face_max_angle", "face_aspect_ratio",
+	"volume", "volume_min_dihedral", "volume_max_dihedral", "volume_aspect_ratio",
+	"tet_vol_to_rms_face_area_ratio"
+};
+
+static const size_t NUM_FACE_MEASURES = QCM_FACE_ASPECT_RATIO + 1;
+static const size_t NUM_VOLUME_MEASURES = NUM_QUALITY_CACHE_MEASURES - QCM_VOLUME;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	position helpers (the last positions are always stored as vector3)
+static inline bool PositionChanged(const vector3& last, const vector3& p)
+{
+	return last.x() != p.x() || last.y() != p.y() || last.z() != p.z();
+}
+
+static inline bool PositionChanged(const vector3& last, const vector2& p)
+{
+	return last.x() != p.x() || last.y() != p.y();
+}
+
+static inline void StorePosition(vector3& last, const vector3& p)
+{
+	last = p;
+}
+
+static inline void StorePosition(vector3& last, const vector2& p)
+{
+	last.x() = p.x();
+	last.y() = p.y();
+	last.z() = 0.0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ElementQualityCache
+ElementQualityCache::ElementQualityCache(Grid& grid, int dim) :
+	m_grid(grid),
+	m_lvl(0)
+{
+	init(dim);
+}
+
+ElementQualityCache::ElementQualityCache(MultiGrid& mg, int dim, int lvl) :
+	m_grid(mg),
+	m_lvl(lvl)
+{
+	init(dim);
+}
+
+ElementQualityCache::~ElementQualityCache()
+{
+	m_grid.detach_from_faces(m_aSlot);
+	m_grid.detach_from_volumes(m_aSlot);
+	m_grid.detach_from_vertices(m_aLastPos);
+}
+
+void ElementQualityCache::init(int dim)
+{
+	UG_COND_THROW(dim != 2 && dim != 3, "ElementQualityCache: Only dimensions 2 or 3 supported.");
+	UG_COND_THROW(m_lvl < 0, "ElementQualityCache: invalid level " << m_lvl << ".");
+
+	m_dim = dim;
+	m_bValid = false;
+	m_numLevelFaces = 0;
+	m_numLevelVols = 0;
+
+	m_grid.attach_to_faces_dv(m_aSlot, -1);
+	m_grid.attach_to_volumes_dv(m_aSlot, -1);
+	m_grid.attach_to_vertices(m_aLastPos);
+	m_aaFaceSlot.access(m_grid, m_aSlot);
+	m_aaVolSlot.access(m_grid, m_aSlot);
+	m_aaLastPos.access(m_grid, m_aLastPos);
+
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+		m_measures[i].bVolume = (i >= QCM_VOLUME);
+
+	m_measures[QCM_FACE_MIN_ANGLE].bAngle = true;
+	m_measures[QCM_FACE_MAX_ANGLE].bAngle = true;
+	m_measures[QCM_VOLUME_MIN_DIHEDRAL].bAngle = true;
+	m_measures[QCM_VOLUME_MAX_DIHEDRAL].bAngle = true;
+
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+		m_measures[i].bHistogram = (i != QCM_FACE_AREA && i != QCM_VOLUME);
+
+	set_histogram_step_sizes(10.0, 0.1);
+}
+
+void ElementQualityCache::set_histogram_step_sizes(number angleStepSize, number aspectRatioStepSize)
+{
+	m_angleStepSize = angleStepSize;
+	m_aspectRatioStepSize = aspectRatioStepSize;
+
+	size_t numAngleBins = floor(180.0/angleStepSize);
+	size_t numRatioBins = floor(1.0/aspectRatioStepSize);
+
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+	{
+		Measure& m = m_measures[i];
+		if(!m.bHistogram)
+			continue;
+		if(m.bAngle)
+			m.hist.init(0.0, angleStepSize, numAngleBins);
+		else
+			m.hist.init(0.0, aspectRatioStepSize, numRatioBins);
+	}
+
+	m_bValid = false;
+}
+
+size_t ElementQualityCache::update()
+{
+	GridObjectCollection goc = m_grid.get_grid_objects();
+	UG_COND_THROW(m_lvl >= (int)goc.num_levels(),
+				  "ElementQualityCache: level " << m_lvl << " does not exist.");
+
+//	a changed number of elements means that the topology changed
+	if(goc.num<Face>(m_lvl) != m_numLevelFaces || goc.num<Volume>(m_lvl) != m_numLevelVols)
+		m_bValid = false;
+
+	vector<size_t> faceSlots, volSlots;
+
+	if(m_dim == 2)
+	{
+		Grid::VertexAttachmentAccessor<APosition2> aaPos(m_grid, aPosition2);
+		if(m_bValid)
+			collect_dirty(goc, aaPos, faceSlots, volSlots);
+		else
+			rebuild(goc, aaPos);
+	}
+	else
+	{
+		Grid::VertexAttachmentAccessor<APosition> aaPos(m_grid, aPosition);
+		if(m_bValid)
+			collect_dirty(goc, aaPos, faceSlots, volSlots);
+		else
+			rebuild(goc, aaPos);
+	}
+
+	if(!m_bValid)
+	{
+		faceSlots.resize(m_faces.size());
+		for(size_t i = 0; i < faceSlots.size(); ++i)
+			faceSlots[i] = i;
+		volSlots.resize(m_vols.size());
+		for(size_t i = 0; i < volSlots.size(); ++i)
+			volSlots[i] = i;
+	}
+
+	if(m_dim == 2)
+	{
+		Grid::VertexAttachmentAccessor<APosition2> aaPos(m_grid, aPosition2);
+		evaluate(aaPos, faceSlots, volSlots);
+	}
+	else
+	{
+		Grid::VertexAttachmentAccessor<APosition> aaPos(m_grid, aPosition);
+		evaluate(aaPos, faceSlots, volSlots);
+	}
+
+	m_bValid = true;
+	reduce();
+
+	return faceSlots.size() + volSlots.size();
+}
+
+template <class TAAPosVRT>
+void ElementQualityCache::rebuild(GridObjectCollection& goc, TAAPosVRT& aaPos)
+{
+	DistributedGridManager* dgm = m_grid.distributed_grid_manager();
+
+//	reset the slots of all elements of the level. The previously cached element
+//	lists must not be used here, since they may contain erased elements.
+	for(FaceIterator iter = goc.begin<Face>(m_lvl); iter != goc.end<Face>(m_lvl); ++iter)
+		m_aaFaceSlot[*iter] = -1;
+	if(m_dim == 3)
+	{
+		for(VolumeIterator iter = goc.begin<Volume>(m_lvl); iter != goc.end<Volume>(m_lvl); ++iter)
+			m_aaVolSlot[*iter] = -1;
+	}
+	m_faces.clear();
+	m_vols.clear();
+
+	for(FaceIterator iter = goc.begin<Face>(m_lvl); iter != goc.end<Face>(m_lvl); ++iter)
+	{
+		#ifdef UG_PARALLEL
+		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored
+			if(dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE))
+				continue;
+		#endif
+		m_aaFaceSlot[*iter] = (int)m_faces.size();
+		m_faces.push_back(*iter);
+	}
+
+	if(m_dim == 3)
+	{
+	//	the slots of the volumes follow their type sections (ghosts are skipped)
+		m_vols.collect(m_grid, goc, m_lvl);
+		for(size_t i = 0; i < m_vols.size(); ++i)
+			m_aaVolSlot[m_vols[i]] = (int)i;
+	}
+
+	for(VertexIterator iter = goc.begin<Vertex>(m_lvl); iter != goc.end<Vertex>(m_lvl); ++iter)
+		StorePosition(m_aaLastPos[*iter], aaPos[*iter]);
+
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+	{
+		Measure& m = m_measures[i];
+		size_t numSlots = m.bVolume ? m_vols.size() : m_faces.size();
+		m.values.assign(numSlots, numeric_limits<number>::quiet_NaN());
+		m.tree.resize(numSlots);
+		m.hist.clear();
+	}
+
+	m_numLevelFaces = goc.num<Face>(m_lvl);
+	m_numLevelVols = goc.num<Volume>(m_lvl);
+}
+
+template <class TAAPosVRT>
+void ElementQualityCache::collect_dirty(GridObjectCollection& goc, TAAPosVRT& aaPos,
+										vector<size_t>& faceSlotsOut,
+										vector<size_t>& volSlotsOut)
+{
+	vector<Face*> faces;
+	vector<Volume*> vols;
+
+	m_grid.begin_marking();
+	for(VertexIterator iter = goc.begin<Vertex>(m_lvl); iter != goc.end<Vertex>(m_lvl); ++iter)
+	{
+		Vertex* vrt = *iter;
+		if(!PositionChanged(m_aaLastPos[vrt], aaPos[vrt]))
+			continue;
+
+		StorePosition(m_aaLastPos[vrt], aaPos[vrt]);
+
+	//	each element is collected once, even if several of its corners moved
+		CollectAssociated(faces, m_grid, vrt);
+		for(size_t i = 0; i < faces.size(); ++i)
+		{
+			int slot = m_aaFaceSlot[faces[i]];
+			if(slot >= 0 && !m_grid.is_marked(faces[i])){
+				m_grid.mark(faces[i]);
+				faceSlotsOut.push_back((size_t)slot);
+			}
+		}
+
+		if(m_dim == 3)
+		{
+			CollectAssociated(vols, m_grid, vrt);
+			for(size_t i = 0; i < vols.size(); ++i)
+			{
+				int slot = m_aaVolSlot[vols[i]];
+				if(slot >= 0 && !m_grid.is_marked(vols[i])){
+					m_grid.mark(vols[i]);
+					volSlotsOut.push_back((size_t)slot);
+				}
+			}
+		}
+	}
+	m_grid.end_marking();
+}
+
+template <class TAAPosVRT>
+void ElementQualityCache::evaluate(TAAPosVRT& aaPos, const vector<size_t>& faceSlots,
+								   const vector<size_t>& volSlots)
+{
+	const number nan = numeric_limits<number>::quiet_NaN();
+
+//	the elements are evaluated in parallel, the values are stored afterwards
+	vector<number> faceVals(faceSlots.size() * NUM_FACE_MEASURES);
+	ParallelForChunks(faceSlots.size(), NumQualityThreadsFor(faceSlots.size()),
+		[&](size_t, size_t from, size_t to)
+		{
+			vector<number> vAngles;
+			for(size_t i = from; i < to; ++i)
+			{
+				Face* f = m_faces[faceSlots[i]];
+				number* vals = &faceVals[i * NUM_FACE_MEASURES];
+
+				vAngles.clear();
+				CalculateAngles(vAngles, m_grid, f, aaPos);
+
+				vals[QCM_FACE_AREA] = FaceArea(f, aaPos);
+				vals[QCM_FACE_MIN_ANGLE] = vAngles.empty() ? nan : *min_element(vAngles.begin(), vAngles.end());
+				vals[QCM_FACE_MAX_ANGLE] = vAngles.empty() ? nan : *max_element(vAngles.begin(), vAngles.end());
+				vals[QCM_FACE_ASPECT_RATIO] = CalculateAspectRatio(m_grid, f, aaPos);
+			}
+		});
+
+//	the volume slots follow the type sections, so that the sorted slots of the
+//	tetrahedra form the range [tetFrom, tetTo), which is evaluated by the tetrahedron kernels
+	vector<size_t> sortedVolSlots(volSlots);
+	sort(sortedVolSlots.begin(), sortedVolSlots.end());
+	const size_t tetFrom = lower_bound(sortedVolSlots.begin(), sortedVolSlots.end(),
+									   m_vols.begin(ROID_TETRAHEDRON)) - sortedVolSlots.begin();
+	const size_t tetTo = lower_bound(sortedVolSlots.begin(), sortedVolSlots.end(),
+									 m_vols.end(ROID_TETRAHEDRON)) - sortedVolSlots.begin();
+
+	vector<number> volVals(sortedVolSlots.size() * NUM_VOLUME_MEASURES);
+
+	auto evaluateVolumes = [&](size_t from, size_t to)
+	{
+		vector<number> vDihedrals;
+		for(size_t i = from; i < to; ++i)
+		{
+			Volume* vol = m_vols[sortedVolSlots[i]];
+			number* vals = &volVals[i * NUM_VOLUME_MEASURES];
+
+			vDihedrals.clear();
+			CalculateAngles(vDihedrals, m_grid, vol, aaPos);
+
+			vals[QCM_VOLUME - QCM_VOLUME] = CalculateVolume(vol, aaPos);
+			vals[QCM_VOLUME_MIN_DIHEDRAL - QCM_VOLUME] = vDihedrals.empty() ? nan : *min_element(vDihedrals.begin(), vDihedrals.end());
+			vals[QCM_VOLUME_MAX_DIHEDRAL - QCM_VOLUME] = vDihedrals.empty() ? nan : *max_element(vDihedrals.begin(), vDihedrals.end());
+			vals[QCM_VOLUME_ASPECT_RATIO - QCM_VOLUME] = ElementAspectRatio(m_grid, vol, aaPos);
+			vals[QCM_TET_VOL_TO_RMS_FACE_AREA_RATIO - QCM_VOLUME] = nan;
+		}
+	};
+
+	auto evaluateTetrahedra = [&](size_t from, size_t to)
+	{
+		TetBatch batch;
+		size_t first = from;
+		for(size_t i = from; i < to; ++i)
+		{
+			batch.push_back(m_vols[sortedVolSlots[i]], aaPos);
+			if(batch.full() || i + 1 == to)
+			{
+				const TetKernelResults& res = batch.evaluate(false);
+				for(size_t j = 0; j < res.num; ++j)
+				{
+					number* vals = &volVals[(first + j) * NUM_VOLUME_MEASURES];
+					vals[QCM_VOLUME - QCM_VOLUME] = res.volume[j];
+					vals[QCM_VOLUME_MIN_DIHEDRAL - QCM_VOLUME] = res.minDihedral[j];
+					vals[QCM_VOLUME_MAX_DIHEDRAL - QCM_VOLUME] = res.maxDihedral[j];
+					vals[QCM_VOLUME_ASPECT_RATIO - QCM_VOLUME] = res.aspectRatio[j];
+					vals[QCM_TET_VOL_TO_RMS_FACE_AREA_RATIO - QCM_VOLUME] = res.volToRMSFaceAreaRatio[j];
+				}
+				batch.clear();
+				first = i + 1;
+			}
+		}
+	};
+
+	ParallelForChunks(sortedVolSlots.size(), NumQualityThreadsFor(sortedVolSlots.size()),
+		[&](size_t, size_t from, size_t to)
+		{
+			evaluateVolumes(from, std::min(to, tetFrom));
+			evaluateTetrahedra(std::max(from, tetFrom), std::min(to, tetTo));
+			evaluateVolumes(std::max(from, tetTo), to);
+		});
+
+	for(size_t i = 0; i < faceSlots.size(); ++i)
+		for(size_t j = 0; j < NUM_FACE_MEASURES; ++j)
+			set_value((QualityCacheMeasure)j, faceSlots[i], faceVals[i * NUM_FACE_MEASURES + j]);
+
+	for(size_t i = 0; i < sortedVolSlots.size(); ++i)
+		for(size_t j = 0; j < NUM_VOLUME_MEASURES; ++j)
+			set_value((QualityCacheMeasure)(QCM_VOLUME + j), sortedVolSlots[i], volVals[i * NUM_VOLUME_MEASURES + j]);
+}
+
+void ElementQualityCache::set_value(QualityCacheMeasure mi, size_t slot, number val)
+{
+	Measure& m = m_measures[mi];
+	number& oldVal = m.values[slot];
+
+	if(m.bHistogram && !std::isnan(oldVal))
+		m.hist.remove(oldVal);
+
+	oldVal = val;
+
+	if(std::isnan(val))
+		m.tree.reset(slot);
+	else
+	{
+		m.tree.set(slot, val);
+		if(m.bHistogram)
+			m.hist.add(val);
+	}
+}
+
+void ElementQualityCache::reduce()
+{
+//	extremal values into one buffer (maxima negated), numbers and histogram counts into
+//	a second one, as in ReduceElementQualityData
+	vector<number> locSums, sums, locMins, mins;
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+	{
+		Measure& m = m_measures[i];
+		locSums.push_back((number)m.tree.num());
+		locMins.push_back(m.tree.min());
+		locMins.push_back(-m.tree.max());
+	}
+
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+	{
+		Measure& m = m_measures[i];
+		if(m.bHistogram){
+			m.hist.set_extremal_values(m.tree.min(), m.tree.max());
+			m.hist.pack(locSums, locMins);
+		}
+	}
+
+	sums = locSums;
+	mins = locMins;
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			pcl::ProcessCommunicator pc;
+			pc.allreduce(locSums, sums, PCL_RO_SUM);
+			pc.allreduce(locMins, mins, PCL_RO_MIN);
+		}
+	#endif
+
+	size_t s = NUM_QUALITY_CACHE_MEASURES;
+	size_t k = 2 * NUM_QUALITY_CACHE_MEASURES;
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+	{
+		Measure& m = m_measures[i];
+		m.globalNum = (size_t)sums[i];
+		m.globalMin = (m.globalNum > 0) ? mins[2*i] : 0.0;
+		m.globalMax = (m.globalNum > 0) ? -mins[2*i+1] : 0.0;
+
+		if(m.bHistogram){
+			m.globalHist = m.hist;
+			m.globalHist.unpack(sums, s, mins, k);
+		}
+	}
+}
+
+number ElementQualityCache::value(Face* f, QualityCacheMeasure m) const
+{
+	UG_COND_THROW(m_measures[m].bVolume, "ElementQualityCache: '" << measure_name(m) << "' is no face measure.");
+	int slot = m_aaFaceSlot[f];
+	if(slot < 0 || (size_t)slot >= m_measures[m].values.size())
+		return numeric_limits<number>::quiet_NaN();
+	return m_measures[m].values[slot];
+}
+
+number ElementQualityCache::value(Volume* v, QualityCacheMeasure m) const
+{
+	UG_COND_THROW(!m_measures[m].bVolume, "ElementQualityCache: '" << measure_name(m) << "' is no volume measure.");
+	int slot = m_aaVolSlot[v];
+	if(slot < 0 || (size_t)slot >= m_measures[m].values.size())
+		return numeric_limits<number>::quiet_NaN();
+	return m_measures[m].values[slot];
+}
+
+const char* ElementQualityCache::measure_name(QualityCacheMeasure m)
+{
+	return s_qualityCacheMeasureNames[m];
+}
+
+QualityCacheMeasure ElementQualityCache::measure_by_name(const char* name) const
+{
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+		if(strcmp(name, s_qualityCacheMeasureNames[i]) == 0)
+			return (QualityCacheMeasure)i;
+
+	UG_THROW("ElementQualityCache: unknown measure '" << name << "'.");
+}
+
+number ElementQualityCache::min(const char* measure) const
+{
+	return min(measure_by_name(measure));
+}
+
+number ElementQualityCache::max(const char* measure) const
+{
+	return max(measure_by_name(measure));
+}
+
+size_t ElementQualityCache::num(const char* measure) const
+{
+	return num(measure_by_name(measure));
+}
+
+void ElementQualityCache::print() const
+{
+	ug::Table<std::stringstream> table(NUM_QUALITY_CACHE_MEASURES + 1, 4);
+	table(0, 0) << "Measure";	table(0, 1) << "Number";
+	table(0, 2) << "Smallest";	table(0, 3) << "Largest";
+
+	size_t row = 1;
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+	{
+		const Measure& m = m_measures[i];
+		if(m.bVolume && m_dim == 2)
+			continue;
+		table(row, 0) << s_qualityCacheMeasureNames[i];
+		table(row, 1) << m.globalNum;
+		table(row, 2) << m.globalMin;
+		table(row, 3) << m.globalMax;
+		++row;
+	}
+
+	UG_LOG(endl << "Cached element qualities on level " << m_lvl << ":" << endl);
+	UG_LOG(table);
+
+	ug::Table<std::stringstream> histTable;
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+	{
+		const Measure& m = m_measures[i];
+		if(!m.bHistogram || m.globalHist.num_values() == 0)
+			continue;
+
+		UG_LOG(endl << "(*) Histogram of '" << s_qualityCacheMeasureNames[i] << "'" << endl);
+		histTable.clear();
+		if(m.bAngle)
+			PrintAngleHistogram(m.globalHist, histTable);
+		else
+			PrintAspectRatioHistogram(m.globalHist, histTable);
+	}
+}
+
+
+}
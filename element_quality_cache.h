@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __ELEMENT_QUALITY_CACHE_H__
+#define __ELEMENT_QUALITY_CACHE_H__
+
+/* system includes */
+#include <stddef.h>
+#include <vector>
+
+#include "lib_grid/lib_grid.h"
+#include "quality_accumulators.h"
+#include "quality_element_types.h"
+#include "quality_histogram.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityCacheMeasure
+///	element wise measures held by an ElementQualityCache
+enum QualityCacheMeasure
+{
+	QCM_FACE_AREA = 0,
+	QCM_FACE_MIN_ANGLE,
+	QCM_FACE_MAX_ANGLE,
+	QCM_FACE_ASPECT_RATIO,
+	QCM_VOLUME,
+	QCM_VOLUME_MIN_DIHEDRAL,
+	QCM_VOLUME_MAX_DIHEDRAL,
+	QCM_VOLUME_ASPECT_RATIO,
+	QCM_TET_VOL_TO_RMS_FACE_AREA_RATIO,
+	NUM_QUALITY_CACHE_MEASURES
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ElementQualityCache
+///	Element qualities of one grid level which are kept up to date while vertices move
+/**	The cache evaluates the measures of all faces and (for dim 3) volumes of a level
+ *	once and stores them per element. It also remembers the position of every vertex.
+ *	On update() only the elements adjacent to vertices whose position changed are
+ *	evaluated again, and the extremal values and histograms are updated incrementally:
+ *	the old value of an element is removed from the histogram and its slot in a
+ *	QualityMinMaxTree is overwritten. Detecting moved vertices costs one comparison
+ *	per vertex, which is far cheaper than evaluating the elements.
+ *
+ *	The cache assumes a fixed topology. If the number of elements on the level changed,
+ *	update() evaluates everything again. Otherwise invalidate() has to be called after
+ *	topology changes.
+ *
+ *	In parallel ghosts as well as horizontal slaves of faces are ignored as in
+ *	ElementQualityStatistics. update() is collective, the returned extremal values and
+ *	histograms are those of all processes.*/
+class ElementQualityCache
+{
+	public:
+	///	caches the qualities of the elements of a grid (level 0)
+		ElementQualityCache(Grid& grid, int dim);
+
+	///	caches the qualities of the elements on level lvl of a multigrid
+		ElementQualityCache(MultiGrid& mg, int dim, int lvl);
+
+		~ElementQualityCache();
+
+	///	sets the bins of the angle (0-180 deg) and ratio (0-1) histograms
+	/**	All elements are evaluated again on the next update.*/
+		void set_histogram_step_sizes(number angleStepSize, number aspectRatioStepSize);
+
+	///	evaluates the elements adjacent to moved vertices and updates the aggregates (collective)
+	/**	Returns the number of elements evaluated on this process.*/
+		size_t update();
+
+	///	forces the evaluation of all elements on the next update
+		void invalidate()					{m_bValid = false;}
+
+	///	extremal values and numbers of elements of all processes, as of the last update
+	/**	The measure is specified by name, e.g. "volume_min_dihedral" (see measure_name).*/
+		number min(const char* measure) const;
+		number max(const char* measure) const;
+		size_t num(const char* measure) const;
+
+		number min(QualityCacheMeasure m) const		{return m_measures[m].globalMin;}
+		number max(QualityCacheMeasure m) const		{return m_measures[m].globalMax;}
+		size_t num(QualityCacheMeasure m) const		{return m_measures[m].globalNum;}
+
+	///	histogram of all processes, as of the last update. Empty for areas and volumes.
+		const QualityHistogram& histogram(QualityCacheMeasure m) const	{return m_measures[m].globalHist;}
+
+	///	cached value of an element. NaN if the measure is not available for it.
+		number value(Face* f, QualityCacheMeasure m) const;
+		number value(Volume* v, QualityCacheMeasure m) const;
+
+	///	name of a measure, as used by min, max and num
+		static const char* measure_name(QualityCacheMeasure m);
+
+	///	prints the extremal values and the histograms as of the last update
+		void print() const;
+
+	private:
+	//	the attachments are owned, copies are not supported
+		ElementQualityCache(const ElementQualityCache&);
+		ElementQualityCache& operator=(const ElementQualityCache&);
+
+	protected:
+	///	per slot values, the aggregates of this process and those of all processes
+		struct Measure
+		{
+			Measure() : bVolume(false), bAngle(false), bHistogram(false),
+						globalMin(0.0), globalMax(0.0), globalNum(0)	{}
+
+			bool bVolume;
+			bool bAngle;
+			bool bHistogram;
+
+			std::vector<number> values;
+			QualityMinMaxTree tree;
+			QualityHistogram hist;
+
+			QualityHistogram globalHist;
+			number globalMin;
+			number globalMax;
+			size_t globalNum;
+		};
+
+		void init(int dim);
+		QualityCacheMeasure measure_by_name(const char* name) const;
+
+	///	assigns slots to the evaluated elements and stores all positions
+		template <class TAAPosVRT>
+		void rebuild(GridObjectCollection& goc, TAAPosVRT& aaPos);
+
+	///	collects the slots of all elements adjacent to moved vertices
+		template <class TAAPosVRT>
+		void collect_dirty(GridObjectCollection& goc, TAAPosVRT& aaPos,
+						   std::vector<size_t>& faceSlotsOut,
+						   std::vector<size_t>& volSlotsOut);
+
+	///	evaluates the given elements and replaces their values
+		template <class TAAPosVRT>
+		void evaluate(TAAPosVRT& aaPos, const std::vector<size_t>& faceSlots,
+					  const std::vector<size_t>& volSlots);
+
+		void set_value(QualityCacheMeasure m, size_t slot, number val);
+
+	///	computes the aggregates of all processes
+		void reduce();
+
+	protected:
+		Grid& m_grid;
+		int m_dim;
+		int m_lvl;
+		bool m_bValid;
+
+		number m_angleStepSize;
+		number m_aspectRatioStepSize;
+
+	///	slot of each evaluated element (-1 for all others)
+		AInt m_aSlot;
+		Grid::FaceAttachmentAccessor<AInt> m_aaFaceSlot;
+		Grid::VolumeAttachmentAccessor<AInt> m_aaVolSlot;
+
+	///	positions of the vertices at the last update (z = 0 for 2d)
+		APosition m_aLastPos;
+		Grid::VertexAttachmentAccessor<APosition> m_aaLastPos;
+
+		std::vector<Face*> m_faces;
+		ElementsByType<Volume> m_vols;
+
+	///	numbers of elements on the level at the last full evaluation
+		size_t m_numLevelFaces;
+		size_t m_numLevelVols;
+
+		Measure m_measures[NUM_QUALITY_CACHE_MEASURES];
+};
+
+
+}
+#endif  //__ELEMENT_QUALITY_CACHE_H__
@@ -0,0 +1,1255 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __ELEMENT_QUALITY_KERNELS_H__
+#define __ELEMENT_QUALITY_KERNELS_H__
+
+/* system includes */
+#include <stddef.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+
+#include "lib_grid/lib_grid.h"
+#include "lib_grid/algorithms/element_angles.h"
+#include "lib_grid/algorithms/element_aspect_ratios.h"
+#include "elem_stat_util.h"
+#include "quality_accumulators.h"
+#include "quality_element_types.h"
+#include "quality_histogram.h"
+#include "quality_metrics.h"
+#include "quality_profile.h"
+#include "quality_quantiles.h"
+#include "quality_threading.h"
+#include "quality_snapshot.h"
+#include "quality_snapshot_kernels.h"
+#include "quality_spatial_map.h"
+#include "quality_worst_elements.h"
+#include "tet_kernels.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ElementQualityData
+///	Quality measures of one grid level, gathered in a single traversal per element type.
+/**	Every element is evaluated exactly once. All measures which depend on the same
+ *	geometric evaluation (e.g. min and max dihedral as well as the deviation from the
+ *	regular dihedral) are fed from that one evaluation.
+ *
+ *	Only the metrics selected by 'metrics' (see QualityMetric, all by default) are
+ *	evaluated and accumulated, all other measures stay empty.*/
+struct ElementQualityData
+{
+	ElementQualityData() :
+		metrics(QM_ALL),
+		triAngles(60.0),
+		quadAngles(90.0),
+		tetDihedrals(70.52877937),
+		hexDihedrals(90.0),
+		octDihedrals(109.4712206),
+		prismTriQuadDihedrals(90.0),
+		prismQuadQuadDihedrals(60.0),
+		pyramidBaseDihedrals(54.73561032),
+		pyramidApexDihedrals(109.4712206),
+		faceMinAngleQuantiles(GetQualityQuantileCompression()),
+		faceAspectRatioQuantiles(GetQualityQuantileCompression()),
+		volMinDihedralQuantiles(GetQualityQuantileCompression()),
+		volAspectRatioQuantiles(GetQualityQuantileCompression()),
+		faceMinAngleWorst(GetQualityStatisticsNumWorstElements(), false),
+		faceAspectRatioWorst(GetQualityStatisticsNumWorstElements(), false),
+		volMinDihedralWorst(GetQualityStatisticsNumWorstElements(), false),
+		volMaxDihedralWorst(GetQualityStatisticsNumWorstElements(), true),
+		volAspectRatioWorst(GetQualityStatisticsNumWorstElements(), false),
+		spatialMap(NULL)
+	{
+		init_histograms(10.0, 0.1);
+	}
+
+///	sets the bins of the angle (0-180 deg) and ratio (0-1) histograms and clears all data
+	void init_histograms(number angleStepSize, number aspectRatioStepSize)
+	{
+		size_t numAngleBins = floor(180.0/angleStepSize);
+		size_t numRatioBins = floor(1.0/aspectRatioStepSize);
+
+		faceMinAngleHist.init(0.0, angleStepSize, numAngleBins);
+		faceMaxAngleHist.init(0.0, angleStepSize, numAngleBins);
+		faceAspectRatioHist.init(0.0, aspectRatioStepSize, numRatioBins);
+		volMinAngleHist.init(0.0, angleStepSize, numAngleBins);
+		volMaxAngleHist.init(0.0, angleStepSize, numAngleBins);
+		volAspectRatioHist.init(0.0, aspectRatioStepSize, numRatioBins);
+		volToRMSFaceAreaRatioHist.init(0.0, aspectRatioStepSize, numRatioBins);
+		prismMinAngleHist.init(0.0, angleStepSize, numAngleBins);
+		prismAspectRatioHist.init(0.0, aspectRatioStepSize, numRatioBins);
+		pyramidMinAngleHist.init(0.0, angleStepSize, numAngleBins);
+		pyramidAspectRatioHist.init(0.0, aspectRatioStepSize, numRatioBins);
+
+		clear();
+	}
+
+	void clear()
+	{
+		numVertices = 0;
+		numEdges = 0;
+		numFaces = 0;
+		numVolumes = 0;
+
+		totalFaceArea = 0.0;
+		totalVolume = 0.0;
+		edgeStatistics.clear();
+
+		edgeLength.clear();
+		faceArea.clear();
+		faceAngle.clear();
+		triAspectRatio.clear();
+		quadAspectRatio.clear();
+		volume.clear();
+		volDihedral.clear();
+		tetAspectRatio.clear();
+		tetVolToRMSFaceAreaRatio.clear();
+		hexAspectRatio.clear();
+		prismAspectRatio.clear();
+		prismVolToRMSFaceAreaRatio.clear();
+		pyramidAspectRatio.clear();
+		pyramidVolToRMSFaceAreaRatio.clear();
+
+		triAngles.clear();
+		quadAngles.clear();
+		tetDihedrals.clear();
+		hexDihedrals.clear();
+		octDihedrals.clear();
+		prismTriQuadDihedrals.clear();
+		prismQuadQuadDihedrals.clear();
+		pyramidBaseDihedrals.clear();
+		pyramidApexDihedrals.clear();
+
+		faceMinAngleHist.clear();
+		faceMaxAngleHist.clear();
+		faceAspectRatioHist.clear();
+		volMinAngleHist.clear();
+		volMaxAngleHist.clear();
+		volAspectRatioHist.clear();
+		volToRMSFaceAreaRatioHist.clear();
+		prismMinAngleHist.clear();
+		prismAspectRatioHist.clear();
+		pyramidMinAngleHist.clear();
+		pyramidAspectRatioHist.clear();
+
+		faceMinAngleQuantiles.clear();
+		faceAspectRatioQuantiles.clear();
+		volMinDihedralQuantiles.clear();
+		volAspectRatioQuantiles.clear();
+
+		faceMinAngleWorst.clear();
+		faceAspectRatioWorst.clear();
+		volMinDihedralWorst.clear();
+		volMaxDihedralWorst.clear();
+		volAspectRatioWorst.clear();
+		nonTetrahedralElemsPresent = false;
+	}
+
+///	adds the data of another part of the same level (e.g. evaluated by another thread)
+	void merge(const ElementQualityData& d)
+	{
+		numVertices += d.numVertices;
+		numEdges += d.numEdges;
+		numFaces += d.numFaces;
+		numVolumes += d.numVolumes;
+
+		totalFaceArea += d.totalFaceArea;
+		totalVolume += d.totalVolume;
+		edgeStatistics.merge(d.edgeStatistics);
+
+		edgeLength.merge(d.edgeLength);
+		faceArea.merge(d.faceArea);
+		faceAngle.merge(d.faceAngle);
+		triAspectRatio.merge(d.triAspectRatio);
+		quadAspectRatio.merge(d.quadAspectRatio);
+		volume.merge(d.volume);
+		volDihedral.merge(d.volDihedral);
+		tetAspectRatio.merge(d.tetAspectRatio);
+		tetVolToRMSFaceAreaRatio.merge(d.tetVolToRMSFaceAreaRatio);
+		hexAspectRatio.merge(d.hexAspectRatio);
+		prismAspectRatio.merge(d.prismAspectRatio);
+		prismVolToRMSFaceAreaRatio.merge(d.prismVolToRMSFaceAreaRatio);
+		pyramidAspectRatio.merge(d.pyramidAspectRatio);
+		pyramidVolToRMSFaceAreaRatio.merge(d.pyramidVolToRMSFaceAreaRatio);
+
+		triAngles.merge(d.triAngles);
+		quadAngles.merge(d.quadAngles);
+		tetDihedrals.merge(d.tetDihedrals);
+		hexDihedrals.merge(d.hexDihedrals);
+		octDihedrals.merge(d.octDihedrals);
+		prismTriQuadDihedrals.merge(d.prismTriQuadDihedrals);
+		prismQuadQuadDihedrals.merge(d.prismQuadQuadDihedrals);
+		pyramidBaseDihedrals.merge(d.pyramidBaseDihedrals);
+		pyramidApexDihedrals.merge(d.pyramidApexDihedrals);
+
+		faceMinAngleHist.merge(d.faceMinAngleHist);
+		faceMaxAngleHist.merge(d.faceMaxAngleHist);
+		faceAspectRatioHist.merge(d.faceAspectRatioHist);
+		volMinAngleHist.merge(d.volMinAngleHist);
+		volMaxAngleHist.merge(d.volMaxAngleHist);
+		volAspectRatioHist.merge(d.volAspectRatioHist);
+		volToRMSFaceAreaRatioHist.merge(d.volToRMSFaceAreaRatioHist);
+		prismMinAngleHist.merge(d.prismMinAngleHist);
+		prismAspectRatioHist.merge(d.prismAspectRatioHist);
+		pyramidMinAngleHist.merge(d.pyramidMinAngleHist);
+		pyramidAspectRatioHist.merge(d.pyramidAspectRatioHist);
+
+		faceMinAngleQuantiles.merge(d.faceMinAngleQuantiles);
+		faceAspectRatioQuantiles.merge(d.faceAspectRatioQuantiles);
+		volMinDihedralQuantiles.merge(d.volMinDihedralQuantiles);
+		volAspectRatioQuantiles.merge(d.volAspectRatioQuantiles);
+
+		faceMinAngleWorst.merge(d.faceMinAngleWorst);
+		faceAspectRatioWorst.merge(d.faceAspectRatioWorst);
+		volMinDihedralWorst.merge(d.volMinDihedralWorst);
+		volMaxDihedralWorst.merge(d.volMaxDihedralWorst);
+		volAspectRatioWorst.merge(d.volAspectRatioWorst);
+		nonTetrahedralElemsPresent = nonTetrahedralElemsPresent || d.nonTetrahedralElemsPresent;
+	}
+
+///	adds one vertex
+	void add_vertex()
+	{
+		numVertices++;
+	}
+
+///	adds one edge
+	void add_edge(number length)
+	{
+		numEdges++;
+		edgeLength.add(length);
+		edgeStatistics.add(length);
+	}
+
+///	adds only the area of one face, for evaluations which need no other face measures
+	void add_face_area(number area)
+	{
+		numFaces++;
+		faceArea.add(area);
+		totalFaceArea += area;
+	}
+
+///	adds the measures of one face
+/**	'aspectRatio' is only regarded for triangles and quadrilaterals. 'elem' is only
+ *	needed for the tracking of the worst elements.*/
+	void add_face(ReferenceObjectID roid, number area,
+				  const number* angles, size_t numAngles, number aspectRatio,
+				  GridObject* elem = NULL)
+	{
+		numFaces++;
+		faceArea.add(area);
+		totalFaceArea += area;
+
+		if(numAngles > 0)
+		{
+			number minAngle = *std::min_element(angles, angles + numAngles);
+			number maxAngle = *std::max_element(angles, angles + numAngles);
+			faceAngle.add(minAngle);
+			faceAngle.add(maxAngle);
+			faceMinAngleHist.add(minAngle);
+			faceMaxAngleHist.add(maxAngle);
+			faceMinAngleQuantiles.add(minAngle);
+			faceMinAngleWorst.add(minAngle, elem);
+			add_to_spatial_map(2, QM_MIN_DIHEDRAL, minAngle, elem);
+		}
+
+		switch(roid)
+		{
+			case ROID_TRIANGLE:
+				triAspectRatio.add(aspectRatio);
+				faceAspectRatioHist.add(aspectRatio);
+				faceAspectRatioQuantiles.add(aspectRatio);
+				faceAspectRatioWorst.add(aspectRatio, elem);
+				add_to_spatial_map(2, QM_ASPECT_RATIO, aspectRatio, elem);
+				triAngles.add_angles(angles, numAngles);
+				break;
+			case ROID_QUADRILATERAL:
+				quadAspectRatio.add(aspectRatio);
+				faceAspectRatioHist.add(aspectRatio);
+				faceAspectRatioQuantiles.add(aspectRatio);
+				faceAspectRatioWorst.add(aspectRatio, elem);
+				add_to_spatial_map(2, QM_ASPECT_RATIO, aspectRatio, elem);
+				quadAngles.add_angles(angles, numAngles);
+				break;
+			default:
+				break;
+		}
+	}
+
+///	adds the measures which are gathered for all volume types
+/**	minMaxDihedral holds the smallest and the largest dihedral of the volume or is
+ *	NULL if no dihedrals were evaluated.*/
+	void add_volume_measures(number vol, const number* minMaxDihedral,
+							 number aspectRatio, GridObject* elem)
+	{
+		numVolumes++;
+		if(metrics & QM_VOLUME)
+		{
+			volume.add(vol);
+			totalVolume += vol;
+		}
+
+		if(minMaxDihedral)
+		{
+			if(metrics & QM_MIN_DIHEDRAL)
+			{
+				volDihedral.add(minMaxDihedral[0]);
+				volMinAngleHist.add(minMaxDihedral[0]);
+				volMinDihedralQuantiles.add(minMaxDihedral[0]);
+				volMinDihedralWorst.add(minMaxDihedral[0], elem);
+				add_to_spatial_map(3, QM_MIN_DIHEDRAL, minMaxDihedral[0], elem);
+			}
+			if(metrics & QM_MAX_DIHEDRAL)
+			{
+				volDihedral.add(minMaxDihedral[1]);
+				volMaxAngleHist.add(minMaxDihedral[1]);
+				volMaxDihedralWorst.add(minMaxDihedral[1], elem);
+			}
+		}
+
+		if(metrics & QM_ASPECT_RATIO)
+		{
+			volAspectRatioHist.add(aspectRatio);
+			volAspectRatioQuantiles.add(aspectRatio);
+			volAspectRatioWorst.add(aspectRatio, elem);
+			add_to_spatial_map(3, QM_ASPECT_RATIO, aspectRatio, elem);
+		}
+	}
+
+///	adds the measures of one volume
+/**	'volToRMSFaceAreaRatio' is only regarded for tetrahedra. 'elem' is only needed
+ *	for the tracking of the worst elements. Prisms and pyramids are added by
+ *	add_prism and add_pyramid.*/
+	void add_volume(ReferenceObjectID roid, number vol,
+					const number* dihedrals, size_t numDihedrals,
+					number aspectRatio, number volToRMSFaceAreaRatio,
+					GridObject* elem = NULL)
+	{
+		number minMaxDihedral[2] = {0.0, 0.0};
+		if(numDihedrals > 0)
+		{
+			minMaxDihedral[0] = *std::min_element(dihedrals, dihedrals + numDihedrals);
+			minMaxDihedral[1] = *std::max_element(dihedrals, dihedrals + numDihedrals);
+		}
+		add_volume_measures(vol, (numDihedrals > 0) ? minMaxDihedral : NULL, aspectRatio, elem);
+
+		const bool bAspectRatio = (metrics & QM_ASPECT_RATIO) != 0;
+		const bool bDeviation = (metrics & QM_DIHEDRAL_DEVIATION) != 0;
+
+		switch(roid)
+		{
+			case ROID_TETRAHEDRON:
+				if(bAspectRatio)
+					tetAspectRatio.add(aspectRatio);
+				if(metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+				{
+					tetVolToRMSFaceAreaRatio.add(volToRMSFaceAreaRatio);
+					volToRMSFaceAreaRatioHist.add(volToRMSFaceAreaRatio);
+				}
+				if(bDeviation)
+					tetDihedrals.add_angles(dihedrals, numDihedrals);
+				return;
+			case ROID_HEXAHEDRON:
+				if(bAspectRatio)
+					hexAspectRatio.add(aspectRatio);
+				if(bDeviation)
+					hexDihedrals.add_angles(dihedrals, numDihedrals);
+				break;
+			case ROID_OCTAHEDRON:
+				if(bDeviation)
+					octDihedrals.add_angles(dihedrals, numDihedrals);
+				break;
+			default:
+				break;
+		}
+
+	//	VolToRMSFaceAreaRatios are only available for tetrahedra, prisms and pyramids
+		if(metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+		{
+			volToRMSFaceAreaRatioHist.add(0.0);
+			nonTetrahedralElemsPresent = true;
+		}
+	}
+
+///	adds one prism evaluated by SnapshotPrismQuality for the metrics of this data
+	void add_prism(const PrismQuality& q, GridObject* elem = NULL)
+	{
+		const number minMaxDihedral[2] = {q.minDihedral, q.maxDihedral};
+		add_volume_measures(q.volume, minMaxDihedral, q.aspectRatio, elem);
+
+		if(metrics & QM_MIN_DIHEDRAL)
+			prismMinAngleHist.add(q.minDihedral);
+		if(metrics & QM_ASPECT_RATIO)
+		{
+			prismAspectRatio.add(q.aspectRatio);
+			prismAspectRatioHist.add(q.aspectRatio);
+		}
+		if(metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+		{
+			prismVolToRMSFaceAreaRatio.add(q.volToRMSFaceAreaRatio);
+			volToRMSFaceAreaRatioHist.add(q.volToRMSFaceAreaRatio);
+		}
+		if(metrics & QM_DIHEDRAL_DEVIATION)
+		{
+			prismTriQuadDihedrals.add_angles(q.triQuadDihedrals, 6);
+			prismQuadQuadDihedrals.add_angles(q.quadQuadDihedrals, 3);
+		}
+	}
+
+///	adds one pyramid evaluated by SnapshotPyramidQuality for the metrics of this data
+	void add_pyramid(const PyramidQuality& q, GridObject* elem = NULL)
+	{
+		const number minMaxDihedral[2] = {q.minDihedral, q.maxDihedral};
+		add_volume_measures(q.volume, minMaxDihedral, q.aspectRatio, elem);
+
+		if(metrics & QM_MIN_DIHEDRAL)
+			pyramidMinAngleHist.add(q.minDihedral);
+		if(metrics & QM_ASPECT_RATIO)
+		{
+			pyramidAspectRatio.add(q.aspectRatio);
+			pyramidAspectRatioHist.add(q.aspectRatio);
+		}
+		if(metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+		{
+			pyramidVolToRMSFaceAreaRatio.add(q.volToRMSFaceAreaRatio);
+			volToRMSFaceAreaRatioHist.add(q.volToRMSFaceAreaRatio);
+		}
+		if(metrics & QM_DIHEDRAL_DEVIATION)
+		{
+			pyramidBaseDihedrals.add_angles(q.baseDihedrals, 4);
+			pyramidApexDihedrals.add_angles(q.apexDihedrals, 4);
+		}
+	}
+
+///	adds the tetrahedra evaluated by the tetrahedron kernels
+/**	'res' has to hold the selected metrics (see TetKernelResults::evaluate_selected).
+ *	'elems' (optional) holds the evaluated tetrahedra in the order of the results.
+ *	Dispatches to the specialization of add_tetrahedra_selected for 'metrics'.*/
+	void add_tetrahedra(const TetKernelResults& res, GridObject* const* elems = NULL);
+
+///	adds the tetrahedra evaluated by the tetrahedron kernels for the volume metrics M
+	template <unsigned int M>
+	void add_tetrahedra_selected(const TetKernelResults& res, GridObject* const* elems)
+	{
+		for(size_t i = 0; i < res.num; ++i)
+		{
+			numVolumes++;
+			if(M & QM_VOLUME)
+			{
+				volume.add(res.volume[i]);
+				totalVolume += res.volume[i];
+			}
+			if(M & QM_MIN_DIHEDRAL)
+			{
+				volDihedral.add(res.minDihedral[i]);
+				volMinAngleHist.add(res.minDihedral[i]);
+				volMinDihedralQuantiles.add(res.minDihedral[i]);
+				if(elems){
+					volMinDihedralWorst.add(res.minDihedral[i], elems[i]);
+					add_to_spatial_map(3, QM_MIN_DIHEDRAL, res.minDihedral[i], elems[i]);
+				}
+			}
+			if(M & QM_MAX_DIHEDRAL)
+			{
+				volDihedral.add(res.maxDihedral[i]);
+				volMaxAngleHist.add(res.maxDihedral[i]);
+				if(elems)
+					volMaxDihedralWorst.add(res.maxDihedral[i], elems[i]);
+			}
+			if(M & QM_ASPECT_RATIO)
+			{
+				volAspectRatioHist.add(res.aspectRatio[i]);
+				volAspectRatioQuantiles.add(res.aspectRatio[i]);
+				if(elems){
+					volAspectRatioWorst.add(res.aspectRatio[i], elems[i]);
+					add_to_spatial_map(3, QM_ASPECT_RATIO, res.aspectRatio[i], elems[i]);
+				}
+				tetAspectRatio.add(res.aspectRatio[i]);
+			}
+			if(M & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+			{
+				tetVolToRMSFaceAreaRatio.add(res.volToRMSFaceAreaRatio[i]);
+				volToRMSFaceAreaRatioHist.add(res.volToRMSFaceAreaRatio[i]);
+			}
+			if(M & QM_DIHEDRAL_DEVIATION)
+				tetDihedrals.add_sums(6, res.sumDihedral[i], res.m2Dihedral[i],
+									   res.minDihedral[i], res.maxDihedral[i]);
+		}
+	}
+
+///	adds the value of an element of dimension 'dim' to the spatial map, if the map bins the given metric
+/**	Only elements of the dimension of the map are binned, so that the face angles
+ *	evaluated by QM_LOWER_DIM in 3d don't end up among the dihedrals of the volumes.*/
+	inline void add_to_spatial_map(int dim, unsigned int metric, number val, GridObject* elem)
+	{
+		if(spatialMap && elem && spatialMap->dim() == dim && spatialMap->metric() == metric)
+			spatialMap->add(elem, val);
+	}
+
+///	sets the number of tracked worst elements per measure and clears the trackers
+	void set_num_worst_elements(size_t k)
+	{
+		faceMinAngleWorst.init(k, false);
+		faceAspectRatioWorst.init(k, false);
+		volMinDihedralWorst.init(k, false);
+		volMaxDihedralWorst.init(k, true);
+		volAspectRatioWorst.init(k, false);
+	}
+
+///	computes the centers of the tracked worst elements of this process
+	template <class TAAPosVRT>
+	void compute_worst_element_centers(TAAPosVRT& aaPos)
+	{
+		faceMinAngleWorst.compute_centers(aaPos);
+		faceAspectRatioWorst.compute_centers(aaPos);
+		volMinDihedralWorst.compute_centers(aaPos);
+		volMaxDihedralWorst.compute_centers(aaPos);
+		volAspectRatioWorst.compute_centers(aaPos);
+	}
+
+//	Evaluated metrics (see QualityMetric)
+	unsigned int metrics;
+
+//	Numbers
+	size_t numVertices;
+	size_t numEdges;
+	size_t numFaces;
+	size_t numVolumes;
+
+//	Extremal values
+	QualityMinMax edgeLength;
+	QualityMinMax faceArea;
+	QualityMinMax faceAngle;
+	QualityMinMax triAspectRatio;
+	QualityMinMax quadAspectRatio;
+	QualityMinMax volume;
+	QualityMinMax volDihedral;
+	QualityMinMax tetAspectRatio;
+	QualityMinMax tetVolToRMSFaceAreaRatio;
+	QualityMinMax hexAspectRatio;
+	QualityMinMax prismAspectRatio;
+	QualityMinMax prismVolToRMSFaceAreaRatio;
+	QualityMinMax pyramidAspectRatio;
+	QualityMinMax pyramidVolToRMSFaceAreaRatio;
+
+//	Sums of the face areas and of the volumes (the latter only with QM_VOLUME)
+	number totalFaceArea;
+	number totalVolume;
+
+//	Length statistics of the edges (sum, moments and logarithmic histogram)
+	EdgeStatistics edgeStatistics;
+
+//	Deviations of face angles and volume dihedrals from the regular case. Prisms and
+//	pyramids have two kinds of dihedrals with different regular values.
+	AngleDeviation triAngles;
+	AngleDeviation quadAngles;
+	AngleDeviation tetDihedrals;
+	AngleDeviation hexDihedrals;
+	AngleDeviation octDihedrals;
+	AngleDeviation prismTriQuadDihedrals;
+	AngleDeviation prismQuadQuadDihedrals;
+	AngleDeviation pyramidBaseDihedrals;
+	AngleDeviation pyramidApexDihedrals;
+
+//	Histograms
+	QualityHistogram faceMinAngleHist;
+	QualityHistogram faceMaxAngleHist;
+	QualityHistogram faceAspectRatioHist;
+	QualityHistogram volMinAngleHist;
+	QualityHistogram volMaxAngleHist;
+	QualityHistogram volAspectRatioHist;
+	QualityHistogram volToRMSFaceAreaRatioHist;
+	QualityHistogram prismMinAngleHist;
+	QualityHistogram prismAspectRatioHist;
+	QualityHistogram pyramidMinAngleHist;
+	QualityHistogram pyramidAspectRatioHist;
+
+//	Quantile sketches of the element wise min angles and aspect ratios
+	QualityQuantileSketch faceMinAngleQuantiles;
+	QualityQuantileSketch faceAspectRatioQuantiles;
+	QualityQuantileSketch volMinDihedralQuantiles;
+	QualityQuantileSketch volAspectRatioQuantiles;
+
+//	Worst elements (only tracked if GetQualityStatisticsNumWorstElements() > 0)
+	WorstElementTracker faceMinAngleWorst;
+	WorstElementTracker faceAspectRatioWorst;
+	WorstElementTracker volMinDihedralWorst;
+	WorstElementTracker volMaxDihedralWorst;
+	WorstElementTracker volAspectRatioWorst;
+	bool nonTetrahedralElemsPresent;
+
+//	Optional map of the min angles or aspect ratios of the elements, which is fed with
+//	the values of all elements added with their grid element (not owned, not merged).
+	QualitySpatialMap* spatialMap;
+};
+
+
+///	specialization of ElementQualityData::add_tetrahedra for the volume metrics M
+template <unsigned int M>
+struct AddTetrahedraSelected
+{
+	static void apply(ElementQualityData& data, const TetKernelResults& res,
+					  GridObject* const* elems)
+	{
+		data.add_tetrahedra_selected<M>(res, elems);
+	}
+};
+
+inline void ElementQualityData::
+add_tetrahedra(const TetKernelResults& res, GridObject* const* elems)
+{
+	typedef void (*AddFunc)(ElementQualityData&, const TetKernelResults&, GridObject* const*);
+	static const QualityMetricsTable<AddFunc, AddTetrahedraSelected> variants;
+	variants[metrics](*this, res, elems);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateVertexQuality
+template <class TIterator>
+void AccumulateVertexQuality(ElementQualityData& data, Grid& grid,
+							 TIterator vrtsBegin, TIterator vrtsEnd)
+{
+	DistributedGridManager* dgm = grid.distributed_grid_manager();
+
+	for(TIterator iter = vrtsBegin; iter != vrtsEnd; ++iter)
+	{
+		#ifdef UG_PARALLEL
+		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
+		//	since they have a copy on another process and
+		//	since we already consider that copy...
+			if(dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE))
+				continue;
+		#endif
+
+		data.add_vertex();
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateEdgeQuality
+template <class TIterator, class TAAPosVRT>
+void AccumulateEdgeQuality(ElementQualityData& data, Grid& grid,
+						   TIterator edgesBegin, TIterator edgesEnd,
+						   TAAPosVRT& aaPos)
+{
+	DistributedGridManager* dgm = grid.distributed_grid_manager();
+
+	for(TIterator iter = edgesBegin; iter != edgesEnd; ++iter)
+	{
+		Edge* e = *iter;
+
+		#ifdef UG_PARALLEL
+		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
+		//	since they have a copy on another process and
+		//	since we already consider that copy...
+			if(dgm->is_ghost(e) || dgm->contains_status(e, ES_H_SLAVE))
+				continue;
+		#endif
+
+		data.add_edge(EdgeLength(e, aaPos));
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AddFaceQuality
+///	evaluates one face of type roid through lib_grid. vAngles is used as temporary storage.
+/**	roid is known by the caller (e.g. from the type section of the face), so it is
+ *	never queried from the face.*/
+template <class TAAPosVRT>
+inline void AddFaceQuality(ElementQualityData& data, Grid& grid, Face* f, ReferenceObjectID roid,
+						   TAAPosVRT& aaPos, std::vector<number>& vAngles)
+{
+//	all face angles at once, min/max and the deviations are derived from them
+	vAngles.clear();
+	CalculateAngles(vAngles, grid, f, aaPos);
+
+	number aspectRatio = 0.0;
+	if(roid == ROID_TRIANGLE || roid == ROID_QUADRILATERAL)
+		aspectRatio = CalculateAspectRatio(grid, f, aaPos);
+
+	data.add_face(roid, FaceArea(f, aaPos), vAngles.data(), vAngles.size(), aspectRatio, f);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AddPrismQuality, AddPyramidQuality
+///	evaluates one prism by the coordinate kernel (see SnapshotPrismQuality)
+template <class TAAPosVRT>
+inline void AddPrismQuality(ElementQualityData& data, Volume* vol, TAAPosVRT& aaPos)
+{
+	static const int corners[6] = {0, 1, 2, 3, 4, 5};
+	number x[6], y[6], z[6];
+	GatherCornerCoordinates(x, y, z, vol, aaPos);
+
+	PrismQuality q;
+	SnapshotPrismQuality(q, x, y, z, corners, data.metrics);
+	data.add_prism(q, vol);
+}
+
+///	evaluates one pyramid by the coordinate kernel (see SnapshotPyramidQuality)
+template <class TAAPosVRT>
+inline void AddPyramidQuality(ElementQualityData& data, Volume* vol, TAAPosVRT& aaPos)
+{
+	static const int corners[5] = {0, 1, 2, 3, 4};
+	number x[5], y[5], z[5];
+	GatherCornerCoordinates(x, y, z, vol, aaPos);
+
+	PyramidQuality q;
+	SnapshotPyramidQuality(q, x, y, z, corners, data.metrics);
+	data.add_pyramid(q, vol);
+}
+
+///	vol/RMS-face-area ratio of a prism or pyramid by the coordinate kernels
+/**	Returns false for all other element types.*/
+template <class TElem, class TAAPosVRT>
+inline bool PrismOrPyramidVolToRMSFaceAreaRatio(number& ratioOut, TElem* elem, TAAPosVRT& aaPos)
+{
+	static const int corners[6] = {0, 1, 2, 3, 4, 5};
+	number x[6], y[6], z[6];
+
+	switch(elem->reference_object_id())
+	{
+		case ROID_PRISM:
+		{
+			GatherCornerCoordinates(x, y, z, elem, aaPos);
+			PrismQuality q;
+			SnapshotPrismQuality(q, x, y, z, corners);
+			ratioOut = q.volToRMSFaceAreaRatio;
+			return true;
+		}
+		case ROID_PYRAMID:
+		{
+			GatherCornerCoordinates(x, y, z, elem, aaPos);
+			PyramidQuality q;
+			SnapshotPyramidQuality(q, x, y, z, corners);
+			ratioOut = q.volToRMSFaceAreaRatio;
+			return true;
+		}
+		default:
+			return false;
+	}
+}
+
+///	aspect ratio of a face as used by all quality evaluations (see CalculateAspectRatio)
+template <class TAAPosVRT>
+inline number ElementAspectRatio(Grid& grid, Face* f, TAAPosVRT& aaPos)
+{
+	return CalculateAspectRatio(grid, f, aaPos);
+}
+
+///	aspect ratio of a volume as used by all quality evaluations
+/**	Prisms and pyramids are evaluated by their coordinate kernels (see
+ *	SnapshotPrismQuality), all other types through lib_grid. This is the value which
+ *	is added to the statistics, so that the report, the cache, the metric index and
+ *	the spatial map agree for every element. Like the tetrahedron aspect ratio, it is
+ *	1 for the regular element and tends to 0 for degenerated ones.*/
+template <class TAAPosVRT>
+inline number ElementAspectRatio(Grid& grid, Volume* vol, TAAPosVRT& aaPos)
+{
+	static const int corners[6] = {0, 1, 2, 3, 4, 5};
+	number x[6], y[6], z[6];
+
+	switch(vol->reference_object_id())
+	{
+		case ROID_PRISM:
+		{
+			GatherCornerCoordinates(x, y, z, vol, aaPos);
+			PrismQuality q;
+			SnapshotPrismQuality(q, x, y, z, corners, QM_ASPECT_RATIO);
+			return q.aspectRatio;
+		}
+		case ROID_PYRAMID:
+		{
+			GatherCornerCoordinates(x, y, z, vol, aaPos);
+			PyramidQuality q;
+			SnapshotPyramidQuality(q, x, y, z, corners, QM_ASPECT_RATIO);
+			return q.aspectRatio;
+		}
+		default:
+			return CalculateAspectRatio(grid, vol, aaPos);
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AddVolumeQuality
+///	evaluates one volume of type roid through lib_grid. vDihedrals is used as temporary storage.
+/**	See AddFaceQuality. Prisms and pyramids are evaluated by their coordinate kernels
+ *	instead (see AddPrismQuality and AddPyramidQuality).*/
+template <class TAAPosVRT>
+inline void AddVolumeQuality(ElementQualityData& data, Grid& grid, Volume* vol, ReferenceObjectID roid,
+							 TAAPosVRT& aaPos, std::vector<number>& vDihedrals)
+{
+	if(roid == ROID_PRISM)
+	{
+		AddPrismQuality(data, vol, aaPos);
+		return;
+	}
+	if(roid == ROID_PYRAMID)
+	{
+		AddPyramidQuality(data, vol, aaPos);
+		return;
+	}
+
+	const unsigned int metrics = data.metrics;
+
+//	all dihedrals at once, min/max and the deviations are derived from them
+	vDihedrals.clear();
+	if(metrics & (QM_MIN_DIHEDRAL | QM_MAX_DIHEDRAL | QM_DIHEDRAL_DEVIATION))
+		CalculateAngles(vDihedrals, grid, vol, aaPos);
+
+	number ratio = 0.0;
+	if(roid == ROID_TETRAHEDRON && (metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO))
+		ratio = CalculateVolToRMSFaceAreaRatio(grid, vol, aaPos);
+
+	number volume = 0.0;
+	if(metrics & QM_VOLUME)
+		volume = CalculateVolume(vol, aaPos);
+
+	number aspectRatio = 0.0;
+	if(metrics & QM_ASPECT_RATIO)
+		aspectRatio = CalculateAspectRatio(grid, vol, aaPos);
+
+	data.add_volume(roid, volume, vDihedrals.data(), vDihedrals.size(), aspectRatio, ratio, vol);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	FaceQualityKernel
+///	evaluates ranges of faces of one type (see ForEachElementType)
+template <class TAAPosVRT>
+struct FaceQualityKernel
+{
+	FaceQualityKernel(ElementQualityData& data_, Grid& grid_,
+					  const ElementsByType<Face>& faces_, TAAPosVRT& aaPos_) :
+		data(data_), grid(grid_), faces(faces_), aaPos(aaPos_)
+	{}
+
+	template <int roid>
+	void apply(size_t from, size_t to)
+	{
+		for(size_t i = from; i < to; ++i)
+			AddFaceQuality(data, grid, faces[i], (ReferenceObjectID)roid, aaPos, vAngles);
+	}
+
+	ElementQualityData& data;
+	Grid& grid;
+	const ElementsByType<Face>& faces;
+	TAAPosVRT& aaPos;
+	std::vector<number> vAngles;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	VolumeQualityKernel
+///	evaluates ranges of volumes of one type (see ForEachElementType)
+/**	Tetrahedra are evaluated batch-wise by the tetrahedron kernels, prisms and
+ *	pyramids by their coordinate kernels, all other types through lib_grid.*/
+template <class TAAPosVRT>
+struct VolumeQualityKernel
+{
+	VolumeQualityKernel(ElementQualityData& data_, Grid& grid_,
+						const ElementsByType<Volume>& vols_, TAAPosVRT& aaPos_) :
+		data(data_), grid(grid_), vols(vols_), aaPos(aaPos_)
+	{}
+
+	template <int roid>
+	void apply(size_t from, size_t to)
+	{
+		add(from, to, (ReferenceObjectID)roid, std::integral_constant<bool, roid == ROID_TETRAHEDRON>());
+	}
+
+	void add(size_t from, size_t to, ReferenceObjectID roid, std::false_type)
+	{
+		for(size_t i = from; i < to; ++i)
+			AddVolumeQuality(data, grid, vols[i], roid, aaPos, vDihedrals);
+	}
+
+	void add(size_t from, size_t to, ReferenceObjectID, std::true_type)
+	{
+		for(size_t i = from; i < to; ++i)
+		{
+			tets.push_back(vols[i], aaPos);
+			if(tets.full())
+			{
+				data.add_tetrahedra(tets.evaluate_selected(data.metrics), tets.elements());
+				tets.clear();
+			}
+		}
+
+		if(!tets.empty())
+		{
+			data.add_tetrahedra(tets.evaluate_selected(data.metrics), tets.elements());
+			tets.clear();
+		}
+	}
+
+	ElementQualityData& data;
+	Grid& grid;
+	const ElementsByType<Volume>& vols;
+	TAAPosVRT& aaPos;
+	std::vector<number> vDihedrals;
+	TetBatch tets;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateFaceQuality
+///	evaluates the faces [from, to) of faces, every type by its own kernel
+template <class TAAPosVRT>
+void AccumulateFaceQuality(ElementQualityData& data, Grid& grid,
+						   const ElementsByType<Face>& faces, size_t from, size_t to,
+						   TAAPosVRT& aaPos)
+{
+	FaceQualityKernel<TAAPosVRT> kernel(data, grid, faces, aaPos);
+	ForEachElementType(faces, from, to, kernel);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateVolumeQuality
+///	evaluates the volumes [from, to) of vols, every type by its own kernel
+template <class TAAPosVRT>
+void AccumulateVolumeQuality(ElementQualityData& data, Grid& grid,
+							 const ElementsByType<Volume>& vols, size_t from, size_t to,
+							 TAAPosVRT& aaPos)
+{
+	VolumeQualityKernel<TAAPosVRT> kernel(data, grid, vols, aaPos);
+	ForEachElementType(vols, from, to, kernel);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateElementQualityInChunks
+///	runs kernel(data, from, to) on contiguous index ranges [0, num) with per-thread data
+/**	The per-thread data is merged into 'data' in thread order.*/
+template <class TKernel>
+void AccumulateElementQualityInChunks(ElementQualityData& data, size_t num,
+									  size_t numThreads, TKernel kernel)
+{
+	if(numThreads <= 1)
+	{
+		kernel(data, 0, num);
+		return;
+	}
+
+	ElementQualityData emptyData(data);
+	emptyData.clear();
+	std::vector<ElementQualityData> threadData(numThreads, emptyData);
+
+//	every thread feeds a spatial map of its own
+	std::vector<QualitySpatialMap> threadMaps;
+	if(data.spatialMap)
+	{
+		threadMaps.assign(numThreads, *data.spatialMap);
+		for(size_t t = 0; t < numThreads; ++t)
+		{
+			threadMaps[t].clear();
+			threadData[t].spatialMap = &threadMaps[t];
+		}
+	}
+
+	ParallelForChunks(num, numThreads,
+		[&](size_t t, size_t from, size_t to)
+		{
+			kernel(threadData[t], from, to);
+		});
+
+	for(size_t t = 0; t < threadData.size(); ++t)
+		data.merge(threadData[t]);
+	for(size_t t = 0; t < threadMaps.size(); ++t)
+		data.spatialMap->merge(threadMaps[t]);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateElementQualityThreaded
+///	runs an Accumulate*Quality kernel on chunks of the given elements with per-thread data
+/**	The per-thread data is merged into 'data' in thread order.*/
+template <class TElem, class TKernel>
+void AccumulateElementQualityThreaded(ElementQualityData& data, std::vector<TElem*>& elems,
+									  size_t numThreads, TKernel kernel)
+{
+	AccumulateElementQualityInChunks(data, elems.size(), numThreads,
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{
+			kernel(d, elems.begin() + from, elems.begin() + to);
+		});
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateElementQuality2d
+///	Evaluates the quality measures of vertices, edges and faces of the given level
+/**	One traversal per element type. The faces are grouped by their type sections
+ *	(see ElementsByType), so every type is evaluated by its own kernel. If more than
+ *	one thread is set by SetQualityStatisticsNumThreads, the elements of each base
+ *	type are split into contiguous chunks, which are evaluated concurrently. The
+ *	kernels only read the grid, so it must not be modified meanwhile.*/
+template <class TAAPosVRT>
+void AccumulateElementQuality2d(ElementQualityData& data, Grid& grid,
+								GridObjectCollection& goc, int level,
+								TAAPosVRT& aaPos, QualityProfile* profile = NULL)
+{
+	size_t numThreads = NumQualityThreadsFor(goc.num<Edge>(level));
+
+	if(numThreads == 1)
+	{
+		{
+			QualityPhaseTimer timer(profile, "vertices");
+			size_t numBefore = data.numVertices;
+			AccumulateVertexQuality(data, grid, goc.begin<Vertex>(level), goc.end<Vertex>(level));
+			timer.set_num_elements(data.numVertices - numBefore);
+		}
+		{
+			QualityPhaseTimer timer(profile, "edges");
+			size_t numBefore = data.numEdges;
+			AccumulateEdgeQuality(data, grid, goc.begin<Edge>(level), goc.end<Edge>(level), aaPos);
+			timer.set_num_elements(data.numEdges - numBefore);
+		}
+	}
+	else
+	{
+		typedef std::vector<Vertex*>::iterator VrtIter;
+		typedef std::vector<Edge*>::iterator EdgeIter;
+
+		{
+			QualityPhaseTimer timer(profile, "vertices");
+			size_t numBefore = data.numVertices;
+			std::vector<Vertex*> vrts;
+			CollectElementPointers(vrts, goc.begin<Vertex>(level), goc.end<Vertex>(level), goc.num<Vertex>(level));
+			AccumulateElementQualityThreaded(data, vrts, numThreads,
+				[&](ElementQualityData& d, VrtIter begin, VrtIter end)
+				{AccumulateVertexQuality(d, grid, begin, end);});
+			timer.set_num_elements(data.numVertices - numBefore);
+		}
+
+		{
+			QualityPhaseTimer timer(profile, "edges");
+			size_t numBefore = data.numEdges;
+			std::vector<Edge*> edges;
+			CollectElementPointers(edges, goc.begin<Edge>(level), goc.end<Edge>(level), goc.num<Edge>(level));
+			AccumulateElementQualityThreaded(data, edges, numThreads,
+				[&](ElementQualityData& d, EdgeIter begin, EdgeIter end)
+				{AccumulateEdgeQuality(d, grid, begin, end, aaPos);});
+			timer.set_num_elements(data.numEdges - numBefore);
+		}
+	}
+
+	QualityPhaseTimer timer(profile, "faces");
+	ElementsByType<Face> faces;
+	faces.collect(grid, goc, level);
+	AccumulateElementQualityInChunks(data, faces.size(), numThreads,
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{AccumulateFaceQuality(d, grid, faces, from, to, aaPos);});
+	timer.set_num_elements(faces.size());
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateElementQuality3d
+///	Evaluates the quality measures of all elements of the given level
+/**	See AccumulateElementQuality2d, volumes are treated in the same way. Vertices,
+ *	edges and faces are only evaluated if data.metrics contains QM_LOWER_DIM.*/
+template <class TAAPosVRT>
+void AccumulateElementQuality3d(ElementQualityData& data, Grid& grid,
+								GridObjectCollection& goc, int level,
+								TAAPosVRT& aaPos, QualityProfile* profile = NULL)
+{
+	if(data.metrics & QM_LOWER_DIM)
+		AccumulateElementQuality2d(data, grid, goc, level, aaPos, profile);
+
+	QualityPhaseTimer timer(profile, "volumes");
+	ElementsByType<Volume> vols;
+	vols.collect(grid, goc, level);
+	AccumulateElementQualityInChunks(data, vols.size(), NumQualityThreadsFor(vols.size()),
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{AccumulateVolumeQuality(d, grid, vols, from, to, aaPos);});
+	timer.set_num_elements(vols.size());
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateElementQuality2d (snapshot)
+///	Evaluates the quality measures of vertices, edges and faces of a QualityGeometrySnapshot
+/**	Edges and triangles are evaluated on the packed coordinates. Elements without a
+ *	coordinate kernel (e.g. quadrilaterals) are evaluated through lib_grid on the
+ *	element pointers stored in the snapshot. Threads are used as in the grid based
+ *	version.*/
+template <class TAAPosVRT>
+void AccumulateElementQuality2d(ElementQualityData& data, Grid& grid,
+								const QualityGeometrySnapshot& snap,
+								TAAPosVRT& aaPos, QualityProfile* profile = NULL)
+{
+	const number* x = snap.x();
+	const number* y = snap.y();
+	const number* z = snap.z();
+
+	data.numVertices += snap.num_evaluated_vertices();
+
+	{
+		const QualityGeometrySnapshot::ElementBlock& edges = snap.block(ROID_EDGE);
+		QualityPhaseTimer timer(profile, "edges", edges.num_elements());
+		AccumulateElementQualityInChunks(data, edges.num_elements(),
+			NumQualityThreadsFor(edges.num_elements()),
+			[&](ElementQualityData& d, size_t from, size_t to)
+			{
+				for(size_t i = from; i < to; ++i)
+					d.add_edge(SnapshotEdgeLength(x, y, z, edges.corners(i)));
+			});
+	}
+
+	QualityPhaseTimer timer(profile, "faces");
+	const QualityGeometrySnapshot::ElementBlock& tris = snap.block(ROID_TRIANGLE);
+	AccumulateElementQualityInChunks(data, tris.num_elements(),
+		NumQualityThreadsFor(tris.num_elements()),
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{
+			TriangleQuality q;
+			for(size_t i = from; i < to; ++i)
+			{
+				SnapshotTriangleQuality(q, x, y, z, tris.corners(i));
+				d.add_face(ROID_TRIANGLE, q.area, q.angles, 3, q.aspectRatio, tris.elems[i]);
+			}
+		});
+
+	const QualityGeometrySnapshot::ElementBlock& quads = snap.block(ROID_QUADRILATERAL);
+	AccumulateElementQualityInChunks(data, quads.num_elements(),
+		NumQualityThreadsFor(quads.num_elements()),
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{
+			std::vector<number> vAngles;
+			for(size_t i = from; i < to; ++i)
+				AddFaceQuality(d, grid, static_cast<Face*>(quads.elems[i]), ROID_QUADRILATERAL, aaPos, vAngles);
+		});
+	timer.set_num_elements(tris.num_elements() + quads.num_elements());
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AccumulateElementQuality3d (snapshot)
+///	Evaluates the quality measures of all elements of a QualityGeometrySnapshot
+/**	See AccumulateElementQuality2d. Tetrahedra are evaluated on the packed
+ *	coordinates by the tetrahedron kernels (see tet_kernels.h), prisms and pyramids
+ *	by their coordinate kernels (see quality_snapshot_kernels.h), all other volumes
+ *	through lib_grid. Vertices, edges and faces are only evaluated if data.metrics
+ *	contains QM_LOWER_DIM.*/
+template <class TAAPosVRT>
+void AccumulateElementQuality3d(ElementQualityData& data, Grid& grid,
+								const QualityGeometrySnapshot& snap,
+								TAAPosVRT& aaPos, QualityProfile* profile = NULL)
+{
+	if(data.metrics & QM_LOWER_DIM)
+		AccumulateElementQuality2d(data, grid, snap, aaPos, profile);
+
+	const number* x = snap.x();
+	const number* y = snap.y();
+	const number* z = snap.z();
+
+	QualityPhaseTimer timer(profile, "volumes");
+	size_t numVolsBefore = data.numVolumes;
+
+	const QualityGeometrySnapshot::ElementBlock& tets = snap.block(ROID_TETRAHEDRON);
+	AccumulateElementQualityInChunks(data, tets.num_elements(),
+		NumQualityThreadsFor(tets.num_elements()),
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{
+			const size_t batchSize = 512;
+			TetKernelResults res;
+			for(size_t i = from; i < to; i += batchSize)
+			{
+				res.evaluate_selected(x, y, z, tets.corners(i), std::min(batchSize, to - i),
+									  d.metrics);
+				d.add_tetrahedra(res, &tets.elems[i]);
+			}
+		});
+
+	const QualityGeometrySnapshot::ElementBlock& prisms = snap.block(ROID_PRISM);
+	AccumulateElementQualityInChunks(data, prisms.num_elements(),
+		NumQualityThreadsFor(prisms.num_elements()),
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{
+			PrismQuality q;
+			for(size_t i = from; i < to; ++i)
+			{
+				SnapshotPrismQuality(q, x, y, z, prisms.corners(i), d.metrics);
+				d.add_prism(q, prisms.elems[i]);
+			}
+		});
+
+	const QualityGeometrySnapshot::ElementBlock& pyramids = snap.block(ROID_PYRAMID);
+	AccumulateElementQualityInChunks(data, pyramids.num_elements(),
+		NumQualityThreadsFor(pyramids.num_elements()),
+		[&](ElementQualityData& d, size_t from, size_t to)
+		{
+			PyramidQuality q;
+			for(size_t i = from; i < to; ++i)
+			{
+				SnapshotPyramidQuality(q, x, y, z, pyramids.corners(i), d.metrics);
+				d.add_pyramid(q, pyramids.elems[i]);
+			}
+		});
+
+	const ReferenceObjectID otherVolTypes[] = {ROID_HEXAHEDRON, ROID_OCTAHEDRON};
+	for(size_t k = 0; k < sizeof(otherVolTypes) / sizeof(otherVolTypes[0]); ++k)
+	{
+		const QualityGeometrySnapshot::ElementBlock& vols = snap.block(otherVolTypes[k]);
+		AccumulateElementQualityInChunks(data, vols.num_elements(),
+			NumQualityThreadsFor(vols.num_elements()),
+			[&](ElementQualityData& d, size_t from, size_t to)
+			{
+				std::vector<number> vDihedrals;
+				for(size_t i = from; i < to; ++i)
+					AddVolumeQuality(d, grid, static_cast<Volume*>(vols.elems[i]), otherVolTypes[k], aaPos, vDihedrals);
+			});
+	}
+	timer.set_num_elements(data.numVolumes - numVolsBefore);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ReduceElementQualityData
+///	Sums up counts, deviations and histograms and reduces the extremal values over all processes.
+void ReduceElementQualityData(ElementQualityData& data);
+
+
+}
+#endif  //__ELEMENT_QUALITY_KERNELS_H__
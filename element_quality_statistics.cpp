@@ -31,11 +31,15 @@
  */
 
 
+#include <limits>
+#include <sstream>
+
 #include "common/util/table.h"
 #include "common/util/stringify.h"
 #include "element_quality_statistics.h"
 #include "lib_grid/grid_objects/tetrahedron_rules.h"
 #include "pcl/pcl_base.h"
+#include "quality_valence.h"
 
 
 namespace ug
@@ -44,71 +48,10 @@ namespace ug
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 //	PrintVertexVolumeValence
-void PrintVertexVolumeValence(MultiGrid& mg, SubsetHandler& sh, int subsetIndex)
+void PrintVertexVolumeValence(MultiGrid& mg, ISubsetHandler& sh, int subsetIndex)
 {
-	AInt aNumElems;
-	mg.attach_to_vertices_dv(aNumElems, 0);
-	Grid::VertexAttachmentAccessor<APosition> aaPos(mg, aPosition);
-	Grid::VertexAttachmentAccessor<AInt> aaNumElems(mg, aNumElems);
-
-	for(VolumeIterator vIter = mg.begin<Volume>(mg.top_level()); vIter != mg.end<Volume>(mg.top_level()); ++vIter)
-	{
-		Volume* vol = *vIter;
-
-		for(size_t i = 0; i < vol->num_vertices(); ++i)
-		{
-			++aaNumElems[vol->vertex(i)];
-		}
-	}
-
-	for(VertexIterator vIter = mg.begin<Vertex>(mg.top_level()); vIter != mg.end<Vertex>(mg.top_level()); ++vIter)
-	{
-		Vertex* vrt = *vIter;
-
-		if(sh.get_subset_index(vrt) == subsetIndex)
-			UG_LOG("Vertex " << aaPos[vrt] << ": aaNumElems[vrt] = " << aaNumElems[vrt] << std::endl);
-	}
-}
-
-
-////////////////////////////////////////////////////////////////////////////////////////////
-//	CreateElementQualityHistogram
-void CreateElementQualityHistogram(vector<int>& histOut, const std::vector<number>& vQualities, int numSections)
-{
-//	Determine min and max quality values and range
-	number minVal = numeric_limits<number>::max();
-	number maxVal = numeric_limits<number>::min();
-
-	for(size_t i = 0; i < vQualities.size(); ++i)
-	{
-		minVal = min(minVal, vQualities[i]);
-		maxVal = max(maxVal, vQualities[i]);
-	}
-
-	number range;
-	range = maxVal - minVal;
-
-	if(range <= 0)
-	{
-		histOut.resize(vQualities.size(), 0);
-		return;
-	}
-
-	histOut.resize(vQualities.size());
-
-//	Calculate correspondence of the i-th quality value to its adequate histogram section
-	for(size_t i = 0; i < vQualities.size(); ++i)
-	{
-		int section = (int)((number)numSections * (vQualities[i] - minVal) / range);
-
-		if(section < 0)
-			section = 0;
-
-		if(section >= numSections)
-			section = numSections - 1;
-
-		histOut[i] = section;
-	}
+	VertexValences valences(mg, 3, mg.top_level());
+	valences.print(&sh, subsetIndex);
 }
 
 
@@ -129,26 +72,21 @@ void AssignSubsetToElementWithSmallestMinAngle(MultiGrid& grid, MGSubsetHandler&
 //	AssignSubsetToElementWithSmallestMinAngle2d
 void AssignSubsetToElementWithSmallestMinAngle2d(MultiGrid& grid, MGSubsetHandler& sh, const char* roid, int si)
 {
-	Selector sel(grid);
 	GridObjectCollection goc = grid.get_grid_objects();
 	Grid::VertexAttachmentAccessor<APosition2> aaPos(grid, aPosition2);
 	uint i = goc.num_levels() - 1;
 
 	if(strcmp(roid, "triangle") == 0 || strcmp(roid, "quadrilateral") == 0)
 	{
-		Face* minAngleElement;
-		minAngleElement = FindElementWithSmallestMinAngle(	grid,
-															goc.begin<Face>(i),
-															goc.end<Face>(i),
-															aaPos);
-
-		sel.select(minAngleElement);
-		CloseSelection(sel);
+		WorstElementTracker minAngleElement(1, false);
+		TrackMinAngles(minAngleElement, grid, goc.begin<Face>(i), goc.end<Face>(i), aaPos);
+		minAngleElement.compute_centers(aaPos);
 
-		sh.assign_subset(sel.begin<Vertex>(), sel.end<Vertex>(), si);
-		sh.assign_subset(sel.begin<Edge>(), sel.end<Edge>(), si);
-		sh.assign_subset(sel.begin<Face>(), sel.end<Face>(), si);
+		WorstElementTracker* trackers[] = {&minAngleElement};
+		AllreduceWorstElements(trackers, 1);
 
+	//	only the process owning the element assigns it
+		minAngleElement.assign_subset(sh, si);
 		sh.set_subset_name("face_with_smallest_minAngle", si);
 	}
 	else
@@ -162,44 +100,29 @@ void AssignSubsetToElementWithSmallestMinAngle2d(MultiGrid& grid, MGSubsetHandle
 //	AssignSubsetToElementWithSmallestMinAngle3d
 void AssignSubsetToElementWithSmallestMinAngle3d(MultiGrid& grid, MGSubsetHandler& sh, const char* roid, int si)
 {
-	Selector sel(grid);
 	GridObjectCollection goc = grid.get_grid_objects();
 	Grid::VertexAttachmentAccessor<APosition> aaPos(grid, aPosition);
 	uint i = goc.num_levels() - 1;
+	WorstElementTracker minAngleElement(1, false);
+	WorstElementTracker* trackers[] = {&minAngleElement};
 
 	if(strcmp(roid, "triangle") == 0 || strcmp(roid, "quadrilateral") == 0)
 	{
-		Face* minAngleElement;
-		minAngleElement = FindElementWithSmallestMinAngle(	grid,
-															goc.begin<Face>(i),
-															goc.end<Face>(i),
-															aaPos);
-
-		sel.select(minAngleElement);
-		CloseSelection(sel);
-
-		sh.assign_subset(sel.begin<Vertex>(), sel.end<Vertex>(), si);
-		sh.assign_subset(sel.begin<Edge>(), sel.end<Edge>(), si);
-		sh.assign_subset(sel.begin<Face>(), sel.end<Face>(), si);
+		TrackMinAngles(minAngleElement, grid, goc.begin<Face>(i), goc.end<Face>(i), aaPos);
+		minAngleElement.compute_centers(aaPos);
+		AllreduceWorstElements(trackers, 1);
 
+	//	only the process owning the element assigns it
+		minAngleElement.assign_subset(sh, si);
 		sh.set_subset_name("face_with_smallest_minAngle", si);
 	}
 	else if(strcmp(roid, "tetrahedron") == 0)
 	{
-		Tetrahedron* minAngleElement;
-		minAngleElement = FindElementWithSmallestMinAngle(	grid,
-															goc.begin<Tetrahedron>(i),
-															goc.end<Tetrahedron>(i),
-															aaPos);
-
-		sel.select(minAngleElement);
-		CloseSelection(sel);
-
-		sh.assign_subset(sel.begin<Vertex>(), sel.end<Vertex>(), si);
-		sh.assign_subset(sel.begin<Edge>(), sel.end<Edge>(), si);
-		sh.assign_subset(sel.begin<Face>(), sel.end<Face>(), si);
-		sh.assign_subset(sel.begin<Volume>(), sel.end<Volume>(), si);
+		TrackMinAngles(minAngleElement, grid, goc.begin<Tetrahedron>(i), goc.end<Tetrahedron>(i), aaPos);
+		minAngleElement.compute_centers(aaPos);
+		AllreduceWorstElements(trackers, 1);
 
+		minAngleElement.assign_subset(sh, si);
 		sh.set_subset_name("tet_with_smallest_minAngle", si);
 	}
 	else
@@ -219,11 +142,17 @@ void MeasureTetrahedronWithSmallestMinAngle(MultiGrid& grid)
 	Grid::VertexAttachmentAccessor<APosition> aaPos(grid, aPosition);
 	uint i = goc.num_levels() - 1;
 
-	Tetrahedron* minAngleElement;
-	minAngleElement = FindElementWithSmallestMinAngle(	grid,
-														goc.begin<Tetrahedron>(i),
-														goc.end<Tetrahedron>(i),
-														aaPos);
+	WorstElementTracker tracker(1, false);
+	TrackMinAngles(tracker, grid, goc.begin<Tetrahedron>(i), goc.end<Tetrahedron>(i), aaPos);
+	tracker.compute_centers(aaPos);
+
+	WorstElementTracker* trackers[] = {&tracker};
+	AllreduceWorstElements(trackers, 1);
+
+//	the measures are taken by the process owning the element
+	if(tracker.num() == 0 || !tracker.entry(0).elem)
+		return;
+	Tetrahedron* minAngleElement = static_cast<Tetrahedron*>(tracker.entry(0).elem);
 
 	sel.select(minAngleElement);
 	CloseSelection(sel);
@@ -290,120 +219,137 @@ void MeasureTetrahedronWithSmallestMinAngle(MultiGrid& grid)
 //	FindBoundsForStiffnesMatrixMaxEigenvalue
 void FindBoundsForStiffnesMatrixMaxEigenvalue(MultiGrid& mg, MGSubsetHandler& shOut)
 {
-	Selector sel(mg);
-
-//	Vertex valence defitions
-	AInt aNumElems;
-	mg.attach_to_vertices_dv(aNumElems, 0);
 	Grid::VertexAttachmentAccessor<APosition> aaPos(mg, aPosition);
-	Grid::VertexAttachmentAccessor<AInt> aaNumElems(mg, aNumElems);
 
-//	Bound defining volume
-	Volume* bdv = *mg.begin<Volume>(mg.top_level());
+//	Collect the volumes of the top level, grouped by their type sections
+//	(ghosts and horizontal slaves are skipped in parallel)
+	GridObjectCollection goc = mg.get_grid_objects();
+	ElementsByType<Volume> vols;
+	vols.collect(mg, goc, mg.top_level());
 
-//	Measurement values
-	number volume = 0.0;
-	number faceArea = 0.0;
-	number faceAreaNormSquared_a = 0.0;
-	number edgeLength = 0.0;
-	number edgeLengthNormSq_b = 0.0;
-	number upperBound = 0.0;
-	number upperBoundTmp = 0.0;
-	int maxVertexValence = 0;
+//	Vertex valences, summed over process interfaces
+	VertexValences valences(mg, 3, mg.top_level());
 
-//	Calculate vertex valences
-	for(VolumeIterator vIter = mg.begin<Volume>(mg.top_level()); vIter != mg.end<Volume>(mg.top_level()); ++vIter)
-	{
-		Volume* vol = *vIter;
+//	Determine bound defining volume. Each volume's faces are taken from its
+//	face descriptors, so that no closure has to be built per volume.
+	size_t numThreads = NumQualityThreadsFor(vols.size());
+	vector<number> threadUpperBound(numThreads, 0.0);
+	vector<size_t> threadBdv(numThreads, vols.size());
 
-		for(size_t i = 0; i < vol->num_vertices(); ++i)
+	ParallelForChunks(vols.size(), numThreads,
+		[&](size_t t, size_t from, size_t to)
+		{
+			FaceDescriptor fd;
+			for(size_t i = from; i < to; ++i)
+			{
+				Volume* vol = vols[i];
+
+				number faceAreaNormSquared_a = 0.0;
+				for(size_t j = 0; j < vol->num_faces(); ++j)
+				{
+					vol->face_desc(j, fd);
+					number faceArea = FaceArea(&fd, aaPos);
+					faceAreaNormSquared_a += faceArea*faceArea;
+				}
+
+				number upperBoundTmp = faceAreaNormSquared_a/9.0/CalculateVolume(vol, aaPos);
+
+				if(threadUpperBound[t] < upperBoundTmp)
+				{
+					threadUpperBound[t] = upperBoundTmp;
+					threadBdv[t] = i;
+				}
+			}
+		});
+
+//	merging in thread order keeps the first volume with the largest bound
+	number upperBound = 0.0;
+	size_t bdvIndex = vols.size();
+	for(size_t t = 0; t < numThreads; ++t)
+	{
+		if(upperBound < threadUpperBound[t])
 		{
-			++aaNumElems[vol->vertex(i)];
+			upperBound = threadUpperBound[t];
+			bdvIndex = threadBdv[t];
 		}
 	}
+	Volume* bdv = (bdvIndex < vols.size()) ? vols[bdvIndex] : NULL;
 
-	sel.clear();
+//	Find the process owning the globally bound defining volume (max-loc).
+//	On equal bounds the lowest rank wins.
+	int procRank = 0;
+	int bdvRank = 0;
+	#ifdef UG_PARALLEL
+		procRank = pcl::ProcRank();
+		pcl::ProcessCommunicator pc;
+		struct {double val; int rank;} locMaxLoc, globMaxLoc;
+		locMaxLoc.val = upperBound;
+		locMaxLoc.rank = procRank;
+		pc.allreduce(&locMaxLoc, &globMaxLoc, 1, MPI_DOUBLE_INT, MPI_MAXLOC);
+		upperBound = globMaxLoc.val;
+		bdvRank = globMaxLoc.rank;
+	#endif
 
-//	Determine bound defining volume
-	for(VolumeIterator vIter = mg.begin<Volume>(mg.top_level()); vIter != mg.end<Volume>(mg.top_level()); ++vIter)
+	if(upperBound <= 0.0)
 	{
-		Volume* vol = *vIter;
+		UG_LOG("FindBoundsForStiffnesMatrixMaxEigenvalue: no volume with positive bound on the top level." << std::endl);
+		return;
+	}
 
-		sel.select(vol);
-		CloseSelection(sel);
+//	Take measurements of bdv on its process:
+//	volume, area norm squared a, length norm squared b, volToRMSFaceAreaRatio, max valence
+	double bdvMeasures[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
+	bool bOwnsBdv = (bdvRank == procRank);
 
+	if(bOwnsBdv)
+	{
 	//	Volume
-		volume = CalculateVolume(vol, aaPos);
+		bdvMeasures[0] = CalculateVolume(bdv, aaPos);
 
 	//	Faces
-		for(FaceIterator fIter = sel.begin<Face>(); fIter != sel.end<Face>(); ++fIter)
+		FaceDescriptor fd;
+		for(size_t i = 0; i < bdv->num_faces(); ++i)
 		{
-			Face* f = *fIter;
-			faceArea = CalculateVolume(f, aaPos);
-			faceAreaNormSquared_a += faceArea*faceArea;
+			bdv->face_desc(i, fd);
+			number faceArea = FaceArea(&fd, aaPos);
+			bdvMeasures[1] += faceArea*faceArea;
 		}
 
-		upperBoundTmp = faceAreaNormSquared_a/9.0/volume;
-
-		if(upperBound < upperBoundTmp)
+	//	Edges
+		EdgeDescriptor ed;
+		for(size_t i = 0; i < bdv->num_edges(); ++i)
 		{
-			upperBound = upperBoundTmp;
-			bdv = vol;
+			bdv->edge_desc(i, ed);
+			number edgeLength = EdgeLength(&ed, aaPos);
+			bdvMeasures[2] += edgeLength*edgeLength;
 		}
 
-		sel.clear();
-		faceAreaNormSquared_a = 0.0;
-	}
-
-//	Complementary TetrahedronVolToRMSFaceAreaRatio calculation
-	Tetrahedron* bdt = static_cast<Tetrahedron*>(bdv);
-	number volToRMSFaceAreaRatio = CalculateTetrahedronVolToRMSFaceAreaRatio(mg, bdt, aaPos);
-
-//	Identification of element with smallest TetrahedronVolToRMSFaceAreaRatio for debugging purposes
-//	GridObjectCollection goc = mg.get_grid_objects();
-//	Tetrahedron* bdt_eqs = FindElementWithSmallestVolToRMSFaceAreaRatio(mg,
-//															goc.begin<Tetrahedron>(mg.top_level()),
-//															goc.end<Tetrahedron>(mg.top_level()),
-//															aaPos);
-//	number volToRMSFaceAreaRatio_eqs = CalculateTetrahedronVolToRMSFaceAreaRatio(mg, bdt_eqs, aaPos);
-
-	//sel.select(bdt_eqs);
-	sel.select(bdv);
-	CloseSelection(sel);
-
-//	Take measurements of bdv
-
-//	Volume
-	//volume = CalculateVolume(bdt_eqs, aaPos);
-	volume = CalculateVolume(bdv, aaPos);
-
-//	Faces
-	for(FaceIterator fIter = sel.begin<Face>(); fIter != sel.end<Face>(); ++fIter)
-	{
-		Face* f = *fIter;
-		faceArea = CalculateVolume(f, aaPos);
-		faceAreaNormSquared_a += faceArea*faceArea;
-	}
-
-//	Edges
-	for(EdgeIterator eIter = sel.begin<Edge>(); eIter != sel.end<Edge>(); ++eIter)
-	{
-		Edge* e = *eIter;
-		edgeLength = CalculateVolume(e, aaPos);
-		edgeLengthNormSq_b += edgeLength*edgeLength;
-	}
-
-//	maximal element vertex valence
-	for(VertexIterator vrtIter = sel.begin<Vertex>(); vrtIter != sel.end<Vertex>(); ++vrtIter)
-	{
-		Vertex* vrt = *vrtIter;
+	//	Complementary TetrahedronVolToRMSFaceAreaRatio calculation
+		if(vols.begin(ROID_TETRAHEDRON) <= bdvIndex && bdvIndex < vols.end(ROID_TETRAHEDRON))
+			bdvMeasures[3] = CalculateTetrahedronVolToRMSFaceAreaRatio(mg, static_cast<Tetrahedron*>(bdv), aaPos);
 
-		if(maxVertexValence < aaNumElems[vrt])
+	//	maximal element vertex valence
+		int maxVertexValence = 0;
+		for(size_t i = 0; i < bdv->num_vertices(); ++i)
 		{
-			maxVertexValence = aaNumElems[vrt];
+			if(maxVertexValence < valences.valence(bdv->vertex(i)))
+			{
+				maxVertexValence = valences.valence(bdv->vertex(i));
+			}
 		}
+		bdvMeasures[4] = maxVertexValence;
 	}
 
+	#ifdef UG_PARALLEL
+		pc.broadcast(bdvMeasures, 5, PCL_DT_DOUBLE, bdvRank);
+	#endif
+
+	number volume = bdvMeasures[0];
+	number faceAreaNormSquared_a = bdvMeasures[1];
+	number edgeLengthNormSq_b = bdvMeasures[2];
+	number volToRMSFaceAreaRatio = bdvMeasures[3];
+	int maxVertexValence = (int)bdvMeasures[4];
+
 	cout.precision(17);
 
 	number volToMeanSquareFaceAreaRatio = 4.0/(upperBound*9.0);
@@ -414,7 +360,6 @@ void FindBoundsForStiffnesMatrixMaxEigenvalue(MultiGrid& mg, MGSubsetHandler& sh
 	UG_LOG(std::endl);
 	UG_LOG("volToMeanSquareFaceAreaRatio = " << volToMeanSquareFaceAreaRatio << std::endl);
 	UG_LOG("volToRMSFaceAreaRatio        = " << volToRMSFaceAreaRatio << std::endl);
-//	UG_LOG("volToRMSFaceAreaRatio_eqs    = " << volToRMSFaceAreaRatio_eqs << std::endl);
 	UG_LOG("Lower local bound            = " << upperBound/3.0 << std::endl);
 	UG_LOG("Upper local bound            = " << upperBound << std::endl);
 	UG_LOG("Lower global bound           = " << upperBound/3.0 << std::endl);
@@ -425,66 +370,118 @@ void FindBoundsForStiffnesMatrixMaxEigenvalue(MultiGrid& mg, MGSubsetHandler& sh
 	UG_LOG("Length norm squared b        = " << edgeLengthNormSq_b << std::endl);
 	UG_LOG("-----------------------------------------------------------------------------" << std::endl);
 
-	shOut.assign_subset(sel.begin<Vertex>(), sel.end<Vertex>(), 0);
-	shOut.assign_subset(sel.begin<Edge>(), sel.end<Edge>(), 0);
-	shOut.assign_subset(sel.begin<Face>(), sel.end<Face>(), 0);
-	shOut.assign_subset(sel.begin<Volume>(), sel.end<Volume>(), 0);
+//	Only the owning process marks the bound defining volume and its sides
+	if(bOwnsBdv)
+	{
+		Selector sel(mg);
+		sel.select(bdv);
+		CloseSelection(sel);
+
+		shOut.assign_subset(sel.begin<Vertex>(), sel.end<Vertex>(), 0);
+		shOut.assign_subset(sel.begin<Edge>(), sel.end<Edge>(), 0);
+		shOut.assign_subset(sel.begin<Face>(), sel.end<Face>(), 0);
+		shOut.assign_subset(sel.begin<Volume>(), sel.end<Volume>(), 0);
+	}
 
 	AssignSubsetColors(shOut);
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////
-//	AssignSubsetsByElementQuality3d
-void AssignSubsetsByElementQuality3d(MultiGrid& grid, MGSubsetHandler& sh, int numSecs)
+//	AssignSubsetsByQuality
+///	assigns the elements of a grid to numSecs subsets by their min angle (faces) or min dihedral (volumes)
+/**	The qualities are stored in one array in the order of the collected elements, so
+ *	that neither an element attachment nor per element names are required. The bins
+ *	either have equal widths between the smallest and largest quality or contain the
+ *	same number of elements (quantile bins). In parallel the bin boundaries are those
+ *	of all processes, ghosts and horizontal slaves are assigned but not counted for
+ *	the quantiles.*/
+template <class TElem, class TAAPosVRT>
+static void AssignSubsetsByQuality(Grid& grid, ISubsetHandler& sh, TAAPosVRT& aaPos,
+								   int numSecs, bool bQuantileBins)
 {
-//	Position attachment management
-	Grid::VertexAttachmentAccessor<APosition> aaPos(grid, aPosition);
-
-//	Management for VolumeAttachment aElemID
-	AInt aElemID;
-	grid.attach_to_volumes(aElemID);
-	Grid::VolumeAttachmentAccessor<AInt> aaElemID(grid, aElemID);
+	UG_COND_THROW(numSecs < 1, "AssignSubsetsByElementQuality: at least one section required.");
 
-//	Init vector for element qualities to be stored
-	std::vector<number> vQualities;
+	GridObjectCollection goc = grid.get_grid_objects();
+	ElementsByType<TElem> elems;
+	elems.collect(grid, goc, -1, false);
+
+//	Calculate the min angle / min dihedral for every element (tetrahedra batch-wise)
+	vector<number> vQualities;
+	vQualities.reserve(elems.size());
+	CollectElementMeasures(elems, aaPos, vQualities,
+		[&](TElem* elem){return CalculateMinAngle(grid, elem, aaPos);},
+		[](const TetKernelResults& res, size_t i){return res.minDihedral[i];});
+
+//	Determine the bin boundaries. edges[k] is the lower boundary of bin k.
+	vector<number> edges(numSecs + 1, 0.0);
+	if(bQuantileBins)
+	{
+		DistributedGridManager* dgm = grid.distributed_grid_manager();
+		QualityQuantileSketch sketch(GetQualityQuantileCompression());
+		for(size_t i = 0; i < elems.size(); ++i)
+		{
+			#ifdef UG_PARALLEL
+				if(dgm->is_ghost(elems[i]) || dgm->contains_status(elems[i], ES_H_SLAVE))
+					continue;
+			#endif
+			sketch.add(vQualities[i]);
+		}
 
-	int numElems = 0;
+		QualityQuantileSketch* sketches[] = {&sketch};
+		AllreduceQuantileSketches(sketches, 1);
 
-//	Calculate aspect ratio for every element and attach element id
-	for(VolumeIterator vIter = grid.begin<Volume>(); vIter != grid.end<Volume>(); ++vIter)
-	{
-		//Tetrahedron* tet = static_cast<Tetrahedron*>(*vIter);
-		number q = CalculateMinDihedral(grid, *vIter, aaPos);
-		//ALTERNATIVELY:
-		//number q = CalculateAspectRatio(grid, tet, aaPos);
-		vQualities.push_back(q);
-
-		aaElemID[*vIter] = numElems;
-		numElems++;
+		for(int k = 0; k <= numSecs; ++k)
+			edges[k] = sketch.quantile((number)k / (number)numSecs);
 	}
+	else
+	{
+		number minMax[2] = {numeric_limits<number>::max(), -numeric_limits<number>::max()};
+		for(size_t i = 0; i < vQualities.size(); ++i)
+		{
+			minMax[0] = min(minMax[0], vQualities[i]);
+			minMax[1] = min(minMax[1], -vQualities[i]);
+		}
 
-//	Create element quality histogram by specified number of sections
-	std::vector<int> hist;
-	CreateElementQualityHistogram(hist, vQualities, numSecs);
+		#ifdef UG_PARALLEL
+			if(pcl::NumProcs() > 1){
+				vector<number> locMinMax(minMax, minMax + 2), globMinMax;
+				pcl::ProcessCommunicator pc;
+				pc.allreduce(locMinMax, globMinMax, PCL_RO_MIN);
+				minMax[0] = globMinMax[0];
+				minMax[1] = globMinMax[1];
+			}
+		#endif
 
-//	Assign elements to subsets by their aspect ration and set subset name by quality
-	for(VolumeIterator vIter = grid.begin<Volume>(); vIter != grid.end<Volume>(); ++vIter)
-	{
-		//Tetrahedron* tet = static_cast<Tetrahedron*>(*vIter);
-		sh.assign_subset(*vIter, hist[aaElemID[*vIter]]);
+		if(minMax[0] > -minMax[1])
+			minMax[0] = minMax[1] = 0.0;
 
-		const char* siName = (mkstr(vQualities[aaElemID[*vIter]])).c_str();
-		sh.set_subset_name(siName, hist[aaElemID[*vIter]]);
+		for(int k = 0; k <= numSecs; ++k)
+			edges[k] = minMax[0] + (-minMax[1] - minMax[0]) * (number)k / (number)numSecs;
 	}
 
-//	Set color range for the assigned subsets and name subsets by their qualities
-	for(int i = 0; i < sh.num_subsets(); ++i)
+//	Assign elements to subsets by the bin of their quality. Values on an inner boundary
+//	belong to the upper bin.
+	sh.subset_required(numSecs - 1);
+	for(size_t i = 0; i < elems.size(); ++i)
 	{
+		int bin = (int)(upper_bound(edges.begin() + 1, edges.end() - 1, vQualities[i])
+						- (edges.begin() + 1));
+		sh.assign_subset(elems[i], bin);
+	}
+
+//	Set one name per subset by its quality range and a color range for the subsets
+	const char* measureName = (TElem::dim == 3) ? "minDihedral" : "minAngle";
+	for(int i = 0; i < numSecs; ++i)
+	{
+		stringstream ss;
+		ss << measureName << " " << edges[i] << " - " << edges[i+1];
+		sh.set_subset_name(ss.str().c_str(), i);
+
 		number ia = 0;
 
-		if(sh.num_subsets() > 1)
-			ia = (number)i/ (number)(sh.num_subsets()-1);
+		if(numSecs > 1)
+			ia = (number)i/ (number)(numSecs-1);
 
 		number r = max<number>(0, -1 + 2 * ia);
 		number g = 1. - fabs(2 * (ia - 0.5));
@@ -497,32 +494,193 @@ void AssignSubsetsByElementQuality3d(MultiGrid& grid, MGSubsetHandler& sh, int n
 		si.color.z() = b;
 		si.color.w() = 1.f;
 	}
+}
+
 
-//	Detach VolumeAttachment from grid
-	grid.detach_from_volumes(aElemID);
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AssignSubsetsByElementQuality3d
+void AssignSubsetsByElementQuality3d(MultiGrid& grid, MGSubsetHandler& sh, int numSecs)
+{
+	AssignSubsetsByElementQuality(grid, sh, 3, numSecs, false);
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 //	AssignSubsetsByElementQuality
-void AssignSubsetsByElementQuality(MultiGrid& mg, MGSubsetHandler& sh, int dim, int numSecs)
+void AssignSubsetsByElementQuality(Grid& grid, ISubsetHandler& sh, int dim, int numSecs,
+								   bool bQuantileBins)
 {
-	if(dim == 2){}
+	if(dim == 2)
+	{
+		Grid::VertexAttachmentAccessor<APosition2> aaPos(grid, aPosition2);
+		AssignSubsetsByQuality<Face>(grid, sh, aaPos, numSecs, bQuantileBins);
+	}
 	else if(dim == 3)
-		AssignSubsetsByElementQuality3d(mg, sh, numSecs);
+	{
+		Grid::VertexAttachmentAccessor<APosition> aaPos(grid, aPosition);
+		AssignSubsetsByQuality<Volume>(grid, sh, aaPos, numSecs, bQuantileBins);
+	}
 	else
 		UG_THROW("Only dimensions 2 or 3 supported.");
 }
 
+void AssignSubsetsByElementQuality(MultiGrid& mg, MGSubsetHandler& sh, int dim, int numSecs)
+{
+	AssignSubsetsByElementQuality(mg, sh, dim, numSecs, false);
+}
 
-////////////////////////////////////////////////////////////////////////////////////////////
-//	AssignSubsetsByElementQuality
 void AssignSubsetsByElementQuality(Grid& grid, SubsetHandler& sh, int dim, int numSecs)
 {
-	if(dim == 2){}
-	else if(dim == 3){}
+	AssignSubsetsByElementQuality(grid, sh, dim, numSecs, false);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	EvaluateElementQualityLevel
+void EvaluateElementQualityLevel(ElementQualityData& data, Grid& grid, GridObjectCollection goc,
+								 int dim, int lvl, QualityProfile* profile,
+								 QualitySpatialMap* map)
+{
+	UG_COND_THROW(lvl < 0 || lvl >= (int)goc.num_levels(), "Invalid level " << lvl << ".");
+
+	if(profile)
+		profile->set_level(lvl);
+
+	UG_COND_THROW(map && map->dim() != dim, "The spatial map was created for dimension "
+				  << map->dim() << ", but dimension " << dim << " is evaluated.");
+
+//	the map is only fed during this evaluation
+	data.spatialMap = map;
+	if(map)
+		data.metrics |= map->metric();
+
+	QualityGeometrySnapshot snapshot;
+
+	if(dim == 2)
+	{
+		Grid::VertexAttachmentAccessor<APosition2> aaPos(grid, aPosition2);
+		if(map)
+			map->set_element_positions(aaPos);
+		if(GetQualityStatisticsUseSnapshot())
+		{
+			{
+				QualityPhaseTimer timer(profile, "snapshot");
+				snapshot.build(grid, goc, lvl, aaPos);
+				timer.set_num_elements(snapshot.num_evaluated_elements(2));
+			}
+			AccumulateElementQuality2d(data, grid, snapshot, aaPos, profile);
+		}
+		else
+			AccumulateElementQuality2d(data, grid, goc, lvl, aaPos, profile);
+
+		QualityPhaseTimer timer(profile, "worst_elements");
+		data.compute_worst_element_centers(aaPos);
+	}
+	else if(dim == 3)
+	{
+		Grid::VertexAttachmentAccessor<APosition> aaPos(grid, aPosition);
+		if(map)
+			map->set_element_positions(aaPos);
+		if(GetQualityStatisticsUseSnapshot())
+		{
+			{
+				QualityPhaseTimer timer(profile, "snapshot");
+				snapshot.build(grid, goc, lvl, aaPos);
+				timer.set_num_elements(snapshot.num_evaluated_elements(3));
+			}
+			AccumulateElementQuality3d(data, grid, snapshot, aaPos, profile);
+		}
+		else
+			AccumulateElementQuality3d(data, grid, goc, lvl, aaPos, profile);
+
+		QualityPhaseTimer timer(profile, "worst_elements");
+		data.compute_worst_element_centers(aaPos);
+	}
 	else
 		UG_THROW("Only dimensions 2 or 3 supported.");
+
+	QualityPhaseTimer timer(profile, "reduce");
+	ReduceElementQualityData(data);
+	if(map){
+		map->allreduce();
+		data.spatialMap = NULL;
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeQualityReport
+///	evaluates the levels [lvlBegin, lvlEnd) into a new report
+/**	If map is given, the measure of the map is binned in the same pass (single level only).*/
+static SmartPtr<QualityReport>
+ComputeQualityReport(Grid& grid, GridObjectCollection goc, int dim, int lvlBegin, int lvlEnd,
+					 number angleHistStepSize, number aspectRatioHistStepSize,
+					 unsigned int metrics = QM_ALL, QualitySpatialMap* map = NULL)
+{
+	SmartPtr<QualityReport> report = make_sp(new QualityReport(dim, angleHistStepSize,
+															   aspectRatioHistStepSize, metrics));
+	QualityProfile* profile = GetQualityStatisticsProfiling() ? &report->profile() : NULL;
+
+	for(int i = lvlBegin; i < lvlEnd; ++i)
+		EvaluateElementQualityLevel(report->add_level(i), grid, goc, dim, i, profile, map);
+
+	if(profile){
+		profile->set_level(-1);
+		profile->reduce();
+	}
+	return report;
+}
+
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim)
+{
+	GridObjectCollection goc = mg.get_grid_objects();
+	return ComputeQualityReport(mg, goc, dim, 0, goc.num_levels(), 10.0, 0.1);
+}
+
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim, int lvl)
+{
+	return ComputeQualityReport(mg, mg.get_grid_objects(), dim, lvl, lvl + 1, 10.0, 0.1);
+}
+
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim, number angleHistStepSize,
+											 number aspectRatioHistStepSize)
+{
+	GridObjectCollection goc = mg.get_grid_objects();
+	return ComputeQualityReport(mg, goc, dim, 0, goc.num_levels(),
+								angleHistStepSize, aspectRatioHistStepSize);
+}
+
+SmartPtr<QualityReport> ComputeQualityReport(Grid& grid, int dim)
+{
+	return ComputeQualityReport(grid, grid.get_grid_objects(), dim, 0, 1, 10.0, 0.1);
+}
+
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim, const char* metrics)
+{
+	GridObjectCollection goc = mg.get_grid_objects();
+	return ComputeQualityReport(mg, goc, dim, 0, goc.num_levels(), 10.0, 0.1,
+								ParseQualityMetrics(metrics));
+}
+
+SmartPtr<QualityReport> ComputeQualityReport(Grid& grid, int dim, const char* metrics)
+{
+	return ComputeQualityReport(grid, grid.get_grid_objects(), dim, 0, 1, 10.0, 0.1,
+								ParseQualityMetrics(metrics));
+}
+
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim, int lvl,
+											 SmartPtr<QualitySpatialMap> map)
+{
+	UG_COND_THROW(map.invalid(), "ComputeQualityReport: No spatial map given.");
+	return ComputeQualityReport(mg, mg.get_grid_objects(), dim, lvl, lvl + 1, 10.0, 0.1,
+								QM_ALL, map.get());
+}
+
+SmartPtr<QualityReport> ComputeQualityReport(Grid& grid, int dim, SmartPtr<QualitySpatialMap> map)
+{
+	UG_COND_THROW(map.invalid(), "ComputeQualityReport: No spatial map given.");
+	return ComputeQualityReport(grid, grid.get_grid_objects(), dim, 0, 1, 10.0, 0.1,
+								QM_ALL, map.get());
 }
 
 
@@ -572,693 +730,343 @@ void ElementQualityStatistics(Grid& grid, int dim)
 		UG_THROW("Only dimensions 2 or 3 supported.");
 }
 
-//	Actual procedures
-void ElementQualityStatistics2d(Grid& grid, GridObjectCollection goc, number angleHistStepSize, number aspectRatioHistStepSize, bool bWriteHistograms)
+//	Wrapper for a selection of metrics
+void ElementQualityStatistics(MultiGrid& mg, int dim, const char* metrics, bool bWriteHistograms)
 {
-	//PROFILE_FUNC();
-	Grid::VertexAttachmentAccessor<APosition2> aaPos(grid, aPosition2);
-
-//	Numbers
-	number n_minEdge = 0.0;
-	number n_maxEdge = 0.0;
-	number n_minFace = 0.0;
-	number n_maxFace = 0.0;
-	number n_minFaceAngle = 0.0;
-	number n_maxFaceAngle = 0.0;
-
-	number n_minTriAspectRatio = 0.0;
-	number n_maxTriAspectRatio = 0.0;
-
-	number n_minQuadAspectRatio = 0.0;
-	number n_maxQuadAspectRatio = 0.0;
-
-
-//	Elements
-	Edge* minEdge;
-	Edge* maxEdge;
-	Face* minFace;
-	Face* maxFace;
-	Face* minAngleFace;
-	Face* maxAngleFace;
-
-	Triangle* minAspectRatioTri;
-	Triangle* maxAspectRatioTri;
-
-	Quadrilateral* minAspectRatioQuad;
-	Quadrilateral* maxAspectRatioQuad;
-
-
-//	Basic grid properties on level i
-	UG_LOG(endl << "%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%" << endl);
-	UG_LOG("GRID QUALITY STATISTICS" << endl << endl);
-	UG_LOG("*** Output info:" << endl);
-	UG_LOG("    - The 'aspect ratio' (AR) represents the ratio of minimal height and " << endl <<
-		   "      maximal edge length of a triangle or tetrahedron respectively." << endl);
-	UG_LOG("    - The Min- and MaxAngle-Histogram lists the number of min/max element angles in " << endl <<
-		   "      different degree ranges (dihedrals for volumes!)." << endl << endl);
-	for(uint i = 0; i < goc.num_levels(); ++i)
-	{
-		//PROFILE_BEGIN(eqs_qualityStatistics2d);
-	//	----------
-	//	2D section
-	//	----------
-		minEdge = FindShortestEdge(goc.begin<Edge>(i), goc.end<Edge>(i), aaPos);
-		maxEdge = FindLongestEdge(goc.begin<Edge>(i), goc.end<Edge>(i), aaPos);
-		minFace = FindSmallestFace(goc.begin<Face>(i), goc.end<Face>(i), aaPos);
-		maxFace = FindLargestFace(goc.begin<Face>(i), goc.end<Face>(i), aaPos);
-		minAngleFace = FindElementWithSmallestMinAngle(	grid,
-														goc.begin<Face>(i),
-														goc.end<Face>(i),
-														aaPos);
-		maxAngleFace = FindElementWithLargestMaxAngle(	grid,
-														goc.begin<Face>(i),
-														goc.end<Face>(i),
-														aaPos);
-		if(minEdge != NULL)
-			n_minEdge = EdgeLength(minEdge, aaPos);
-		if(maxEdge != NULL)
-			n_maxEdge = EdgeLength(maxEdge, aaPos);
-		if(minFace != NULL)
-			n_minFace = FaceArea(minFace, aaPos);
-		if(maxFace != NULL)
-			n_maxFace = FaceArea(maxFace, aaPos);
-		if(minAngleFace != NULL)
-			n_minFaceAngle = CalculateMinAngle(grid, minAngleFace, aaPos);
-		if(maxAngleFace != NULL)
-			n_maxFaceAngle = CalculateMaxAngle(grid, maxAngleFace, aaPos);
-
-	//	Check for triangles
-		if(goc.num<Triangle>(i) > 0)
-		{
-			minAspectRatioTri = FindElementWithSmallestAspectRatio(	grid,
-																	goc.begin<Triangle>(i),
-																	goc.end<Triangle>(i),
-																	aaPos);
-			maxAspectRatioTri = FindElementWithLargestAspectRatio(	grid,
-																	goc.begin<Triangle>(i),
-																	goc.end<Triangle>(i),
-																	aaPos);
-			if(minAspectRatioTri != NULL)
-				n_minTriAspectRatio = CalculateAspectRatio(grid, minAspectRatioTri, aaPos);
-			if(maxAspectRatioTri != NULL)
-				n_maxTriAspectRatio = CalculateAspectRatio(grid, maxAspectRatioTri, aaPos);
-		}
-
-	//	Check for quadrilaterals
-		if (goc.num<Quadrilateral>(i) > 0)
-		{
-			minAspectRatioQuad = FindElementWithSmallestAspectRatio(grid,
-																	goc.begin<Quadrilateral>(i),
-																	goc.end<Quadrilateral>(i),
-																	aaPos);
-			maxAspectRatioQuad = FindElementWithLargestAspectRatio(grid,
-																   goc.begin<Quadrilateral>(i),
-																   goc.end<Quadrilateral>(i),
-																   aaPos);
-			if(minAspectRatioQuad != NULL)
-				n_minQuadAspectRatio = CalculateAspectRatio(grid, minAspectRatioQuad, aaPos);
-			if(maxAspectRatioQuad != NULL)
-				n_maxQuadAspectRatio = CalculateAspectRatio(grid, maxAspectRatioQuad, aaPos);
-		}
-		//PROFILE_END();
-
-
-		//PROFILE_BEGIN(eqs_qualityStatisticsOutput);
-	//	Table summary
-		ug::Table<std::stringstream> table(8, 4);
-		table(0, 0) << "Number of volumes"; 	table(0, 1) << goc.num_volumes(i);
-		table(1, 0) << "Number of faces"; 		table(1, 1) << goc.num_faces(i);
-		table(2, 0) << "Number of vertices";	table(2, 1) << goc.num_vertices(i);
-
-		table(3, 0) << " "; table(3, 1) << " ";
-		table(3, 2) << " "; table(3, 3) << " ";
-
-		table(4, 0) << "Shortest edge";	table(4, 1) << n_minEdge;
-		table(4, 2) << "Longest edge";	table(4, 3) << n_maxEdge;
-
-		table(5, 0) << "Smallest face angle";	table(5, 1) << n_minFaceAngle;
-		table(5, 2) << "Largest face angle";	table(5, 3) << n_maxFaceAngle;
-
-		table(6, 0) << "Smallest face";	table(6, 1) << n_minFace;
-		table(6, 2) << "Largest face";	table(6, 3) << n_maxFace;
-
-		if(goc.num<Triangle>(i) > 0)
-		{
-			table(7, 0) << "Smallest triangle AR";	table(7, 1) << n_minTriAspectRatio;
-			table(7, 2) << "Largest triangle AR";	table(7, 3) << n_maxTriAspectRatio;
-		}
-
-		if(goc.num<Quadrilateral>(i) > 0)
-		{
-			table(8, 0) << "Smallest quad AR";	table(8, 1) << n_minQuadAspectRatio;
-			table(8, 2) << "Largest quad AR";	table(8, 3) << n_maxQuadAspectRatio;
-		}
-
-	//	Output section
-		UG_LOG("+++++++++++++++++" << endl);
-		UG_LOG(" Grid level " << i << ":" << endl);
-		UG_LOG("+++++++++++++++++" << endl << endl);
-		UG_LOG(table);
-
-
-		//PROFILE_BEGIN(eqs_minAngleHistogram);
-	//	TODO:
-		//MinAngleHistogram(grid, goc.begin<Face>(i), goc.end<Face>(i), aaPos, angleHistStepSize, i);
-		//MaxAngleHistogram(grid, goc.begin<Face>(i), goc.end<Face>(i), aaPos, angleHistStepSize, i);
-		//PROFILE_END();
-
-		UG_LOG(endl);
-		PrintAngleStatistics2d(grid, goc, i, aaPos);
-	}
-
-	UG_LOG(endl << "%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%" << endl << endl);
+	UG_COND_THROW(dim != 3, "A selection of metrics is only supported in 3d.");
+	ElementQualityStatistics3d(mg, mg.get_grid_objects(), 10.0, 0.1, bWriteHistograms,
+							   ParseQualityMetrics(metrics));
 }
 
-void ElementQualityStatistics3d(Grid& grid, GridObjectCollection goc, number angleHistStepSize, number aspectRatioHistStepSize, bool bWriteHistograms)
+void ElementQualityStatistics(MultiGrid& mg, int dim, const char* metrics)
 {
-	//PROFILE_FUNC();
-	Grid::VertexAttachmentAccessor<APosition> aaPos(grid, aPosition);
-	DistributedGridManager* dgm = grid.distributed_grid_manager();
-
-//	Output
-	vector<number> volMinAngles;
-	vector<number> volMaxAngles;
-	vector<number> volAspectRatios;
-	vector<number> volToRMSFaceAreaRatios;
-	vector<number> faceMinAngles;
-	vector<number> faceMaxAngles;
-
-	//ug::Table<std::stringstream> volMinAngleTable(numRanges, 2);
-	ug::Table<std::stringstream> volMinAngleTable;
-	ug::Table<std::stringstream> volMaxAngleTable;
-	ug::Table<std::stringstream> volAspectRatioTable;
-	ug::Table<std::stringstream> volToRMSFaceAreaRatioTable;
-
-//	Numbers
-	size_t numVertices = 0;
-	size_t numEdges = 0;
-	size_t numFaces = 0;
-	size_t numVolumes = 0;
-
-	number n_minEdge = std::numeric_limits<double>::max();
-	number n_maxEdge = std::numeric_limits<double>::min();
-	number n_minFace = std::numeric_limits<double>::max();
-	number n_maxFace = std::numeric_limits<double>::min();
-	number n_minFaceAngle = std::numeric_limits<double>::max();
-	number n_maxFaceAngle = std::numeric_limits<double>::min();
-
-	number n_minTriAspectRatio = std::numeric_limits<double>::max();
-	number n_maxTriAspectRatio = std::numeric_limits<double>::min();
-
-	number n_minQuadAspectRatio = std::numeric_limits<double>::max();
-	number n_maxQuadAspectRatio = std::numeric_limits<double>::min();
-
-	number n_minVolume = std::numeric_limits<double>::max();
-	number n_maxVolume = std::numeric_limits<double>::min();
-	number n_minVolAngle = std::numeric_limits<double>::max();
-	number n_maxVolAngle = std::numeric_limits<double>::min();
-
-	number n_minTetAspectRatio = std::numeric_limits<double>::max();
-	number n_maxTetAspectRatio = std::numeric_limits<double>::min();
-	number n_minTetVolToRMSFaceAreaRatio = std::numeric_limits<double>::max();
-	number n_maxTetVolToRMSFaceAreaRatio = std::numeric_limits<double>::min();
-
-	number n_minHexAspectRatio = std::numeric_limits<double>::max();
-	number n_maxHexAspectRatio = std::numeric_limits<double>::min();
-	number n_minHexVolToRMSFaceAreaRatio = std::numeric_limits<double>::max();
-	number n_maxHexVolToRMSFaceAreaRatio = std::numeric_limits<double>::min();
-
-
-//	Elements
-	Edge* minEdge;
-	Edge* maxEdge;
-	Face* minFace = NULL;
-	Face* maxFace = NULL;
-	Face* minAngleFace;
-	Face* maxAngleFace;
-
-	Triangle* minAspectRatioTri;
-	Triangle* maxAspectRatioTri;
-
-	Quadrilateral* minAspectRatioQuad;
-	Quadrilateral* maxAspectRatioQuad;
-
-	Volume* minVolume;
-	Volume* maxVolume;
-	Volume* minAngleVol;
-	Volume* maxAngleVol;
-
-	Tetrahedron* minAspectRatioTet;
-	Tetrahedron* maxAspectRatioTet;
-	Tetrahedron* minVolToRMSFaceAreaRatioTet;
-	Tetrahedron* maxVolToRMSFaceAreaRatioTet;
-
-	Hexahedron* minAspectRatioHex;
-	Hexahedron* maxAspectRatioHex;
-
-
-//	Basic grid properties on level i
-	UG_LOG(endl << "%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%" << endl);
-	UG_LOG("GRID QUALITY STATISTICS" << endl << endl);
-	UG_LOG("*** Output info:" << endl);
-	UG_LOG("    - The 'aspect ratio' (AR) represents the ratio of minimal height and " << endl <<
-		   "      maximal edge length of a triangle or tetrahedron respectively." << endl);
-	UG_LOG("    - The Min- and MaxAngle-Histogram lists the number of min/max element angles in " << endl <<
-		   "      different degree ranges (dihedrals for volumes!)." << endl << endl);
-	for(uint i = 0; i < goc.num_levels(); ++i)
-	{
-		//PROFILE_BEGIN(eqs_qualityStatistics2d);
+	ElementQualityStatistics(mg, dim, metrics, false);
+}
 
-	//	--------------------
-	//	Number of elements
-	//	--------------------
-		numVertices = 0;
-		numEdges = 0;
-		numFaces = 0;
-		numVolumes = 0;
+void ElementQualityStatistics(Grid& grid, int dim, const char* metrics, bool bWriteHistograms)
+{
+	UG_COND_THROW(dim != 3, "A selection of metrics is only supported in 3d.");
+	ElementQualityStatistics3d(grid, grid.get_grid_objects(), 10.0, 0.1, bWriteHistograms,
+							   ParseQualityMetrics(metrics));
+}
 
-		for(VertexIterator vrtIter = goc.begin<Vertex>(i); vrtIter != goc.end<Vertex>(i); ++vrtIter)
-		{
-			Vertex* vrt = *vrtIter;
+void ElementQualityStatistics(Grid& grid, int dim, const char* metrics)
+{
+	ElementQualityStatistics(grid, dim, metrics, false);
+}
 
-			#ifdef UG_PARALLEL
-			//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-			//	since they have a copy on another process and
-			//	since we already consider that copy...
-				if(dgm->is_ghost(vrt) || dgm->contains_status(vrt, ES_H_SLAVE))
-					continue;
-			#endif
+//	Actual procedures
+void ElementQualityStatistics2d(Grid& grid, GridObjectCollection goc, number angleHistStepSize, number aspectRatioHistStepSize, bool bWriteHistograms)
+{
+	SmartPtr<QualityReport> report = ComputeQualityReport(grid, goc, 2, 0, goc.num_levels(),
+														  angleHistStepSize, aspectRatioHistStepSize);
+	PrintQualityReport(*report, bWriteHistograms);
+}
 
-			numVertices++;
-		}
+void ElementQualityStatistics3d(Grid& grid, GridObjectCollection goc, number angleHistStepSize, number aspectRatioHistStepSize, bool bWriteHistograms, unsigned int metrics)
+{
+	SmartPtr<QualityReport> report = ComputeQualityReport(grid, goc, 3, 0, goc.num_levels(),
+														  angleHistStepSize, aspectRatioHistStepSize,
+														  metrics);
+	PrintQualityReport(*report, bWriteHistograms);
+}
 
-		for(EdgeIterator eIter = goc.begin<Edge>(i); eIter != goc.end<Edge>(i); ++eIter)
-		{
-			Edge* e = *eIter;
 
-			#ifdef UG_PARALLEL
-			//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-			//	since they have a copy on another process and
-			//	since we already consider that copy...
-				if(dgm->is_ghost(e) || dgm->contains_status(e, ES_H_SLAVE))
-					continue;
-			#endif
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeElementQualityQuantiles
+static SmartPtr<QualityQuantileSketch>
+ComputeElementQualityQuantiles(Grid& grid, GridObjectCollection goc, int dim, int lvl, const char* measure)
+{
+	bool bMinAngle = (strcmp(measure, "min_angle") == 0);
+	UG_COND_THROW(!bMinAngle && strcmp(measure, "aspect_ratio") != 0,
+				  "ComputeElementQualityQuantiles: only 'min_angle' and 'aspect_ratio' supported.");
 
-			numEdges++;
-		}
+	ElementQualityData data;
+	EvaluateElementQualityLevel(data, grid, goc, dim, lvl);
 
-		for(FaceIterator fIter = goc.begin<Face>(i); fIter != goc.end<Face>(i); ++fIter)
-		{
-			Face* f = *fIter;
+	if(dim == 2)
+		return make_sp(new QualityQuantileSketch(bMinAngle ? data.faceMinAngleQuantiles
+														   : data.faceAspectRatioQuantiles));
+	return make_sp(new QualityQuantileSketch(bMinAngle ? data.volMinDihedralQuantiles
+													   : data.volAspectRatioQuantiles));
+}
 
-			#ifdef UG_PARALLEL
-			//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-			//	since they have a copy on another process and
-			//	since we already consider that copy...
-				if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-					continue;
-			#endif
+SmartPtr<QualityQuantileSketch> ComputeElementQualityQuantiles(MultiGrid& mg, int dim, int lvl, const char* measure)
+{
+	return ComputeElementQualityQuantiles(mg, mg.get_grid_objects(), dim, lvl, measure);
+}
 
-			numFaces++;
-		}
+SmartPtr<QualityQuantileSketch> ComputeElementQualityQuantiles(Grid& grid, int dim, const char* measure)
+{
+	return ComputeElementQualityQuantiles(grid, grid.get_grid_objects(), dim, 0, measure);
+}
 
-		for(VolumeIterator vIter = goc.begin<Volume>(i); vIter != goc.end<Volume>(i); ++vIter)
-		{
-			Volume* v = *vIter;
 
-			#ifdef UG_PARALLEL
-			//	ghosts (vertical masters) have to be ignored,
-			//	since they have a copy on another process and
-			//	since we already consider that copy...
-				if(dgm->is_ghost(v))
-					continue;
-			#endif
+////////////////////////////////////////////////////////////////////////////////////////////
+//	FindWorstElements
+SmartPtr<WorstElementTracker> FindWorstElements(MultiGrid& mg, int dim, int lvl, const char* measure, int k)
+{
+	UG_COND_THROW(k < 0, "FindWorstElements: k has to be non-negative.");
+
+	ElementQualityData data;
+	data.set_num_worst_elements((size_t)k);
+	EvaluateElementQualityLevel(data, mg, mg.get_grid_objects(), dim, lvl);
+
+	WorstElementTracker* tracker = NULL;
+	if(strcmp(measure, "face_min_angle") == 0)				tracker = &data.faceMinAngleWorst;
+	else if(strcmp(measure, "face_aspect_ratio") == 0)		tracker = &data.faceAspectRatioWorst;
+	else if(strcmp(measure, "volume_min_dihedral") == 0)	tracker = &data.volMinDihedralWorst;
+	else if(strcmp(measure, "volume_max_dihedral") == 0)	tracker = &data.volMaxDihedralWorst;
+	else if(strcmp(measure, "volume_aspect_ratio") == 0)	tracker = &data.volAspectRatioWorst;
+	else
+		UG_THROW("FindWorstElements: only 'face_min_angle', 'face_aspect_ratio', 'volume_min_dihedral', "
+				 "'volume_max_dihedral' and 'volume_aspect_ratio' supported.");
 
-			numVolumes++;
-		}
+	return make_sp(new WorstElementTracker(*tracker));
+}
 
-		#ifdef UG_PARALLEL
-			if(pcl::NumProcs() > 1){
-			//	sum the numbers of all involved processes. Since we ignored ghosts,
-			//	each process contributes the numbers of a unique part of the grid.
-				pcl::ProcessCommunicator pc;
-				numVertices = pc.allreduce(numVertices, PCL_RO_SUM);
-				numEdges = pc.allreduce(numEdges, PCL_RO_SUM);
-				numFaces = pc.allreduce(numFaces, PCL_RO_SUM);
-				numVolumes = pc.allreduce(numVolumes, PCL_RO_SUM);
-			}
-		#endif
+void SelectWorstElements(MultiGrid& mg, Selector& sel, int dim, const char* measure, int k)
+{
+	FindWorstElements(mg, dim, mg.top_level(), measure, k)->select(sel);
+}
 
-	//	----------
-	//	2D section
-	//	----------
-		minEdge = FindShortestEdge(goc.begin<Edge>(i), goc.end<Edge>(i), aaPos);
-		maxEdge = FindLongestEdge(goc.begin<Edge>(i), goc.end<Edge>(i), aaPos);
-
-		minFace = FindSmallestFace(goc.begin<Face>(i), goc.end<Face>(i), aaPos);
-		maxFace = FindLargestFace(goc.begin<Face>(i), goc.end<Face>(i), aaPos);
-
-		minAngleFace = FindElementWithSmallestMinAngle(	grid,
-														goc.begin<Face>(i),
-														goc.end<Face>(i),
-														aaPos);
-		maxAngleFace = FindElementWithLargestMaxAngle(	grid,
-														goc.begin<Face>(i),
-														goc.end<Face>(i),
-														aaPos);
-		if(minEdge != NULL)
-			n_minEdge = EdgeLength(minEdge, aaPos);
-		if(maxEdge != NULL)
-			n_maxEdge = EdgeLength(maxEdge, aaPos);
-		if(minFace != NULL)
-			n_minFace = FaceArea(minFace, aaPos);
-		if(maxFace != NULL)
-			n_maxFace = FaceArea(maxFace, aaPos);
-		if(minAngleFace != NULL)
-			n_minFaceAngle = CalculateMinAngle(grid, minAngleFace, aaPos);
-		if(maxAngleFace != NULL)
-			n_maxFaceAngle = CalculateMaxAngle(grid, maxAngleFace, aaPos);
-
-	//	Check for triangles
-		if(goc.num<Triangle>(i) > 0)
-		{
-			minAspectRatioTri = FindElementWithSmallestAspectRatio(grid,
-																	goc.begin<Triangle>(i),
-																	goc.end<Triangle>(i),
-																	aaPos);
-			maxAspectRatioTri = FindElementWithLargestAspectRatio(grid,
-																	goc.begin<Triangle>(i),
-																	goc.end<Triangle>(i),
-																	aaPos);
-			if(minAspectRatioTri != NULL)
-				n_minTriAspectRatio = CalculateAspectRatio(grid, minAspectRatioTri, aaPos);
-			if(maxAspectRatioTri != NULL)
-				n_maxTriAspectRatio = CalculateAspectRatio(grid, maxAspectRatioTri, aaPos);
-		}
+void AssignSubsetToWorstElements(MultiGrid& mg, MGSubsetHandler& sh, int dim, const char* measure, int k, int si)
+{
+	FindWorstElements(mg, dim, mg.top_level(), measure, k)->assign_subset(sh, si);
+	sh.set_subset_name(measure, si);
+	AssignSubsetColors(sh);
+}
 
-	//	Check for quadrilaterals
-		if (goc.num<Quadrilateral>(i) > 0)
-		{
-			minAspectRatioQuad = FindElementWithSmallestAspectRatio(grid,
-																	goc.begin<Quadrilateral>(i),
-																	goc.end<Quadrilateral>(i),
-																	aaPos);
-			maxAspectRatioQuad = FindElementWithLargestAspectRatio(	grid,
-																	goc.begin<Quadrilateral>(i),
-																	goc.end<Quadrilateral>(i),
-																	aaPos);
-			if(minAspectRatioQuad != NULL)
-				n_minQuadAspectRatio = CalculateAspectRatio(grid, minAspectRatioQuad, aaPos);
-			if(maxAspectRatioQuad != NULL)
-				n_maxQuadAspectRatio = CalculateAspectRatio(grid, maxAspectRatioQuad, aaPos);
-		}
-		//PROFILE_END();
 
-	//	----------
-	//	3D section
-	//	----------
-		if(goc.num<Volume>(i) > 0)
-		{
-			//PROFILE_BEGIN(eqs_qualityStatistics3d);
-			minVolume = FindSmallestVolume(	goc.begin<Volume>(i),
-											goc.end<Volume>(i),
-											aaPos);
-
-			maxVolume = FindLargestVolume(	goc.begin<Volume>(i),
-											goc.end<Volume>(i),
-											aaPos);
-
-			minAngleVol = FindElementWithSmallestMinAngle(	grid,
-															goc.volumes_begin(i),
-															goc.volumes_end(i),
-															aaPos);
-			maxAngleVol = FindElementWithLargestMaxAngle(	grid,
-															goc.volumes_begin(i),
-															goc.volumes_end(i),
-				 											aaPos);
-
-			if(minVolume != NULL)
-				n_minVolume = CalculateVolume(minVolume, aaPos);
-			if(maxVolume != NULL)
-				n_maxVolume = CalculateVolume(maxVolume, aaPos);
-			if(minAngleVol != NULL)
-				n_minVolAngle = CalculateMinAngle(grid, minAngleVol, aaPos);
-			if(maxAngleVol != NULL)
-				n_maxVolAngle = CalculateMaxAngle(grid, maxAngleVol, aaPos);
-
-		//	Tetrahedron section
-			if(goc.num<Tetrahedron>(i) > 0)
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ReduceElementQualityData
+void ReduceElementQualityData(ElementQualityData& data)
+{
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			size_t* counts[] = {&data.numVertices, &data.numEdges, &data.numFaces, &data.numVolumes};
+
+			QualityMinMax* ranges[] = {&data.edgeLength, &data.faceArea, &data.faceAngle,
+									   &data.triAspectRatio, &data.quadAspectRatio,
+									   &data.volume, &data.volDihedral,
+									   &data.tetAspectRatio, &data.tetVolToRMSFaceAreaRatio,
+									   &data.hexAspectRatio,
+									   &data.prismAspectRatio, &data.prismVolToRMSFaceAreaRatio,
+									   &data.pyramidAspectRatio, &data.pyramidVolToRMSFaceAreaRatio};
+
+			AngleDeviation* deviations[] = {&data.triAngles, &data.quadAngles,
+											&data.tetDihedrals, &data.hexDihedrals, &data.octDihedrals,
+											&data.prismTriQuadDihedrals, &data.prismQuadQuadDihedrals,
+											&data.pyramidBaseDihedrals, &data.pyramidApexDihedrals};
+
+			QualityHistogram* histograms[] = {&data.faceMinAngleHist, &data.faceMaxAngleHist,
+											  &data.faceAspectRatioHist,
+											  &data.volMinAngleHist, &data.volMaxAngleHist,
+											  &data.volAspectRatioHist, &data.volToRMSFaceAreaRatioHist,
+											  &data.prismMinAngleHist, &data.prismAspectRatioHist,
+											  &data.pyramidMinAngleHist, &data.pyramidAspectRatioHist};
+
+			const size_t numCounts = sizeof(counts) / sizeof(counts[0]);
+			const size_t numRanges = sizeof(ranges) / sizeof(ranges[0]);
+			const size_t numDeviations = sizeof(deviations) / sizeof(deviations[0]);
+			const size_t numHistograms = sizeof(histograms) / sizeof(histograms[0]);
+
+		//	pack everything which has to be summed up into one buffer and all extremal
+		//	values into a second one (maxima negated), so that two collectives suffice
+		//	for those.
+			vector<number> locSums, sums, locMins, mins;
+			for(size_t k = 0; k < numCounts; ++k)
+				locSums.push_back((number)*counts[k]);
+			locSums.push_back(data.totalFaceArea);
+			locSums.push_back(data.totalVolume);
+			for(size_t k = 0; k < numRanges; ++k)
 			{
-				minAspectRatioTet = FindElementWithSmallestAspectRatio(	grid,
-
-																		goc.begin<Tetrahedron>(i),
-																		goc.end<Tetrahedron>(i),
-																		aaPos);
-				maxAspectRatioTet = FindElementWithLargestAspectRatio(	grid,
-																		goc.begin<Tetrahedron>(i),
-																		goc.end<Tetrahedron>(i),
-																		aaPos);
-
-				minVolToRMSFaceAreaRatioTet = FindElementWithSmallestVolToRMSFaceAreaRatio(grid,
-																		goc.begin<Tetrahedron>(i),
-																		goc.end<Tetrahedron>(i),
-																		aaPos);
-				maxVolToRMSFaceAreaRatioTet = FindElementWithLargestVolToRMSFaceAreaRatio(grid,
-																		goc.begin<Tetrahedron>(i),
-																		goc.end<Tetrahedron>(i),
-																		aaPos);
-
-
-
-				if(minAspectRatioTet != NULL)
-					n_minTetAspectRatio = CalculateAspectRatio(grid, minAspectRatioTet, aaPos);
-				if(maxAspectRatioTet != NULL)
-					n_maxTetAspectRatio = CalculateAspectRatio(grid, maxAspectRatioTet, aaPos);
-				if(minVolToRMSFaceAreaRatioTet != NULL)
-					n_minTetVolToRMSFaceAreaRatio = CalculateVolToRMSFaceAreaRatio(grid, minVolToRMSFaceAreaRatioTet, aaPos);
-				if(maxVolToRMSFaceAreaRatioTet != NULL)
-					n_maxTetVolToRMSFaceAreaRatio = CalculateVolToRMSFaceAreaRatio(grid, maxVolToRMSFaceAreaRatioTet, aaPos);
+				locSums.push_back((number)ranges[k]->num);
+				locMins.push_back(ranges[k]->min);
+				locMins.push_back(-ranges[k]->max);
 			}
-
-		//	Hexahedron section
-			if (goc.num<Hexahedron>(i) > 0) {
-				minAspectRatioHex = FindElementWithSmallestAspectRatio(	grid,
-																		goc.begin<Hexahedron>(i),
-																		goc.end<Hexahedron>(i),
-																		aaPos);
-				maxAspectRatioHex = FindElementWithLargestAspectRatio(	grid,
-																		goc.begin<Hexahedron>(i),
-																		goc.end<Hexahedron>(i),
-																		aaPos);
-
-				if(minAspectRatioHex != NULL)
-					n_minHexAspectRatio = CalculateAspectRatio(grid, minAspectRatioHex, aaPos);
-				if(maxAspectRatioHex != NULL)
-					n_maxHexAspectRatio = CalculateAspectRatio(grid, maxAspectRatioHex, aaPos);
+			for(size_t k = 0; k < numDeviations; ++k)
+				locSums.push_back((number)deviations[k]->numElems);
+			for(size_t k = 0; k < numHistograms; ++k)
+				histograms[k]->pack(locSums, locMins);
+			data.edgeStatistics.pack(locSums, locMins);
+
+		//	sum the numbers of all involved processes. Since we ignored ghosts,
+		//	each process contributes the numbers of a unique part of the grid.
+			pcl::ProcessCommunicator pc;
+			pc.allreduce(locSums, sums, PCL_RO_SUM);
+			pc.allreduce(locMins, mins, PCL_RO_MIN);
+
+			size_t s = 0;
+			for(size_t k = 0; k < numCounts; ++k)
+				*counts[k] = (size_t)sums[s++];
+			data.totalFaceArea = sums[s++];
+			data.totalVolume = sums[s++];
+			for(size_t k = 0; k < numRanges; ++k)
+			{
+				ranges[k]->num = (size_t)sums[s++];
+				ranges[k]->min = mins[2*k];
+				ranges[k]->max = -mins[2*k+1];
 			}
+			for(size_t k = 0; k < numDeviations; ++k)
+				deviations[k]->numElems = (size_t)sums[s++];
+			size_t m = 2*numRanges;
+			for(size_t k = 0; k < numHistograms; ++k)
+				histograms[k]->unpack(sums, s, mins, m);
+			data.edgeStatistics.unpack(sums, s, mins, m);
+
+		//	the angle and edge length moments are merged pairwise in a third collective
+			MomentAccumulator* moments[numDeviations + 1];
+			for(size_t k = 0; k < numDeviations; ++k)
+				moments[k] = &deviations[k]->angles;
+			moments[numDeviations] = &data.edgeStatistics.moments();
+			AllreduceMoments(moments, numDeviations + 1);
+
+		//	sketches and worst elements are only fed by the angle and aspect ratio
+		//	metrics. Since the metrics are the same on all processes, their
+		//	collectives can be skipped without them.
+			if(!(data.metrics & (QM_MIN_DIHEDRAL | QM_MAX_DIHEDRAL | QM_ASPECT_RATIO | QM_LOWER_DIM)))
+				return;
+
+		//	the quantile sketches are merged by one reduction
+			QualityQuantileSketch* sketches[] = {&data.faceMinAngleQuantiles, &data.faceAspectRatioQuantiles,
+												 &data.volMinDihedralQuantiles, &data.volAspectRatioQuantiles};
+			AllreduceQuantileSketches(sketches, sizeof(sketches) / sizeof(sketches[0]));
+
+		//	the worst elements of all processes (the centers have to be computed already)
+			WorstElementTracker* trackers[] = {&data.faceMinAngleWorst, &data.faceAspectRatioWorst,
+											   &data.volMinDihedralWorst, &data.volMaxDihedralWorst,
+											   &data.volAspectRatioWorst};
+			AllreduceWorstElements(trackers, sizeof(trackers) / sizeof(trackers[0]));
 		}
+	#endif
+}
 
-		#ifdef UG_PARALLEL
-			if(pcl::NumProcs() > 1){
-			//	sum the numbers of all involved processes. Since we ignored ghosts,
-			//	each process contributes the numbers of a unique part of the grid.
-				pcl::ProcessCommunicator pc;
-				n_minEdge = pc.allreduce(n_minEdge, PCL_RO_MIN);
-				n_maxEdge = pc.allreduce(n_maxEdge, PCL_RO_MAX);
-				n_minFace = pc.allreduce(n_minFace, PCL_RO_MIN);
-				n_maxFace = pc.allreduce(n_maxFace, PCL_RO_MAX);
-				n_minFaceAngle = pc.allreduce(n_minFaceAngle, PCL_RO_MIN);
-				n_maxFaceAngle = pc.allreduce(n_maxFaceAngle, PCL_RO_MAX);
-				n_minTriAspectRatio = pc.allreduce(n_minTriAspectRatio, PCL_RO_MIN);
-				n_maxTriAspectRatio = pc.allreduce(n_maxTriAspectRatio, PCL_RO_MAX);
-//				n_minQuadAngle = pc.allreduce(n_minQuadAngle, PCL_RO_MIN);
-//				n_maxQuadAngle = pc.allreduce(n_maxQuadAngle, PCL_RO_MAX);
-				n_minQuadAspectRatio = pc.allreduce(n_minQuadAspectRatio, PCL_RO_MIN);
-				n_maxQuadAspectRatio = pc.allreduce(n_maxQuadAspectRatio, PCL_RO_MAX);
-				n_minVolume = pc.allreduce(n_minVolume, PCL_RO_MIN);
-				n_maxVolume = pc.allreduce(n_maxVolume, PCL_RO_MAX);
-				n_minVolAngle = pc.allreduce(n_minVolAngle, PCL_RO_MIN);
-				n_maxVolAngle = pc.allreduce(n_maxVolAngle, PCL_RO_MAX);
-				n_minTetAspectRatio = pc.allreduce(n_minTetAspectRatio, PCL_RO_MIN);
-				n_maxTetAspectRatio = pc.allreduce(n_maxTetAspectRatio, PCL_RO_MAX);
-				n_minTetVolToRMSFaceAreaRatio = pc.allreduce(n_minTetVolToRMSFaceAreaRatio, PCL_RO_MIN);
-				n_maxTetVolToRMSFaceAreaRatio = pc.allreduce(n_maxTetVolToRMSFaceAreaRatio, PCL_RO_MAX);
-			}
-		#endif
-
-		//PROFILE_BEGIN(eqs_qualityStatisticsOutput);
-	//	Table summary
-		ug::Table<std::stringstream> table(11, 4);
-		table(0, 0) << "Number of volumes"; 	table(0, 1) << numVolumes;
-		table(1, 0) << "Number of faces"; 		table(1, 1) << numFaces;
-		table(2, 0) << "Number of vertices";	table(2, 1) << numVertices;
-
-		table(3, 0) << " "; table(3, 1) << " ";
-		table(3, 2) << " "; table(3, 3) << " ";
-
-		table(4, 0) << "Shortest edge";	table(4, 1) << n_minEdge;
-		table(4, 2) << "Longest edge";	table(4, 3) << n_maxEdge;
-
-		table(5, 0) << "Smallest face angle";	table(5, 1) << n_minFaceAngle;
-		table(5, 2) << "Largest face angle";	table(5, 3) << n_maxFaceAngle;
 
-		if(goc.num<Triangle>(i) > 0)
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrintAngleStatistics2d
+void PrintAngleStatistics2d(const ElementQualityData& data)
+{
+//	Output standard deviation for triangular/quadrilateral angles
+	if(data.triAngles.numElems > 0 || data.quadAngles.numElems > 0)
+	{
+		UG_LOG("(*) Standard deviation of face angles to regular case" << endl);
+		UG_LOG("	(60° for triangles, 90° for quadrilaterals)" << endl);
+		UG_LOG(endl);
+		UG_LOG("	Triangles (" << data.triAngles.numElems << "):" << endl);
+		if(data.triAngles.numElems > 0)
 		{
-			table(6, 0) << "Smallest triangle AR"; table(6, 1) << n_minTriAspectRatio;
-			table(6, 2) << "Largest triangle AR"; table(6, 3) << n_maxTriAspectRatio;
+			UG_LOG("		sd   = " << data.triAngles.standard_deviation() << endl);
+			UG_LOG("		mean = " << data.triAngles.mean() << endl);
 		}
-
-		if (goc.num<Quadrilateral>(i) > 0)
+		UG_LOG(endl);
+		UG_LOG("	Quadrilaterals (" << data.quadAngles.numElems << "):" << endl);
+		if(data.quadAngles.numElems > 0)
 		{
-			table(7, 0) << "Smallest quadrilateral AR"; table(7, 1) << n_minQuadAspectRatio;
-			table(7, 2) << "Largest quadrilateral AR"; table(7, 3) << n_maxQuadAspectRatio;
+			UG_LOG("		sd   = " << data.quadAngles.standard_deviation() << endl);
+			UG_LOG("		mean = " << data.quadAngles.mean() << endl);
 		}
+		UG_LOG(endl);
+	}
 
-		table(8, 0) << "Smallest face";	table(8, 1) << n_minFace;
-		table(8, 2) << "Largest face";	table(8, 3) << n_maxFace;
-
-		if(goc.num_volumes(i) > 0)
-		{
-			table(9, 0) << "Smallest volume";		table(9, 1) << n_minVolume;
-			table(9, 2) << "Largest volume";		table(9, 3) << n_maxVolume;
-			table(10, 0) << "Smallest volume dihedral";	table(10, 1) << n_minVolAngle;
-			table(10, 2) << "Largest volume dihedral";	table(10, 3) << n_maxVolAngle;
-
-			if(goc.num<Tetrahedron>(i) > 0)
-			{
-				table(11, 0) << "Smallest tet AR";	table(11, 1) << n_minTetAspectRatio;
-				table(11, 2) << "Largest tet AR";	table(11, 3) << n_maxTetAspectRatio;
-				table(12, 0) << "Smallest tet Vol/FaceAreaRatio";	table(12, 1) << n_minTetVolToRMSFaceAreaRatio;
-				table(12, 2) << "Largest tet Vol/FaceAreaRatio";	table(12, 3) << n_maxTetVolToRMSFaceAreaRatio;
-			}
-
-			if (goc.num<Hexahedron>(i) > 0) {
-				table(13, 0) << "Smallest hex AR";	table(13, 1) << n_minHexAspectRatio;
-				table(13, 2) << "Largest hex AR";	table(13, 3) << n_maxHexAspectRatio;
-				table(14, 0) << "Smallest hex Vol/FaceAreaRatio";	table(14, 1) << n_minHexVolToRMSFaceAreaRatio;
-				table(14, 2) << "Largest hex Vol/FaceAreaRatio";	table(14, 3) << n_maxHexVolToRMSFaceAreaRatio;
-			}
-		}
+}
 
 
-	//	Output section
-		UG_LOG("+++++++++++++++++" << endl);
-		UG_LOG(" Grid level " << i << ":" << endl);
-		UG_LOG("+++++++++++++++++" << endl << endl);
-		UG_LOG(table);
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrintAngleStatistics3d
+void PrintAngleStatistics3d(const ElementQualityData& data)
+{
+	PrintAngleStatistics2d(data);
 
-		//PROFILE_BEGIN(eqs_minAngleHistogram);
-		if(goc.num_volumes(i) > 0)
+//	Output standard deviation for tetrahedral/hexahedral/octahedral dihedrals
+	if(data.tetDihedrals.numElems > 0 || data.hexDihedrals.numElems > 0 || data.octDihedrals.numElems > 0)
+	{
+		UG_LOG("(*) Standard deviation of dihedral angles to regular case" << endl);
+		UG_LOG("	(70.5288° for tetrahedrons, 90° for hexahedrons, 109.471° for Octahedrons)" << endl);
+		UG_LOG(endl);
+		UG_LOG("	Tetrahedrons (" << data.tetDihedrals.numElems << "):" << endl);
+		if(data.tetDihedrals.numElems > 0)
 		{
-			volMinAngles.clear();
-			volMaxAngles.clear();
-			volAspectRatios.clear();
-			volToRMSFaceAreaRatios.clear();
-
-			CollectMinAngles(grid, goc.begin<Volume>(i), goc.end<Volume>(i), aaPos, volMinAngles);
-			CollectMaxAngles(grid, goc.begin<Volume>(i), goc.end<Volume>(i), aaPos, volMaxAngles);
-			CollectAspectRatios(grid, goc.begin<Volume>(i), goc.end<Volume>(i), aaPos, volAspectRatios);
-			CollectVolToRMSFaceAreaRatios(grid, goc.begin<Volume>(i), goc.end<Volume>(i), aaPos, volToRMSFaceAreaRatios);
+			UG_LOG("		sd   = " << data.tetDihedrals.standard_deviation() << endl);
+			UG_LOG("		mean = " << data.tetDihedrals.mean() << endl);
 		}
-		else
+		UG_LOG(endl);
+		UG_LOG("	Hexahedrons (" << data.hexDihedrals.numElems << "):" << endl);
+		if(data.hexDihedrals.numElems > 0)
 		{
-		//	TODO:
-//			CollectMinAngles(grid, goc.begin<Face>(i), goc.end<Face>(i), aaPos, faceMinAngles);
-//			CollectMaxAngles(grid, goc.begin<Face>(i), goc.end<Face>(i), aaPos, faceMaxAngles);
-//			CollectAspectRatios(grid, goc.begin<Face>(i), goc.end<Face>(i), aaPos, faceAspectRatios);
+			UG_LOG("		sd   = " << data.hexDihedrals.standard_deviation() << endl);
+			UG_LOG("		mean = " << data.hexDihedrals.mean() << endl);
 		}
-		//PROFILE_END();
-
-		UG_LOG(endl << "(*) MinAngle-Histogram for '" << "3d' elements");
 		UG_LOG(endl);
-		volMinAngleTable.clear();
-		PrintAngleHistogram(volMinAngles, angleHistStepSize, volMinAngleTable);
-
-		UG_LOG(endl << "(*) MaxAngle-Histogram for '" << "3d' elements");
+		UG_LOG("	Octahedrons (" << data.octDihedrals.numElems << "):" << endl);
+		if(data.octDihedrals.numElems > 0)
+		{
+			UG_LOG("		sd   = " << data.octDihedrals.standard_deviation() << endl);
+			UG_LOG("		mean = " << data.octDihedrals.mean() << endl);
+		}
 		UG_LOG(endl);
-		volMaxAngleTable.clear();
-		PrintAngleHistogram(volMaxAngles, angleHistStepSize, volMaxAngleTable);
+	}
 
-		UG_LOG(endl << "(*) AspectRatio-Histogram for '" << "3d' elements");
+//	Prisms and pyramids have two kinds of dihedrals, which are given separately
+	if(data.prismTriQuadDihedrals.numElems > 0 || data.pyramidBaseDihedrals.numElems > 0)
+	{
+		UG_LOG("(*) Standard deviation of prism and pyramid dihedral angles to regular case" << endl);
+		UG_LOG("	(prisms: 90° at triangle edges, 60° between quadrilaterals," << endl);
+		UG_LOG("	 pyramids: 54.7356° at base edges, 109.471° at apex edges)" << endl);
 		UG_LOG(endl);
-		volAspectRatioTable.clear();
-		PrintAspectRatioHistogram(volAspectRatios, aspectRatioHistStepSize, volAspectRatioTable);
-
-		UG_LOG(endl << "(*) VolToRMSFaceAreaRatioHistogram-Histogram for '" << "3d' elements");
+		UG_LOG("	Prisms (" << data.prismTriQuadDihedrals.numElems << "):" << endl);
+		if(data.prismTriQuadDihedrals.numElems > 0)
+		{
+			UG_LOG("		triangle edges:       sd   = " << data.prismTriQuadDihedrals.standard_deviation() << endl);
+			UG_LOG("		                      mean = " << data.prismTriQuadDihedrals.mean() << endl);
+			UG_LOG("		quadrilateral edges:  sd   = " << data.prismQuadQuadDihedrals.standard_deviation() << endl);
+			UG_LOG("		                      mean = " << data.prismQuadQuadDihedrals.mean() << endl);
+		}
 		UG_LOG(endl);
-		volToRMSFaceAreaRatioTable.clear();
-		PrintAspectRatioHistogram(volToRMSFaceAreaRatios, aspectRatioHistStepSize, volToRMSFaceAreaRatioTable);
-
-	//	----------------------------------------
-	//	Histogram table file output section
-	//	----------------------------------------
-		if(bWriteHistograms)
+		UG_LOG("	Pyramids (" << data.pyramidBaseDihedrals.numElems << "):" << endl);
+		if(data.pyramidBaseDihedrals.numElems > 0)
 		{
-			int procRank = 0;
-			#ifdef UG_PARALLEL
-				procRank = pcl::ProcRank();
-			#endif
-			if(procRank == 0)
-			{
-				ofstream ofstr;
-				std::stringstream ss;
-				ss << "volMinAngles_lvl_" << i << ".csv";
-				ofstr.open(ss.str().c_str());
-				ofstr << volMinAngleTable.to_csv(";");
-				ofstr.close();
-
-				ofstr.clear();
-				ss.str("");
-				ss << "volMaxAngles_lvl_" << i << ".csv";
-				ofstr.open(ss.str().c_str());
-				ofstr << volMaxAngleTable.to_csv(";");
-				ofstr.close();
-
-				ofstr.clear();
-				ss.str("");
-				ss << "volAspectRatios_lvl_" << i << ".csv";
-				ofstr.open(ss.str().c_str());
-				ofstr << volAspectRatioTable.to_csv(";");
-				ofstr.close();
-
-				ofstr.clear();
-				ss.str("");
-				ss << "volToRMSFaceAreaRatios_lvl_" << i << ".csv";
-				ofstr.open(ss.str().c_str());
-				ofstr << volToRMSFaceAreaRatioTable.to_csv(";");
-				ofstr.close();
-			}
+			UG_LOG("		base edges:           sd   = " << data.pyramidBaseDihedrals.standard_deviation() << endl);
+			UG_LOG("		                      mean = " << data.pyramidBaseDihedrals.mean() << endl);
+			UG_LOG("		apex edges:           sd   = " << data.pyramidApexDihedrals.standard_deviation() << endl);
+			UG_LOG("		                      mean = " << data.pyramidApexDihedrals.mean() << endl);
 		}
-
 		UG_LOG(endl);
-		PrintAngleStatistics3d(grid, goc, i, aaPos);
 	}
+}
 
-	UG_LOG(endl << "%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%" << endl << endl);
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrintWorstElements
+void PrintWorstElements(const ElementQualityData& data)
+{
+	const WorstElementTracker* trackers[] = {&data.faceMinAngleWorst, &data.faceAspectRatioWorst,
+											 &data.volMinDihedralWorst, &data.volMaxDihedralWorst,
+											 &data.volAspectRatioWorst};
+	const char* names[] = {"Face min angle", "Face AR", "Volume min dihedral",
+						   "Volume max dihedral", "Volume AR"};
+
+	for(size_t k = 0; k < sizeof(trackers) / sizeof(trackers[0]); ++k)
+	{
+		if(trackers[k]->num() == 0)
+			continue;
+		UG_LOG("(*) " << trackers[k]->num() << " worst elements by " << names[k] << endl);
+		trackers[k]->print(names[k]);
+		UG_LOG(endl);
+	}
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 //	PrintHistograms
 ////////////////////////////////////////////////////////////////////////////////////////////
-void PrintAngleHistogram(vector<number>& locAngles, number stepSize, ug::Table<std::stringstream>& outTable)
+void PrintAngleHistogram(const QualityHistogram& hist, ug::Table<std::stringstream>& outTable)
 {
-	vector<number> angles;
-
-	#ifdef UG_PARALLEL
-	//	propagate to all processes
-		pcl::ProcessCommunicator pc;
-		pc.allgatherv(angles, locAngles);
-	#else
-		angles = locAngles;
-	#endif
-
-//	Sort the calculated angles in an ascending way
-	sort (angles.begin(), angles.end());
+	if(hist.num_values() == 0)
+		return;
 
 //	Evaluate the minimal and maximal degree rounding to 10
-	int minDeg = round(number(angles.front()) / 10.0) * 10;
-	int maxDeg = round(number(angles.back()) / 10.0) * 10;
+	int minDeg = round(number(hist.min()) / 10.0) * 10;
+	int maxDeg = round(number(hist.max()) / 10.0) * 10;
 
 //	Expand minDeg and maxDeg by plus minus 10 degrees or at least to 0 or 180 degrees
 	if((minDeg-10) > 0)
@@ -1272,119 +1080,28 @@ void PrintAngleHistogram(vector<number>& locAngles, number stepSize, ug::Table<s
 		maxDeg = 180;
 
 //	Evaluate the number of ranges in respect to the specified step size
-	uint numRanges = floor((maxDeg-minDeg) / stepSize);
-	vector<uint> counter(numRanges, 0);
-
-//	Count the elements in their corresponding minAngle range
-	for(uint i = 0; i < angles.size(); ++i)
-	{
-		number angle = angles[i];
-		for (uint range = 0; range < numRanges; range++)
-		{
-			if (angle < minDeg + (range+1)*stepSize)
-			{
-				++counter[range];
-				break;
-			}
-		}
-	}
+	uint numRanges = floor((maxDeg-minDeg) / hist.step_size());
 
 //	----------------------------------------
 //	Histogram table output section: (THIRDS)
 //	----------------------------------------
-
-//	Divide the output table into three thirds (columnwise)
-	uint numRows = ceil(number(numRanges) / 3.0);
-
-//	Create table object
-	ug::Table<std::stringstream> angleTable(numRows, 6);
-
-//	First third
-	uint i = 0;
-	for(; i < numRows; ++i)
-	{
-		angleTable(i, 0) << minDeg + i*stepSize << " - " << minDeg + (i+1)*stepSize << " deg : ";
-		angleTable(i, 1) << counter[i];
-	}
-
-//	Second third
-//	Check, if second third of table is needed
-	if(i < counter.size())
-	{
-		for(; i < 2*numRows; ++i)
-		{
-			angleTable(i-numRows, 2) << minDeg + i*stepSize << " - " << minDeg + (i+1)*stepSize << " deg : ";
-			angleTable(i-numRows, 3) << counter[i];
-		}
-	}
-
-//	Third third
-	if(i < counter.size())
-//	Check, if third third of table is needed
-	{
-		for(; i < numRanges; ++i)
-		{
-			angleTable(i-2*numRows, 4) << minDeg + i*stepSize << " - " << minDeg + (i+1)*stepSize << " deg : ";
-			angleTable(i-2*numRows, 5) << counter[i];
-		}
-	}
-
-//	Output table
-	UG_LOG(endl << angleTable);
-
+	hist.print_thirds(minDeg, numRanges, " deg : ");
 
 //	----------------------------------------
 //	Histogram table file output section
 //	----------------------------------------
-	numRanges = floor(180.0/stepSize);
-	counter.clear();
-	counter.resize(numRanges, 0.0);
-	int numElems = 0;
-
-//	Count the elements in their corresponding minAngle range
-	for(uint i = 0; i < angles.size(); ++i)
-	{
-		number angle = angles[i];
-		for (uint range = 0; range < numRanges; range++)
-		{
-			if (angle < (range+1)*stepSize)
-			{
-				++counter[range];
-				++numElems;
-				break;
-			}
-		}
-	}
-
-	outTable.add_rows(numRanges);
-	outTable.add_cols(2);
-
-	for(uint i = 0; i < numRanges; ++i)
-	{
-		outTable(i, 0) << i*stepSize << " - " << (i+1)*stepSize;
-		outTable(i, 1) << 100.0/numElems*counter[i];
-	}
+	hist.write_percentages(outTable);
 }
 
 
-void PrintAspectRatioHistogram(vector<number>& locAspectRatios, number stepSize, ug::Table<std::stringstream>& outTable)
+void PrintAspectRatioHistogram(const QualityHistogram& hist, ug::Table<std::stringstream>& outTable)
 {
-	vector<number> aspectRatios;
-
-	#ifdef UG_PARALLEL
-	//	propagate to all processes
-		pcl::ProcessCommunicator pc;
-		pc.allgatherv(aspectRatios, locAspectRatios);
-	#else
-		aspectRatios = locAspectRatios;
-	#endif
-
-//	Sort the calculated aspectRatios in an ascending way
-	sort(aspectRatios.begin(), aspectRatios.end());
+	if(hist.num_values() == 0)
+		return;
 
 //	Evaluate the minimal and maximal aspectRatio rounding to 0.01
-	number minAspectRatio = round(number(aspectRatios.front()) * 10.0) / 10.0;
-	number maxAspectRatio = round(number(aspectRatios.back()) * 10.0) / 10.0;
+	number minAspectRatio = round(number(hist.min()) * 10.0) / 10.0;
+	number maxAspectRatio = round(number(hist.max()) * 10.0) / 10.0;
 
 //	Expand minAspectRatio and maxAspectRatio by plus minus 0.1 or at least to 0 or 1.0
 	if((minAspectRatio-0.1) > 0)
@@ -1398,97 +1115,16 @@ void PrintAspectRatioHistogram(vector<number>& locAspectRatios, number stepSize,
 		maxAspectRatio = 1.0;
 
 //	Evaluate the number of ranges in respect to the specified step size
-	uint numRanges = round((maxAspectRatio-minAspectRatio) / stepSize);
-	vector<uint> counter(numRanges, 0);
-
-//	Count the elements in their corresponding aspectRatio range
-	for(uint i = 0; i < aspectRatios.size(); ++i)
-	{
-		number aspectRatio = aspectRatios[i];
-		for (uint range = 0; range < numRanges; range++)
-		{
-			if (aspectRatio < minAspectRatio + (range+1)*stepSize)
-			{
-				++counter[range];
-				break;
-			}
-		}
-	}
+	uint numRanges = round((maxAspectRatio-minAspectRatio) / hist.step_size());
 
 //	----------------------------------------
 //	Histogram table output section: (THIRDS)
 //	----------------------------------------
-
-//	Divide the output table into three thirds (columnwise)
-	uint numRows = ceil(number(numRanges) / 3.0);
-
-//	Create table object
-	ug::Table<std::stringstream> aspectRatioTable(numRows, 6);
-
-//	First third
-	uint i = 0;
-	for(; i < numRows; ++i)
-	{
-		aspectRatioTable(i, 0) << minAspectRatio + i*stepSize << " - " << minAspectRatio + (i+1)*stepSize << " : ";
-		aspectRatioTable(i, 1) << counter[i];
-	}
-
-//	Second third
-//	Check, if second third of table is needed
-	if(i < counter.size())
-	{
-		for(; i < 2*numRows; ++i)
-		{
-			aspectRatioTable(i-numRows, 2) << minAspectRatio + i*stepSize << " - " << minAspectRatio + (i+1)*stepSize << " : ";
-			aspectRatioTable(i-numRows, 3) << counter[i];
-		}
-	}
-
-//	Third third
-	if(i < counter.size())
-//	Check, if third third of table is needed
-	{
-		for(; i < numRanges; ++i)
-		{
-			aspectRatioTable(i-2*numRows, 4) << minAspectRatio + i*stepSize << " - " << minAspectRatio + (i+1)*stepSize << " : ";
-			aspectRatioTable(i-2*numRows, 5) << counter[i];
-		}
-	}
-
-//	Output table
-	UG_LOG(endl << aspectRatioTable);
-
+	hist.print_thirds(minAspectRatio, numRanges, " : ");
 
 //	----------------------------------------
 //	Histogram table file output section
 //	----------------------------------------
-	numRanges = floor(1.0/stepSize);
-	counter.clear();
-	counter.resize(numRanges, 0.0);
-	int numElems = 0;
-
-//	Count the elements in their corresponding aspectRatio range
-	for(uint i = 0; i < aspectRatios.size(); ++i)
-	{
-		number aspectRatio = aspectRatios[i];
-		for (uint range = 0; range < numRanges; range++)
-		{
-			if (aspectRatio < (range+1)*stepSize)
-			{
-				++counter[range];
-				++numElems;
-				break;
-			}
-		}
-	}
-
-	outTable.add_rows(numRanges);
-	outTable.add_cols(2);
-
-	for(uint i = 0; i < numRanges; ++i)
-	{
-		outTable(i, 0) << i*stepSize << " - " << (i+1)*stepSize;
-		outTable(i, 1) << 100.0/numElems*counter[i];
-	}
+	hist.write_percentages(outTable);
 }
 }
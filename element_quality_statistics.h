@@ -44,11 +44,14 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <type_traits>
 
 #include "lib_grid/lib_grid.h"
 #include "elem_stat_util.h"
 #include "lib_grid/algorithms/element_angles.h"
 #include "lib_grid/algorithms/element_aspect_ratios.h"
+#include "element_quality_kernels.h"
+#include "quality_report.h"
 
 
 
@@ -58,6 +61,165 @@ using namespace std;
 namespace ug {
 
 
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TetBatchPushBack
+///	adds the element to the batch if it is a tetrahedron. Returns whether it was added.
+/**	The overload is selected at compile time by the iterator's element type, so only
+ *	iterators of the tetrahedron type section (goc.begin<Tetrahedron>) feed the kernels.
+ *	Ranges of generic volumes are evaluated through lib_grid, to evaluate them by type
+ *	collect them in an ElementsByType<Volume> instead (see CollectElementMeasures by type).*/
+template <class TAAPosVRT>
+inline bool TetBatchPushBack(TetBatch& batch, Tetrahedron* tet, TAAPosVRT& aaPos)
+{
+	batch.push_back(tet, aaPos);
+	return true;
+}
+
+///	elements of lower dimension and generic volumes are not evaluated by the tetrahedron kernels
+template <class TAAPosVRT>
+inline bool TetBatchPushBack(TetBatch&, GridObject*, TAAPosVRT&)
+{
+	return false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	FlushTetBatch
+///	evaluates the batch and writes tetMeasure(results, i) to measures[slots[i]]
+template <class TTetMeasure>
+void FlushTetBatch(TetBatch& batch, vector<size_t>& slots,
+				   vector<number>& measures, TTetMeasure tetMeasure)
+{
+	const TetKernelResults& res = batch.evaluate(false);
+	for(size_t i = 0; i < res.num; ++i)
+		measures[slots[i]] = tetMeasure(res, i);
+
+	batch.clear();
+	slots.clear();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CollectElementMeasures
+///	appends measure(elem) for every element to 'measuresOut' in the order of the elements
+/**	Ranges of the tetrahedron type section are evaluated batch-wise by the tetrahedron
+ *	kernels instead, their measure is taken by tetMeasure(results, i) (see TetBatchPushBack).
+ *	If bSkipCopies is set, ghosts and horizontal slaves are skipped in parallel.*/
+template <class TIterator, class TAAPosVRT, class TMeasure, class TTetMeasure>
+void CollectElementMeasures(Grid& grid, TIterator elementsBegin,
+							TIterator elementsEnd,
+							TAAPosVRT& aaPos,
+							vector<number>& measuresOut,
+							TMeasure measure, TTetMeasure tetMeasure,
+							bool bSkipCopies = true)
+{
+	DistributedGridManager* dgm = grid.distributed_grid_manager();
+
+//	tetrahedra in the batch and the entries of measuresOut they belong to
+	TetBatch batch;
+	vector<size_t> batchSlots;
+
+	for(TIterator iter = elementsBegin; iter != elementsEnd; ++iter)
+	{
+		#ifdef UG_PARALLEL
+		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
+		//	since they have a copy on another process and
+		//	since we already consider that copy...
+			if(bSkipCopies && (dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE)))
+				continue;
+		#endif
+
+		if(!TetBatchPushBack(batch, *iter, aaPos))
+		{
+			measuresOut.push_back(measure(*iter));
+			continue;
+		}
+
+		batchSlots.push_back(measuresOut.size());
+		measuresOut.push_back(0.0);
+
+		if(batch.full())
+			FlushTetBatch(batch, batchSlots, measuresOut, tetMeasure);
+	}
+
+	if(!batch.empty())
+		FlushTetBatch(batch, batchSlots, measuresOut, tetMeasure);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ElementMeasureCollector
+///	writes the measures of ranges of elements of one type (see ForEachElementType)
+template <class TBaseElem, class TAAPosVRT, class TMeasure, class TTetMeasure>
+struct ElementMeasureCollector
+{
+	ElementMeasureCollector(const ElementsByType<TBaseElem>& elems_, TAAPosVRT& aaPos_,
+							number* measuresOut_, TMeasure& measure_, TTetMeasure& tetMeasure_) :
+		elems(elems_), aaPos(aaPos_), measuresOut(measuresOut_),
+		measure(measure_), tetMeasure(tetMeasure_)
+	{}
+
+	template <int roid>
+	void apply(size_t from, size_t to)
+	{
+		collect(from, to, std::integral_constant<bool, roid == ROID_TETRAHEDRON>());
+	}
+
+	void collect(size_t from, size_t to, std::false_type)
+	{
+		for(size_t i = from; i < to; ++i)
+			measuresOut[i] = measure(elems[i]);
+	}
+
+///	tetrahedra (only instantiated for volumes)
+	void collect(size_t from, size_t to, std::true_type)
+	{
+		TetBatch batch;
+		size_t first = from;
+		for(size_t i = from; i < to; ++i)
+		{
+			batch.push_back(elems[i], aaPos);
+			if(batch.full() || i + 1 == to)
+			{
+				const TetKernelResults& res = batch.evaluate(false);
+				for(size_t j = 0; j < res.num; ++j)
+					measuresOut[first + j] = tetMeasure(res, j);
+				batch.clear();
+				first = i + 1;
+			}
+		}
+	}
+
+	const ElementsByType<TBaseElem>& elems;
+	TAAPosVRT& aaPos;
+	number* measuresOut;
+	TMeasure& measure;
+	TTetMeasure& tetMeasure;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CollectElementMeasures (by type)
+///	appends measure(elem) for all elements of elems to 'measuresOut' in the order of elems
+/**	Every type is evaluated by its own kernel: tetrahedra batch-wise by the tetrahedron
+ *	kernels, their measure is taken by tetMeasure(results, i). Ghosts and horizontal
+ *	slaves were already skipped by ElementsByType, if requested.*/
+template <class TBaseElem, class TAAPosVRT, class TMeasure, class TTetMeasure>
+void CollectElementMeasures(const ElementsByType<TBaseElem>& elems, TAAPosVRT& aaPos,
+							vector<number>& measuresOut,
+							TMeasure measure, TTetMeasure tetMeasure)
+{
+	const size_t offset = measuresOut.size();
+	measuresOut.resize(offset + elems.size(), 0.0);
+	if(elems.empty())
+		return;
+
+	ElementMeasureCollector<TBaseElem, TAAPosVRT, TMeasure, TTetMeasure>
+		collector(elems, aaPos, &measuresOut[offset], measure, tetMeasure);
+	ForEachElementType(elems, 0, elems.size(), collector);
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 //	CollectMinAngles
 template <class TIterator, class TAAPosVRT>
@@ -67,8 +229,6 @@ void CollectMinAngles(Grid& grid, TIterator elementsBegin,
 					  vector<number>& minAngles)
 {
 	//PROFILE_FUNC();
-	DistributedGridManager* dgm = grid.distributed_grid_manager();
-
 //	if elementsBegin equals elementsEnd, then the list is empty and we can
 //	immediately return NULL
 	if(elementsBegin == elementsEnd)
@@ -77,20 +237,10 @@ void CollectMinAngles(Grid& grid, TIterator elementsBegin,
 		return;
 	}
 
-//	Calculate the minAngle of every element
-	for(TIterator iter = elementsBegin; iter != elementsEnd; ++iter)
-	{
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE))
-				continue;
-		#endif
-
-		number curMinAngle = CalculateMinAngle(grid, *iter, aaPos);
-		minAngles.push_back(curMinAngle);
-	}
+//	Calculate the minAngle of every element (tetrahedra batch-wise)
+	CollectElementMeasures(grid, elementsBegin, elementsEnd, aaPos, minAngles,
+		[&](decltype(*elementsBegin) elem){return CalculateMinAngle(grid, elem, aaPos);},
+		[](const TetKernelResults& res, size_t i){return res.minDihedral[i];});
 }
 
 
@@ -103,8 +253,6 @@ void CollectMaxAngles(Grid& grid, TIterator elementsBegin,
 					  vector<number>& maxAngles)
 {
 	//PROFILE_FUNC();
-	DistributedGridManager* dgm = grid.distributed_grid_manager();
-
 //	if elementsBegin equals elementsEnd, then the list is empty and we can
 //	immediately return NULL
 	if(elementsBegin == elementsEnd)
@@ -113,20 +261,10 @@ void CollectMaxAngles(Grid& grid, TIterator elementsBegin,
 		return;
 	}
 
-//	Calculate the minAngle of every element
-	for(TIterator iter = elementsBegin; iter != elementsEnd; ++iter)
-	{
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE))
-				continue;
-		#endif
-
-		number curMaxAngle = CalculateMaxAngle(grid, *iter, aaPos);
-		maxAngles.push_back(curMaxAngle);
-	}
+//	Calculate the maxAngle of every element (tetrahedra batch-wise)
+	CollectElementMeasures(grid, elementsBegin, elementsEnd, aaPos, maxAngles,
+		[&](decltype(*elementsBegin) elem){return CalculateMaxAngle(grid, elem, aaPos);},
+		[](const TetKernelResults& res, size_t i){return res.maxDihedral[i];});
 }
 
 
@@ -139,8 +277,6 @@ void CollectAspectRatios(Grid& grid, TIterator elementsBegin,
 						 vector<number>& aspectRatios)
 {
 	//PROFILE_FUNC();
-	DistributedGridManager* dgm = grid.distributed_grid_manager();
-
 //	if elementsBegin equals elementsEnd, then the list is empty and we can
 //	immediately return NULL
 	if(elementsBegin == elementsEnd)
@@ -149,20 +285,10 @@ void CollectAspectRatios(Grid& grid, TIterator elementsBegin,
 		return;
 	}
 
-//	Calculate the aspectRatio of every element
-	for(TIterator iter = elementsBegin; iter != elementsEnd; ++iter)
-	{
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE))
-				continue;
-		#endif
-
-		number curAspectRatio = CalculateAspectRatio(grid, *iter, aaPos);
-		aspectRatios.push_back(curAspectRatio);
-	}
+//	Calculate the aspectRatio of every element (tetrahedra batch-wise)
+	CollectElementMeasures(grid, elementsBegin, elementsEnd, aaPos, aspectRatios,
+		[&](decltype(*elementsBegin) elem){return ElementAspectRatio(grid, elem, aaPos);},
+		[](const TetKernelResults& res, size_t i){return res.aspectRatio[i];});
 }
 
 
@@ -175,8 +301,6 @@ void CollectVolToRMSFaceAreaRatios(Grid& grid, TIterator elementsBegin,
 								   vector<number>& ratios)
 {
 	//PROFILE_FUNC();
-	DistributedGridManager* dgm = grid.distributed_grid_manager();
-
 //	if elementsBegin equals elementsEnd, then the list is empty and we can
 //	immediately return NULL
 	if(elementsBegin == elementsEnd)
@@ -185,410 +309,100 @@ void CollectVolToRMSFaceAreaRatios(Grid& grid, TIterator elementsBegin,
 		return;
 	}
 
-//	Calculate the ratio of every element
+//	Calculate the ratio of every element (tetrahedra batch-wise, prisms and pyramids by
+//	their coordinate kernels, all others are set to 0)
 	bool nonTetrahedralElemsPresent = false;
-	for(TIterator iter = elementsBegin; iter != elementsEnd; ++iter)
-	{
-		#ifdef UG_PARALLEL
-		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-		//	since they have a copy on another process and
-		//	since we already consider that copy...
-			if(dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE))
-				continue;
-		#endif
-
-		if (!dynamic_cast<Tetrahedron*>(*iter))
+	CollectElementMeasures(grid, elementsBegin, elementsEnd, aaPos, ratios,
+		[&](decltype(*elementsBegin) elem) -> number
 		{
-			ratios.push_back(0.0);
+			number ratio;
+			if(PrismOrPyramidVolToRMSFaceAreaRatio(ratio, elem, aaPos))
+				return ratio;
 			nonTetrahedralElemsPresent = true;
-			continue;
-		}
-		number curRatio = CalculateVolToRMSFaceAreaRatio(grid, *iter, aaPos);
-		ratios.push_back(curRatio);
-	}
+			return 0.0;
+		},
+		[](const TetKernelResults& res, size_t i){return res.volToRMSFaceAreaRatio[i];});
 
 	if (nonTetrahedralElemsPresent)
 		UG_LOGN("CollectVolToRMSFaceAreaRatios could not calculate VolToRMSFaceAreaRatios "
-			"for non-tetraheadral elements (set to 0.0)");
+			"for elements other than tetrahedra, prisms and pyramids (set to 0.0)");
 }
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////
-//	PrintAngleStatistics2d
-template <class TAAPosVRT>
-void PrintAngleStatistics2d(Grid& grid, GridObjectCollection& goc, int level, TAAPosVRT& aaPos)
+//	TrackMinAngles
+///	adds the min angle of every element to the tracker (tetrahedra batch-wise)
+/**	Ghosts and horizontal slaves are skipped in parallel. The tracker still has to be
+ *	reduced over all processes (see AllreduceWorstElements).*/
+template <class TIterator, class TAAPosVRT>
+void TrackMinAngles(WorstElementTracker& tracker, Grid& grid,
+					TIterator elementsBegin, TIterator elementsEnd,
+					TAAPosVRT& aaPos)
 {
-	size_t numTriangles = 0;
-	size_t numQuadrilaterals = 0;
-
-	number sd_tri = 0.0;
-	number sd_quad = 0.0;
-	number mean_tri = 0.0;
-	number mean_quad = 0.0;
-	number regAngle = 90.0;
-
 	DistributedGridManager* dgm = grid.distributed_grid_manager();
-	int i = level;
-
-//	Calculate and output standard deviation for triangular/quadrilateral angles
-	if(goc.num<Triangle>(i) > 0 || goc.num<Quadrilateral>(i) > 0)
-	{
-		vector<number> vAnglesOut;
-
-		for(FaceIterator fIter = goc.begin<Face>(i); fIter != goc.end<Face>(i); ++fIter)
-		{
-			vAnglesOut.clear();
-			Face* f = *fIter;
-
-			#ifdef UG_PARALLEL
-			//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-			//	since they have a copy on another process and
-			//	since we already consider that copy...
-				if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-					continue;
-			#endif
-
-			if(f->reference_object_id() == ROID_TRIANGLE)
-			{
-				regAngle = 60.0;
-				CalculateAngles(vAnglesOut, grid, f, aaPos);
-				numTriangles++;
-
-				for(size_t k = 0; k < vAnglesOut.size(); ++k)
-				{
-					sd_tri += (regAngle-vAnglesOut[k])*(regAngle-vAnglesOut[k]);
-					mean_tri += vAnglesOut[k];
-				}
-			}
-
-			if(f->reference_object_id() == ROID_QUADRILATERAL)
-			{
-				regAngle = 90.0;
-				CalculateAngles(vAnglesOut, grid, f, aaPos);
-				numQuadrilaterals++;
-
-				for(size_t k = 0; k < vAnglesOut.size(); ++k)
-				{
-					sd_quad += (regAngle-vAnglesOut[k])*(regAngle-vAnglesOut[k]);
-					mean_quad += vAnglesOut[k];
-				}
-			}
-		}
-	}
-
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the numbers of all involved processes. Since we ignored ghosts,
-		//	each process contributes the numbers of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			numTriangles = pc.allreduce(numTriangles, PCL_RO_SUM);
-			numQuadrilaterals = pc.allreduce(numQuadrilaterals, PCL_RO_SUM);
-			sd_tri = pc.allreduce(sd_tri, PCL_RO_SUM);
-			mean_tri = pc.allreduce(mean_tri, PCL_RO_SUM);
-			sd_quad = pc.allreduce(sd_quad, PCL_RO_SUM);
-			mean_quad = pc.allreduce(mean_quad, PCL_RO_SUM);
-		}
-	#endif
+	TetBatch batch;
 
-//	Calculate and output standard deviation for triangular/quadrilateral angles
-	if(goc.num<Triangle>(i) > 0 || goc.num<Quadrilateral>(i) > 0)
+	for(TIterator iter = elementsBegin; iter != elementsEnd; ++iter)
 	{
-		if(goc.num<Triangle>(i) > 0)
-		{
-			sd_tri *= (1.0/(3*numTriangles));
-			sd_tri = sqrt(sd_tri);
-			mean_tri *= (1.0/(3*numTriangles));
-		}
+		#ifdef UG_PARALLEL
+		//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
+		//	since they have a copy on another process and
+		//	since we already consider that copy...
+			if(dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE))
+				continue;
+		#endif
 
-		if(goc.num<Quadrilateral>(i) > 0)
+		if(!TetBatchPushBack(batch, *iter, aaPos))
 		{
-			sd_quad *= (1.0/(4*numQuadrilaterals));
-			sd_quad = sqrt(sd_quad);
-			mean_quad *= (1.0/(4*numQuadrilaterals));
+			tracker.add(CalculateMinAngle(grid, *iter, aaPos), *iter);
+			continue;
 		}
 
-		UG_LOG("(*) Standard deviation of face angles to regular case" << endl);
-		UG_LOG("	(60° for triangles, 90° for quadrilaterals)" << endl);
-		UG_LOG(endl);
-		UG_LOG("	Triangles (" << numTriangles << "):" << endl);
-		if(goc.num<Triangle>(i) > 0)
+		if(batch.full())
 		{
-			UG_LOG("		sd   = " << sd_tri << endl);
-			UG_LOG("		mean = " << mean_tri << endl);
+			const TetKernelResults& res = batch.evaluate(false);
+			for(size_t i = 0; i < res.num; ++i)
+				tracker.add(res.minDihedral[i], batch.elements()[i]);
+			batch.clear();
 		}
-		UG_LOG(endl);
-		UG_LOG("	Quadrilaterals (" << numQuadrilaterals << "):" << endl);
-		if(goc.num<Quadrilateral>(i) > 0)
-		{
-			UG_LOG("		sd   = " << sd_quad << endl);
-			UG_LOG("		mean = " << mean_quad << endl);
-		}
-		UG_LOG(endl);
 	}
-}
-
 
-////////////////////////////////////////////////////////////////////////////////////////////
-//	PrintAngleStatistics3d
-template <class TAAPosVRT>
-void PrintAngleStatistics3d(Grid& grid, GridObjectCollection& goc, int level, TAAPosVRT& aaPos)
-{
-	size_t numTriangles = 0;
-	size_t numQuadrilaterals = 0;
-	size_t numTetrahedrons = 0;
-	size_t numHexahedrons = 0;
-	size_t numOctahedrons = 0;
-
-	number sd_tri = 0.0;
-	number sd_quad = 0.0;
-	number mean_tri = 0.0;
-	number mean_quad = 0.0;
-	number regAngle = 90.0;
-
-	number sd_tet = 0.0;
-	number sd_hex = 0.0;
-	number sd_oct = 0.0;
-	number mean_tet = 0.0;
-	number mean_hex = 0.0;
-	number mean_oct = 0.0;
-	number regVolDihedral = 90.0;
-
-	DistributedGridManager* dgm = grid.distributed_grid_manager();
-	int i = level;
-
-//	Calculate and output standard deviation for triangular/quadrilateral angles
-	if(goc.num<Triangle>(i) > 0 || goc.num<Quadrilateral>(i) > 0)
+	if(!batch.empty())
 	{
-		vector<number> vAnglesOut;
-
-		for(FaceIterator fIter = goc.begin<Face>(i); fIter != goc.end<Face>(i); ++fIter)
-		{
-			vAnglesOut.clear();
-			Face* f = *fIter;
-
-			#ifdef UG_PARALLEL
-			//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
-			//	since they have a copy on another process and
-			//	since we already consider that copy...
-				if(dgm->is_ghost(f) || dgm->contains_status(f, ES_H_SLAVE))
-					continue;
-			#endif
-
-			if(f->reference_object_id() == ROID_TRIANGLE)
-			{
-				regAngle = 60.0;
-				CalculateAngles(vAnglesOut, grid, f, aaPos);
-				numTriangles++;
-
-				for(size_t k = 0; k < vAnglesOut.size(); ++k)
-				{
-					sd_tri += (regAngle-vAnglesOut[k])*(regAngle-vAnglesOut[k]);
-					mean_tri += vAnglesOut[k];
-				}
-			}
-
-			if(f->reference_object_id() == ROID_QUADRILATERAL)
-			{
-				regAngle = 90.0;
-				CalculateAngles(vAnglesOut, grid, f, aaPos);
-				numQuadrilaterals++;
-
-				for(size_t k = 0; k < vAnglesOut.size(); ++k)
-				{
-					sd_quad += (regAngle-vAnglesOut[k])*(regAngle-vAnglesOut[k]);
-					mean_quad += vAnglesOut[k];
-				}
-			}
-		}
+		const TetKernelResults& res = batch.evaluate(false);
+		for(size_t i = 0; i < res.num; ++i)
+			tracker.add(res.minDihedral[i], batch.elements()[i]);
 	}
+}
 
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the numbers of all involved processes. Since we ignored ghosts,
-		//	each process contributes the numbers of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			numTriangles = pc.allreduce(numTriangles, PCL_RO_SUM);
-			numQuadrilaterals = pc.allreduce(numQuadrilaterals, PCL_RO_SUM);
-			sd_tri = pc.allreduce(sd_tri, PCL_RO_SUM);
-			mean_tri = pc.allreduce(mean_tri, PCL_RO_SUM);
-			sd_quad = pc.allreduce(sd_quad, PCL_RO_SUM);
-			mean_quad = pc.allreduce(mean_quad, PCL_RO_SUM);
-		}
-	#endif
-
-//	Calculate and output standard deviation for triangular/quadrilateral angles
-	if(goc.num<Triangle>(i) > 0 || goc.num<Quadrilateral>(i) > 0)
-	{
-		if(goc.num<Triangle>(i) > 0)
-		{
-			sd_tri *= (1.0/(3*numTriangles));
-			sd_tri = sqrt(sd_tri);
-			mean_tri *= (1.0/(3*numTriangles));
-		}
-
-		if(goc.num<Quadrilateral>(i) > 0)
-		{
-			sd_quad *= (1.0/(4*numQuadrilaterals));
-			sd_quad = sqrt(sd_quad);
-			mean_quad *= (1.0/(4*numQuadrilaterals));
-		}
-
-		UG_LOG("(*) Standard deviation of face angles to regular case" << endl);
-		UG_LOG("	(60° for triangles, 90° for quadrilaterals)" << endl);
-		UG_LOG(endl);
-		UG_LOG("	Triangles (" << numTriangles << "):" << endl);
-		if(goc.num<Triangle>(i) > 0)
-		{
-			UG_LOG("		sd   = " << sd_tri << endl);
-			UG_LOG("		mean = " << mean_tri << endl);
-		}
-		UG_LOG(endl);
-		UG_LOG("	Quadrilaterals (" << numQuadrilaterals << "):" << endl);
-		if(goc.num<Quadrilateral>(i) > 0)
-		{
-			UG_LOG("		sd   = " << sd_quad << endl);
-			UG_LOG("		mean = " << mean_quad << endl);
-		}
-		UG_LOG(endl);
-	}
-
-//	Calculate and output standard deviation for tetrahedral/hexahedral angles
-	if(goc.num<Tetrahedron>(i) > 0 || goc.num<Hexahedron>(i) > 0 || goc.num<Octahedron>(i) > 0)
-	{
-		vector<number> vDihedralsOut;
-
-		for(VolumeIterator vIter = goc.begin<Volume>(i); vIter != goc.end<Volume>(i); ++vIter)
-		{
-			vDihedralsOut.clear();
-			Volume* vol = *vIter;
-
-			#ifdef UG_PARALLEL
-			//	ghosts (vertical masters) have to be ignored,
-			//	since they have a copy on another process and
-			//	since we already consider that copy...
-				if(dgm->is_ghost(vol))
-					continue;
-			#endif
-
-			if(vol->reference_object_id() == ROID_TETRAHEDRON)
-			{
-				regVolDihedral = 70.52877937;
-				CalculateAngles(vDihedralsOut, grid, vol, aaPos);
-				numTetrahedrons++;
-
-				for(size_t k = 0; k < vDihedralsOut.size(); ++k)
-				{
-					sd_tet += (regVolDihedral-vDihedralsOut[k])*(regVolDihedral-vDihedralsOut[k]);
-					mean_tet += vDihedralsOut[k];
-				}
-			}
-
-			if(vol->reference_object_id() == ROID_HEXAHEDRON)
-			{
-				regVolDihedral = 90.0;
-				CalculateAngles(vDihedralsOut, grid, vol, aaPos);
-				numHexahedrons++;
-
-				for(size_t k = 0; k < vDihedralsOut.size(); ++k)
-				{
-					sd_hex += (regVolDihedral-vDihedralsOut[k])*(regVolDihedral-vDihedralsOut[k]);
-					mean_hex += vDihedralsOut[k];
-				}
-			}
 
-			if(vol->reference_object_id() == ROID_OCTAHEDRON)
-			{
-				regVolDihedral = 109.4712206;
-				CalculateAngles(vDihedralsOut, grid, vol, aaPos);
-				numOctahedrons++;
-
-				for(size_t k = 0; k < vDihedralsOut.size(); ++k)
-				{
-					sd_oct += (regVolDihedral-vDihedralsOut[k])*(regVolDihedral-vDihedralsOut[k]);
-					mean_oct += vDihedralsOut[k];
-				}
-			}
-		}
-	}
-
-	#ifdef UG_PARALLEL
-		if(pcl::NumProcs() > 1){
-		//	sum the numbers of all involved processes. Since we ignored ghosts,
-		//	each process contributes the numbers of a unique part of the grid.
-			pcl::ProcessCommunicator pc;
-			numTetrahedrons = pc.allreduce(numTetrahedrons, PCL_RO_SUM);
-			numHexahedrons = pc.allreduce(numHexahedrons, PCL_RO_SUM);
-			numOctahedrons = pc.allreduce(numOctahedrons, PCL_RO_SUM);
-			sd_tet = pc.allreduce(sd_tet, PCL_RO_SUM);
-			mean_tet = pc.allreduce(mean_tet, PCL_RO_SUM);
-			sd_hex = pc.allreduce(sd_hex, PCL_RO_SUM);
-			mean_hex = pc.allreduce(mean_hex, PCL_RO_SUM);
-			sd_oct = pc.allreduce(sd_oct, PCL_RO_SUM);
-			mean_oct = pc.allreduce(mean_oct, PCL_RO_SUM);
-		}
-	#endif
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrintAngleStatistics2d
+void PrintAngleStatistics2d(const ElementQualityData& data);
 
-//	Calculate and output standard deviation for tetrahedral/hexahedral angles
-	if(goc.num<Tetrahedron>(i) > 0 || goc.num<Hexahedron>(i) > 0 || goc.num<Octahedron>(i) > 0)
-	{
-		if(goc.num<Tetrahedron>(i) > 0)
-		{
-			sd_tet *= (1.0/(6*numTetrahedrons));
-			sd_tet = sqrt(sd_tet);
-			mean_tet *= (1.0/(6*numTetrahedrons));
-		}
 
-		if(goc.num<Hexahedron>(i) > 0)
-		{
-			sd_hex *= (1.0/(12*numHexahedrons));
-			sd_hex = sqrt(sd_hex);
-			mean_hex *= (1.0/(12*numHexahedrons));
-		}
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrintAngleStatistics3d
+void PrintAngleStatistics3d(const ElementQualityData& data);
 
-		if(goc.num<Octahedron>(i) > 0)
-		{
-			sd_oct *= (1.0/(12*numOctahedrons));
-			sd_oct = sqrt(sd_oct);
-			mean_oct *= (1.0/(12*numOctahedrons));
-		}
 
-		UG_LOG("(*) Standard deviation of dihedral angles to regular case" << endl);
-		UG_LOG("	(70.5288° for tetrahedrons, 90° for hexahedrons, 109.471° for Octahedrons)" << endl);
-		UG_LOG(endl);
-		UG_LOG("	Tetrahedrons (" << numTetrahedrons << "):" << endl);
-		if(goc.num<Tetrahedron>(i) > 0)
-		{
-			UG_LOG("		sd   = " << sd_tet << endl);
-			UG_LOG("		mean = " << mean_tet << endl);
-		}
-		UG_LOG(endl);
-		UG_LOG("	Hexahedrons (" << numHexahedrons << "):" << endl);
-		if(goc.num<Hexahedron>(i) > 0)
-		{
-			UG_LOG("		sd   = " << sd_hex << endl);
-			UG_LOG("		mean = " << mean_hex << endl);
-		}
-		UG_LOG(endl);
-		UG_LOG("	Octahedrons (" << numOctahedrons << "):" << endl);
-		if(goc.num<Octahedron>(i) > 0)
-		{
-			UG_LOG("		sd   = " << sd_oct << endl);
-			UG_LOG("		mean = " << mean_oct << endl);
-		}
-		UG_LOG(endl);
-	}
-}
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrintWorstElements
+///	logs the tracked worst elements (see SetQualityStatisticsNumWorstElements)
+void PrintWorstElements(const ElementQualityData& data);
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 //	PrintAngleHistograms
-void PrintAngleHistogram(vector<number>& locAngles, number stepSize, ug::Table<std::stringstream>& outTable);
-void PrintAspectRatioHistogram(vector<number>& locAspectRatios, number stepSize, ug::Table<std::stringstream>& outTable);
+//	(the histograms have to be reduced over all processes already)
+void PrintAngleHistogram(const QualityHistogram& hist, ug::Table<std::stringstream>& outTable);
+void PrintAspectRatioHistogram(const QualityHistogram& hist, ug::Table<std::stringstream>& outTable);
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 //	PrintVertexVolumeValence
-void PrintVertexVolumeValence(MultiGrid& mg, SubsetHandler& sh, int subsetIndex);
+///	prints the histogram of the vertex-volume valences of the vertices in subset subsetIndex (top level)
+void PrintVertexVolumeValence(MultiGrid& mg, ISubsetHandler& sh, int subsetIndex);
 
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -613,11 +427,14 @@ void AssignSubsetsByElementQuality3d(MultiGrid& mg, MGSubsetHandler& sh, int num
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 //	AssignSubsetsByElementQuality
-void AssignSubsetsByElementQuality(MultiGrid& mg, MGSubsetHandler& sh, int dim, int numSecs);
+///	assigns all faces (dim 2) or volumes (dim 3) to numSecs subsets by their min angle / min dihedral
+/**	With bQuantileBins every subset receives (about) the same number of elements,
+ *	otherwise the subsets cover equal ranges between the smallest and largest value.
+ *	Subset i is named by its range. Collective in parallel.*/
+void AssignSubsetsByElementQuality(Grid& grid, ISubsetHandler& sh, int dim, int numSecs,
+								   bool bQuantileBins);
 
-
-////////////////////////////////////////////////////////////////////////////////////////////
-//	AssignSubsetsByElementQuality
+void AssignSubsetsByElementQuality(MultiGrid& mg, MGSubsetHandler& sh, int dim, int numSecs);
 void AssignSubsetsByElementQuality(Grid& grid, SubsetHandler& sh, int dim, int numSecs);
 
 
@@ -631,9 +448,74 @@ void ElementQualityStatistics(MultiGrid& mg, int dim);
 void ElementQualityStatistics(Grid& grid, int dim, number angleHistStepSize, number aspectRatioHistStepSize, bool bWriteHistograms);
 void ElementQualityStatistics(Grid& grid, int dim);
 
+//	Wrapper evaluating only a selection of metrics, e.g. "min_dihedral" (3d only, see ParseQualityMetrics)
+//	The versions without bWriteHistograms don't write any histogram files.
+void ElementQualityStatistics(MultiGrid& mg, int dim, const char* metrics, bool bWriteHistograms);
+void ElementQualityStatistics(MultiGrid& mg, int dim, const char* metrics);
+void ElementQualityStatistics(Grid& grid, int dim, const char* metrics, bool bWriteHistograms);
+void ElementQualityStatistics(Grid& grid, int dim, const char* metrics);
+
 //	Actual procedures
 void ElementQualityStatistics2d(Grid& grid, GridObjectCollection goc, number angleHistStepSize = 10.0, number aspectRatioHistStepSize = 0.1, bool bWriteHistograms = true);
-void ElementQualityStatistics3d(Grid& grid, GridObjectCollection goc, number angleHistStepSize = 10.0, number aspectRatioHistStepSize = 0.1, bool bWriteHistograms = true);
+void ElementQualityStatistics3d(Grid& grid, GridObjectCollection goc, number angleHistStepSize = 10.0, number aspectRatioHistStepSize = 0.1, bool bWriteHistograms = true, unsigned int metrics = QM_ALL);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeQualityReport
+///	evaluates the element qualities of all levels (or of level lvl) without any output
+/**	The returned report holds the data of all processes (collective). Its print method
+ *	writes the output of ElementQualityStatistics.*/
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim);
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim, int lvl);
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim, number angleHistStepSize,
+											 number aspectRatioHistStepSize);
+SmartPtr<QualityReport> ComputeQualityReport(Grid& grid, int dim);
+
+///	evaluates only the selected metrics of all levels, e.g. "min_dihedral, aspect_ratio" (3d only)
+/**	Unrequested metrics are not computed at all (see QualityMetric).*/
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim, const char* metrics);
+SmartPtr<QualityReport> ComputeQualityReport(Grid& grid, int dim, const char* metrics);
+
+///	evaluates level lvl and bins the measure of 'map' into the map in the same pass
+/**	The map has to be created by CreateQualitySpatialMap for the same grid and level.
+ *	It is reduced over all processes with the report (collective).*/
+SmartPtr<QualityReport> ComputeQualityReport(MultiGrid& mg, int dim, int lvl,
+											 SmartPtr<QualitySpatialMap> map);
+SmartPtr<QualityReport> ComputeQualityReport(Grid& grid, int dim, SmartPtr<QualitySpatialMap> map);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	EvaluateElementQualityLevel
+///	evaluates all elements of a level in one pass and reduces the data over all processes
+/**	Only the metrics in data.metrics are evaluated. If map is given, the measure of the
+ *	map is binned into it in the same pass and the map is reduced, too (collective).*/
+void EvaluateElementQualityLevel(ElementQualityData& data, Grid& grid, GridObjectCollection goc,
+								 int dim, int lvl, QualityProfile* profile = NULL,
+								 QualitySpatialMap* map = NULL);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeElementQualityQuantiles
+///	returns the quantile sketch of the element wise 'min_angle' or 'aspect_ratio' of a level
+/**	For dim 2 the faces, for dim 3 the volumes (min dihedrals) are evaluated. The sketch
+ *	is merged over all processes (collective).*/
+SmartPtr<QualityQuantileSketch> ComputeElementQualityQuantiles(MultiGrid& mg, int dim, int lvl, const char* measure);
+SmartPtr<QualityQuantileSketch> ComputeElementQualityQuantiles(Grid& grid, int dim, const char* measure);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	FindWorstElements
+///	returns the k worst elements of a level by the given measure (collective)
+/**	Supported measures are 'face_min_angle', 'face_aspect_ratio', 'volume_min_dihedral',
+ *	'volume_max_dihedral' and 'volume_aspect_ratio'. All measures are evaluated in a
+ *	single pass, the elements are merged over all processes.*/
+SmartPtr<WorstElementTracker> FindWorstElements(MultiGrid& mg, int dim, int lvl, const char* measure, int k);
+
+///	selects the k worst elements of the top level (on the processes owning them)
+void SelectWorstElements(MultiGrid& mg, Selector& sel, int dim, const char* measure, int k);
+
+///	assigns the k worst elements of the top level and their sides to subset si
+void AssignSubsetToWorstElements(MultiGrid& mg, MGSubsetHandler& sh, int dim, const char* measure, int k, int si);
 
 
 }	 
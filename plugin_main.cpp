@@ -37,6 +37,18 @@
 #include "lib_grid/lib_grid.h"
 #include "element_quality_statistics.h"
 #include "elem_stat_util.h"
+#include "element_quality_cache.h"
+#include "quality_metric_index.h"
+#include "quality_spatial_map.h"
+#include "quality_threading.h"
+#include "quality_snapshot.h"
+#include "quality_fields.h"
+#include "quality_quantiles.h"
+#include "quality_profile.h"
+#include "quality_report.h"
+#include "quality_valence.h"
+#include "quality_ugx_stream.h"
+#include "tet_kernels.h"
 
 #include <string>
 
@@ -60,6 +72,126 @@ InitUGPlugin_ElementQualityStatistics(ug::bridge::Registry* reg, string parentGr
 	reg->add_function(	"ElementQualityStatistics",
 						(void (*)(ug::MultiGrid&, int)) (&ug::ElementQualityStatistics),
 						grp, "", "mg#dim", "Prints element quality statistics for a multigrid object");
+	reg->add_function(	"ElementQualityStatistics",
+						(void (*)(ug::Grid&, int, const char*)) (&ug::ElementQualityStatistics),
+						grp, "", "grid#dim#metrics", "Prints the statistics of the selected metrics only, e.g. 'min_dihedral, aspect_ratio' (3d only)");
+	reg->add_function(	"ElementQualityStatistics",
+						(void (*)(ug::MultiGrid&, int, const char*)) (&ug::ElementQualityStatistics),
+						grp, "", "mg#dim#metrics", "Prints the statistics of the selected metrics only, e.g. 'min_dihedral, aspect_ratio' (3d only)");
+	reg->add_function(	"ElementQualityStatistics",
+						(void (*)(ug::Grid&, int, const char*, bool)) (&ug::ElementQualityStatistics),
+						grp, "", "grid#dim#metrics#bWriteHistograms", "Prints the statistics of the selected metrics only and optionally writes their histograms (3d only)");
+	reg->add_function(	"ElementQualityStatistics",
+						(void (*)(ug::MultiGrid&, int, const char*, bool)) (&ug::ElementQualityStatistics),
+						grp, "", "mg#dim#metrics#bWriteHistograms", "Prints the statistics of the selected metrics only and optionally writes their histograms (3d only)");
+
+//	Register the phase timings of the quality evaluations
+	reg->add_function(	"SetQualityStatisticsProfiling", &ug::SetQualityStatisticsProfiling,
+						grp, "", "bProfile", "Records wall clock time, element count and throughput of every phase of the quality statistics (appended as a table to the output)");
+	{
+		typedef ug::QualityProfile T;
+		reg->add_class_<T>("QualityProfile", grp)
+			.add_method("num_phases", &T::num_phases)
+			.add_method("phase_name", &T::phase_name, "name", "i")
+			.add_method("phase_level", &T::phase_level, "lvl", "i", "grid level of a phase (-1: not level specific)")
+			.add_method("seconds", &T::seconds, "seconds", "i", "time of this process")
+			.add_method("min_seconds", &T::min_seconds, "seconds", "i", "minimal time over all processes")
+			.add_method("avg_seconds", &T::avg_seconds, "seconds", "i", "average time over all processes")
+			.add_method("max_seconds", &T::max_seconds, "seconds", "i", "maximal time over all processes")
+			.add_method("num_elements", &T::num_elements, "num", "i", "elements of all processes")
+			.add_method("throughput", &T::throughput, "elemsPerSecond", "i", "elements per second of the slowest process")
+			.add_method("print", &T::print);
+	}
+
+//	Register the structured quality report
+	{
+		typedef ug::QualityReport T;
+		reg->add_class_<T>("QualityReport", grp)
+			.add_method("dim", &T::dim)
+			.add_method("metrics", &T::metrics, "metrics", "", "bit mask of the evaluated metrics")
+			.add_method("num_levels", &T::num_levels, "number of evaluated levels")
+			.add_method("level", &T::level, "lvl", "i", "grid level of the i-th evaluated level")
+			.add_method("has_level", &T::has_level, "", "lvl")
+			.add_method("num_elements", &T::num_elements, "num", "lvl#type", "'vertex', 'edge', 'face', 'volume', 'triangle', 'quadrilateral', 'tetrahedron', 'hexahedron', 'octahedron', 'prism' or 'pyramid'")
+			.add_method("min", &T::min, "min", "lvl#measure", "smallest value of a measure, e.g. 'edge_length', 'volume_dihedral' or 'tetrahedron_aspect_ratio'")
+			.add_method("max", &T::max, "max", "lvl#measure", "largest value of a measure, e.g. 'edge_length', 'volume_dihedral' or 'tetrahedron_aspect_ratio'")
+			.add_method("angle_mean", &T::angle_mean, "mean", "lvl#type", "mean deviation of the angles (dihedrals) of an element type from the regular case")
+			.add_method("angle_deviation", &T::angle_deviation, "sd", "lvl#type", "standard deviation of the angles (dihedrals) of an element type from the regular case")
+			.add_method("quantile", &T::quantile, "value", "lvl#measure#q", "'face_min_angle', 'face_aspect_ratio', 'volume_min_dihedral' or 'volume_aspect_ratio'")
+			.add_method("histogram_num_bins", &T::histogram_num_bins, "", "lvl#name")
+			.add_method("histogram_bin_lower", &T::histogram_bin_lower, "", "lvl#name#bin")
+			.add_method("histogram_bin_upper", &T::histogram_bin_upper, "", "lvl#name#bin")
+			.add_method("histogram_count", &T::histogram_count, "", "lvl#name#bin")
+			.add_method("print", &T::print, "", "", "logs the report like ElementQualityStatistics")
+			.add_method("write_histograms", &T::write_histograms, "", "", "writes the histograms as csv files")
+			.add_method("profile", static_cast<const ug::QualityProfile& (T::*)() const>(&T::profile), "profile", "", "phase timings (see SetQualityStatisticsProfiling)");
+	}
+	reg->add_function(	"ComputeQualityReport",
+						(SmartPtr<ug::QualityReport> (*)(ug::MultiGrid&, int)) (&ug::ComputeQualityReport),
+						grp, "report", "mg#dim", "Evaluates the element qualities of all levels without any output");
+	reg->add_function(	"ComputeQualityReport",
+						(SmartPtr<ug::QualityReport> (*)(ug::MultiGrid&, int, int)) (&ug::ComputeQualityReport),
+						grp, "report", "mg#dim#lvl", "Evaluates the element qualities of one level without any output");
+	reg->add_function(	"ComputeQualityReport",
+						(SmartPtr<ug::QualityReport> (*)(ug::MultiGrid&, int, number, number)) (&ug::ComputeQualityReport),
+						grp, "report", "mg#dim#angleHistStepSize#aspectRatioHistStepSize", "Evaluates the element qualities of all levels without any output");
+	reg->add_function(	"ComputeQualityReport",
+						(SmartPtr<ug::QualityReport> (*)(ug::Grid&, int)) (&ug::ComputeQualityReport),
+						grp, "report", "grid#dim", "Evaluates the element qualities of a grid without any output");
+	reg->add_function(	"ComputeQualityReport",
+						(SmartPtr<ug::QualityReport> (*)(ug::MultiGrid&, int, const char*)) (&ug::ComputeQualityReport),
+						grp, "report", "mg#dim#metrics", "Evaluates only the selected metrics of all levels, e.g. 'min_dihedral' (3d only)");
+	reg->add_function(	"ComputeQualityReport",
+						(SmartPtr<ug::QualityReport> (*)(ug::Grid&, int, const char*)) (&ug::ComputeQualityReport),
+						grp, "report", "grid#dim#metrics", "Evaluates only the selected metrics of a grid, e.g. 'min_dihedral' (3d only)");
+
+//	Register the streaming evaluation of .ugx files
+	reg->add_function(	"ComputeQualityReportFromFile",
+						(SmartPtr<ug::QualityReport> (*)(const char*, int)) (&ug::ComputeQualityReportFromFile),
+						grp, "report", "filename#dim", "Evaluates the element qualities of a .ugx file chunk-wise without loading its grid");
+	reg->add_function(	"ComputeQualityReportFromFile",
+						(SmartPtr<ug::QualityReport> (*)(const char*, int, size_t)) (&ug::ComputeQualityReportFromFile),
+						grp, "report", "filename#dim#chunkSize", "Evaluates the element qualities of a .ugx file in chunks of at most chunkSize elements");
+	reg->add_function(	"ElementQualityStatisticsFromFile",
+						(void (*)(const char*, int)) (&ug::ElementQualityStatisticsFromFile),
+						grp, "", "filename#dim", "Prints the element quality statistics of a .ugx file without loading its grid");
+	reg->add_function(	"ElementQualityStatisticsFromFile",
+						(void (*)(const char*, int, size_t, number, number, bool)) (&ug::ElementQualityStatisticsFromFile),
+						grp, "", "filename#dim#chunkSize#angleHistStepSize#aspectRatioHistStepSize#bWriteHistograms", "Prints the element quality statistics of a .ugx file without loading its grid");
+
+//	Register the binary export of per element quality values
+	reg->add_function(	"WriteElementQualityFields",
+						(void (*)(ug::MultiGrid&, int, int, const char*, bool)) (&ug::WriteElementQualityFields),
+						grp, "", "mg#dim#lvl#filename#bMerged", "Writes the quality values of every element of a level to one binary file per process, or to one merged file");
+	reg->add_function(	"WriteElementQualityFields",
+						(void (*)(ug::Grid&, int, const char*, bool)) (&ug::WriteElementQualityFields),
+						grp, "", "grid#dim#filename#bMerged", "Writes the quality values of every element to one binary file per process, or to one merged file");
+	{
+		typedef ug::QualityFieldFile T;
+		reg->add_class_<T>("QualityFieldFile", grp)
+			.add_constructor<void (*)(const char*)>("filename")
+			.add_method("num_rows", &T::num_rows)
+			.add_method("num_columns", &T::num_columns)
+			.add_method("dim", &T::dim)
+			.add_method("rank", &T::rank, "rank", "", "writing process (-1 for merged files)")
+			.add_method("column_name", &T::column_name, "name", "col")
+			.add_method("column_index", &T::column_index, "col", "name")
+			.add_method("row_index", &T::row_index, "index", "row")
+			.add_method("element_id_proc", &T::element_id_proc, "proc", "row", "process of the global id (aGeomObjID) of the element")
+			.add_method("element_id_local", &T::element_id_local, "id", "row", "local id of the global id (aGeomObjID) of the element")
+			.add_method("value", &T::value, "value", "name#row")
+			.set_construct_as_smart_pointer(true);
+	}
+
+//	Register thread count of the quality evaluations
+	reg->add_function(	"SetQualityStatisticsNumThreads", &ug::SetQualityStatisticsNumThreads,
+						grp, "", "numThreads", "Sets the number of threads per process used by ElementQualityStatistics and the subset measures (0: all hardware threads, 1: serial)");
+	reg->add_function(	"SetQualityTetKernel", &ug::SetQualityTetKernel,
+						grp, "", "name", "Selects the tetrahedron kernel of the quality evaluations ('auto', 'scalar', 'avx2', 'avx512')");
+	reg->add_function(	"GetQualityTetKernel", &ug::GetQualityTetKernel,
+						grp, "name", "", "Returns the selected tetrahedron kernel");
+	reg->add_function(	"SetQualityStatisticsUseSnapshot", &ug::SetQualityStatisticsUseSnapshot,
+						grp, "", "bUseSnapshot", "Evaluates ElementQualityStatistics on a packed copy of each level's geometry");
 
 //	Register CalculateSubsetSurfaceArea
 	reg->add_function(	"get_subset_surface_area", &ug::CalculateSubsetSurfaceArea,
@@ -67,6 +199,136 @@ InitUGPlugin_ElementQualityStatistics(ug::bridge::Registry* reg, string parentGr
 	reg->add_function(	"get_subset_volume", &ug::CalculateSubsetVolume,
 						grp, "Subset volume", "mg#subsetIndex#sh", "Returns subset volume.");
 
+//	Register the fused edge statistics of a subset
+	{
+		typedef ug::EdgeStatistics T;
+		reg->add_class_<T>("EdgeStatistics", grp)
+			.add_method("count", &T::count, "number of edges")
+			.add_method("sum", &T::sum, "total length")
+			.add_method("mean", &T::mean, "mean length")
+			.add_method("min", &T::min, "shortest length")
+			.add_method("max", &T::max, "longest length")
+			.add_method("variance", &T::variance, "variance of the lengths")
+			.add_method("standard_deviation", &T::standard_deviation, "standard deviation of the lengths")
+			.add_method("num_histogram_bins", &T::num_histogram_bins)
+			.add_method("histogram_bin_lower", &T::histogram_bin_lower, "", "bin")
+			.add_method("histogram_bin_upper", &T::histogram_bin_upper, "", "bin")
+			.add_method("histogram_count", &T::histogram_count, "", "bin")
+			.add_method("print", &T::print);
+	}
+	reg->add_function(	"ComputeEdgeStatisticsInSubset",
+						(SmartPtr<ug::EdgeStatistics> (*)(ug::MultiGrid&, int, ug::MGSubsetHandler&)) (&ug::ComputeEdgeStatisticsInSubset),
+						grp, "edgeStatistics", "mg#subsetIndex#sh", "Computes count, total, mean, min, max, variance and a length histogram of the edges in a subset in one pass");
+	reg->add_function(	"ComputeEdgeStatisticsInSubset",
+						(SmartPtr<ug::EdgeStatistics> (*)(ug::MultiGrid&, int, ug::MGSubsetHandler&, int)) (&ug::ComputeEdgeStatisticsInSubset),
+						grp, "edgeStatistics", "mg#subsetIndex#sh#binsPerOctave", "Computes count, total, mean, min, max, variance and a length histogram of the edges in a subset in one pass");
+
+//	Register the tracking of the worst elements
+	reg->add_function(	"SetQualityStatisticsNumWorstElements", &ug::SetQualityStatisticsNumWorstElements,
+						grp, "", "numWorstElements", "Sets the number of worst elements per measure listed by ElementQualityStatistics (0: none)");
+	{
+		typedef ug::WorstElementTracker T;
+		reg->add_class_<T>("WorstElementTracker", grp)
+			.add_method("num", &T::num, "number of tracked elements")
+			.add_method("value", &T::value, "value", "i", "value of the i-th worst element")
+			.add_method("center", &T::center, "center", "i", "center of the i-th worst element")
+			.add_method("rank", &T::rank, "rank", "i", "process owning the i-th worst element")
+			.add_method("select", &T::select, "", "sel", "selects the tracked elements of this process")
+			.add_method("assign_subset", &T::assign_subset, "", "sh#si", "assigns the tracked elements of this process to a subset")
+			.add_method("print", &T::print, "", "name");
+	}
+	reg->add_function(	"FindWorstElements", &ug::FindWorstElements,
+						grp, "tracker", "mg#dim#lvl#measure#k", "Finds the k worst elements of a level by 'face_min_angle', 'face_aspect_ratio', 'volume_min_dihedral', 'volume_max_dihedral' or 'volume_aspect_ratio'");
+	reg->add_function(	"SelectWorstElements", &ug::SelectWorstElements,
+						grp, "", "mg#sel#dim#measure#k", "Selects the k worst elements of the top level");
+	reg->add_function(	"AssignSubsetToWorstElements", &ug::AssignSubsetToWorstElements,
+						grp, "", "mg#sh#dim#measure#k#si", "Assigns the k worst elements of the top level to a subset");
+
+//	Register the incremental quality cache for moving meshes
+	{
+		typedef ug::ElementQualityCache T;
+		reg->add_class_<T>("ElementQualityCache", grp)
+			.add_constructor<void (*)(ug::MultiGrid&, int, int)>("mg#dim#lvl")
+			.add_method("set_histogram_step_sizes", &T::set_histogram_step_sizes, "", "angleStepSize#aspectRatioStepSize")
+			.add_method("update", &T::update, "numEvaluated", "", "evaluates the elements adjacent to moved vertices and updates the aggregates (collective)")
+			.add_method("invalidate", &T::invalidate, "", "", "forces the evaluation of all elements on the next update")
+			.add_method("min", (number (T::*)(const char*) const) (&T::min), "min", "measure")
+			.add_method("max", (number (T::*)(const char*) const) (&T::max), "max", "measure")
+			.add_method("num", (size_t (T::*)(const char*) const) (&T::num), "num", "measure")
+			.add_method("print", &T::print)
+			.set_construct_as_smart_pointer(true);
+	}
+	{
+		typedef ug::QualityMetricIndex T;
+		reg->add_class_<T>("QualityMetricIndex", grp)
+			.add_constructor<void (*)(ug::MultiGrid&, int, int)>("mg#dim#lvl")
+			.add_method("invalidate", &T::invalidate, "", "", "drops the sorted values, e.g. after vertices have been moved")
+			.add_method("is_built", &T::is_built, "built", "measure")
+			.add_method("count", &T::count, "num", "measure#lo#hi", "number of elements of all processes with lo <= value < hi")
+			.add_method("count_below", &T::count_below, "num", "measure#threshold", "number of elements of all processes with value < threshold")
+			.add_method("count_above", &T::count_above, "num", "measure#threshold", "number of elements of all processes with value >= threshold")
+			.add_method("local_count", &T::local_count, "num", "measure#lo#hi", "number of elements of this process with lo <= value < hi")
+			.add_method("select", &T::select, "num", "sel#measure#lo#hi", "selects the elements with lo <= value < hi")
+			.add_method("assign_subset", &T::assign_subset, "num", "sh#si#measure#lo#hi", "assigns the elements with lo <= value < hi to subset si")
+			.add_method("num_local", &T::num_local, "num", "measure")
+			.add_method("sorted_value", &T::sorted_value, "value", "measure#i")
+			.set_construct_as_smart_pointer(true);
+	}
+
+//	Register the spatial map of the element qualities
+	{
+		typedef ug::QualitySpatialMap T;
+		reg->add_class_<T>("QualitySpatialMap", grp)
+			.add_method("num_cells", (size_t (T::*)() const) (&T::num_cells), "num")
+			.add_method("threshold", &T::threshold, "threshold")
+			.add_method("count", &T::count, "num", "cell", "number of elements whose center lies in the cell")
+			.add_method("num_below", &T::num_below, "num", "cell", "number of elements in the cell below the threshold")
+			.add_method("min", &T::min, "min", "cell", "smallest value in the cell (-1 if empty)")
+			.add_method("mean", &T::mean, "mean", "cell", "mean value in the cell (-1 if empty)")
+			.add_method("write_vtk", &T::write_vtk, "", "filename", "writes the cells as legacy vtk structured points")
+			.add_method("write_table", &T::write_table, "", "filename", "writes the non-empty cells as csv, worst cells first")
+			.add_method("print", &T::print, "", "numCells", "prints the worst cells")
+			.set_construct_as_smart_pointer(true);
+	}
+	reg->add_function(	"ComputeQualitySpatialMap",
+						(SmartPtr<ug::QualitySpatialMap> (*)(ug::MultiGrid&, int, int, const char*, number, int)) (&ug::ComputeQualitySpatialMap),
+						grp, "map", "mg#dim#lvl#measure#threshold#resolution", "Aggregates 'min_angle' or 'aspect_ratio' on a uniform grid of cells ('resolution' cells along the longest side)");
+	reg->add_function(	"ComputeQualitySpatialMap",
+						(SmartPtr<ug::QualitySpatialMap> (*)(ug::Grid&, int, const char*, number, int)) (&ug::ComputeQualitySpatialMap),
+						grp, "map", "grid#dim#measure#threshold#resolution", "Aggregates 'min_angle' or 'aspect_ratio' on a uniform grid of cells ('resolution' cells along the longest side)");
+	reg->add_function(	"CreateQualitySpatialMap",
+						(SmartPtr<ug::QualitySpatialMap> (*)(ug::MultiGrid&, int, int, const char*, number, int)) (&ug::CreateQualitySpatialMap),
+						grp, "map", "mg#dim#lvl#measure#threshold#resolution", "Creates an empty map of 'min_angle' or 'aspect_ratio' over the bounding box of a level, to be filled by ComputeQualityReport");
+	reg->add_function(	"CreateQualitySpatialMap",
+						(SmartPtr<ug::QualitySpatialMap> (*)(ug::Grid&, int, const char*, number, int)) (&ug::CreateQualitySpatialMap),
+						grp, "map", "grid#dim#measure#threshold#resolution", "Creates an empty map of 'min_angle' or 'aspect_ratio' over the bounding box of a grid, to be filled by ComputeQualityReport");
+	reg->add_function(	"ComputeQualityReport",
+						(SmartPtr<ug::QualityReport> (*)(ug::MultiGrid&, int, int, SmartPtr<ug::QualitySpatialMap>)) (&ug::ComputeQualityReport),
+						grp, "report", "mg#dim#lvl#map", "Evaluates the element qualities of one level and fills the spatial map in the same pass");
+	reg->add_function(	"ComputeQualityReport",
+						(SmartPtr<ug::QualityReport> (*)(ug::Grid&, int, SmartPtr<ug::QualitySpatialMap>)) (&ug::ComputeQualityReport),
+						grp, "report", "grid#dim#map", "Evaluates the element qualities of a grid and fills the spatial map in the same pass");
+
+//	Register the quantile sketches of the element qualities
+	reg->add_function(	"SetQualityQuantileCompression", &ug::SetQualityQuantileCompression,
+						grp, "", "compression", "Sets the accuracy of the quality percentiles (larger is more accurate, default 1000)");
+	{
+		typedef ug::QualityQuantileSketch T;
+		reg->add_class_<T>("QualityQuantileSketch", grp)
+			.add_method("quantile", &T::quantile, "value", "q", "estimate of the q-quantile (0 <= q <= 1)")
+			.add_method("count", &T::count, "number of values")
+			.add_method("min", &T::min, "smallest value")
+			.add_method("max", &T::max, "largest value")
+			.add_method("compression", &T::compression)
+			.add_method("num_centroids", &T::num_centroids);
+	}
+	reg->add_function(	"ComputeElementQualityQuantiles",
+						(SmartPtr<ug::QualityQuantileSketch> (*)(ug::MultiGrid&, int, int, const char*)) (&ug::ComputeElementQualityQuantiles),
+						grp, "quantiles", "mg#dim#lvl#measure", "Quantile sketch of the element 'min_angle' or 'aspect_ratio' on a level");
+	reg->add_function(	"ComputeElementQualityQuantiles",
+						(SmartPtr<ug::QualityQuantileSketch> (*)(ug::Grid&, int, const char*)) (&ug::ComputeElementQualityQuantiles),
+						grp, "quantiles", "grid#dim#measure", "Quantile sketch of the element 'min_angle' or 'aspect_ratio'");
+
 	reg->add_function(	"CountNumberOfEdgesInSubset", &ug::CountNumberOfEdgesInSubset,
 						grp, "Subset volume", "mg#subsetIndex#sh", "Counts edges in subset");
 	reg->add_function(	"ComputeAverageEdgeLengthInSubset", &ug::ComputeAverageEdgeLengthInSubset,
@@ -85,6 +347,9 @@ InitUGPlugin_ElementQualityStatistics(ug::bridge::Registry* reg, string parentGr
 	reg->add_function(	"AssignSubsetsByElementQuality",
 						(void (*)(ug::MultiGrid&, ug::MGSubsetHandler&, int, int)) (&ug::AssignSubsetsByElementQuality),
 						grp, "", "mg#sh", "");
+	reg->add_function(	"AssignSubsetsByElementQuality",
+						(void (*)(ug::Grid&, ug::ISubsetHandler&, int, int, bool)) (&ug::AssignSubsetsByElementQuality),
+						grp, "", "grid#sh#dim#numSecs#bQuantileBins", "Assigns the elements to numSecs subsets by min angle (2d) or min dihedral (3d), with equal ranges or equal numbers of elements per subset");
 	reg->add_function(	"AssignSubsetToElementWithSmallestMinAngle",
 						(void (*)(ug::MultiGrid&, ug::MGSubsetHandler&, int, const char*, int)) (&ug::AssignSubsetToElementWithSmallestMinAngle),
 						grp, "", "mg#sh#roid", "");
@@ -98,6 +363,14 @@ InitUGPlugin_ElementQualityStatistics(ug::bridge::Registry* reg, string parentGr
 						grp, "", "mg#sh", "");
 
 	reg->add_function(	"PrintVertexVolumeValence",
-						(void (*)(ug::MultiGrid&, ug::MGSubsetHandler&, int)) (&ug::PrintVertexVolumeValence),
-						grp, "", "mg#sh#si", "");
+						(void (*)(ug::MultiGrid&, ug::ISubsetHandler&, int)) (&ug::PrintVertexVolumeValence),
+						grp, "", "mg#sh#si", "Prints the histogram of the vertex-volume valences of a subset on the top level");
+	{
+		typedef ug::VertexValences T;
+		reg->add_class_<T>("VertexValences", grp)
+			.add_constructor<void (*)(ug::MultiGrid&, int, int)>("mg#dim#lvl")
+			.add_method("max_valence", &T::max_valence, "maxValence", "", "largest valence of all processes")
+			.add_method("print", &T::print, "", "sh#si", "prints the valence histogram of the vertices in a subset (all vertices if sh is nil)")
+			.set_construct_as_smart_pointer(true);
+	}
 }
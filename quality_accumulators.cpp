@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include <vector>
+
+#include "quality_accumulators.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+
+namespace ug
+{
+
+
+#ifdef UG_PARALLEL
+///	MPI user operation: inoutvec[i] = invec[i] (+) inoutvec[i] for packed MomentAccumulators
+static void MergePackedMoments(void* invec, void* inoutvec, int* len, MPI_Datatype*)
+{
+	const number* in = static_cast<const number*>(invec);
+	number* inout = static_cast<number*>(inoutvec);
+
+	MomentAccumulator a, b;
+	for(int i = 0; i < *len; ++i)
+	{
+		a.unpack(in + i * MomentAccumulator::PACKED_SIZE);
+		b.unpack(inout + i * MomentAccumulator::PACKED_SIZE);
+		a.merge(b);
+		a.pack(inout + i * MomentAccumulator::PACKED_SIZE);
+	}
+}
+#endif
+
+
+void AllreduceMoments(MomentAccumulator** accs, size_t numAccs)
+{
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1 && numAccs > 0){
+			const size_t packedSize = MomentAccumulator::PACKED_SIZE;
+			std::vector<number> loc(numAccs * packedSize), glob(numAccs * packedSize);
+			for(size_t k = 0; k < numAccs; ++k)
+				accs[k]->pack(&loc[k * packedSize]);
+
+		//	one element of the reduction is one packed accumulator. The pairwise merge
+		//	(Chan et al.) is numerically stable for any grouping, but the grouping is
+		//	chosen by MPI, so the last digits may differ between process counts.
+			MPI_Datatype accType;
+			MPI_Type_contiguous((int)packedSize,
+								(sizeof(number) == sizeof(double)) ? MPI_DOUBLE : MPI_FLOAT,
+								&accType);
+			MPI_Type_commit(&accType);
+
+			MPI_Op mergeOp;
+			MPI_Op_create(&MergePackedMoments, 0, &mergeOp);
+
+			pcl::ProcessCommunicator pc;
+			pc.allreduce(&loc.front(), &glob.front(), (int)numAccs, accType, mergeOp);
+
+			MPI_Op_free(&mergeOp);
+			MPI_Type_free(&accType);
+
+			for(size_t k = 0; k < numAccs; ++k)
+				accs[k]->unpack(&glob[k * packedSize]);
+		}
+	#endif
+}
+
+
+}
@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __QUALITY_ACCUMULATORS_H__
+#define __QUALITY_ACCUMULATORS_H__
+
+/* system includes */
+#include <stddef.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include "common/types.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityMinMax
+///	Keeps track of the number of values as well as of the smallest and largest value
+///	of a quality measure.
+struct QualityMinMax
+{
+	QualityMinMax()	{clear();}
+
+	void clear()
+	{
+		num = 0;
+		min = std::numeric_limits<number>::max();
+		max = -std::numeric_limits<number>::max();
+	}
+
+	void add(number val)
+	{
+		++num;
+		if(val < min) min = val;
+		if(val > max) max = val;
+	}
+
+	void merge(const QualityMinMax& mm)
+	{
+		num += mm.num;
+		if(mm.min < min) min = mm.min;
+		if(mm.max > max) max = mm.max;
+	}
+
+	bool empty() const	{return num == 0;}
+
+	size_t num;
+	number min;
+	number max;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityMinMaxTree
+///	Smallest and largest value of a fixed number of slots whose values may change
+/**	The values are stored in the leaves of a binary tournament tree, so that setting
+ *	or resetting a slot costs O(log n) and the extremal values are available in O(1).
+ *	Used to keep the extremal qualities up to date if only some elements changed.*/
+class QualityMinMaxTree
+{
+	public:
+		QualityMinMaxTree()	{resize(0);}
+
+	///	sets the number of slots and resets all of them
+		void resize(size_t numSlots)
+		{
+			m_numLeaves = 1;
+			while(m_numLeaves < numSlots)
+				m_numLeaves *= 2;
+			m_min.assign(2 * m_numLeaves, std::numeric_limits<number>::max());
+			m_max.assign(2 * m_numLeaves, -std::numeric_limits<number>::max());
+			m_numSlots = numSlots;
+			m_num = 0;
+			m_used.assign(numSlots, false);
+		}
+
+		size_t num_slots() const	{return m_numSlots;}
+
+	///	assigns a value to a slot
+		void set(size_t slot, number val)
+		{
+			if(!m_used[slot]){
+				m_used[slot] = true;
+				++m_num;
+			}
+			size_t i = m_numLeaves + slot;
+			m_min[i] = m_max[i] = val;
+			propagate(i);
+		}
+
+	///	removes the value of a slot
+		void reset(size_t slot)
+		{
+			if(!m_used[slot])
+				return;
+			m_used[slot] = false;
+			--m_num;
+			size_t i = m_numLeaves + slot;
+			m_min[i] = std::numeric_limits<number>::max();
+			m_max[i] = -std::numeric_limits<number>::max();
+			propagate(i);
+		}
+
+	///	number of slots with a value
+		size_t num() const		{return m_num;}
+		bool empty() const		{return m_num == 0;}
+
+		number min() const		{return m_min[1];}
+		number max() const		{return m_max[1];}
+
+	protected:
+		void propagate(size_t i)
+		{
+			for(i /= 2; i > 0; i /= 2)
+			{
+				m_min[i] = std::min(m_min[2*i], m_min[2*i+1]);
+				m_max[i] = std::max(m_max[2*i], m_max[2*i+1]);
+			}
+		}
+
+	protected:
+		size_t m_numSlots;
+		size_t m_numLeaves;
+		size_t m_num;
+		std::vector<number> m_min;
+		std::vector<number> m_max;
+		std::vector<bool> m_used;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	MomentAccumulator
+///	Numerically stable, mergeable accumulator of count, mean, M2, min and max
+/**	M2 is the sum of the squared deviations from the mean. Values are added by
+ *	Welford's update. Accumulators of different threads or processes are merged by
+ *	the pairwise formula of Chan et al. If 'compensated' is set, the updates of mean
+ *	and M2 additionally use Kahan summation.
+ *
+ *	All accumulators of a set can be reduced over all processes with a single
+ *	collective, see AllreduceMoments.*/
+struct MomentAccumulator
+{
+	MomentAccumulator(bool compensated = false) : bCompensated(compensated)	{clear();}
+
+	void clear()
+	{
+		num = 0;
+		mean = 0.0;
+		m2 = 0.0;
+		min = std::numeric_limits<number>::max();
+		max = -std::numeric_limits<number>::max();
+		cMean = 0.0;
+		cM2 = 0.0;
+	}
+
+	void add(number val)
+	{
+		++num;
+		number delta = val - mean;
+		sum_up(mean, cMean, delta / (number)num);
+		sum_up(m2, cM2, delta * (val - mean));
+		if(val < min) min = val;
+		if(val > max) max = val;
+	}
+
+	void merge(const MomentAccumulator& ma)
+	{
+		if(ma.num == 0)
+			return;
+
+		if(num == 0)
+		{
+			num = ma.num;
+			mean = ma.mean;
+			m2 = ma.m2;
+			min = ma.min;
+			max = ma.max;
+			cMean = 0.0;
+			cM2 = 0.0;
+			return;
+		}
+
+		number n = (number)num + (number)ma.num;
+		number delta = ma.mean - mean;
+		sum_up(mean, cMean, delta * (number)ma.num / n);
+		sum_up(m2, cM2, ma.m2 + delta * delta * (number)num * (number)ma.num / n);
+		num += ma.num;
+		if(ma.min < min) min = ma.min;
+		if(ma.max > max) max = ma.max;
+	}
+
+	bool empty() const	{return num == 0;}
+
+///	population variance
+	number variance() const
+	{
+		if(num == 0) return 0.0;
+		return m2 / (number)num;
+	}
+
+	number standard_deviation() const	{return sqrt(variance());}
+
+///	mean of the squared deviations from 'ref' (instead of from the mean)
+	number mean_square_deviation(number ref) const
+	{
+		if(num == 0) return 0.0;
+		return m2 / (number)num + (mean - ref) * (mean - ref);
+	}
+
+///	number of values written by pack
+	static const size_t PACKED_SIZE = 5;
+
+	void pack(number* buf) const
+	{
+		buf[0] = (number)num; buf[1] = mean; buf[2] = m2; buf[3] = min; buf[4] = max;
+	}
+
+	void unpack(const number* buf)
+	{
+		num = (size_t)(buf[0] + 0.5); mean = buf[1]; m2 = buf[2]; min = buf[3]; max = buf[4];
+		cMean = 0.0;
+		cM2 = 0.0;
+	}
+
+	size_t num;
+	number mean;
+	number m2;
+	number min;
+	number max;
+
+//	Kahan compensations of mean and m2
+	number cMean;
+	number cM2;
+	bool bCompensated;
+
+	protected:
+		void sum_up(number& sum, number& c, number val) const
+		{
+			if(!bCompensated)
+			{
+				sum += val;
+				return;
+			}
+			number y = val - c;
+			number t = sum + y;
+			c = (t - sum) - y;
+			sum = t;
+		}
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AllreduceMoments
+///	merges the accumulators of all processes (collective)
+/**	Uses one MPI reduction with a user defined operation for all accumulators, which
+ *	merges two accumulators by the numerically stable pairwise update of Chan et al.
+ *	Does nothing in serial builds or if only one process is involved.*/
+void AllreduceMoments(MomentAccumulator** accs, size_t numAccs);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AngleDeviation
+///	Accumulates element angles and their deviation from the angle of the regular element.
+struct AngleDeviation
+{
+	AngleDeviation(number regularAngle) : regAngle(regularAngle), angles(true)	{clear();}
+
+	void clear()
+	{
+		numElems = 0;
+		angles.clear();
+	}
+
+	void add_angles(const number* a, size_t numAng)
+	{
+		++numElems;
+		for(size_t k = 0; k < numAng; ++k)
+			angles.add(a[k]);
+	}
+
+	void add_angles(const std::vector<number>& vAngles)
+	{
+		add_angles(vAngles.data(), vAngles.size());
+	}
+
+///	adds one element given by the sum of its angles, the sum of their squared
+///	deviations from their mean (m2) and by its smallest and largest angle
+/**	The element is merged as one accumulator. m2 has to be computed from the
+ *	deviations themselves, not as sum(a^2) - n mean^2, to keep the merge stable.*/
+	void add_sums(size_t numAng, number angleSum, number m2,
+				  number minAngle, number maxAngle)
+	{
+		++numElems;
+		if(numAng == 0)
+			return;
+
+		MomentAccumulator elem;
+		elem.num = numAng;
+		elem.mean = angleSum / (number)numAng;
+		elem.m2 = m2;
+		elem.min = minAngle;
+		elem.max = maxAngle;
+		angles.merge(elem);
+	}
+
+	void merge(const AngleDeviation& ad)
+	{
+		numElems += ad.numElems;
+		angles.merge(ad.angles);
+	}
+
+///	root mean square deviation of the angles from the regular angle
+	number standard_deviation() const
+	{
+		return sqrt(angles.mean_square_deviation(regAngle));
+	}
+
+	number mean() const
+	{
+		return angles.mean;
+	}
+
+	number regAngle;
+	size_t numElems;
+	MomentAccumulator angles;
+};
+
+
+}
+#endif  //__QUALITY_ACCUMULATORS_H__
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __QUALITY_ELEMENT_TYPES_H__
+#define __QUALITY_ELEMENT_TYPES_H__
+
+/* system includes */
+#include <stddef.h>
+#include <vector>
+#include <algorithm>
+
+#include "lib_grid/lib_grid.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ElementsByType
+///	the faces or volumes of a level, grouped by their reference object
+/**	The elements are gathered from the type sections of a GridObjectCollection
+ *	(goc.begin<Tetrahedron>(lvl), ...), so the type of an element never has to be
+ *	queried. All elements of one reference object are stored contiguously in the
+ *	index range [begin(roid), end(roid)), which allows to run a kernel specialized
+ *	for that type on the whole range (see ForEachElementType).
+ *
+ *	Ghosts and horizontal slaves are skipped in parallel if bSkipCopies is set, as
+ *	done by all quality statistics.*/
+template <class TBaseElem>
+class ElementsByType
+{
+	public:
+		ElementsByType()	{clear();}
+
+	///	removes all elements
+		void clear()
+		{
+			m_elems.clear();
+			for(int i = 0; i < NUM_REFERENCE_OBJECTS; ++i)
+				m_begin[i] = m_end[i] = 0;
+		}
+
+	///	appends the elements of the type section TElem of level lvl (of all levels if lvl < 0)
+	/**	All sections of one reference object have to be appended consecutively.*/
+		template <class TElem>
+		void append(Grid& grid, GridObjectCollection& goc, int lvl,
+					ReferenceObjectID roid, bool bSkipCopies = true)
+		{
+			if(m_begin[roid] == m_end[roid])
+				m_begin[roid] = m_elems.size();
+			else
+				UG_COND_THROW(m_end[roid] != m_elems.size(),
+							  "ElementsByType: sections of a reference object have to be appended consecutively.");
+
+			if(lvl < 0)
+			{
+				for(size_t l = 0; l < goc.num_levels(); ++l)
+					append_section(grid, goc.begin<TElem>(l), goc.end<TElem>(l),
+								   goc.num<TElem>(l), bSkipCopies);
+			}
+			else
+				append_section(grid, goc.begin<TElem>(lvl), goc.end<TElem>(lvl),
+							   goc.num<TElem>(lvl), bSkipCopies);
+
+			m_end[roid] = m_elems.size();
+			if(m_begin[roid] == m_end[roid])
+				m_begin[roid] = m_end[roid] = 0;
+		}
+
+	///	appends all type sections of TBaseElem (Face or Volume) of level lvl (of all levels if lvl < 0)
+		void collect(Grid& grid, GridObjectCollection& goc, int lvl, bool bSkipCopies = true);
+
+		size_t size() const							{return m_elems.size();}
+		bool empty() const							{return m_elems.empty();}
+
+		TBaseElem* operator[](size_t i) const		{return m_elems[i];}
+		TBaseElem* const* elements() const			{return m_elems.data();}
+
+	///	index range of the elements of a reference object
+		size_t begin(ReferenceObjectID roid) const	{return m_begin[roid];}
+		size_t end(ReferenceObjectID roid) const	{return m_end[roid];}
+		size_t num(ReferenceObjectID roid) const	{return m_end[roid] - m_begin[roid];}
+
+	private:
+		template <class TIterator>
+		void append_section(Grid& grid, TIterator begin, TIterator end, size_t num,
+							bool bSkipCopies)
+		{
+			DistributedGridManager* dgm = grid.distributed_grid_manager();
+
+			m_elems.reserve(m_elems.size() + num);
+			for(TIterator iter = begin; iter != end; ++iter)
+			{
+				#ifdef UG_PARALLEL
+				//	ghosts (vertical masters) as well as horizontal slaves (low dimensional elements only) have to be ignored,
+				//	since they have a copy on another process and
+				//	since we already consider that copy...
+					if(bSkipCopies && (dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE)))
+						continue;
+				#endif
+
+				m_elems.push_back(*iter);
+			}
+		}
+
+		std::vector<TBaseElem*>	m_elems;
+		size_t m_begin[NUM_REFERENCE_OBJECTS];
+		size_t m_end[NUM_REFERENCE_OBJECTS];
+};
+
+
+template <>
+inline void ElementsByType<Face>::
+collect(Grid& grid, GridObjectCollection& goc, int lvl, bool bSkipCopies)
+{
+	append<Triangle>(grid, goc, lvl, ROID_TRIANGLE, bSkipCopies);
+	append<ConstrainedTriangle>(grid, goc, lvl, ROID_TRIANGLE, bSkipCopies);
+	append<ConstrainingTriangle>(grid, goc, lvl, ROID_TRIANGLE, bSkipCopies);
+	append<Quadrilateral>(grid, goc, lvl, ROID_QUADRILATERAL, bSkipCopies);
+	append<ConstrainedQuadrilateral>(grid, goc, lvl, ROID_QUADRILATERAL, bSkipCopies);
+	append<ConstrainingQuadrilateral>(grid, goc, lvl, ROID_QUADRILATERAL, bSkipCopies);
+}
+
+template <>
+inline void ElementsByType<Volume>::
+collect(Grid& grid, GridObjectCollection& goc, int lvl, bool bSkipCopies)
+{
+	append<Tetrahedron>(grid, goc, lvl, ROID_TETRAHEDRON, bSkipCopies);
+	append<Hexahedron>(grid, goc, lvl, ROID_HEXAHEDRON, bSkipCopies);
+	append<Prism>(grid, goc, lvl, ROID_PRISM, bSkipCopies);
+	append<Pyramid>(grid, goc, lvl, ROID_PYRAMID, bSkipCopies);
+	append<Octahedron>(grid, goc, lvl, ROID_OCTAHEDRON, bSkipCopies);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ForEachElementType
+///	calls func.template apply<roid>(first, last) for the part [first, last) of [from, to) of every type
+/**	The reference object is a template argument, so that func can select a kernel
+ *	specialized for the type at compile time, which contains no per element type
+ *	checks. [from, to) may span several types, e.g. the chunk of a thread.*/
+template <int roid, class TBaseElem, class TFunc>
+inline void ApplyToElementType(const ElementsByType<TBaseElem>& elems,
+							   size_t from, size_t to, TFunc& func)
+{
+	const size_t first = std::max(from, elems.begin((ReferenceObjectID)roid));
+	const size_t last = std::min(to, elems.end((ReferenceObjectID)roid));
+	if(first < last)
+		func.template apply<roid>(first, last);
+}
+
+template <class TFunc>
+void ForEachElementType(const ElementsByType<Face>& faces, size_t from, size_t to, TFunc& func)
+{
+	ApplyToElementType<ROID_TRIANGLE>(faces, from, to, func);
+	ApplyToElementType<ROID_QUADRILATERAL>(faces, from, to, func);
+}
+
+template <class TFunc>
+void ForEachElementType(const ElementsByType<Volume>& vols, size_t from, size_t to, TFunc& func)
+{
+	ApplyToElementType<ROID_TETRAHEDRON>(vols, from, to, func);
+	ApplyToElementType<ROID_HEXAHEDRON>(vols, from, to, func);
+	ApplyToElementType<ROID_PRISM>(vols, from, to, func);
+	ApplyToElementType<ROID_PYRAMID>(vols, from, to, func);
+	ApplyToElementType<ROID_OCTAHEDRON>(vols, from, to, func);
+}
+
+
+}
+#endif  //__QUALITY_ELEMENT_TYPES_H__
@@ -0,0 +1,493 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "quality_fields.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#include "lib_grid/parallelization/parallelization_util.h"
+#endif
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityFields
+void QualityFields::init(int dimension)
+{
+	UG_COND_THROW(dimension != 2 && dimension != 3, "QualityFields: Only dimensions 2 or 3 supported.");
+
+	dim = dimension;
+	names.clear();
+	if(dim == 3)
+	{
+		names.push_back("min_dihedral");
+		names.push_back("max_dihedral");
+		names.push_back("aspect_ratio");
+		names.push_back("volume");
+		names.push_back("vol_to_rms_face_area_ratio");
+	}
+	else
+	{
+		names.push_back("min_angle");
+		names.push_back("max_angle");
+		names.push_back("aspect_ratio");
+		names.push_back("area");
+	}
+
+	rowIndices.clear();
+	elemIDs.clear();
+	columns.clear();
+	columns.resize(names.size());
+	firstRow = 0;
+	numGlobalRows = 0;
+}
+
+void QualityFields::reserve(size_t numRows)
+{
+	rowIndices.reserve(numRows);
+	elemIDs.reserve(2 * numRows);
+	for(size_t i = 0; i < columns.size(); ++i)
+		columns[i].reserve(numRows);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CollectQualityFields
+void AppendTetrahedronQualityFields(QualityFields& fields, const TetKernelResults& res)
+{
+	for(size_t i = 0; i < res.num; ++i)
+	{
+		fields.rowIndices.push_back(0);
+		fields.columns[0].push_back(res.minDihedral[i]);
+		fields.columns[1].push_back(res.maxDihedral[i]);
+		fields.columns[2].push_back(res.aspectRatio[i]);
+		fields.columns[3].push_back(res.volume[i]);
+		fields.columns[4].push_back(res.volToRMSFaceAreaRatio[i]);
+	}
+}
+
+void AssignQualityFieldRowIndices(QualityFields& fields)
+{
+	unsigned long long numRows = fields.num_rows();
+	unsigned long long offset = 0;
+	unsigned long long numGlobalRows = numRows;
+
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			pcl::ProcessCommunicator pc;
+			MPI_Exscan(&numRows, &offset, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+					   pc.get_mpi_communicator());
+			if(pcl::ProcRank() == 0)
+				offset = 0;
+			pc.allreduce(&numRows, &numGlobalRows, 1, PCL_DT_UNSIGNED_LONG_LONG, PCL_RO_SUM);
+		}
+	#endif
+
+	fields.firstRow = offset;
+	fields.numGlobalRows = numGlobalRows;
+	for(size_t i = 0; i < fields.rowIndices.size(); ++i)
+		fields.rowIndices[i] = offset + i;
+}
+
+///	makes sure that all elements of type TElem carry a global id in aGeomObjID (collective)
+template <class TElem>
+static void ProvideQualityFieldElementIDs(Grid& grid)
+{
+	if(grid.has_attachment<TElem>(aGeomObjID))
+		return;
+
+	grid.attach_to<TElem>(aGeomObjID);
+
+	#ifdef UG_PARALLEL
+		DistributedGridManager* dgm = grid.distributed_grid_manager();
+		if(dgm){
+			CreateAndDistributeGlobalIDs<TElem>(grid, dgm->grid_layout_map());
+			return;
+		}
+	#endif
+
+	Grid::AttachmentAccessor<TElem, AGeomObjID> aaID(grid, aGeomObjID);
+	size_t i = 0;
+	for(typename geometry_traits<TElem>::iterator iter = grid.begin<TElem>();
+		iter != grid.end<TElem>(); ++iter, ++i)
+	{
+		aaID[*iter] = GeomObjID(0, i);
+	}
+}
+
+///	writes the global ids of the elements of the rows, which are in the order of elems
+template <class TElem>
+static void AssignQualityFieldElementIDs(QualityFields& fields, Grid& grid,
+										 const ElementsByType<TElem>& elems)
+{
+	ProvideQualityFieldElementIDs<TElem>(grid);
+
+	Grid::AttachmentAccessor<TElem, AGeomObjID> aaID(grid, aGeomObjID);
+	fields.elemIDs.resize(2 * elems.size());
+	for(size_t i = 0; i < elems.size(); ++i)
+	{
+		const GeomObjID& id = aaID[elems[i]];
+		fields.elemIDs[2 * i] = (uint64_t)id.first;
+		fields.elemIDs[2 * i + 1] = (uint64_t)id.second;
+	}
+}
+
+void CollectQualityFields(QualityFields& fields, Grid& grid, GridObjectCollection goc,
+						  int dim, int lvl)
+{
+	UG_COND_THROW(lvl < 0 || lvl >= (int)goc.num_levels(), "Invalid level " << lvl << ".");
+
+	fields.init(dim);
+	if(dim == 3)
+	{
+		Grid::VertexAttachmentAccessor<APosition> aaPos(grid, aPosition);
+		ElementsByType<Volume> vols;
+		vols.collect(grid, goc, lvl);
+		fields.reserve(vols.size());
+		CollectVolumeQualityFields(fields, grid, vols, aaPos);
+		AssignQualityFieldElementIDs(fields, grid, vols);
+	}
+	else
+	{
+		Grid::VertexAttachmentAccessor<APosition2> aaPos(grid, aPosition2);
+		ElementsByType<Face> faces;
+		faces.collect(grid, goc, lvl);
+		fields.reserve(faces.size());
+		CollectFaceQualityFields(fields, grid, faces, aaPos);
+		AssignQualityFieldElementIDs(fields, grid, faces);
+	}
+
+	AssignQualityFieldRowIndices(fields);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Binary quality field files
+///	header and column names of a file
+static void PackQualityFieldHeader(vector<char>& bufOut, const QualityFields& fields,
+								   int rank, int numProcs, uint64_t numRows,
+								   uint64_t firstRow)
+{
+	QualityFieldFileHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, "UGQFLD02", 8);
+	hdr.byteOrderMark = QUALITY_FIELD_BYTE_ORDER_MARK;
+	hdr.headerSize = sizeof(hdr) + fields.num_columns() * QUALITY_FIELD_NAME_LENGTH;
+	hdr.numColumns = fields.num_columns();
+	hdr.dim = fields.dim;
+	hdr.rank = rank;
+	hdr.numProcs = numProcs;
+	hdr.numRows = numRows;
+	hdr.firstRow = firstRow;
+	hdr.numGlobalRows = fields.numGlobalRows;
+
+	bufOut.assign(hdr.headerSize, 0);
+	memcpy(&bufOut.front(), &hdr, sizeof(hdr));
+	for(size_t i = 0; i < fields.num_columns(); ++i)
+	{
+		UG_COND_THROW(fields.names[i].size() >= QUALITY_FIELD_NAME_LENGTH,
+					  "Quality field name '" << fields.names[i] << "' too long.");
+		memcpy(&bufOut[sizeof(hdr) + i * QUALITY_FIELD_NAME_LENGTH],
+			   fields.names[i].c_str(), fields.names[i].size());
+	}
+}
+
+///	writes all rows of 'fields' into one file with the given rank information
+static void WriteQualityFieldFile(const QualityFields& fields, const char* filename,
+								  int rank, int numProcs)
+{
+	vector<char> hdr;
+	PackQualityFieldHeader(hdr, fields, rank, numProcs, fields.num_rows(), fields.firstRow);
+
+	ofstream out(filename, ios::out | ios::binary | ios::trunc);
+	UG_COND_THROW(!out, "Couldn't open file '" << filename << "' for writing.");
+
+	out.write(&hdr.front(), hdr.size());
+	if(fields.num_rows() > 0)
+	{
+		out.write(reinterpret_cast<const char*>(&fields.rowIndices.front()),
+				  fields.num_rows() * sizeof(uint64_t));
+		out.write(reinterpret_cast<const char*>(&fields.elemIDs.front()),
+				  2 * fields.num_rows() * sizeof(uint64_t));
+		for(size_t i = 0; i < fields.num_columns(); ++i)
+			out.write(reinterpret_cast<const char*>(&fields.columns[i].front()),
+					  fields.num_rows() * sizeof(double));
+	}
+
+	UG_COND_THROW(!out, "Couldn't write file '" << filename << "'.");
+}
+
+std::string WriteQualityFieldsPerProcess(const QualityFields& fields, const char* filenameBase)
+{
+	int rank = 0;
+	int numProcs = 1;
+	#ifdef UG_PARALLEL
+		rank = pcl::ProcRank();
+		numProcs = pcl::NumProcs();
+	#endif
+
+	std::stringstream ss;
+	ss << filenameBase << "_p" << rank << ".uqf";
+	WriteQualityFieldFile(fields, ss.str().c_str(), rank, numProcs);
+	return ss.str();
+}
+
+#ifdef UG_PARALLEL
+///	collective write of the local part of a column. All processes perform the same
+///	number of calls, each of at most maxChunk entries.
+/**	Returns false if one of the writes failed. The remaining calls are performed
+ *	anyways, so that the collective calls of all processes still match.*/
+template <class T>
+static bool WriteColumnAtAll(MPI_File fh, MPI_Offset offset, const std::vector<T>& col,
+							 size_t numChunks, size_t maxChunk)
+{
+	bool bSuccess = true;
+	for(size_t k = 0; k < numChunks; ++k)
+	{
+		size_t from = std::min(k * maxChunk, col.size());
+		size_t num = std::min(maxChunk, col.size() - from);
+		const T* buf = (num > 0) ? &col[from] : NULL;
+		int err = MPI_File_write_at_all(fh, offset + (MPI_Offset)(from * sizeof(T)),
+										const_cast<T*>(buf), (int)(num * sizeof(T)), MPI_BYTE,
+										MPI_STATUS_IGNORE);
+		bSuccess &= (err == MPI_SUCCESS);
+	}
+	return bSuccess;
+}
+#endif
+
+void WriteQualityFieldsMerged(const QualityFields& fields, const char* filename)
+{
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			pcl::ProcessCommunicator pc;
+
+			vector<char> hdr;
+			PackQualityFieldHeader(hdr, fields, -1, pcl::NumProcs(), fields.numGlobalRows, 0);
+
+			MPI_File fh;
+			int err = MPI_File_open(pc.get_mpi_communicator(), const_cast<char*>(filename),
+									MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &fh);
+			UG_COND_THROW(err != MPI_SUCCESS, "Couldn't open file '" << filename << "' for writing.");
+
+		//	the row indices and the columns take colSize bytes, the element ids twice as much
+			MPI_Offset colSize = (MPI_Offset)(fields.numGlobalRows * sizeof(double));
+			MPI_Offset fileSize = (MPI_Offset)hdr.size() + colSize * (MPI_Offset)(fields.num_columns() + 3);
+			bool bSuccess = (MPI_File_set_size(fh, fileSize) == MPI_SUCCESS);
+
+			if(pcl::ProcRank() == 0){
+				bSuccess &= (MPI_File_write_at(fh, 0, &hdr.front(), (int)hdr.size(), MPI_BYTE,
+											   MPI_STATUS_IGNORE) == MPI_SUCCESS);
+			}
+
+		//	the rows of this process start at firstRow in every column.
+		//	Chunks keep the byte counts of the single calls in the range of int.
+			const size_t maxChunk = (size_t)1 << 24;
+			unsigned long long numRows = fields.num_rows(), maxNumRows = 0;
+			pc.allreduce(&numRows, &maxNumRows, 1, PCL_DT_UNSIGNED_LONG_LONG, PCL_RO_MAX);
+			size_t numChunks = (maxNumRows + maxChunk - 1) / maxChunk;
+
+			MPI_Offset rowOffset = (MPI_Offset)(fields.firstRow * sizeof(double));
+			bSuccess &= WriteColumnAtAll(fh, (MPI_Offset)hdr.size() + rowOffset, fields.rowIndices,
+										 numChunks, maxChunk);
+			bSuccess &= WriteColumnAtAll(fh, (MPI_Offset)hdr.size() + colSize + 2 * rowOffset,
+										 fields.elemIDs, numChunks, 2 * maxChunk);
+			for(size_t i = 0; i < fields.num_columns(); ++i)
+				bSuccess &= WriteColumnAtAll(fh, (MPI_Offset)hdr.size() + colSize * (MPI_Offset)(i + 3)
+											 + rowOffset, fields.columns[i], numChunks, maxChunk);
+
+			bSuccess &= (MPI_File_close(&fh) == MPI_SUCCESS);
+
+		//	all processes throw, if the file couldn't be written by one of them
+			int allSuccess = pc.allreduce((int)bSuccess, PCL_RO_MIN);
+			UG_COND_THROW(!allSuccess, "Couldn't write file '" << filename << "'.");
+			return;
+		}
+	#endif
+
+	WriteQualityFieldFile(fields, filename, -1, 1);
+}
+
+static void WriteElementQualityFields(Grid& grid, GridObjectCollection goc, int dim, int lvl,
+									  const char* filename, bool bMerged)
+{
+	QualityFields fields;
+	CollectQualityFields(fields, grid, goc, dim, lvl);
+
+	if(bMerged)
+		WriteQualityFieldsMerged(fields, filename);
+	else
+		WriteQualityFieldsPerProcess(fields, filename);
+}
+
+void WriteElementQualityFields(MultiGrid& mg, int dim, int lvl, const char* filename, bool bMerged)
+{
+	WriteElementQualityFields(mg, mg.get_grid_objects(), dim, lvl, filename, bMerged);
+}
+
+void WriteElementQualityFields(Grid& grid, int dim, const char* filename, bool bMerged)
+{
+	WriteElementQualityFields(grid, grid.get_grid_objects(), dim, 0, filename, bMerged);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityFieldFile
+QualityFieldFile::QualityFieldFile(const char* filename) :
+	m_data(NULL),
+	m_size(0),
+	m_bMapped(false)
+{
+#ifndef _WIN32
+	int fd = open(filename, O_RDONLY);
+	UG_COND_THROW(fd < 0, "Couldn't open quality field file '" << filename << "'.");
+
+	struct stat st;
+	if(fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(p != MAP_FAILED)
+		{
+			m_data = static_cast<const char*>(p);
+			m_size = st.st_size;
+			m_bMapped = true;
+		}
+	}
+	close(fd);
+#endif
+
+//	fallback if the file couldn't be mapped
+	if(!m_bMapped)
+	{
+		ifstream in(filename, ios::in | ios::binary);
+		UG_COND_THROW(!in, "Couldn't open quality field file '" << filename << "'.");
+		in.seekg(0, ios::end);
+		m_buffer.resize(in.tellg());
+		in.seekg(0, ios::beg);
+		if(!m_buffer.empty())
+			in.read(&m_buffer.front(), m_buffer.size());
+		m_data = m_buffer.empty() ? NULL : &m_buffer.front();
+		m_size = m_buffer.size();
+	}
+
+	UG_COND_THROW(m_size < sizeof(QualityFieldFileHeader) || memcmp(m_data, "UGQFLD02", 8) != 0,
+				  "'" << filename << "' is no quality field file.");
+
+	m_header = reinterpret_cast<const QualityFieldFileHeader*>(m_data);
+	UG_COND_THROW(m_header->byteOrderMark != QUALITY_FIELD_BYTE_ORDER_MARK,
+				  "Quality field file '" << filename << "' was written with a different byte order.");
+
+	uint64_t numRows = m_header->numRows;
+	uint64_t expectedSize = m_header->headerSize + 3 * numRows * sizeof(uint64_t)
+							+ numRows * m_header->numColumns * sizeof(double);
+	UG_COND_THROW(m_size < expectedSize, "Quality field file '" << filename << "' is truncated.");
+
+	m_names = m_data + sizeof(QualityFieldFileHeader);
+	m_rowIndices = reinterpret_cast<const uint64_t*>(m_data + m_header->headerSize);
+	m_elemIDs = m_rowIndices + numRows;
+	m_columns = reinterpret_cast<const double*>(m_elemIDs + 2 * numRows);
+}
+
+QualityFieldFile::~QualityFieldFile()
+{
+#ifndef _WIN32
+	if(m_bMapped)
+		munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+std::string QualityFieldFile::column_name(size_t col) const
+{
+	UG_COND_THROW(col >= num_columns(), "QualityFieldFile: invalid column " << col << ".");
+	const char* name = m_names + col * QUALITY_FIELD_NAME_LENGTH;
+	return std::string(name, strnlen(name, QUALITY_FIELD_NAME_LENGTH));
+}
+
+int QualityFieldFile::column_index(const char* name) const
+{
+	for(size_t i = 0; i < num_columns(); ++i)
+		if(column_name(i) == name)
+			return (int)i;
+	return -1;
+}
+
+const double* QualityFieldFile::column(size_t col) const
+{
+	UG_COND_THROW(col >= num_columns(), "QualityFieldFile: invalid column " << col << ".");
+	return m_columns + col * num_rows();
+}
+
+uint64_t QualityFieldFile::row_index(size_t row) const
+{
+	UG_COND_THROW(row >= num_rows(), "QualityFieldFile: invalid row " << row << ".");
+	return m_rowIndices[row];
+}
+
+uint64_t QualityFieldFile::element_id_proc(size_t row) const
+{
+	UG_COND_THROW(row >= num_rows(), "QualityFieldFile: invalid row " << row << ".");
+	return m_elemIDs[2 * row];
+}
+
+uint64_t QualityFieldFile::element_id_local(size_t row) const
+{
+	UG_COND_THROW(row >= num_rows(), "QualityFieldFile: invalid row " << row << ".");
+	return m_elemIDs[2 * row + 1];
+}
+
+double QualityFieldFile::value(const char* name, size_t row) const
+{
+	int col = column_index(name);
+	UG_COND_THROW(col < 0, "QualityFieldFile: no column '" << name << "'.");
+	UG_COND_THROW(row >= num_rows(), "QualityFieldFile: invalid row " << row << ".");
+	return column(col)[row];
+}
+
+
+}
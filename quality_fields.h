@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __QUALITY_FIELDS_H__
+#define __QUALITY_FIELDS_H__
+
+/* system includes */
+#include <stddef.h>
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include <type_traits>
+
+#include "lib_grid/lib_grid.h"
+#include "lib_grid/algorithms/element_angles.h"
+#include "lib_grid/algorithms/element_aspect_ratios.h"
+#include "quality_element_types.h"
+#include "quality_snapshot_kernels.h"
+#include "tet_kernels.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityFields
+///	Per element quality values of the elements of one level owned by this process
+/**	The values are stored column wise. rowIndices[i] is the index of row i in the rows
+ *	of all processes. The row indices are consecutive over all processes, ordered by
+ *	process rank and by the element order on each process, in which the elements are
+ *	grouped by their type (see AssignQualityFieldRowIndices and ElementsByType). They
+ *	only depend on the distribution of the grid. Row i belongs to the element with the
+ *	global id (elemIDs[2*i], elemIDs[2*i+1]), i.e. the process and the local id of
+ *	its aGeomObjID, which is the same on all processes (see CollectQualityFields).
+ *	Values which are not available for an element (e.g. the vol/RMS-face-area ratio of
+ *	a hexahedron) are NaN.
+ *
+ *	Columns for volumes (dim 3): min_dihedral, max_dihedral, aspect_ratio, volume,
+ *	vol_to_rms_face_area_ratio. Columns for faces (dim 2): min_angle, max_angle,
+ *	aspect_ratio, area.*/
+struct QualityFields
+{
+	QualityFields() : dim(0), firstRow(0), numGlobalRows(0)	{}
+
+	size_t num_rows() const				{return rowIndices.size();}
+	size_t num_columns() const			{return columns.size();}
+
+///	sets the columns for the given dimension and removes all rows
+	void init(int dimension);
+
+///	reserves memory for the given number of rows
+	void reserve(size_t numRows);
+
+	int dim;
+	std::vector<std::string> names;
+	std::vector<uint64_t> rowIndices;
+	std::vector<uint64_t> elemIDs;		///< process and local id of the global id of each row
+	std::vector<std::vector<double> > columns;
+
+///	row index of the first row and number of rows of all processes
+	uint64_t firstRow;
+	uint64_t numGlobalRows;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CollectQualityFields
+///	appends the rows of tetrahedra evaluated by the tetrahedron kernels
+void AppendTetrahedronQualityFields(QualityFields& fields, const TetKernelResults& res);
+
+///	appends the quality values of the volumes of a type to the fields (see ForEachElementType)
+/**	Tetrahedra are evaluated batch-wise by the tetrahedron kernels, prisms and pyramids
+ *	by their coordinate kernels (see SnapshotPrismQuality) and all other types through
+ *	lib_grid.*/
+template <class TAAPosVRT>
+struct VolumeQualityFieldsCollector
+{
+	VolumeQualityFieldsCollector(QualityFields& fields_, Grid& grid_,
+								 const ElementsByType<Volume>& vols_, TAAPosVRT& aaPos_) :
+		fields(fields_), grid(grid_), vols(vols_), aaPos(aaPos_)
+	{}
+
+	template <int roid>
+	void apply(size_t from, size_t to)
+	{
+		collect(from, to, std::integral_constant<int, roid>());
+	}
+
+	void collect(size_t from, size_t to, std::integral_constant<int, ROID_TETRAHEDRON>)
+	{
+		TetBatch tets;
+		for(size_t i = from; i < to; ++i)
+		{
+			tets.push_back(vols[i], aaPos);
+			if(tets.full() || i + 1 == to)
+			{
+				AppendTetrahedronQualityFields(fields, tets.evaluate(false));
+				tets.clear();
+			}
+		}
+	}
+
+	void collect(size_t from, size_t to, std::integral_constant<int, ROID_PRISM>)
+	{
+		static const int corners[6] = {0, 1, 2, 3, 4, 5};
+		number x[6], y[6], z[6];
+		PrismQuality q;
+		for(size_t i = from; i < to; ++i)
+		{
+			GatherCornerCoordinates(x, y, z, vols[i], aaPos);
+			SnapshotPrismQuality(q, x, y, z, corners);
+			append(q.minDihedral, q.maxDihedral, q.aspectRatio, q.volume, q.volToRMSFaceAreaRatio);
+		}
+	}
+
+	void collect(size_t from, size_t to, std::integral_constant<int, ROID_PYRAMID>)
+	{
+		static const int corners[5] = {0, 1, 2, 3, 4};
+		number x[5], y[5], z[5];
+		PyramidQuality q;
+		for(size_t i = from; i < to; ++i)
+		{
+			GatherCornerCoordinates(x, y, z, vols[i], aaPos);
+			SnapshotPyramidQuality(q, x, y, z, corners);
+			append(q.minDihedral, q.maxDihedral, q.aspectRatio, q.volume, q.volToRMSFaceAreaRatio);
+		}
+	}
+
+	template <int roid>
+	void collect(size_t from, size_t to, std::integral_constant<int, roid>)
+	{
+		const double nan = std::numeric_limits<double>::quiet_NaN();
+		std::vector<number> vDihedrals;
+
+		for(size_t i = from; i < to; ++i)
+		{
+			Volume* vol = vols[i];
+
+			vDihedrals.clear();
+			CalculateAngles(vDihedrals, grid, vol, aaPos);
+
+			fields.rowIndices.push_back(0);
+			fields.columns[0].push_back(vDihedrals.empty() ? nan : *std::min_element(vDihedrals.begin(), vDihedrals.end()));
+			fields.columns[1].push_back(vDihedrals.empty() ? nan : *std::max_element(vDihedrals.begin(), vDihedrals.end()));
+			fields.columns[2].push_back(CalculateAspectRatio(grid, vol, aaPos));
+			fields.columns[3].push_back(CalculateVolume(vol, aaPos));
+			fields.columns[4].push_back(nan);
+		}
+	}
+
+	void append(number minDihedral, number maxDihedral, number aspectRatio, number volume,
+				number volToRMSFaceAreaRatio)
+	{
+		fields.rowIndices.push_back(0);
+		fields.columns[0].push_back(minDihedral);
+		fields.columns[1].push_back(maxDihedral);
+		fields.columns[2].push_back(aspectRatio);
+		fields.columns[3].push_back(volume);
+		fields.columns[4].push_back(volToRMSFaceAreaRatio);
+	}
+
+	QualityFields& fields;
+	Grid& grid;
+	const ElementsByType<Volume>& vols;
+	TAAPosVRT& aaPos;
+};
+
+///	appends the quality values of the volumes of a level owned by this process
+/**	The rows are ordered by the element types (see ElementsByType), ghosts are skipped.
+ *	The row indices and element ids are assigned by CollectQualityFields afterwards.*/
+template <class TAAPosVRT>
+void CollectVolumeQualityFields(QualityFields& fields, Grid& grid,
+								const ElementsByType<Volume>& vols, TAAPosVRT& aaPos)
+{
+	VolumeQualityFieldsCollector<TAAPosVRT> collector(fields, grid, vols, aaPos);
+	ForEachElementType(vols, 0, vols.size(), collector);
+}
+
+///	appends the quality values of the faces of a level owned by this process
+/**	The rows are ordered by the element types (see ElementsByType), ghosts and
+ *	horizontal slaves are skipped. The row indices and element ids are assigned by
+ *	CollectQualityFields afterwards.*/
+template <class TAAPosVRT>
+void CollectFaceQualityFields(QualityFields& fields, Grid& grid,
+							  const ElementsByType<Face>& faces, TAAPosVRT& aaPos)
+{
+	const double nan = std::numeric_limits<double>::quiet_NaN();
+	std::vector<number> vAngles;
+
+//	all face types (triangles and quadrilaterals) have an aspect ratio
+	for(size_t i = 0; i < faces.size(); ++i)
+	{
+		Face* f = faces[i];
+
+		vAngles.clear();
+		CalculateAngles(vAngles, grid, f, aaPos);
+
+		fields.rowIndices.push_back(0);
+		fields.columns[0].push_back(vAngles.empty() ? nan : *std::min_element(vAngles.begin(), vAngles.end()));
+		fields.columns[1].push_back(vAngles.empty() ? nan : *std::max_element(vAngles.begin(), vAngles.end()));
+		fields.columns[2].push_back(CalculateAspectRatio(grid, f, aaPos));
+		fields.columns[3].push_back(FaceArea(f, aaPos));
+	}
+}
+
+///	numbers the rows of all processes consecutively by process rank (collective)
+void AssignQualityFieldRowIndices(QualityFields& fields);
+
+///	collects the quality values of the elements of level lvl (collective)
+/**	The global ids of the elements are taken from aGeomObjID. If the elements don't
+ *	carry it yet, it is attached and, in parallel, created and distributed by
+ *	CreateAndDistributeGlobalIDs, so that an element has the same id on all processes.
+ *	In serial, the ids are (0, index of the element in the grid).*/
+void CollectQualityFields(QualityFields& fields, Grid& grid, GridObjectCollection goc,
+						  int dim, int lvl);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Binary quality field files
+/**	Layout of a file (native byte order, all offsets multiples of 8):
+ *	- QualityFieldFileHeader
+ *	- numColumns names of QUALITY_FIELD_NAME_LENGTH bytes (zero padded)
+ *	- numRows row indices (uint64_t)
+ *	- numRows element ids, 2 uint64_t each (process and local id of aGeomObjID)
+ *	- numColumns columns of numRows values each (double)
+ *
+ *	Every process either writes a file of its own (rank != -1) or all processes write
+ *	their rows into one file (rank == -1) through collective MPI-IO writes. In both
+ *	cases no data is sent to another process, so writing is O(local elements).*/
+static const size_t QUALITY_FIELD_NAME_LENGTH = 32;
+static const uint32_t QUALITY_FIELD_BYTE_ORDER_MARK = 0x01020304;
+
+struct QualityFieldFileHeader
+{
+	char magic[8];				///< "UGQFLD02"
+	uint32_t byteOrderMark;		///< QUALITY_FIELD_BYTE_ORDER_MARK in the writer's byte order
+	uint32_t headerSize;		///< offset of the row indices in bytes
+	uint32_t numColumns;
+	int32_t dim;
+	int32_t rank;				///< writing process, -1 for a merged file
+	int32_t numProcs;
+	uint64_t numRows;
+	uint64_t firstRow;			///< row index of the first row
+	uint64_t numGlobalRows;		///< number of rows of all processes
+	uint32_t reserved[2];
+};
+
+///	writes the rows of this process to a file of its own, e.g. "fields_p3.uqf" for "fields"
+/**	Returns the name of the written file.*/
+std::string WriteQualityFieldsPerProcess(const QualityFields& fields, const char* filenameBase);
+
+///	writes the rows of all processes into one file (collective)
+void WriteQualityFieldsMerged(const QualityFields& fields, const char* filename);
+
+///	evaluates the elements of a level and writes their quality values (collective)
+/**	If bMerged is set, one file 'filename' is written by all processes, otherwise each
+ *	process writes 'filename'_p<rank>.uqf.*/
+void WriteElementQualityFields(MultiGrid& mg, int dim, int lvl, const char* filename, bool bMerged);
+void WriteElementQualityFields(Grid& grid, int dim, const char* filename, bool bMerged);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityFieldFile
+///	Read-only access to a binary quality field file
+/**	The file is mapped into memory (POSIX) or read as a whole (other platforms), so that
+ *	the columns can be accessed without copies.*/
+class QualityFieldFile
+{
+	public:
+		QualityFieldFile(const char* filename);
+		~QualityFieldFile();
+
+		const QualityFieldFileHeader& header() const	{return *m_header;}
+
+		size_t num_rows() const				{return m_header->numRows;}
+		size_t num_columns() const			{return m_header->numColumns;}
+		int dim() const						{return m_header->dim;}
+		int rank() const					{return m_header->rank;}
+
+		std::string column_name(size_t col) const;
+
+	///	index of the column with the given name, -1 if there is none
+		int column_index(const char* name) const;
+
+		const uint64_t* row_indices() const	{return m_rowIndices;}
+	///	process and local id of the global id of each row (2 entries per row)
+		const uint64_t* element_ids() const	{return m_elemIDs;}
+		const double* column(size_t col) const;
+
+	///	single values (for scripts)
+		uint64_t row_index(size_t row) const;
+		uint64_t element_id_proc(size_t row) const;
+		uint64_t element_id_local(size_t row) const;
+		double value(const char* name, size_t row) const;
+
+	private:
+		QualityFieldFile(const QualityFieldFile&);
+		QualityFieldFile& operator=(const QualityFieldFile&);
+
+	private:
+		const char* m_data;
+		size_t m_size;
+		bool m_bMapped;
+		std::vector<char> m_buffer;
+
+		const QualityFieldFileHeader* m_header;
+		const char* m_names;
+		const uint64_t* m_rowIndices;
+		const uint64_t* m_elemIDs;
+		const double* m_columns;
+};
+
+
+}
+#endif  //__QUALITY_FIELDS_H__
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include "quality_histogram.h"
+#include "common/log.h"
+#include "common/error.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityHistogram
+QualityHistogram::QualityHistogram()
+{
+	init(0.0, 1.0, 0);
+}
+
+QualityHistogram::QualityHistogram(number lowerBound, number stepSize, size_t numBins)
+{
+	init(lowerBound, stepSize, numBins);
+}
+
+void QualityHistogram::init(number lowerBound, number stepSize, size_t numBins)
+{
+	UG_COND_THROW(stepSize <= 0, "QualityHistogram: step size has to be positive.");
+
+	m_lowerBound = lowerBound;
+	m_stepSize = stepSize;
+	m_counts.resize(numBins);
+	clear();
+}
+
+void QualityHistogram::clear()
+{
+	m_counts.assign(m_counts.size(), 0);
+	m_numValues = 0;
+	m_numBelow = 0;
+	m_numAbove = 0;
+	m_min = numeric_limits<number>::max();
+	m_max = -numeric_limits<number>::max();
+}
+
+void QualityHistogram::merge(const QualityHistogram& hist)
+{
+	UG_COND_THROW(hist.m_counts.size() != m_counts.size()
+				  || hist.m_lowerBound != m_lowerBound
+				  || hist.m_stepSize != m_stepSize,
+				  "QualityHistogram::merge: histograms with different bins can't be merged.");
+
+	for(size_t i = 0; i < m_counts.size(); ++i)
+		m_counts[i] += hist.m_counts[i];
+
+	m_numValues += hist.m_numValues;
+	m_numBelow += hist.m_numBelow;
+	m_numAbove += hist.m_numAbove;
+	if(hist.m_min < m_min) m_min = hist.m_min;
+	if(hist.m_max > m_max) m_max = hist.m_max;
+}
+
+void QualityHistogram::pack(vector<number>& sumsOut, vector<number>& minsOut) const
+{
+	sumsOut.push_back((number)m_numValues);
+	sumsOut.push_back((number)m_numBelow);
+	sumsOut.push_back((number)m_numAbove);
+	for(size_t i = 0; i < m_counts.size(); ++i)
+		sumsOut.push_back((number)m_counts[i]);
+
+	minsOut.push_back(m_min);
+	minsOut.push_back(-m_max);
+}
+
+void QualityHistogram::unpack(const vector<number>& sums, size_t& sumOffset,
+							  const vector<number>& mins, size_t& minOffset)
+{
+	m_numValues = (size_t)sums[sumOffset++];
+	m_numBelow = (size_t)sums[sumOffset++];
+	m_numAbove = (size_t)sums[sumOffset++];
+	for(size_t i = 0; i < m_counts.size(); ++i)
+		m_counts[i] = (size_t)sums[sumOffset++];
+
+	m_min = mins[minOffset++];
+	m_max = -mins[minOffset++];
+}
+
+void QualityHistogram::allreduce()
+{
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			vector<number> locSums, sums, locMins, mins;
+			pack(locSums, locMins);
+
+			pcl::ProcessCommunicator pc;
+			pc.allreduce(locSums, sums, PCL_RO_SUM);
+			pc.allreduce(locMins, mins, PCL_RO_MIN);
+
+			size_t sumOffset = 0, minOffset = 0;
+			unpack(sums, sumOffset, mins, minOffset);
+		}
+	#endif
+}
+
+void QualityHistogram::print_thirds(number from, size_t numRanges, const char* suffix) const
+{
+//	first bin of the table (tolerance for rounded range bounds)
+	number firstPos = floor((from - m_lowerBound) / m_stepSize + 1e-8);
+	size_t first = (firstPos > 0) ? (size_t)firstPos : 0;
+
+//	Divide the output table into three thirds (columnwise)
+	size_t numRows = ceil(number(numRanges) / 3.0);
+
+//	Create table object
+	ug::Table<std::stringstream> table(numRows, 6);
+
+	for(size_t i = 0; i < numRanges; ++i)
+	{
+		size_t bin = first + i;
+		size_t third = i / numRows;
+		size_t row = i - third*numRows;
+
+		table(row, 2*third) << bin_lower(bin) << " - " << bin_upper(bin) << suffix;
+		table(row, 2*third+1) << ((bin < m_counts.size()) ? m_counts[bin] : 0);
+	}
+
+//	Output table
+	UG_LOG(endl << table);
+}
+
+void QualityHistogram::write_percentages(ug::Table<std::stringstream>& tableOut) const
+{
+	size_t numBinned = num_binned();
+
+	tableOut.add_rows(m_counts.size());
+	tableOut.add_cols(2);
+
+	for(size_t i = 0; i < m_counts.size(); ++i)
+	{
+		tableOut(i, 0) << bin_lower(i) << " - " << bin_upper(i);
+		tableOut(i, 1) << 100.0/numBinned*m_counts[i];
+	}
+}
+
+
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __QUALITY_HISTOGRAM_H__
+#define __QUALITY_HISTOGRAM_H__
+
+/* system includes */
+#include <stddef.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <sstream>
+
+#include "common/types.h"
+#include "common/util/table.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityHistogram
+///	Streaming histogram with equidistant bins for element quality measures
+/**	The bins cover [lowerBound, lowerBound + numBins*stepSize). The bin of a value is
+ *	computed arithmetically, values are added one at a time and are not stored.
+ *	Values outside of the covered range are only counted as below or above.
+ *	Histograms with identical bins can be merged (e.g. from different threads) and
+ *	summed up over all processes.*/
+class QualityHistogram
+{
+	public:
+		QualityHistogram();
+		QualityHistogram(number lowerBound, number stepSize, size_t numBins);
+
+	///	sets the bins and clears all counts
+		void init(number lowerBound, number stepSize, size_t numBins);
+
+	///	clears all counts, the bins are kept
+		void clear();
+
+	///	returns the bin of the given value. May be negative or >= num_bins().
+		inline int bin_index(number val) const
+		{
+			number pos = floor((val - m_lowerBound) / m_stepSize);
+			if(!(pos >= 0)) return -1;
+			if(pos >= (number)m_counts.size()) return (int)m_counts.size();
+			return (int)pos;
+		}
+
+	///	returns the bin of the given value, clamped to the first and last bin
+		inline size_t clamped_bin_index(number val) const
+		{
+			int bin = bin_index(val);
+			if(bin < 0) return 0;
+			if(bin >= (int)m_counts.size()) return m_counts.size() - 1;
+			return (size_t)bin;
+		}
+
+	///	adds a value
+		inline void add(number val)
+		{
+			++m_numValues;
+			if(val < m_min) m_min = val;
+			if(val > m_max) m_max = val;
+
+			int bin = bin_index(val);
+			if(bin < 0)
+				++m_numBelow;
+			else if(bin >= (int)m_counts.size())
+				++m_numAbove;
+			else
+				++m_counts[bin];
+		}
+
+	///	removes a value which has been added before
+	/**	The extremal values are not updated, see set_extremal_values.*/
+		inline void remove(number val)
+		{
+			--m_numValues;
+
+			int bin = bin_index(val);
+			if(bin < 0)
+				--m_numBelow;
+			else if(bin >= (int)m_counts.size())
+				--m_numAbove;
+			else
+				--m_counts[bin];
+		}
+
+	///	overwrites the smallest and largest value (e.g. if values have been removed)
+		void set_extremal_values(number minVal, number maxVal)
+		{
+			m_min = minVal;
+			m_max = maxVal;
+		}
+
+	///	adds the counts of a histogram with identical bins
+		void merge(const QualityHistogram& hist);
+
+	///	sums up the counts of all processes (collective)
+		void allreduce();
+
+	///	appends the counts to a sum buffer and the extremal values to a min buffer
+	/**	The maximum is stored negated, so that the min buffer can be reduced with
+	 *	PCL_RO_MIN. Used to reduce several histograms with only two collectives.*/
+		void pack(std::vector<number>& sumsOut, std::vector<number>& minsOut) const;
+
+	///	reads the reduced values written by pack. The offsets are advanced.
+		void unpack(const std::vector<number>& sums, size_t& sumOffset,
+					const std::vector<number>& mins, size_t& minOffset);
+
+		size_t num_bins() const				{return m_counts.size();}
+		number lower_bound() const			{return m_lowerBound;}
+		number step_size() const			{return m_stepSize;}
+		number bin_lower(size_t bin) const	{return m_lowerBound + bin*m_stepSize;}
+		number bin_upper(size_t bin) const	{return m_lowerBound + (bin+1)*m_stepSize;}
+		size_t count(size_t bin) const		{return m_counts[bin];}
+		const std::vector<size_t>& counts() const	{return m_counts;}
+
+		size_t num_values() const			{return m_numValues;}
+		size_t num_binned() const			{return m_numValues - m_numBelow - m_numAbove;}
+		size_t num_below() const			{return m_numBelow;}
+		size_t num_above() const			{return m_numAbove;}
+
+	///	smallest and largest value added (also if outside of the bins)
+		number min() const					{return m_min;}
+		number max() const					{return m_max;}
+
+	///	logs numRanges bins starting with the bin containing 'from', split into thirds
+	/**	'suffix' is appended to the range labels (e.g. " deg : "). 'from' should be a
+	 *	bin bound, otherwise the printed ranges start at the bound below it.*/
+		void print_thirds(number from, size_t numRanges, const char* suffix) const;
+
+	///	writes the percentage of binned values per bin into a table (for csv output)
+		void write_percentages(ug::Table<std::stringstream>& tableOut) const;
+
+	protected:
+		number m_lowerBound;
+		number m_stepSize;
+		std::vector<size_t> m_counts;
+
+		size_t m_numValues;
+		size_t m_numBelow;
+		size_t m_numAbove;
+		number m_min;
+		number m_max;
+};
+
+
+}
+#endif  //__QUALITY_HISTOGRAM_H__
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "quality_metric_index.h"
+#include "element_quality_statistics.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityMetricIndex
+QualityMetricIndex::QualityMetricIndex(Grid& grid, int dim) :
+	m_pGrid(&grid),
+	m_lvl(0)
+{
+	init(dim);
+}
+
+QualityMetricIndex::QualityMetricIndex(MultiGrid& mg, int dim, int lvl) :
+	m_pGrid(&mg),
+	m_lvl(lvl)
+{
+	init(dim);
+}
+
+QualityMetricIndex::~QualityMetricIndex()
+{
+	if(m_pGrid)
+		m_pGrid->unregister_observer(this);
+}
+
+void QualityMetricIndex::init(int dim)
+{
+	UG_COND_THROW(dim != 2 && dim != 3, "QualityMetricIndex: Only dimensions 2 or 3 supported.");
+	UG_COND_THROW(m_lvl < 0, "QualityMetricIndex: invalid level " << m_lvl << ".");
+
+	m_dim = dim;
+	m_pGrid->register_observer(this, OT_GRID_OBSERVER | OT_FACE_OBSERVER | OT_VOLUME_OBSERVER);
+}
+
+void QualityMetricIndex::invalidate()
+{
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+	{
+		m_measures[i].bBuilt = false;
+		vector<Entry>().swap(m_measures[i].entries);
+	}
+}
+
+QualityCacheMeasure QualityMetricIndex::measure_by_name(const char* name) const
+{
+	for(size_t i = 0; i < NUM_QUALITY_CACHE_MEASURES; ++i)
+		if(strcmp(name, ElementQualityCache::measure_name((QualityCacheMeasure)i)) == 0)
+			return (QualityCacheMeasure)i;
+
+	UG_THROW("QualityMetricIndex: unknown measure '" << name << "'.");
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	GridObserver callbacks
+void QualityMetricIndex::face_created(Grid*, Face*, GridObject*, bool)
+{
+	invalidate();
+}
+
+void QualityMetricIndex::face_to_be_erased(Grid*, Face*, Face*)
+{
+	invalidate();
+}
+
+void QualityMetricIndex::volume_created(Grid*, Volume*, GridObject*, bool)
+{
+	invalidate();
+}
+
+void QualityMetricIndex::volume_to_be_erased(Grid*, Volume*, Volume*)
+{
+	invalidate();
+}
+
+void QualityMetricIndex::elements_to_be_cleared(Grid*)
+{
+	invalidate();
+}
+
+void QualityMetricIndex::grid_to_be_destroyed(Grid*)
+{
+	invalidate();
+	m_pGrid = NULL;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	build
+template <class TElem, class TAAPosVRT>
+void QualityMetricIndex::build(SortedMeasure& sm, QualityCacheMeasure m, TAAPosVRT& aaPos)
+{
+	Grid& grid = *m_pGrid;
+	GridObjectCollection goc = grid.get_grid_objects();
+	UG_COND_THROW(m_lvl >= (int)goc.num_levels(),
+				  "QualityMetricIndex: level " << m_lvl << " does not exist.");
+
+//	elements evaluated by the statistics, grouped by type
+	ElementsByType<TElem> elems;
+	elems.collect(grid, goc, m_lvl);
+
+	vector<number> vals;
+	vals.reserve(elems.size());
+	switch(m)
+	{
+		case QCM_FACE_AREA:
+		case QCM_VOLUME:
+			CollectElementMeasures(elems, aaPos, vals,
+				[&](TElem* elem){return CalculateVolume(elem, aaPos);},
+				[](const TetKernelResults& res, size_t i){return res.volume[i];});
+			break;
+		case QCM_FACE_MIN_ANGLE:
+		case QCM_VOLUME_MIN_DIHEDRAL:
+			CollectElementMeasures(elems, aaPos, vals,
+				[&](TElem* elem){return CalculateMinAngle(grid, elem, aaPos);},
+				[](const TetKernelResults& res, size_t i){return res.minDihedral[i];});
+			break;
+		case QCM_FACE_MAX_ANGLE:
+		case QCM_VOLUME_MAX_DIHEDRAL:
+			CollectElementMeasures(elems, aaPos, vals,
+				[&](TElem* elem){return CalculateMaxAngle(grid, elem, aaPos);},
+				[](const TetKernelResults& res, size_t i){return res.maxDihedral[i];});
+			break;
+		case QCM_FACE_ASPECT_RATIO:
+		case QCM_VOLUME_ASPECT_RATIO:
+			CollectElementMeasures(elems, aaPos, vals,
+				[&](TElem* elem){return ElementAspectRatio(grid, elem, aaPos);},
+				[](const TetKernelResults& res, size_t i){return res.aspectRatio[i];});
+			break;
+		case QCM_TET_VOL_TO_RMS_FACE_AREA_RATIO:
+		//	only defined for tetrahedra, the NaNs of all other types are not indexed
+			CollectElementMeasures(elems, aaPos, vals,
+				[](TElem*){return numeric_limits<number>::quiet_NaN();},
+				[](const TetKernelResults& res, size_t i){return res.volToRMSFaceAreaRatio[i];});
+			break;
+		default:
+			UG_THROW("QualityMetricIndex: unknown measure " << m);
+	}
+
+//	NaNs are not indexed, since they can't be sorted
+	sm.entries.clear();
+	sm.entries.reserve(vals.size());
+	for(size_t i = 0; i < vals.size(); ++i)
+	{
+		if(std::isnan(vals[i]))
+			continue;
+		Entry e;
+		e.value = vals[i];
+		e.elem = elems[i];
+		sm.entries.push_back(e);
+	}
+
+	sort(sm.entries.begin(), sm.entries.end());
+	sm.bBuilt = true;
+}
+
+
+const std::vector<QualityMetricIndex::Entry>&
+QualityMetricIndex::entries(QualityCacheMeasure m)
+{
+	UG_COND_THROW(!m_pGrid, "QualityMetricIndex: the grid has been destroyed.");
+
+	SortedMeasure& sm = m_measures[m];
+	if(sm.bBuilt)
+		return sm.entries;
+
+	const bool bVolume = (m >= QCM_VOLUME);
+	UG_COND_THROW(bVolume && m_dim < 3, "QualityMetricIndex: volume measures require dim 3.");
+
+	if(m_dim == 2)
+	{
+		Grid::VertexAttachmentAccessor<APosition2> aaPos(*m_pGrid, aPosition2);
+		build<Face>(sm, m, aaPos);
+	}
+	else
+	{
+		Grid::VertexAttachmentAccessor<APosition> aaPos(*m_pGrid, aPosition);
+		if(bVolume)
+			build<Volume>(sm, m, aaPos);
+		else
+			build<Face>(sm, m, aaPos);
+	}
+	return sm.entries;
+}
+
+
+void QualityMetricIndex::
+find_range(const std::vector<Entry>& entries, number lo, number hi,
+		   size_t& firstOut, size_t& lastOut) const
+{
+	Entry loEntry, hiEntry;
+	loEntry.value = lo;
+	hiEntry.value = hi;
+	firstOut = lower_bound(entries.begin(), entries.end(), loEntry) - entries.begin();
+	lastOut = lower_bound(entries.begin(), entries.end(), hiEntry) - entries.begin();
+	if(lastOut < firstOut)
+		lastOut = firstOut;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	queries
+bool QualityMetricIndex::is_built(const char* measure) const
+{
+	return m_measures[measure_by_name(measure)].bBuilt;
+}
+
+size_t QualityMetricIndex::local_count(const char* measure, number lo, number hi)
+{
+	size_t first, last;
+	find_range(entries(measure_by_name(measure)), lo, hi, first, last);
+	return last - first;
+}
+
+size_t QualityMetricIndex::count(const char* measure, number lo, number hi)
+{
+	size_t num = local_count(measure, lo, hi);
+
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			pcl::ProcessCommunicator pc;
+			num = (size_t)pc.allreduce((number)num, PCL_RO_SUM);
+		}
+	#endif
+
+	return num;
+}
+
+size_t QualityMetricIndex::count_below(const char* measure, number threshold)
+{
+	return count(measure, -numeric_limits<number>::infinity(), threshold);
+}
+
+size_t QualityMetricIndex::count_above(const char* measure, number threshold)
+{
+//	hi = inf would exclude elements with value inf
+	size_t first, last;
+	const vector<Entry>& e = entries(measure_by_name(measure));
+	find_range(e, threshold, numeric_limits<number>::infinity(), first, last);
+	size_t num = e.size() - first;
+
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			pcl::ProcessCommunicator pc;
+			num = (size_t)pc.allreduce((number)num, PCL_RO_SUM);
+		}
+	#endif
+
+	return num;
+}
+
+size_t QualityMetricIndex::select(Selector& sel, const char* measure, number lo, number hi)
+{
+	const vector<Entry>& e = entries(measure_by_name(measure));
+	size_t first, last;
+	find_range(e, lo, hi, first, last);
+	for(size_t i = first; i < last; ++i)
+		sel.select(e[i].elem);
+	return last - first;
+}
+
+size_t QualityMetricIndex::assign_subset(ISubsetHandler& sh, int si, const char* measure,
+										 number lo, number hi)
+{
+	const vector<Entry>& e = entries(measure_by_name(measure));
+	size_t first, last;
+	find_range(e, lo, hi, first, last);
+	if(last > first)
+		sh.subset_required(si);
+	for(size_t i = first; i < last; ++i)
+		sh.assign_subset(e[i].elem, si);
+	return last - first;
+}
+
+size_t QualityMetricIndex::num_local(const char* measure)
+{
+	return entries(measure_by_name(measure)).size();
+}
+
+number QualityMetricIndex::sorted_value(const char* measure, size_t i)
+{
+	const vector<Entry>& e = entries(measure_by_name(measure));
+	UG_COND_THROW(i >= e.size(), "QualityMetricIndex: index " << i << " out of range.");
+	return e[i].value;
+}
+
+}
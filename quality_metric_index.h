@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __QUALITY_METRIC_INDEX_H__
+#define __QUALITY_METRIC_INDEX_H__
+
+/* system includes */
+#include <stddef.h>
+#include <vector>
+
+#include "lib_grid/lib_grid.h"
+#include "element_quality_cache.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityMetricIndex
+///	Sorted element qualities of one grid level for threshold queries
+/**	For every measure (see QualityCacheMeasure, e.g. "volume_min_dihedral") the index
+ *	holds the pairs (value, element) of all evaluated elements of the level, sorted by
+ *	value. The pairs of a measure are computed and sorted on its first query, all
+ *	further queries only search the sorted array:
+ *	- counting the elements in a value range costs O(log n),
+ *	- selecting them or assigning them to a subset costs O(log n + k) for k elements.
+ *
+ *	Value ranges are half open, [lo, hi). Elements whose measure isn't a number are not
+ *	indexed. "tet_vol_to_rms_face_area_ratio" only indexes tetrahedra.
+ *
+ *	The index observes the grid and drops all measures as soon as faces or volumes are
+ *	created or erased. Moving vertices can't be observed, invalidate() has to be called
+ *	afterwards (for moving vertices see ElementQualityCache).
+ *
+ *	In parallel ghosts and horizontal slaves are not indexed. count is collective and
+ *	returns the number of elements of all processes, all other queries are local.*/
+class QualityMetricIndex : public GridObserver
+{
+	public:
+	///	indexes the elements of a grid (level 0)
+		QualityMetricIndex(Grid& grid, int dim);
+
+	///	indexes the elements on level lvl of a multigrid
+		QualityMetricIndex(MultiGrid& mg, int dim, int lvl);
+
+		virtual ~QualityMetricIndex();
+
+	///	drops the sorted values of all measures, they are rebuilt on the next query
+		void invalidate();
+
+	///	returns whether the sorted values of a measure are currently available
+		bool is_built(const char* measure) const;
+
+	///	number of elements of this process with lo <= value < hi
+		size_t local_count(const char* measure, number lo, number hi);
+
+	///	number of elements of all processes with lo <= value < hi (collective)
+		size_t count(const char* measure, number lo, number hi);
+
+	///	number of elements of all processes with value < threshold (collective)
+		size_t count_below(const char* measure, number threshold);
+
+	///	number of elements of all processes with value >= threshold (collective)
+		size_t count_above(const char* measure, number threshold);
+
+	///	selects the elements of this process with lo <= value < hi. Returns their number.
+		size_t select(Selector& sel, const char* measure, number lo, number hi);
+
+	///	assigns the elements of this process with lo <= value < hi to subset si. Returns their number.
+		size_t assign_subset(ISubsetHandler& sh, int si, const char* measure, number lo, number hi);
+
+	///	number of indexed elements of this process
+		size_t num_local(const char* measure);
+
+	///	value of the i-th element of this process in ascending order
+		number sorted_value(const char* measure, size_t i);
+
+	//	GridObserver callbacks
+		virtual void face_created(Grid* grid, Face* f, GridObject* pParent, bool replacesParent);
+		virtual void face_to_be_erased(Grid* grid, Face* f, Face* replacedBy);
+		virtual void volume_created(Grid* grid, Volume* vol, GridObject* pParent, bool replacesParent);
+		virtual void volume_to_be_erased(Grid* grid, Volume* vol, Volume* replacedBy);
+		virtual void elements_to_be_cleared(Grid* grid);
+		virtual void grid_to_be_destroyed(Grid* grid);
+
+	private:
+	//	the index is registered as observer of the grid, copies are not supported
+		QualityMetricIndex(const QualityMetricIndex&);
+		QualityMetricIndex& operator=(const QualityMetricIndex&);
+
+	protected:
+		struct Entry
+		{
+			number value;
+			GridObject* elem;
+
+			bool operator<(const Entry& e) const	{return value < e.value;}
+		};
+
+		struct SortedMeasure
+		{
+			SortedMeasure() : bBuilt(false)	{}
+
+			bool bBuilt;
+			std::vector<Entry> entries;
+		};
+
+		void init(int dim);
+		QualityCacheMeasure measure_by_name(const char* name) const;
+
+	///	returns the sorted entries of a measure and builds them if necessary
+		const std::vector<Entry>& entries(QualityCacheMeasure m);
+
+	///	returns the range [first, last) of entries with lo <= value < hi
+		void find_range(const std::vector<Entry>& entries, number lo, number hi,
+						size_t& firstOut, size_t& lastOut) const;
+
+		template <class TElem, class TAAPosVRT>
+		void build(SortedMeasure& sm, QualityCacheMeasure m, TAAPosVRT& aaPos);
+
+	protected:
+		Grid* m_pGrid;
+		int m_dim;
+		int m_lvl;
+
+		SortedMeasure m_measures[NUM_QUALITY_CACHE_MEASURES];
+};
+
+}
+#endif  //__QUALITY_METRIC_INDEX_H__
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <sstream>
+
+#include "quality_metrics.h"
+#include "common/error.h"
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+struct QualityMetricName
+{
+	const char* name;
+	unsigned int metric;
+};
+
+static const QualityMetricName g_qualityMetricNames[] = {
+	{"volume", QM_VOLUME},
+	{"min_dihedral", QM_MIN_DIHEDRAL},
+	{"max_dihedral", QM_MAX_DIHEDRAL},
+	{"dihedral_deviation", QM_DIHEDRAL_DEVIATION},
+	{"aspect_ratio", QM_ASPECT_RATIO},
+	{"vol_to_rms_face_area_ratio", QM_VOL_TO_RMS_FACE_AREA_RATIO},
+	{"lower_dim", QM_LOWER_DIM}
+};
+
+static const size_t g_numQualityMetricNames = sizeof(g_qualityMetricNames)
+											  / sizeof(g_qualityMetricNames[0]);
+
+
+unsigned int ParseQualityMetrics(const string& metrics)
+{
+	unsigned int res = 0;
+
+	stringstream ss(metrics);
+	string name;
+	while(getline(ss, name, ','))
+	{
+	//	trim white spaces
+		size_t first = name.find_first_not_of(" \t");
+		if(first == string::npos)
+			continue;
+		name = name.substr(first, name.find_last_not_of(" \t") - first + 1);
+
+		if(name == "all")
+		{
+			res |= QM_ALL;
+			continue;
+		}
+
+		size_t i = 0;
+		for(; i < g_numQualityMetricNames; ++i)
+		{
+			if(name == g_qualityMetricNames[i].name)
+			{
+				res |= g_qualityMetricNames[i].metric;
+				break;
+			}
+		}
+
+		UG_COND_THROW(i == g_numQualityMetricNames,
+					  "ParseQualityMetrics: unknown metric '" << name << "'. Valid are 'volume', "
+					  "'min_dihedral', 'max_dihedral', 'dihedral_deviation', 'aspect_ratio', "
+					  "'vol_to_rms_face_area_ratio', 'lower_dim' and 'all'.");
+	}
+
+	UG_COND_THROW(res == 0, "ParseQualityMetrics: no metric given.");
+	return res;
+}
+
+string QualityMetricsToString(unsigned int metrics)
+{
+	if((metrics & QM_ALL) == QM_ALL)
+		return "all";
+
+	string res;
+	for(size_t i = 0; i < g_numQualityMetricNames; ++i)
+	{
+		if(metrics & g_qualityMetricNames[i].metric)
+		{
+			if(!res.empty())
+				res += ", ";
+			res += g_qualityMetricNames[i].name;
+		}
+	}
+	return res;
+}
+
+}
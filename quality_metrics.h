@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __QUALITY_METRICS_H__
+#define __QUALITY_METRICS_H__
+
+/* system includes */
+#include <stddef.h>
+#include <string>
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityMetric
+///	bits of the metric selection of the quality statistics
+/**	The first six bits are the volume metrics. The tetrahedron kernels and the
+ *	accumulation of their results are specialized at compile time for every
+ *	combination of them (see QualityMetricsTable), so that unrequested metrics are not
+ *	evaluated at all. QM_LOWER_DIM switches the evaluation of vertices, edges and
+ *	faces of a 3d grid on or off.
+ *
+ *	Minimal and maximal dihedral include their histograms, quantiles and worst
+ *	elements, the aspect ratio includes its histogram, quantiles and worst elements.*/
+enum QualityMetric
+{
+	QM_VOLUME						= 1 << 0,	///< element volumes
+	QM_MIN_DIHEDRAL					= 1 << 1,	///< smallest dihedral per element
+	QM_MAX_DIHEDRAL					= 1 << 2,	///< largest dihedral per element
+	QM_DIHEDRAL_DEVIATION			= 1 << 3,	///< deviation of all dihedrals from the regular one
+	QM_ASPECT_RATIO					= 1 << 4,
+	QM_VOL_TO_RMS_FACE_AREA_RATIO	= 1 << 5,	///< tetrahedra, prisms and pyramids
+	QM_LOWER_DIM					= 1 << 6,	///< vertices, edge lengths and face measures
+
+	QM_VOLUME_METRICS				= (1 << 6) - 1,
+	QM_ALL							= (1 << 7) - 1
+};
+
+///	number of combinations of the volume metrics
+const size_t NUM_VOLUME_METRIC_COMBINATIONS = QM_VOLUME_METRICS + 1;
+
+///	parses a comma separated list of metric names, e.g. "min_dihedral, aspect_ratio"
+/**	Valid names are "volume", "min_dihedral", "max_dihedral", "dihedral_deviation",
+ *	"aspect_ratio", "vol_to_rms_face_area_ratio", "lower_dim" and "all".*/
+unsigned int ParseQualityMetrics(const std::string& metrics);
+
+///	returns the comma separated names of the metrics in 'metrics'
+std::string QualityMetricsToString(unsigned int metrics);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityMetricsTable
+///	table of the specializations TSpec<M>::apply for all combinations M of the volume metrics
+/**	TSpec<M> has to provide a static function 'apply' of type TFunc. The table is
+ *	indexed by the volume metric bits of a selection, bits above are ignored.*/
+template <class TFunc, template <unsigned int> class TSpec>
+class QualityMetricsTable
+{
+	public:
+		QualityMetricsTable()	{Fill<QM_VOLUME_METRICS, 0>::fill(m_funcs);}
+
+		TFunc operator[](unsigned int metrics) const	{return m_funcs[metrics & QM_VOLUME_METRICS];}
+
+	private:
+		template <unsigned int M, int dummy>
+		struct Fill
+		{
+			static void fill(TFunc* funcs)
+			{
+				funcs[M] = &TSpec<M>::apply;
+				Fill<M - 1, dummy>::fill(funcs);
+			}
+		};
+
+		template <int dummy>
+		struct Fill<0, dummy>
+		{
+			static void fill(TFunc* funcs)	{funcs[0] = &TSpec<0>::apply;}
+		};
+
+		TFunc m_funcs[NUM_VOLUME_METRIC_COMBINATIONS];
+};
+
+}
+#endif  //__QUALITY_METRICS_H__
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <sstream>
+
+#include "quality_profile.h"
+#include "common/log.h"
+#include "common/util/table.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+static bool g_qualityProfiling = false;
+
+void SetQualityStatisticsProfiling(bool bProfile)
+{
+	g_qualityProfiling = bProfile;
+}
+
+bool GetQualityStatisticsProfiling()
+{
+	return g_qualityProfiling;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityProfile
+void QualityProfile::
+add(const char* phase, double seconds, size_t numElems)
+{
+	for(size_t i = 0; i < m_phases.size(); ++i)
+	{
+		Phase& p = m_phases[i];
+		if(p.lvl == m_curLvl && p.name == phase)
+		{
+			p.seconds += seconds;
+			p.numElems += numElems;
+			p.minSeconds = p.avgSeconds = p.maxSeconds = p.seconds;
+			p.totalElems = p.numElems;
+			return;
+		}
+	}
+
+	Phase p;
+	p.name = phase;
+	p.lvl = m_curLvl;
+	p.seconds = p.minSeconds = p.avgSeconds = p.maxSeconds = seconds;
+	p.numElems = p.totalElems = numElems;
+	m_phases.push_back(p);
+}
+
+
+void QualityProfile::
+reduce()
+{
+	for(size_t i = 0; i < m_phases.size(); ++i)
+	{
+		Phase& p = m_phases[i];
+		p.minSeconds = p.avgSeconds = p.maxSeconds = p.seconds;
+		p.totalElems = p.numElems;
+	}
+
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			vector<double> secs, negSecs, sums, mins;
+			for(size_t i = 0; i < m_phases.size(); ++i)
+			{
+				secs.push_back(m_phases[i].seconds);
+				negSecs.push_back(-m_phases[i].seconds);
+				sums.push_back(m_phases[i].seconds);
+				sums.push_back((double)m_phases[i].numElems);
+			}
+		//	max and min in one reduction
+			secs.insert(secs.end(), negSecs.begin(), negSecs.end());
+
+			vector<double> gSums, gMins;
+			pcl::ProcessCommunicator pc;
+			pc.allreduce(sums, gSums, PCL_RO_SUM);
+			pc.allreduce(secs, gMins, PCL_RO_MIN);
+
+			const size_t num = m_phases.size();
+			for(size_t i = 0; i < num; ++i)
+			{
+				Phase& p = m_phases[i];
+				p.minSeconds = gMins[i];
+				p.maxSeconds = -gMins[num + i];
+				p.avgSeconds = gSums[2*i] / pcl::NumProcs();
+				p.totalElems = (size_t)(gSums[2*i + 1] + 0.5);
+			}
+		}
+	#endif
+}
+
+
+double QualityProfile::
+throughput(size_t i) const
+{
+	const Phase& p = m_phases[i];
+	if(p.totalElems == 0 || p.maxSeconds <= 0)
+		return 0;
+	return p.totalElems / p.maxSeconds;
+}
+
+
+void QualityProfile::
+print() const
+{
+	UG_LOG(endl << "APPENDIX: PHASE TIMINGS (wall clock, min/avg/max over processes)" << endl);
+
+	ug::Table<std::stringstream> table(m_phases.size() + 1, 7);
+	table(0, 0) << "Phase";		table(0, 1) << "Level";		table(0, 2) << "Elements";
+	table(0, 3) << "min [s]";	table(0, 4) << "avg [s]";	table(0, 5) << "max [s]";
+	table(0, 6) << "Elements/s";
+
+	for(size_t i = 0; i < m_phases.size(); ++i)
+	{
+		const Phase& p = m_phases[i];
+		table(i+1, 0) << p.name;
+		if(p.lvl >= 0)	table(i+1, 1) << p.lvl;
+		else			table(i+1, 1) << "-";
+		table(i+1, 2) << p.totalElems;
+		table(i+1, 3) << p.minSeconds;
+		table(i+1, 4) << p.avgSeconds;
+		table(i+1, 5) << p.maxSeconds;
+		if(p.totalElems > 0)	table(i+1, 6) << throughput(i);
+		else					table(i+1, 6) << "-";
+	}
+
+	UG_LOG(table);
+}
+
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __QUALITY_PROFILE_H__
+#define __QUALITY_PROFILE_H__
+
+/* system includes */
+#include <stddef.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "common/types.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Profiling of the quality evaluations
+///	enables or disables the phase timings of the quality statistics
+/**	Disabled by default. If disabled, no clocks are read at all.*/
+void SetQualityStatisticsProfiling(bool bProfile);
+
+///	returns whether the phase timings of the quality statistics are recorded
+bool GetQualityStatisticsProfiling();
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityProfile
+///	Wall clock times and element counts of the phases of a quality evaluation
+/**	Every phase (e.g. "edges", "volumes" or "reduce") is recorded per grid level.
+ *	Phases which don't belong to a level (e.g. "print") have level -1. Repeated
+ *	phases of the same level are summed up.
+ *
+ *	The times are measured on each process. reduce computes the minimum, average and
+ *	maximum time over all processes as well as the total number of elements. Before
+ *	reduce is called, these values are those of the local process. The phases count
+ *	the elements they actually evaluated, i.e. without ghosts and horizontal slaves,
+ *	so that every element is counted once in the total.*/
+class QualityProfile
+{
+	public:
+		QualityProfile() : m_curLvl(-1)	{}
+
+		void clear()						{m_phases.clear(); m_curLvl = -1;}
+
+	///	level of the subsequently added phases (-1: not level specific)
+		void set_level(int lvl)				{m_curLvl = lvl;}
+
+	///	adds the time and the number of evaluated elements of a phase of the current level
+		void add(const char* phase, double seconds, size_t numElems);
+
+	///	reduces the times and element counts over all processes
+	/**	Has to be called on all processes with the same phases.*/
+		void reduce();
+
+		size_t num_phases() const						{return m_phases.size();}
+		std::string phase_name(size_t i) const			{return m_phases[i].name;}
+		int phase_level(size_t i) const					{return m_phases[i].lvl;}
+
+	///	time of this process
+		double seconds(size_t i) const					{return m_phases[i].seconds;}
+		double min_seconds(size_t i) const				{return m_phases[i].minSeconds;}
+		double avg_seconds(size_t i) const				{return m_phases[i].avgSeconds;}
+		double max_seconds(size_t i) const				{return m_phases[i].maxSeconds;}
+
+	///	number of elements of all processes
+		size_t num_elements(size_t i) const				{return m_phases[i].totalElems;}
+
+	///	elements per second, limited by the slowest process (0 if no elements)
+		double throughput(size_t i) const;
+
+	///	logs the phases as a table
+		void print() const;
+
+	private:
+		struct Phase
+		{
+			std::string name;
+			int lvl;
+			double seconds;
+			size_t numElems;
+
+			double minSeconds;
+			double avgSeconds;
+			double maxSeconds;
+			size_t totalElems;
+		};
+
+		std::vector<Phase> m_phases;
+		int m_curLvl;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityPhaseTimer
+///	measures the wall clock time of a phase from construction to destruction
+/**	Does nothing if the profile is NULL, i.e. if profiling is disabled. The number of
+ *	elements can be set after the evaluation, e.g. from the counters of the data.*/
+class QualityPhaseTimer
+{
+	public:
+		QualityPhaseTimer(QualityProfile* profile, const char* phase, size_t numElems = 0) :
+			m_profile(profile), m_phase(phase), m_numElems(numElems)
+		{
+			if(m_profile)
+				m_start = std::chrono::steady_clock::now();
+		}
+
+		~QualityPhaseTimer()
+		{
+			if(m_profile)
+			{
+				std::chrono::duration<double> dt = std::chrono::steady_clock::now() - m_start;
+				m_profile->add(m_phase, dt.count(), m_numElems);
+			}
+		}
+
+		void set_num_elements(size_t numElems)	{m_numElems = numElems;}
+
+	private:
+		QualityProfile* m_profile;
+		const char* m_phase;
+		size_t m_numElems;
+		std::chrono::steady_clock::time_point m_start;
+};
+
+}
+#endif  //__QUALITY_PROFILE_H__
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+
+#include "quality_quantiles.h"
+#include "common/error.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+static number g_qualityQuantileCompression = 1000.0;
+
+void SetQualityQuantileCompression(number compression)
+{
+	UG_COND_THROW(compression < 10, "SetQualityQuantileCompression: compression has to be at least 10.");
+	g_qualityQuantileCompression = compression;
+}
+
+number GetQualityQuantileCompression()
+{
+	return g_qualityQuantileCompression;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityQuantileSketch
+QualityQuantileSketch::QualityQuantileSketch(number compression) :
+	m_compression(compression)
+{
+	UG_COND_THROW(compression < 10, "QualityQuantileSketch: compression has to be at least 10.");
+	clear();
+}
+
+void QualityQuantileSketch::clear()
+{
+	m_centroids.clear();
+	m_buffer.clear();
+	m_count = 0;
+	m_min = numeric_limits<number>::max();
+	m_max = -numeric_limits<number>::max();
+}
+
+void QualityQuantileSketch::merge(const QualityQuantileSketch& sketch)
+{
+	if(sketch.empty())
+		return;
+
+	m_count += sketch.m_count;
+	if(sketch.m_min < m_min) m_min = sketch.m_min;
+	if(sketch.m_max > m_max) m_max = sketch.m_max;
+
+	m_buffer.insert(m_buffer.end(), sketch.m_centroids.begin(), sketch.m_centroids.end());
+	m_buffer.insert(m_buffer.end(), sketch.m_buffer.begin(), sketch.m_buffer.end());
+	if(m_buffer.size() >= buffer_capacity())
+		compress();
+}
+
+number QualityQuantileSketch::scale(number q) const
+{
+	const number pi = 3.14159265358979323846;
+	return m_compression / (2.0 * pi) * asin(2.0 * q - 1.0);
+}
+
+void QualityQuantileSketch::compress()
+{
+	if(m_buffer.empty())
+		return;
+
+//	the merged centroids are already sorted. Stable sorting keeps the order of equal
+//	means, so that the result is reproducible.
+	size_t numMerged = m_centroids.size();
+	m_centroids.insert(m_centroids.end(), m_buffer.begin(), m_buffer.end());
+	m_buffer.clear();
+	stable_sort(m_centroids.begin() + numMerged, m_centroids.end());
+	inplace_merge(m_centroids.begin(), m_centroids.begin() + numMerged, m_centroids.end());
+
+	number totalWeight = 0.0;
+	for(size_t i = 0; i < m_centroids.size(); ++i)
+		totalWeight += m_centroids[i].weight;
+
+//	greedily merge neighbouring centroids, as long as the merged centroid spans at
+//	most one unit of the scale function
+	size_t cur = 0;
+	number weightBefore = 0.0;
+	number kLeft = scale(0.0);
+	for(size_t i = 1; i < m_centroids.size(); ++i)
+	{
+		Centroid& c = m_centroids[cur];
+		const Centroid& next = m_centroids[i];
+		number qRight = std::min<number>(1.0, (weightBefore + c.weight + next.weight) / totalWeight);
+
+		if(scale(qRight) - kLeft <= 1.0)
+		{
+			c.weight += next.weight;
+			c.mean += (next.mean - c.mean) * next.weight / c.weight;
+		}
+		else
+		{
+			weightBefore += c.weight;
+			kLeft = scale(std::min<number>(1.0, weightBefore / totalWeight));
+			m_centroids[++cur] = next;
+		}
+	}
+	m_centroids.resize(cur + 1);
+}
+
+number QualityQuantileSketch::quantile(number q) const
+{
+	if(empty())
+		return 0.0;
+
+	if(!m_buffer.empty())
+	{
+		QualityQuantileSketch tmp(*this);
+		tmp.compress();
+		return tmp.quantile(q);
+	}
+
+	if(q <= 0.0) return m_min;
+	if(q >= 1.0) return m_max;
+
+	const vector<Centroid>& c = m_centroids;
+	number index = q * (number)m_count;
+
+//	the values of a centroid are assumed to be spread evenly around its mean. Between
+//	the means of neighbouring centroids and towards the extremal values the quantiles
+//	are interpolated linearly.
+	number halfFirst = 0.5 * c.front().weight;
+	if(index < halfFirst)
+		return m_min + (c.front().mean - m_min) * index / halfFirst;
+
+	number cum = halfFirst;
+	for(size_t i = 0; i + 1 < c.size(); ++i)
+	{
+		number dw = 0.5 * (c[i].weight + c[i+1].weight);
+		if(cum + dw > index)
+			return c[i].mean + (c[i+1].mean - c[i].mean) * (index - cum) / dw;
+		cum += dw;
+	}
+
+	number halfLast = 0.5 * c.back().weight;
+	number t = std::min<number>(1.0, (index - cum) / halfLast);
+	return c.back().mean + (m_max - c.back().mean) * t;
+}
+
+void QualityQuantileSketch::pack(vector<number>& bufOut) const
+{
+	bufOut.push_back((number)m_count);
+	bufOut.push_back(m_min);
+	bufOut.push_back(m_max);
+	bufOut.push_back((number)num_centroids());
+	for(size_t i = 0; i < m_centroids.size(); ++i)
+	{
+		bufOut.push_back(m_centroids[i].mean);
+		bufOut.push_back(m_centroids[i].weight);
+	}
+	for(size_t i = 0; i < m_buffer.size(); ++i)
+	{
+		bufOut.push_back(m_buffer[i].mean);
+		bufOut.push_back(m_buffer[i].weight);
+	}
+}
+
+void QualityQuantileSketch::merge_packed(const vector<number>& buf, size_t& offset)
+{
+	UG_COND_THROW(offset + 4 > buf.size(), "QualityQuantileSketch: invalid packed sketch.");
+
+	size_t count = (size_t)buf[offset];
+	number minVal = buf[offset + 1];
+	number maxVal = buf[offset + 2];
+	size_t numCentroids = (size_t)buf[offset + 3];
+	offset += 4;
+
+	UG_COND_THROW(offset + 2 * numCentroids > buf.size(), "QualityQuantileSketch: invalid packed sketch.");
+
+	if(count > 0)
+	{
+		m_count += count;
+		if(minVal < m_min) m_min = minVal;
+		if(maxVal > m_max) m_max = maxVal;
+		for(size_t i = 0; i < numCentroids; ++i)
+			m_buffer.push_back(Centroid(buf[offset + 2*i], buf[offset + 2*i + 1]));
+	}
+	offset += 2 * numCentroids;
+
+	if(m_buffer.size() >= buffer_capacity())
+		compress();
+}
+
+
+void QualityQuantileSketch::pack_fixed(number* buf, size_t capacity) const
+{
+	UG_COND_THROW(!m_buffer.empty() || m_centroids.size() > capacity,
+				  "QualityQuantileSketch: sketch doesn't fit into a slot of capacity " << capacity << ".");
+
+	buf[0] = m_compression;
+	buf[1] = (number)m_count;
+	buf[2] = m_min;
+	buf[3] = m_max;
+	buf[4] = (number)m_centroids.size();
+	for(size_t i = 0; i < m_centroids.size(); ++i)
+	{
+		buf[5 + 2*i] = m_centroids[i].mean;
+		buf[5 + 2*i + 1] = m_centroids[i].weight;
+	}
+	for(size_t i = 2 * m_centroids.size(); i < 2 * capacity; ++i)
+		buf[5 + i] = 0.0;
+}
+
+void QualityQuantileSketch::merge_packed_fixed(const number* buf)
+{
+	size_t count = (size_t)buf[1];
+	if(count == 0)
+		return;
+
+	m_count += count;
+	if(buf[2] < m_min) m_min = buf[2];
+	if(buf[3] > m_max) m_max = buf[3];
+
+	size_t numCentroids = (size_t)buf[4];
+	for(size_t i = 0; i < numCentroids; ++i)
+		m_buffer.push_back(Centroid(buf[5 + 2*i], buf[5 + 2*i + 1]));
+
+	if(m_buffer.size() >= buffer_capacity())
+		compress();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AllreduceQuantileSketches
+#ifdef UG_PARALLEL
+///	MPI user operation: inoutvec[i] = invec[i] (+) inoutvec[i] for sketches written by pack_fixed
+/**	The capacity of the slots is derived from the size of the datatype. The merged
+ *	sketch is compressed, so that it fits into a slot again.*/
+static void MergePackedSketches(void* invec, void* inoutvec, int* len, MPI_Datatype* dtype)
+{
+	int slotBytes;
+	MPI_Type_size(*dtype, &slotBytes);
+	const size_t slotSize = (size_t)slotBytes / sizeof(number);
+	const size_t capacity = (slotSize - 5) / 2;
+
+	const number* in = static_cast<const number*>(invec);
+	number* inout = static_cast<number*>(inoutvec);
+
+	for(int i = 0; i < *len; ++i)
+	{
+		const number* a = in + i * slotSize;
+		number* b = inout + i * slotSize;
+
+		QualityQuantileSketch merged(a[0]);
+		merged.merge_packed_fixed(a);
+		merged.merge_packed_fixed(b);
+		merged.compress();
+		merged.pack_fixed(b, capacity);
+	}
+}
+#endif
+
+
+void AllreduceQuantileSketches(QualityQuantileSketch** sketches, size_t numSketches)
+{
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1 && numSketches > 0){
+			pcl::ProcessCommunicator pc;
+
+		//	all slots have the capacity of the sketch with the largest compression
+			size_t locCapacity = 0;
+			for(size_t k = 0; k < numSketches; ++k)
+				locCapacity = std::max(locCapacity, sketches[k]->max_num_compressed_centroids());
+			const size_t capacity = (size_t)pc.allreduce((number)locCapacity, PCL_RO_MAX);
+			const size_t slotSize = QualityQuantileSketch::fixed_packed_size(capacity);
+
+			vector<number> loc(numSketches * slotSize), glob(numSketches * slotSize);
+			for(size_t k = 0; k < numSketches; ++k)
+			{
+				sketches[k]->compress();
+				sketches[k]->pack_fixed(&loc[k * slotSize], capacity);
+			}
+
+		//	one element of the reduction is one sketch. The operation is declared
+		//	non-commutative, so that the sketches are merged in rank order.
+			MPI_Datatype sketchType;
+			MPI_Type_contiguous((int)slotSize,
+								(sizeof(number) == sizeof(double)) ? MPI_DOUBLE : MPI_FLOAT,
+								&sketchType);
+			MPI_Type_commit(&sketchType);
+
+			MPI_Op mergeOp;
+			MPI_Op_create(&MergePackedSketches, 0, &mergeOp);
+
+			pc.allreduce(&loc.front(), &glob.front(), (int)numSketches, sketchType, mergeOp);
+
+			MPI_Op_free(&mergeOp);
+			MPI_Type_free(&sketchType);
+
+			for(size_t k = 0; k < numSketches; ++k)
+			{
+				sketches[k]->clear();
+				sketches[k]->merge_packed_fixed(&glob[k * slotSize]);
+				sketches[k]->compress();
+			}
+		}
+	#endif
+}
+
+
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __QUALITY_QUANTILES_H__
+#define __QUALITY_QUANTILES_H__
+
+/* system includes */
+#include <stddef.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "common/types.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Accuracy of the quantile sketches
+///	sets the compression of the quantile sketches used by the quality statistics
+/**	Larger values give more accurate quantiles at the cost of memory and merge time.
+ *	A sketch holds at most about 'compression' centroids. Default is 1000.*/
+void SetQualityQuantileCompression(number compression);
+
+///	returns the compression of the quantile sketches used by the quality statistics
+number GetQualityQuantileCompression();
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityQuantileSketch
+///	Mergeable streaming quantile sketch (merging t-digest) for element quality measures
+/**	The values are summarized by weighted centroids whose size is limited by the
+ *	arcsine scale function k(q) = compression/(2 pi) * asin(2q - 1). A centroid at
+ *	quantile q thus holds at most a fraction 2 pi sqrt(q(1-q))/compression of all values,
+ *	i.e. the centroids get small towards the tails, where the quality percentiles of
+ *	interest (p0.1, p1, p5) are located. The smallest and largest values are kept exactly.
+ *
+ *	Added values are buffered and merged into the centroids in batches. Sketches of
+ *	different threads or processes are merged in O(sketch size). Merging is
+ *	deterministic, i.e. the result only depends on the order of the merged sketches.*/
+class QualityQuantileSketch
+{
+	public:
+	///	weighted mean of a group of values
+		struct Centroid
+		{
+			Centroid() : mean(0.0), weight(0.0)	{}
+			Centroid(number m, number w) : mean(m), weight(w)	{}
+
+			bool operator<(const Centroid& c) const	{return mean < c.mean;}
+
+			number mean;
+			number weight;
+		};
+
+	public:
+		QualityQuantileSketch(number compression = 1000.0);
+
+	///	clears all values, the compression is kept
+		void clear();
+
+	///	adds a value
+		inline void add(number val)
+		{
+			++m_count;
+			if(val < m_min) m_min = val;
+			if(val > m_max) m_max = val;
+
+			m_buffer.push_back(Centroid(val, 1.0));
+			if(m_buffer.size() >= buffer_capacity())
+				compress();
+		}
+
+	///	adds the values of another sketch
+		void merge(const QualityQuantileSketch& sketch);
+
+	///	merges the buffered values into the centroids
+		void compress();
+
+	///	returns an estimate of the q-quantile (0 <= q <= 1). Returns 0 for empty sketches.
+		number quantile(number q) const;
+
+		size_t count() const				{return m_count;}
+		bool empty() const					{return m_count == 0;}
+		number compression() const			{return m_compression;}
+
+	///	smallest and largest value added. 0 for empty sketches.
+		number min() const					{return empty() ? 0.0 : m_min;}
+		number max() const					{return empty() ? 0.0 : m_max;}
+
+	///	number of centroids (buffered values included)
+		size_t num_centroids() const		{return m_centroids.size() + m_buffer.size();}
+
+	///	appends count, extremal values and all (also buffered) centroids to a buffer
+		void pack(std::vector<number>& bufOut) const;
+
+	///	merges a sketch written by pack into this one. The offset is advanced.
+		void merge_packed(const std::vector<number>& buf, size_t& offset);
+
+	///	upper bound for the number of centroids after compress()
+	/**	Two neighbouring centroids always span more than one unit of the scale
+	 *	function, whose range is compression/2.*/
+		size_t max_num_compressed_centroids() const	{return (size_t)ceil(m_compression) + 4;}
+
+	///	number of entries written by pack_fixed for sketches of the given capacity
+		static size_t fixed_packed_size(size_t capacity)	{return 5 + 2 * capacity;}
+
+	///	writes the compression, count, extremal values and centroids to a slot of fixed size
+	/**	The sketch has to be compressed and must not hold more than 'capacity'
+	 *	centroids. Unused entries are set to 0.*/
+		void pack_fixed(number* buf, size_t capacity) const;
+
+	///	merges a sketch written by pack_fixed into this one
+		void merge_packed_fixed(const number* buf);
+
+	protected:
+		size_t buffer_capacity() const		{return 5 * (size_t)m_compression + 16;}
+
+	///	value of the scale function at quantile q
+		number scale(number q) const;
+
+	protected:
+		number m_compression;
+
+	///	merged centroids, sorted by their means
+		std::vector<Centroid> m_centroids;
+
+	///	values and centroids which still have to be merged
+		std::vector<Centroid> m_buffer;
+
+		size_t m_count;
+		number m_min;
+		number m_max;
+};
+
+
+///	merges the sketches of all processes (collective)
+/**	The sketches are written to slots of a fixed capacity and reduced by a user
+ *	defined MPI operation, which merges and compresses two sketches at every step of
+ *	the reduction. Each message thus has the size of one sketch, independent of the
+ *	number of processes. The operation is non-commutative, i.e. the sketches are
+ *	merged in rank order.*/
+void AllreduceQuantileSketches(QualityQuantileSketch** sketches, size_t numSketches);
+
+
+}
+#endif  //__QUALITY_QUANTILES_H__
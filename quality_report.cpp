@@ -0,0 +1,646 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "quality_report.h"
+#include "element_quality_statistics.h"
+#include "common/util/table.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityReport
+///	returns whether 'unit' is an integer multiple of stepSize
+static bool StepSizeDivides(number stepSize, number unit)
+{
+	number n = unit / stepSize;
+	return n >= 1.0 - 1e-8 && fabs(n - round(n)) < 1e-8 * n;
+}
+
+QualityReport::QualityReport(int dim, number angleHistStepSize, number aspectRatioHistStepSize,
+							 unsigned int metrics) :
+	m_dim(dim),
+	m_angleHistStepSize(angleHistStepSize),
+	m_aspectRatioHistStepSize(aspectRatioHistStepSize),
+	m_metrics(metrics & QM_ALL)
+{
+	UG_COND_THROW(dim != 2 && dim != 3, "QualityReport: Only dimensions 2 or 3 supported.");
+	UG_COND_THROW(angleHistStepSize <= 0 || aspectRatioHistStepSize <= 0,
+				  "QualityReport: the histogram step sizes have to be positive.");
+//	the printed tables start at a multiple of 10 degrees resp. 0.1, which has to be a
+//	bin bound of the histograms (starting at 0), so that the counts are those of the
+//	ranges printed before
+	UG_COND_THROW(!StepSizeDivides(angleHistStepSize, 10.0),
+				  "QualityReport: the angle histogram step size " << angleHistStepSize
+				  << " has to divide 10 degrees.");
+	UG_COND_THROW(!StepSizeDivides(aspectRatioHistStepSize, 0.1),
+				  "QualityReport: the aspect ratio histogram step size " << aspectRatioHistStepSize
+				  << " has to divide 0.1.");
+	UG_COND_THROW(dim == 2 && m_metrics != QM_ALL,
+				  "QualityReport: a selection of metrics is only supported in 3d.");
+	UG_COND_THROW(m_metrics == 0, "QualityReport: no metric selected.");
+}
+
+bool QualityReport::has_level(int lvl) const
+{
+	return find(m_lvls.begin(), m_lvls.end(), lvl) != m_lvls.end();
+}
+
+ElementQualityData& QualityReport::add_level(int lvl)
+{
+	UG_COND_THROW(has_level(lvl), "QualityReport: level " << lvl << " has already been added.");
+	m_lvls.push_back(lvl);
+	m_data.push_back(ElementQualityData());
+	m_data.back().init_histograms(m_angleHistStepSize, m_aspectRatioHistStepSize);
+	m_data.back().metrics = m_metrics;
+	return m_data.back();
+}
+
+const ElementQualityData& QualityReport::data(int lvl) const
+{
+	for(size_t i = 0; i < m_lvls.size(); ++i)
+		if(m_lvls[i] == lvl)
+			return m_data[i];
+	UG_THROW("QualityReport: level " << lvl << " has not been evaluated.");
+}
+
+size_t QualityReport::num_elements(int lvl, const char* type) const
+{
+	const ElementQualityData& d = data(lvl);
+	if(strcmp(type, "vertex") == 0)				return d.numVertices;
+	if(strcmp(type, "edge") == 0)				return d.numEdges;
+	if(strcmp(type, "face") == 0)				return d.numFaces;
+	if(strcmp(type, "volume") == 0)				return d.numVolumes;
+	if(strcmp(type, "triangle") == 0)			return d.triAspectRatio.num;
+	if(strcmp(type, "quadrilateral") == 0)		return d.quadAspectRatio.num;
+	if(strcmp(type, "tetrahedron") == 0)		return d.tetAspectRatio.num;
+	if(strcmp(type, "hexahedron") == 0)			return d.hexAspectRatio.num;
+	if(strcmp(type, "octahedron") == 0)			return d.octDihedrals.numElems;
+	if(strcmp(type, "prism") == 0)				return d.prismAspectRatio.num;
+	if(strcmp(type, "pyramid") == 0)			return d.pyramidAspectRatio.num;
+	UG_THROW("QualityReport: unknown element type '" << type << "'.");
+}
+
+const QualityMinMax& QualityReport::min_max(int lvl, const char* measure) const
+{
+	const ElementQualityData& d = data(lvl);
+	if(strcmp(measure, "edge_length") == 0)				return d.edgeLength;
+	if(strcmp(measure, "face_area") == 0)				return d.faceArea;
+	if(strcmp(measure, "face_angle") == 0)				return d.faceAngle;
+	if(strcmp(measure, "triangle_aspect_ratio") == 0)	return d.triAspectRatio;
+	if(strcmp(measure, "quadrilateral_aspect_ratio") == 0)	return d.quadAspectRatio;
+	if(strcmp(measure, "volume") == 0)					return d.volume;
+	if(strcmp(measure, "volume_dihedral") == 0)			return d.volDihedral;
+	if(strcmp(measure, "tetrahedron_aspect_ratio") == 0)	return d.tetAspectRatio;
+	if(strcmp(measure, "tetrahedron_vol_to_rms_face_area_ratio") == 0)	return d.tetVolToRMSFaceAreaRatio;
+	if(strcmp(measure, "hexahedron_aspect_ratio") == 0)	return d.hexAspectRatio;
+	if(strcmp(measure, "prism_aspect_ratio") == 0)		return d.prismAspectRatio;
+	if(strcmp(measure, "prism_vol_to_rms_face_area_ratio") == 0)	return d.prismVolToRMSFaceAreaRatio;
+	if(strcmp(measure, "pyramid_aspect_ratio") == 0)	return d.pyramidAspectRatio;
+	if(strcmp(measure, "pyramid_vol_to_rms_face_area_ratio") == 0)	return d.pyramidVolToRMSFaceAreaRatio;
+	UG_THROW("QualityReport: unknown measure '" << measure << "'.");
+}
+
+number QualityReport::min(int lvl, const char* measure) const
+{
+	const QualityMinMax& mm = min_max(lvl, measure);
+	return mm.empty() ? 0.0 : mm.min;
+}
+
+number QualityReport::max(int lvl, const char* measure) const
+{
+	const QualityMinMax& mm = min_max(lvl, measure);
+	return mm.empty() ? 0.0 : mm.max;
+}
+
+const AngleDeviation& QualityReport::angle_deviation_data(int lvl, const char* type) const
+{
+	const ElementQualityData& d = data(lvl);
+	if(strcmp(type, "triangle") == 0)			return d.triAngles;
+	if(strcmp(type, "quadrilateral") == 0)		return d.quadAngles;
+	if(strcmp(type, "tetrahedron") == 0)		return d.tetDihedrals;
+	if(strcmp(type, "hexahedron") == 0)			return d.hexDihedrals;
+	if(strcmp(type, "octahedron") == 0)			return d.octDihedrals;
+	if(strcmp(type, "prism_triangle_edges") == 0)		return d.prismTriQuadDihedrals;
+	if(strcmp(type, "prism_quadrilateral_edges") == 0)	return d.prismQuadQuadDihedrals;
+	if(strcmp(type, "pyramid_base_edges") == 0)		return d.pyramidBaseDihedrals;
+	if(strcmp(type, "pyramid_apex_edges") == 0)		return d.pyramidApexDihedrals;
+	UG_THROW("QualityReport: unknown element type '" << type << "'.");
+}
+
+number QualityReport::angle_mean(int lvl, const char* type) const
+{
+	const AngleDeviation& ad = angle_deviation_data(lvl, type);
+	return (ad.numElems > 0) ? ad.mean() : 0.0;
+}
+
+number QualityReport::angle_deviation(int lvl, const char* type) const
+{
+	const AngleDeviation& ad = angle_deviation_data(lvl, type);
+	return (ad.numElems > 0) ? ad.standard_deviation() : 0.0;
+}
+
+number QualityReport::quantile(int lvl, const char* measure, number q) const
+{
+	const ElementQualityData& d = data(lvl);
+	if(strcmp(measure, "face_min_angle") == 0)			return d.faceMinAngleQuantiles.quantile(q);
+	if(strcmp(measure, "face_aspect_ratio") == 0)		return d.faceAspectRatioQuantiles.quantile(q);
+	if(strcmp(measure, "volume_min_dihedral") == 0)		return d.volMinDihedralQuantiles.quantile(q);
+	if(strcmp(measure, "volume_aspect_ratio") == 0)		return d.volAspectRatioQuantiles.quantile(q);
+	UG_THROW("QualityReport: no quantiles of '" << measure << "' available.");
+}
+
+const QualityHistogram& QualityReport::histogram(int lvl, const char* name) const
+{
+	const ElementQualityData& d = data(lvl);
+	if(strcmp(name, "face_min_angle") == 0)				return d.faceMinAngleHist;
+	if(strcmp(name, "face_max_angle") == 0)				return d.faceMaxAngleHist;
+	if(strcmp(name, "face_aspect_ratio") == 0)			return d.faceAspectRatioHist;
+	if(strcmp(name, "volume_min_angle") == 0)			return d.volMinAngleHist;
+	if(strcmp(name, "volume_max_angle") == 0)			return d.volMaxAngleHist;
+	if(strcmp(name, "volume_aspect_ratio") == 0)		return d.volAspectRatioHist;
+	if(strcmp(name, "volume_vol_to_rms_face_area_ratio") == 0)	return d.volToRMSFaceAreaRatioHist;
+	if(strcmp(name, "prism_min_angle") == 0)			return d.prismMinAngleHist;
+	if(strcmp(name, "prism_aspect_ratio") == 0)			return d.prismAspectRatioHist;
+	if(strcmp(name, "pyramid_min_angle") == 0)			return d.pyramidMinAngleHist;
+	if(strcmp(name, "pyramid_aspect_ratio") == 0)		return d.pyramidAspectRatioHist;
+	UG_THROW("QualityReport: no histogram '" << name << "' available.");
+}
+
+size_t QualityReport::histogram_num_bins(int lvl, const char* name) const
+{
+	return histogram(lvl, name).num_bins();
+}
+
+number QualityReport::histogram_bin_lower(int lvl, const char* name, size_t bin) const
+{
+	const QualityHistogram& hist = histogram(lvl, name);
+	UG_COND_THROW(bin >= hist.num_bins(), "QualityReport: invalid bin " << bin << ".");
+	return hist.bin_lower(bin);
+}
+
+number QualityReport::histogram_bin_upper(int lvl, const char* name, size_t bin) const
+{
+	const QualityHistogram& hist = histogram(lvl, name);
+	UG_COND_THROW(bin >= hist.num_bins(), "QualityReport: invalid bin " << bin << ".");
+	return hist.bin_upper(bin);
+}
+
+size_t QualityReport::histogram_count(int lvl, const char* name, size_t bin) const
+{
+	const QualityHistogram& hist = histogram(lvl, name);
+	UG_COND_THROW(bin >= hist.num_bins(), "QualityReport: invalid bin " << bin << ".");
+	return hist.count(bin);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AddQuantileRows
+///	writes the p0.1, p1, p5 and median of a sketch into two rows of a summary table
+static void AddQuantileRows(ug::Table<std::stringstream>& table, size_t row,
+							const char* name, const QualityQuantileSketch& sketch)
+{
+	table(row, 0) << name << " p0.1";		table(row, 1) << sketch.quantile(0.001);
+	table(row, 2) << name << " p1";			table(row, 3) << sketch.quantile(0.01);
+	table(row+1, 0) << name << " p5";		table(row+1, 1) << sketch.quantile(0.05);
+	table(row+1, 2) << name << " median";	table(row+1, 3) << sketch.quantile(0.5);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Formatted output
+void QualityReport::print() const
+{
+//	Basic grid properties
+	UG_LOG(endl << "%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%" << endl);
+	UG_LOG("GRID QUALITY STATISTICS" << endl << endl);
+	UG_LOG("*** Output info:" << endl);
+	UG_LOG("    - The 'aspect ratio' (AR) represents the ratio of minimal height and " << endl <<
+		   "      maximal edge length of a triangle or tetrahedron respectively." << endl <<
+		   "      For prisms and pyramids it is the ratio of volume and cubed maximal" << endl <<
+		   "      edge length, normalized to 1 for the regular element as for tetrahedra." << endl);
+	UG_LOG("    - The Min- and MaxAngle-Histogram lists the number of min/max element angles in " << endl <<
+		   "      different degree ranges (dihedrals for volumes!)." << endl);
+	if(m_metrics != QM_ALL)
+		UG_LOG("    - Only the following metrics have been evaluated: "
+			   << QualityMetricsToString(m_metrics) << endl);
+	UG_LOG(endl);
+
+	for(size_t i = 0; i < m_lvls.size(); ++i)
+	{
+		if(m_dim == 2)
+			print_level_2d(i);
+		else
+			print_level_3d(i);
+	}
+
+	UG_LOG(endl << "%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%%" << endl << endl);
+}
+
+void QualityReport::print_level_2d(size_t i) const
+{
+	const ElementQualityData& data = m_data[i];
+
+	number n_minEdge = data.edgeLength.empty() ? 0.0 : data.edgeLength.min;
+	number n_maxEdge = data.edgeLength.empty() ? 0.0 : data.edgeLength.max;
+	number n_minFace = data.faceArea.empty() ? 0.0 : data.faceArea.min;
+	number n_maxFace = data.faceArea.empty() ? 0.0 : data.faceArea.max;
+	number n_minFaceAngle = data.faceAngle.empty() ? 0.0 : data.faceAngle.min;
+	number n_maxFaceAngle = data.faceAngle.empty() ? 0.0 : data.faceAngle.max;
+
+//	Table summary
+	ug::Table<std::stringstream> table(8, 4);
+	table(0, 0) << "Number of volumes"; 	table(0, 1) << data.numVolumes;
+	table(1, 0) << "Number of faces"; 		table(1, 1) << data.numFaces;
+	table(2, 0) << "Number of vertices";	table(2, 1) << data.numVertices;
+
+	table(3, 0) << " "; table(3, 1) << " ";
+	table(3, 2) << " "; table(3, 3) << " ";
+
+	table(4, 0) << "Shortest edge";	table(4, 1) << n_minEdge;
+	table(4, 2) << "Longest edge";	table(4, 3) << n_maxEdge;
+
+	table(5, 0) << "Smallest face angle";	table(5, 1) << n_minFaceAngle;
+	table(5, 2) << "Largest face angle";	table(5, 3) << n_maxFaceAngle;
+
+	table(6, 0) << "Smallest face";	table(6, 1) << n_minFace;
+	table(6, 2) << "Largest face";	table(6, 3) << n_maxFace;
+
+	if(!data.triAspectRatio.empty())
+	{
+		table(7, 0) << "Smallest triangle AR";	table(7, 1) << data.triAspectRatio.min;
+		table(7, 2) << "Largest triangle AR";	table(7, 3) << data.triAspectRatio.max;
+	}
+
+	if(!data.quadAspectRatio.empty())
+	{
+		table(8, 0) << "Smallest quad AR";	table(8, 1) << data.quadAspectRatio.min;
+		table(8, 2) << "Largest quad AR";	table(8, 3) << data.quadAspectRatio.max;
+	}
+
+	if(!data.faceMinAngleQuantiles.empty())
+	{
+		table(9, 0) << " "; table(9, 1) << " ";
+		table(9, 2) << " "; table(9, 3) << " ";
+		AddQuantileRows(table, 10, "face min angle", data.faceMinAngleQuantiles);
+		AddQuantileRows(table, 12, "face AR", data.faceAspectRatioQuantiles);
+	}
+
+//	Output section
+	UG_LOG("+++++++++++++++++" << endl);
+	UG_LOG(" Grid level " << m_lvls[i] << ":" << endl);
+	UG_LOG("+++++++++++++++++" << endl << endl);
+	UG_LOG(table);
+
+//	The histograms have already been filled during the traversal
+	if(data.numFaces > 0)
+	{
+		ug::Table<std::stringstream> histTable;
+
+		UG_LOG(endl << "(*) MinAngle-Histogram for '" << "2d' elements");
+		UG_LOG(endl);
+		PrintAngleHistogram(data.faceMinAngleHist, histTable);
+
+		UG_LOG(endl << "(*) MaxAngle-Histogram for '" << "2d' elements");
+		UG_LOG(endl);
+		histTable.clear();
+		PrintAngleHistogram(data.faceMaxAngleHist, histTable);
+
+		UG_LOG(endl << "(*) AspectRatio-Histogram for '" << "2d' elements");
+		UG_LOG(endl);
+		histTable.clear();
+		PrintAspectRatioHistogram(data.faceAspectRatioHist, histTable);
+	}
+
+	UG_LOG(endl);
+	PrintAngleStatistics2d(data);
+	PrintWorstElements(data);
+}
+
+void QualityReport::print_level_3d(size_t i) const
+{
+	const ElementQualityData& data = m_data[i];
+
+	if(data.nonTetrahedralElemsPresent)
+		UG_LOGN("ElementQualityStatistics3d could not calculate VolToRMSFaceAreaRatios "
+			"for elements other than tetrahedra, prisms and pyramids (set to 0.0)");
+
+//	Table summary
+	ug::Table<std::stringstream> table(11, 4);
+	table(0, 0) << "Number of volumes"; 	table(0, 1) << data.numVolumes;
+
+	const bool bLowerDim = (data.metrics & QM_LOWER_DIM) != 0;
+	if(bLowerDim)
+	{
+		table(1, 0) << "Number of faces"; 		table(1, 1) << data.numFaces;
+		table(2, 0) << "Number of vertices";	table(2, 1) << data.numVertices;
+
+		table(3, 0) << " "; table(3, 1) << " ";
+		table(3, 2) << " "; table(3, 3) << " ";
+
+		table(4, 0) << "Shortest edge";	table(4, 1) << data.edgeLength.min;
+		table(4, 2) << "Longest edge";	table(4, 3) << data.edgeLength.max;
+
+		table(5, 0) << "Smallest face angle";	table(5, 1) << data.faceAngle.min;
+		table(5, 2) << "Largest face angle";	table(5, 3) << data.faceAngle.max;
+	}
+
+	if(!data.triAspectRatio.empty())
+	{
+		table(6, 0) << "Smallest triangle AR"; table(6, 1) << data.triAspectRatio.min;
+		table(6, 2) << "Largest triangle AR"; table(6, 3) << data.triAspectRatio.max;
+	}
+
+	if(!data.quadAspectRatio.empty())
+	{
+		table(7, 0) << "Smallest quadrilateral AR"; table(7, 1) << data.quadAspectRatio.min;
+		table(7, 2) << "Largest quadrilateral AR"; table(7, 3) << data.quadAspectRatio.max;
+	}
+
+	if(bLowerDim)
+	{
+		table(8, 0) << "Smallest face";	table(8, 1) << data.faceArea.min;
+		table(8, 2) << "Largest face";	table(8, 3) << data.faceArea.max;
+	}
+
+	if(data.numVolumes > 0)
+	{
+		if(!data.volume.empty())
+		{
+			table(9, 0) << "Smallest volume";		table(9, 1) << data.volume.min;
+			table(9, 2) << "Largest volume";		table(9, 3) << data.volume.max;
+		}
+	//	volDihedral holds the smallest and/or the largest dihedral of each element
+		if(data.metrics & QM_MIN_DIHEDRAL)
+		{
+			table(10, 0) << "Smallest volume dihedral";	table(10, 1) << data.volDihedral.min;
+		}
+		if(data.metrics & QM_MAX_DIHEDRAL)
+		{
+			table(10, 2) << "Largest volume dihedral";	table(10, 3) << data.volDihedral.max;
+		}
+
+		if(!data.tetAspectRatio.empty())
+		{
+			table(11, 0) << "Smallest tet AR";	table(11, 1) << data.tetAspectRatio.min;
+			table(11, 2) << "Largest tet AR";	table(11, 3) << data.tetAspectRatio.max;
+		}
+		if(!data.tetVolToRMSFaceAreaRatio.empty())
+		{
+			table(12, 0) << "Smallest tet Vol/FaceAreaRatio";	table(12, 1) << data.tetVolToRMSFaceAreaRatio.min;
+			table(12, 2) << "Largest tet Vol/FaceAreaRatio";	table(12, 3) << data.tetVolToRMSFaceAreaRatio.max;
+		}
+
+		if(!data.hexAspectRatio.empty())
+		{
+			table(13, 0) << "Smallest hex AR";	table(13, 1) << data.hexAspectRatio.min;
+			table(13, 2) << "Largest hex AR";	table(13, 3) << data.hexAspectRatio.max;
+		}
+
+	//	prism and pyramid rows are only added if such elements exist
+		size_t row = 14;
+		if(!data.prismAspectRatio.empty())
+		{
+			table(row, 0) << "Smallest prism AR";	table(row, 1) << data.prismAspectRatio.min;
+			table(row, 2) << "Largest prism AR";	table(row, 3) << data.prismAspectRatio.max;
+			++row;
+		}
+		if(!data.prismVolToRMSFaceAreaRatio.empty())
+		{
+			table(row, 0) << "Smallest prism Vol/FaceAreaRatio";	table(row, 1) << data.prismVolToRMSFaceAreaRatio.min;
+			table(row, 2) << "Largest prism Vol/FaceAreaRatio";	table(row, 3) << data.prismVolToRMSFaceAreaRatio.max;
+			++row;
+		}
+		if(!data.pyramidAspectRatio.empty())
+		{
+			table(row, 0) << "Smallest pyramid AR";	table(row, 1) << data.pyramidAspectRatio.min;
+			table(row, 2) << "Largest pyramid AR";	table(row, 3) << data.pyramidAspectRatio.max;
+			++row;
+		}
+		if(!data.pyramidVolToRMSFaceAreaRatio.empty())
+		{
+			table(row, 0) << "Smallest pyramid Vol/FaceAreaRatio";	table(row, 1) << data.pyramidVolToRMSFaceAreaRatio.min;
+			table(row, 2) << "Largest pyramid Vol/FaceAreaRatio";	table(row, 3) << data.pyramidVolToRMSFaceAreaRatio.max;
+			++row;
+		}
+
+	//	the quantile blocks follow a blank row, each of them only if it was evaluated
+		if(!data.volMinDihedralQuantiles.empty() || !data.volAspectRatioQuantiles.empty())
+		{
+			table(row, 0) << " "; table(row, 1) << " ";
+			table(row, 2) << " "; table(row, 3) << " ";
+			++row;
+		}
+		if(!data.volMinDihedralQuantiles.empty())
+		{
+			AddQuantileRows(table, row, "volume min dihedral", data.volMinDihedralQuantiles);
+			row += 2;
+		}
+		if(!data.volAspectRatioQuantiles.empty())
+		{
+			AddQuantileRows(table, row, "volume AR", data.volAspectRatioQuantiles);
+			row += 2;
+		}
+	}
+
+//	Output section
+	UG_LOG("+++++++++++++++++" << endl);
+	UG_LOG(" Grid level " << m_lvls[i] << ":" << endl);
+	UG_LOG("+++++++++++++++++" << endl << endl);
+	UG_LOG(table);
+
+//	The histograms have already been filled during the traversal
+	if(data.numVolumes > 0)
+	{
+		ug::Table<std::stringstream> histTable;
+
+		if(data.metrics & QM_MIN_DIHEDRAL)
+		{
+			UG_LOG(endl << "(*) MinAngle-Histogram for '" << "3d' elements");
+			UG_LOG(endl);
+			PrintAngleHistogram(data.volMinAngleHist, histTable);
+		}
+
+		if(data.metrics & QM_MAX_DIHEDRAL)
+		{
+			UG_LOG(endl << "(*) MaxAngle-Histogram for '" << "3d' elements");
+			UG_LOG(endl);
+			histTable.clear();
+			PrintAngleHistogram(data.volMaxAngleHist, histTable);
+		}
+
+		if(data.metrics & QM_ASPECT_RATIO)
+		{
+			UG_LOG(endl << "(*) AspectRatio-Histogram for '" << "3d' elements");
+			UG_LOG(endl);
+			histTable.clear();
+			PrintAspectRatioHistogram(data.volAspectRatioHist, histTable);
+		}
+
+		if(data.metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+		{
+			UG_LOG(endl << "(*) VolToRMSFaceAreaRatioHistogram-Histogram for '" << "3d' elements");
+			UG_LOG(endl);
+			histTable.clear();
+			PrintAspectRatioHistogram(data.volToRMSFaceAreaRatioHist, histTable);
+		}
+
+	//	dedicated histograms of prisms and pyramids (empty for other meshes)
+		const QualityHistogram* typeHists[] = {&data.prismMinAngleHist, &data.prismAspectRatioHist,
+											   &data.pyramidMinAngleHist, &data.pyramidAspectRatioHist};
+		const char* typeHistNames[] = {"MinAngle-Histogram for prisms", "AspectRatio-Histogram for prisms",
+									   "MinAngle-Histogram for pyramids", "AspectRatio-Histogram for pyramids"};
+		for(size_t k = 0; k < sizeof(typeHists) / sizeof(typeHists[0]); ++k)
+		{
+			if(typeHists[k]->num_values() == 0)
+				continue;
+			UG_LOG(endl << "(*) " << typeHistNames[k]);
+			UG_LOG(endl);
+			histTable.clear();
+			if(k % 2 == 0)
+				PrintAngleHistogram(*typeHists[k], histTable);
+			else
+				PrintAspectRatioHistogram(*typeHists[k], histTable);
+		}
+	}
+
+	UG_LOG(endl);
+	PrintAngleStatistics3d(data);
+	PrintWorstElements(data);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Histogram table file output
+void QualityReport::write_histograms() const
+{
+	int procRank = 0;
+	#ifdef UG_PARALLEL
+		procRank = pcl::ProcRank();
+	#endif
+	if(procRank != 0)
+		return;
+
+	const char* names[] = {"volMinAngles", "volMaxAngles", "volAspectRatios", "volToRMSFaceAreaRatios",
+						   "prismMinAngles", "prismAspectRatios", "pyramidMinAngles", "pyramidAspectRatios"};
+	const unsigned int histMetrics[] = {QM_MIN_DIHEDRAL, QM_MAX_DIHEDRAL, QM_ASPECT_RATIO,
+										QM_VOL_TO_RMS_FACE_AREA_RATIO,
+										QM_MIN_DIHEDRAL, QM_ASPECT_RATIO, QM_MIN_DIHEDRAL, QM_ASPECT_RATIO};
+	const bool bOnlyIfFilled[] = {false, false, false, false, true, true, true, true};
+
+	for(size_t i = 0; i < m_lvls.size(); ++i)
+	{
+		const ElementQualityData& data = m_data[i];
+
+	//	2d: the face histograms are written for all levels with faces
+		if(m_dim == 2)
+		{
+			if(data.numFaces > 0)
+			{
+				write_histogram_csv(data.faceMinAngleHist, "faceMinAngles", m_lvls[i]);
+				write_histogram_csv(data.faceMaxAngleHist, "faceMaxAngles", m_lvls[i]);
+				write_histogram_csv(data.faceAspectRatioHist, "faceAspectRatios", m_lvls[i]);
+			}
+			continue;
+		}
+
+		if(data.numVolumes == 0)
+			continue;
+
+		const QualityHistogram* hists[] = {&data.volMinAngleHist, &data.volMaxAngleHist,
+										   &data.volAspectRatioHist, &data.volToRMSFaceAreaRatioHist,
+										   &data.prismMinAngleHist, &data.prismAspectRatioHist,
+										   &data.pyramidMinAngleHist, &data.pyramidAspectRatioHist};
+
+		for(size_t k = 0; k < sizeof(hists) / sizeof(hists[0]); ++k)
+		{
+			if(!(data.metrics & histMetrics[k]))
+				continue;
+			if(bOnlyIfFilled[k] && hists[k]->num_values() == 0)
+				continue;
+
+			write_histogram_csv(*hists[k], names[k], m_lvls[i]);
+		}
+	}
+}
+
+void QualityReport::write_histogram_csv(const QualityHistogram& hist, const char* name,
+										int lvl) const
+{
+	ug::Table<std::stringstream> histTable;
+	hist.write_percentages(histTable);
+
+	std::stringstream ss;
+	ss << name << "_lvl_" << lvl << ".csv";
+	ofstream ofstr(ss.str().c_str());
+	ofstr << histTable.to_csv(";");
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrintQualityReport
+void PrintQualityReport(QualityReport& report, bool bWriteHistograms)
+{
+	QualityProfile* profile = GetQualityStatisticsProfiling() ? &report.profile() : NULL;
+
+	{
+		QualityPhaseTimer timer(profile, "print");
+		report.print();
+	}
+
+	if(bWriteHistograms)
+	{
+		QualityPhaseTimer timer(profile, "write_histograms");
+		report.write_histograms();
+	}
+
+	if(profile){
+		profile->reduce();
+		profile->print();
+	}
+}
+
+}
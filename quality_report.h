@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __QUALITY_REPORT_H__
+#define __QUALITY_REPORT_H__
+
+/* system includes */
+#include <stddef.h>
+#include <vector>
+
+#include "element_quality_kernels.h"
+#include "quality_profile.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityReport
+///	Element quality measures of the levels of a grid, reduced over all processes
+/**	The report is the result of ComputeQualityReport. It holds the ElementQualityData
+ *	of every evaluated level, i.e. the numbers of elements, the extremal values, the
+ *	angle deviations from the regular case, the histograms and the quantile sketches.
+ *	Its getters can be used by scripts without any formatting, print writes the
+ *	well-known output of ElementQualityStatistics.
+ *
+ *	All getters take the grid level and a name:
+ *	- num_elements: "vertex", "edge", "face", "volume", "triangle", "quadrilateral",
+ *	  "tetrahedron", "hexahedron", "octahedron", "prism", "pyramid"
+ *	- min, max: "edge_length", "face_area", "face_angle", "triangle_aspect_ratio",
+ *	  "quadrilateral_aspect_ratio", "volume", "volume_dihedral",
+ *	  "tetrahedron_aspect_ratio", "tetrahedron_vol_to_rms_face_area_ratio",
+ *	  "hexahedron_aspect_ratio", "prism_aspect_ratio",
+ *	  "prism_vol_to_rms_face_area_ratio", "pyramid_aspect_ratio",
+ *	  "pyramid_vol_to_rms_face_area_ratio"
+ *	- angle_mean, angle_deviation: "triangle", "quadrilateral", "tetrahedron",
+ *	  "hexahedron", "octahedron" (face angles resp. dihedrals), "prism_triangle_edges",
+ *	  "prism_quadrilateral_edges", "pyramid_base_edges", "pyramid_apex_edges"
+ *	  (dihedrals at the respective edges of prisms and pyramids)
+ *	- quantile: "face_min_angle", "face_aspect_ratio", "volume_min_dihedral",
+ *	  "volume_aspect_ratio"
+ *	- histogram_*: "face_min_angle", "face_max_angle", "face_aspect_ratio",
+ *	  "volume_min_angle", "volume_max_angle", "volume_aspect_ratio",
+ *	  "volume_vol_to_rms_face_area_ratio", "prism_min_angle", "prism_aspect_ratio",
+ *	  "pyramid_min_angle", "pyramid_aspect_ratio"
+ *
+ *	A report of a 3d grid may be restricted to a selection of metrics (see
+ *	QualityMetric). The measures of all other metrics are then empty. Note that the
+ *	numbers of tetrahedra, hexahedra, prisms and pyramids are taken from their aspect
+ *	ratios and the number of octahedra from their dihedral deviations.
+ *
+ *	The histograms start at 0, while the printed tables start at the smallest value
+ *	rounded to 10 degrees resp. 0.1 (minus one range). To print the same ranges as
+ *	ElementQualityStatistics always did, the angle step size has to divide 10 degrees
+ *	and the aspect ratio step size has to divide 0.1 (e.g. 5, 2 or 1 degrees and
+ *	0.05, 0.02 or 0.01). Other step sizes are rejected.*/
+class QualityReport
+{
+	public:
+		QualityReport(int dim, number angleHistStepSize = 10.0,
+					  number aspectRatioHistStepSize = 0.1, unsigned int metrics = QM_ALL);
+
+		int dim() const										{return m_dim;}
+	///	the evaluated metrics (see QualityMetric)
+		unsigned int metrics() const						{return m_metrics;}
+		number angle_hist_step_size() const					{return m_angleHistStepSize;}
+		number aspect_ratio_hist_step_size() const			{return m_aspectRatioHistStepSize;}
+
+	///	number of evaluated levels
+		size_t num_levels() const							{return m_lvls.size();}
+	///	grid level of the i-th evaluated level
+		int level(size_t i) const							{return m_lvls[i];}
+		bool has_level(int lvl) const;
+
+	///	appends a level with empty data and initialized histograms
+		ElementQualityData& add_level(int lvl);
+
+	///	data of a grid level. Throws if the level has not been evaluated.
+		const ElementQualityData& data(int lvl) const;
+
+		size_t num_elements(int lvl, const char* type) const;
+		number min(int lvl, const char* measure) const;
+		number max(int lvl, const char* measure) const;
+
+	///	mean and standard deviation of the face angles or dihedrals from the regular case
+		number angle_mean(int lvl, const char* type) const;
+		number angle_deviation(int lvl, const char* type) const;
+
+	///	estimate of the q-quantile (0 <= q <= 1) of an element wise measure
+		number quantile(int lvl, const char* measure, number q) const;
+
+		size_t histogram_num_bins(int lvl, const char* name) const;
+		number histogram_bin_lower(int lvl, const char* name, size_t bin) const;
+		number histogram_bin_upper(int lvl, const char* name, size_t bin) const;
+		size_t histogram_count(int lvl, const char* name, size_t bin) const;
+
+	///	logs the summary tables, histograms, angle deviations and worst elements
+		void print() const;
+
+	///	writes the histograms of every level as csv files (process 0 only)
+	/**	The face histograms (faceMinAngles, faceMaxAngles, faceAspectRatios) are
+	 *	written for 2d reports, the volume histograms for 3d reports.*/
+		void write_histograms() const;
+
+	///	phase timings of the evaluation (only recorded if profiling is enabled)
+	/**	See SetQualityStatisticsProfiling.*/
+		QualityProfile& profile()							{return m_profile;}
+		const QualityProfile& profile() const				{return m_profile;}
+
+	protected:
+		const QualityMinMax& min_max(int lvl, const char* measure) const;
+		const AngleDeviation& angle_deviation_data(int lvl, const char* type) const;
+		const QualityHistogram& histogram(int lvl, const char* name) const;
+
+		void print_level_2d(size_t i) const;
+		void print_level_3d(size_t i) const;
+
+	///	writes one histogram to the file <name>_lvl_<lvl>.csv
+		void write_histogram_csv(const QualityHistogram& hist, const char* name, int lvl) const;
+
+	protected:
+		int m_dim;
+		number m_angleHistStepSize;
+		number m_aspectRatioHistStepSize;
+		unsigned int m_metrics;
+
+		std::vector<int> m_lvls;
+		std::vector<ElementQualityData> m_data;
+		QualityProfile m_profile;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrintQualityReport
+///	logs a report, writes its histograms and appends the phase timings if profiling is enabled
+/**	The print and the histogram output are recorded as phases of the report's
+ *	profile. Has to be called on all processes.*/
+void PrintQualityReport(QualityReport& report, bool bWriteHistograms);
+
+
+}
+#endif  //__QUALITY_REPORT_H__
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include "quality_snapshot.h"
+
+
+namespace ug
+{
+
+
+static bool g_qualityUseSnapshot = false;
+
+void SetQualityStatisticsUseSnapshot(bool bUseSnapshot)
+{
+	g_qualityUseSnapshot = bUseSnapshot;
+}
+
+bool GetQualityStatisticsUseSnapshot()
+{
+	return g_qualityUseSnapshot;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityGeometrySnapshot
+QualityGeometrySnapshot::
+QualityGeometrySnapshot() :
+	m_numEvalVrts(0),
+	m_dim(0)
+{
+}
+
+void QualityGeometrySnapshot::
+clear()
+{
+	m_x.clear();
+	m_y.clear();
+	m_z.clear();
+
+	for(int i = 0; i < NUM_REFERENCE_OBJECTS; ++i)
+	{
+		m_blocks[i].numCorners = 0;
+		m_blocks[i].vrtInds.clear();
+		m_blocks[i].elems.clear();
+	}
+
+	m_numEvalVrts = 0;
+	m_dim = 0;
+}
+
+void QualityGeometrySnapshot::
+push_coordinates(const vector2& p)
+{
+	m_x.push_back(p.x());
+	m_y.push_back(p.y());
+	m_z.push_back(0.0);
+	m_dim = 2;
+}
+
+void QualityGeometrySnapshot::
+push_coordinates(const vector3& p)
+{
+	m_x.push_back(p.x());
+	m_y.push_back(p.y());
+	m_z.push_back(p.z());
+	m_dim = 3;
+}
+
+
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __QUALITY_SNAPSHOT_H__
+#define __QUALITY_SNAPSHOT_H__
+
+/* system includes */
+#include <stddef.h>
+#include <vector>
+
+#include "lib_grid/lib_grid.h"
+#include "quality_element_types.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Use of the geometry snapshot
+///	enables or disables the evaluation of the quality statistics on a QualityGeometrySnapshot
+/**	Disabled by default, i.e. the kernels access the grid directly. Only edges,
+ *	triangles, tetrahedra, prisms and pyramids have kernels working on the packed
+ *	coordinates of the snapshot. Quadrilaterals, hexahedra and octahedra are still
+ *	evaluated through lib_grid on the positions of the live grid, taken from the
+ *	element pointers stored in the snapshot.*/
+void SetQualityStatisticsUseSnapshot(bool bUseSnapshot);
+
+///	returns whether the quality statistics are evaluated on a QualityGeometrySnapshot
+bool GetQualityStatisticsUseSnapshot();
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityGeometrySnapshot
+///	Contiguous copy of the geometry of one grid level for the quality kernels
+/**	The coordinates of the vertices of the level are packed into separate x, y and z
+ *	arrays (z is 0 for 2d positions). The elements are grouped by their reference
+ *	object type. Each group holds the vertex indices of its elements in one contiguous
+ *	array (4 per tetrahedron, 8 per hexahedron, ...) together with the element
+ *	pointers, so that each result can be mapped back to its GridObject.
+ *
+ *	Only elements which are evaluated by the statistics are stored, i.e. in parallel
+ *	ghosts as well as horizontal slaves of edges and faces are skipped during build.
+ *	The snapshot is a copy and has to be rebuilt if the grid changes.
+ *
+ *	The blocks of all types are stored, but only edges, triangles, tetrahedra, prisms
+ *	and pyramids are evaluated on the packed coordinates (see tet_kernels.h and
+ *	quality_snapshot_kernels.h). For quadrilaterals, hexahedra and octahedra the
+ *	statistics fall back to lib_grid, which reads the positions of the live grid
+ *	through the stored element pointers.*/
+class QualityGeometrySnapshot
+{
+	public:
+	///	connectivity of all elements of one reference object type
+		struct ElementBlock
+		{
+			ElementBlock() : numCorners(0)	{}
+
+			size_t num_elements() const			{return elems.size();}
+			const int* corners(size_t i) const	{return &vrtInds[i * numCorners];}
+
+			size_t numCorners;
+			std::vector<int> vrtInds;
+			std::vector<GridObject*> elems;
+		};
+
+	public:
+		QualityGeometrySnapshot();
+
+	///	packs the vertices and elements of the given level
+		template <class TAAPosVRT>
+		void build(Grid& grid, GridObjectCollection& goc, int level, TAAPosVRT& aaPos);
+
+		void clear();
+
+	///	number of packed vertices (including ghosts, whose coordinates are needed)
+		size_t num_vertices() const				{return m_x.size();}
+
+	///	number of vertices evaluated on this process (no ghosts and horizontal slaves)
+		size_t num_evaluated_vertices() const	{return m_numEvalVrts;}
+
+	///	number of stored elements of dimension dim (1: edges, 2: faces, 3: volumes)
+		size_t num_evaluated_elements(int dim) const
+		{
+		//	the reference objects of one dimension are numbered consecutively
+			static const int firstRoid[3] = {ROID_EDGE, ROID_TRIANGLE, ROID_TETRAHEDRON};
+			static const int lastRoid[3] = {ROID_EDGE, ROID_QUADRILATERAL, ROID_OCTAHEDRON};
+			size_t num = 0;
+			if(dim >= 1 && dim <= 3)
+				for(int roid = firstRoid[dim-1]; roid <= lastRoid[dim-1]; ++roid)
+					num += m_blocks[roid].num_elements();
+			return num;
+		}
+
+	///	dimension of the position attachment the snapshot was built from
+		int dim() const							{return m_dim;}
+
+		const number* x() const					{return m_x.data();}
+		const number* y() const					{return m_y.data();}
+		const number* z() const					{return m_z.data();}
+
+		const ElementBlock& block(ReferenceObjectID roid) const		{return m_blocks[roid];}
+		size_t num_elements(ReferenceObjectID roid) const			{return m_blocks[roid].num_elements();}
+		GridObject* element(ReferenceObjectID roid, size_t i) const	{return m_blocks[roid].elems[i];}
+
+	protected:
+		template <class TIterator, class TAAPosVRT>
+		void add_edges(Grid& grid, TIterator begin, TIterator end,
+					   Grid::VertexAttachmentAccessor<AInt>& aaInd, TAAPosVRT& aaPos);
+
+		template <class TBaseElem, class TAAPosVRT>
+		void add_elements(const ElementsByType<TBaseElem>& elems,
+						  Grid::VertexAttachmentAccessor<AInt>& aaInd, TAAPosVRT& aaPos);
+
+		template <class TAAPosVRT>
+		int vertex_index(Vertex* v, Grid::VertexAttachmentAccessor<AInt>& aaInd,
+						 TAAPosVRT& aaPos);
+
+		void push_coordinates(const vector2& p);
+		void push_coordinates(const vector3& p);
+
+	protected:
+		std::vector<number> m_x;
+		std::vector<number> m_y;
+		std::vector<number> m_z;
+		ElementBlock m_blocks[NUM_REFERENCE_OBJECTS];
+		size_t m_numEvalVrts;
+		int m_dim;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualityGeometrySnapshot - template implementations
+template <class TAAPosVRT>
+void QualityGeometrySnapshot::
+build(Grid& grid, GridObjectCollection& goc, int level, TAAPosVRT& aaPos)
+{
+	clear();
+
+	DistributedGridManager* dgm = grid.distributed_grid_manager();
+
+//	temporary vertex indices. Vertices of the level are packed in their order,
+//	vertices referenced from other levels (if any) are appended on demand.
+	AInt aInd;
+	grid.attach_to_vertices_dv(aInd, -1);
+	Grid::VertexAttachmentAccessor<AInt> aaInd(grid, aInd);
+
+	m_x.reserve(goc.num<Vertex>(level));
+	m_y.reserve(goc.num<Vertex>(level));
+	m_z.reserve(goc.num<Vertex>(level));
+
+	for(VertexIterator iter = goc.begin<Vertex>(level); iter != goc.end<Vertex>(level); ++iter)
+	{
+		Vertex* v = *iter;
+		vertex_index(v, aaInd, aaPos);
+
+		#ifdef UG_PARALLEL
+		//	ghosts (vertical masters) as well as horizontal slaves have to be ignored,
+		//	since they have a copy on another process and
+		//	since we already consider that copy...
+			if(dgm->is_ghost(v) || dgm->contains_status(v, ES_H_SLAVE))
+				continue;
+		#endif
+
+		m_numEvalVrts++;
+	}
+
+	add_edges(grid, goc.begin<Edge>(level), goc.end<Edge>(level), aaInd, aaPos);
+
+//	faces and volumes are taken from their type sections, so that every block is
+//	filled from a contiguous range
+	ElementsByType<Face> faces;
+	faces.collect(grid, goc, level);
+	add_elements(faces, aaInd, aaPos);
+
+	ElementsByType<Volume> vols;
+	vols.collect(grid, goc, level);
+	add_elements(vols, aaInd, aaPos);
+
+	grid.detach_from_vertices(aInd);
+}
+
+template <class TIterator, class TAAPosVRT>
+void QualityGeometrySnapshot::
+add_edges(Grid& grid, TIterator begin, TIterator end,
+		  Grid::VertexAttachmentAccessor<AInt>& aaInd, TAAPosVRT& aaPos)
+{
+	DistributedGridManager* dgm = grid.distributed_grid_manager();
+	ElementBlock& blk = m_blocks[ROID_EDGE];
+	blk.numCorners = 2;
+
+	for(TIterator iter = begin; iter != end; ++iter)
+	{
+		Edge* e = *iter;
+
+		#ifdef UG_PARALLEL
+		//	see AccumulateEdgeQuality
+			if(dgm->is_ghost(e) || dgm->contains_status(e, ES_H_SLAVE))
+				continue;
+		#endif
+
+		blk.elems.push_back(e);
+		blk.vrtInds.push_back(vertex_index(e->vertex(0), aaInd, aaPos));
+		blk.vrtInds.push_back(vertex_index(e->vertex(1), aaInd, aaPos));
+	}
+}
+
+template <class TBaseElem, class TAAPosVRT>
+void QualityGeometrySnapshot::
+add_elements(const ElementsByType<TBaseElem>& elems,
+			 Grid::VertexAttachmentAccessor<AInt>& aaInd, TAAPosVRT& aaPos)
+{
+	for(int r = 0; r < NUM_REFERENCE_OBJECTS; ++r)
+	{
+		const ReferenceObjectID roid = (ReferenceObjectID)r;
+		if(elems.num(roid) == 0)
+			continue;
+
+		ElementBlock& blk = m_blocks[roid];
+		blk.numCorners = elems[elems.begin(roid)]->num_vertices();
+		blk.elems.reserve(blk.elems.size() + elems.num(roid));
+		blk.vrtInds.reserve(blk.vrtInds.size() + elems.num(roid) * blk.numCorners);
+
+		for(size_t i = elems.begin(roid); i < elems.end(roid); ++i)
+		{
+			TBaseElem* elem = elems[i];
+			blk.elems.push_back(elem);
+			for(size_t j = 0; j < blk.numCorners; ++j)
+				blk.vrtInds.push_back(vertex_index(elem->vertex(j), aaInd, aaPos));
+		}
+	}
+}
+
+template <class TAAPosVRT>
+int QualityGeometrySnapshot::
+vertex_index(Vertex* v, Grid::VertexAttachmentAccessor<AInt>& aaInd, TAAPosVRT& aaPos)
+{
+	if(aaInd[v] < 0)
+	{
+		aaInd[v] = (int)m_x.size();
+		push_coordinates(aaPos[v]);
+	}
+	return aaInd[v];
+}
+
+
+}
+#endif  //__QUALITY_SNAPSHOT_H__
@@ -0,0 +1,445 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __QUALITY_SNAPSHOT_KERNELS_H__
+#define __QUALITY_SNAPSHOT_KERNELS_H__
+
+/* system includes */
+#include <stddef.h>
+#include <cmath>
+
+#include "common/types.h"
+#include "common/math/ugmath.h"
+#include "quality_metrics.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Scalar kernels on packed coordinates
+/*	The kernels below evaluate the same measures as the corresponding lib_grid
+ *	functions (EdgeLength, FaceArea, CalculateAngles, CalculateAspectRatio,
+ *	CalculateVolume and CalculateVolToRMSFaceAreaRatio), but directly on the x, y, z
+ *	arrays of a QualityGeometrySnapshot. 'c' points to the vertex indices of one element.
+ *	All angles are returned in degrees. The prism and pyramid kernels define their own
+ *	aspect ratio and vol/RMS-face-area ratio, normalized to 1 for the regular element.
+ *	They only evaluate the measures of the given metrics (see QualityMetric), all other
+ *	members of their results are set to 0.*/
+
+///	clamps the cosine to [-1, 1] and returns the angle in degrees
+inline number SnapshotAngleFromCos(number cosAngle)
+{
+	if(cosAngle > 1.0) cosAngle = 1.0;
+	if(cosAngle < -1.0) cosAngle = -1.0;
+	return rad_to_deg(acos(cosAngle));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	SnapshotEdgeLength
+inline number SnapshotEdgeLength(const number* x, const number* y, const number* z,
+								 const int* c)
+{
+	number dx = x[c[1]] - x[c[0]];
+	number dy = y[c[1]] - y[c[0]];
+	number dz = z[c[1]] - z[c[0]];
+	return sqrt(dx*dx + dy*dy + dz*dz);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TriangleQuality
+///	measures of one triangle
+struct TriangleQuality
+{
+	number area;
+	number angles[3];
+	number aspectRatio;		///< sqrt(4/3) * hmin / lmax, 1 for the regular triangle
+};
+
+inline void SnapshotTriangleQuality(TriangleQuality& q,
+									const number* x, const number* y, const number* z,
+									const int* c)
+{
+//	edge vectors e[i] from corner i to corner i+1
+	number ex[3], ey[3], ez[3], lenSq[3];
+	for(int i = 0; i < 3; ++i)
+	{
+		int j = (i + 1) % 3;
+		ex[i] = x[c[j]] - x[c[i]];
+		ey[i] = y[c[j]] - y[c[i]];
+		ez[i] = z[c[j]] - z[c[i]];
+		lenSq[i] = ex[i]*ex[i] + ey[i]*ey[i] + ez[i]*ez[i];
+	}
+
+//	angle at corner i between e[i] and -e[i-1]
+	for(int i = 0; i < 3; ++i)
+	{
+		int k = (i + 2) % 3;
+		number d = -(ex[i]*ex[k] + ey[i]*ey[k] + ez[i]*ez[k]);
+		q.angles[i] = SnapshotAngleFromCos(d / sqrt(lenSq[i] * lenSq[k]));
+	}
+
+	number nx = ey[0]*ez[1] - ez[0]*ey[1];
+	number ny = ez[0]*ex[1] - ex[0]*ez[1];
+	number nz = ex[0]*ey[1] - ey[0]*ex[1];
+	number twiceArea = sqrt(nx*nx + ny*ny + nz*nz);
+	q.area = 0.5 * twiceArea;
+
+//	the smallest height belongs to the longest edge: hmin = 2A / lmax
+	number maxLenSq = lenSq[0];
+	if(lenSq[1] > maxLenSq) maxLenSq = lenSq[1];
+	if(lenSq[2] > maxLenSq) maxLenSq = lenSq[2];
+	q.aspectRatio = sqrt(4.0/3.0) * twiceArea / maxLenSq;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TetrahedronQuality
+///	measures of one tetrahedron
+struct TetrahedronQuality
+{
+	number volume;
+	number dihedrals[6];
+	number aspectRatio;				///< sqrt(3/2) * hmin / lmax, 1 for the regular tetrahedron
+	number volToRMSFaceAreaRatio;	///< normalized V / A_rms^(3/2), 1 for the regular tetrahedron
+};
+
+inline void SnapshotTetrahedronQuality(TetrahedronQuality& q,
+									   const number* x, const number* y, const number* z,
+									   const int* c)
+{
+//	edge vectors from corner 0
+	number ax = x[c[1]] - x[c[0]], ay = y[c[1]] - y[c[0]], az = z[c[1]] - z[c[0]];
+	number bx = x[c[2]] - x[c[0]], by = y[c[2]] - y[c[0]], bz = z[c[2]] - z[c[0]];
+	number cx = x[c[3]] - x[c[0]], cy = y[c[3]] - y[c[0]], cz = z[c[3]] - z[c[0]];
+
+//	area normals n[i] of the faces opposite to corner i. They are either all outward
+//	or all inward (depending on the orientation), which does not matter for the
+//	dihedrals, since only products of two normals are used.
+	number nx[4], ny[4], nz[4];
+	nx[1] = cy*bz - cz*by;	ny[1] = cz*bx - cx*bz;	nz[1] = cx*by - cy*bx;
+	nx[2] = ay*cz - az*cy;	ny[2] = az*cx - ax*cz;	nz[2] = ax*cy - ay*cx;
+	nx[3] = by*az - bz*ay;	ny[3] = bz*ax - bx*az;	nz[3] = bx*ay - by*ax;
+	nx[0] = -(nx[1] + nx[2] + nx[3]);
+	ny[0] = -(ny[1] + ny[2] + ny[3]);
+	nz[0] = -(nz[1] + nz[2] + nz[3]);
+
+	number nLen[4];
+	number maxNLen = 0.0;
+	number sumNLenSq = 0.0;
+	for(int i = 0; i < 4; ++i)
+	{
+		number lenSq = nx[i]*nx[i] + ny[i]*ny[i] + nz[i]*nz[i];
+		nLen[i] = sqrt(lenSq);
+		sumNLenSq += lenSq;
+		if(nLen[i] > maxNLen) maxNLen = nLen[i];
+	}
+
+//	the dihedral at edge (i,j) lies between the faces opposite to the other two corners
+	static const int faceA[6] = {2, 1, 1, 0, 0, 0};
+	static const int faceB[6] = {3, 3, 2, 3, 2, 1};
+	for(int e = 0; e < 6; ++e)
+	{
+		int k = faceA[e], l = faceB[e];
+		number d = -(nx[k]*nx[l] + ny[k]*ny[l] + nz[k]*nz[l]);
+		q.dihedrals[e] = SnapshotAngleFromCos(d / (nLen[k] * nLen[l]));
+	}
+
+	number det = ax*nx[1] + ay*ny[1] + az*nz[1];
+	number absDet = fabs(det);
+	q.volume = absDet / 6.0;
+
+//	longest edge
+	number dx, dy, dz;
+	number maxLenSq = ax*ax + ay*ay + az*az;
+	number lenSq = bx*bx + by*by + bz*bz;			if(lenSq > maxLenSq) maxLenSq = lenSq;
+	lenSq = cx*cx + cy*cy + cz*cz;					if(lenSq > maxLenSq) maxLenSq = lenSq;
+	dx = bx - ax; dy = by - ay; dz = bz - az;
+	lenSq = dx*dx + dy*dy + dz*dz;					if(lenSq > maxLenSq) maxLenSq = lenSq;
+	dx = cx - ax; dy = cy - ay; dz = cz - az;
+	lenSq = dx*dx + dy*dy + dz*dz;					if(lenSq > maxLenSq) maxLenSq = lenSq;
+	dx = cx - bx; dy = cy - by; dz = cz - bz;
+	lenSq = dx*dx + dy*dy + dz*dz;					if(lenSq > maxLenSq) maxLenSq = lenSq;
+
+//	hmin = 3V / Amax = |det| / |n|max
+	q.aspectRatio = sqrt(3.0/2.0) * absDet / (maxNLen * sqrt(maxLenSq));
+
+//	A_rms = sqrt(sum(A_i^2) / 4) with A_i = |n_i| / 2
+	number rmsArea = sqrt(sumNLenSq / 16.0);
+	q.volToRMSFaceAreaRatio = pow(3.0, 7.0/4.0) * sqrt(2.0) / 4.0
+							  * q.volume / pow(rmsArea, 1.5);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	SnapshotPolyhedronQuality
+///	topology of a prism or pyramid for SnapshotPolyhedronQuality
+/**	The corners of every face are ordered counter clockwise seen from outside of a
+ *	positively oriented element. edgeFaces holds the two faces adjacent to every edge.*/
+struct PolyhedronTopology
+{
+	int numFaces;
+	int faceNumCorners[5];
+	int faceCorners[5][4];
+	int numEdges;
+	int edgeCorners[9][2];
+	int edgeFaces[9][2];
+};
+
+///	measures shared by the prism and pyramid kernels
+struct PolyhedronMeasures
+{
+	number volume;
+	number dihedrals[9];		///< in the edge order of the topology
+	number maxEdgeLenSq;
+	number sumFaceAreaSq;
+};
+
+///	evaluates the dihedrals, the volume and the extremal lengths of a prism or pyramid
+/**	Faces are represented by their area normals (for quadrilaterals half the cross
+ *	product of the diagonals), so that non planar quadrilaterals are treated as
+ *	bilinear patches. The volume is the flux of the position through the faces,
+ *	which is exact for those patches. The dihedrals are only evaluated if bDihedrals
+ *	is set, the longest edge only if bEdgeLengths is set.*/
+inline void SnapshotPolyhedronQuality(PolyhedronMeasures& m, const PolyhedronTopology& t,
+									  const number* x, const number* y, const number* z,
+									  const int* c, bool bDihedrals = true,
+									  bool bEdgeLengths = true)
+{
+	number nx[5], ny[5], nz[5], nLen[5];
+	number flux = 0.0;
+	m.sumFaceAreaSq = 0.0;
+
+	for(int f = 0; f < t.numFaces; ++f)
+	{
+		const int* fc = t.faceCorners[f];
+		int i0 = c[fc[0]], i1 = c[fc[1]], i2 = c[fc[2]];
+		number ax, ay, az, bx, by, bz;
+		number cx = x[i0] + x[i1] + x[i2];
+		number cy = y[i0] + y[i1] + y[i2];
+		number cz = z[i0] + z[i1] + z[i2];
+
+		if(t.faceNumCorners[f] == 3)
+		{
+			ax = x[i1] - x[i0];	ay = y[i1] - y[i0];	az = z[i1] - z[i0];
+			bx = x[i2] - x[i0];	by = y[i2] - y[i0];	bz = z[i2] - z[i0];
+			cx /= 3.0; cy /= 3.0; cz /= 3.0;
+		}
+		else
+		{
+			int i3 = c[fc[3]];
+			ax = x[i2] - x[i0];	ay = y[i2] - y[i0];	az = z[i2] - z[i0];
+			bx = x[i3] - x[i1];	by = y[i3] - y[i1];	bz = z[i3] - z[i1];
+			cx = (cx + x[i3]) / 4.0; cy = (cy + y[i3]) / 4.0; cz = (cz + z[i3]) / 4.0;
+		}
+
+		nx[f] = 0.5 * (ay*bz - az*by);
+		ny[f] = 0.5 * (az*bx - ax*bz);
+		nz[f] = 0.5 * (ax*by - ay*bx);
+
+		number lenSq = nx[f]*nx[f] + ny[f]*ny[f] + nz[f]*nz[f];
+		nLen[f] = sqrt(lenSq);
+		m.sumFaceAreaSq += lenSq;
+		flux += cx*nx[f] + cy*ny[f] + cz*nz[f];
+	}
+
+	m.volume = fabs(flux) / 3.0;
+
+//	interior dihedral from the (both outward or both inward) normals of the adjacent faces
+	if(bDihedrals)
+	{
+		for(int e = 0; e < t.numEdges; ++e)
+		{
+			int k = t.edgeFaces[e][0], l = t.edgeFaces[e][1];
+			number d = -(nx[k]*nx[l] + ny[k]*ny[l] + nz[k]*nz[l]);
+			m.dihedrals[e] = SnapshotAngleFromCos(d / (nLen[k] * nLen[l]));
+		}
+	}
+
+	m.maxEdgeLenSq = 0.0;
+	if(bEdgeLengths)
+	{
+		for(int e = 0; e < t.numEdges; ++e)
+		{
+			int i0 = c[t.edgeCorners[e][0]], i1 = c[t.edgeCorners[e][1]];
+			number dx = x[i1] - x[i0], dy = y[i1] - y[i0], dz = z[i1] - z[i0];
+			number lenSq = dx*dx + dy*dy + dz*dz;
+			if(lenSq > m.maxEdgeLenSq) m.maxEdgeLenSq = lenSq;
+		}
+	}
+}
+
+///	true if one of the metrics requires the dihedrals of an element
+inline bool QualityMetricsNeedDihedrals(unsigned int metrics)
+{
+	return (metrics & (QM_MIN_DIHEDRAL | QM_MAX_DIHEDRAL | QM_DIHEDRAL_DEVIATION)) != 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	GatherCornerCoordinates
+///	writes a position to entry i of separate x, y and z arrays
+inline void SetCornerCoordinates(number* x, number* y, number* z, size_t i, const vector2& p)
+{
+	x[i] = p.x(); y[i] = p.y(); z[i] = 0.0;
+}
+
+inline void SetCornerCoordinates(number* x, number* y, number* z, size_t i, const vector3& p)
+{
+	x[i] = p.x(); y[i] = p.y(); z[i] = p.z();
+}
+
+///	copies the corner coordinates of a grid element to separate x, y and z arrays
+/**	Used to evaluate single elements by the kernels below without a snapshot.*/
+template <class TElem, class TAAPosVRT>
+inline void GatherCornerCoordinates(number* x, number* y, number* z, TElem* elem,
+									TAAPosVRT& aaPos)
+{
+	for(size_t i = 0; i < elem->num_vertices(); ++i)
+		SetCornerCoordinates(x, y, z, i, aaPos[elem->vertex(i)]);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PrismQuality
+///	measures of one prism (corners 0, 1, 2 at the bottom, corner i+3 above corner i)
+/**	The dihedrals are grouped by the faces they lie between, since the regular prism
+ *	(all edges of equal length) has two different dihedrals: 90 degrees at the 6 edges
+ *	of the triangles and 60 degrees at the 3 edges between the quadrilaterals.*/
+struct PrismQuality
+{
+	number volume;
+	number triQuadDihedrals[6];
+	number quadQuadDihedrals[3];
+	number minDihedral;
+	number maxDihedral;
+	number aspectRatio;				///< normalized V / lmax^3, 1 for the regular prism
+	number volToRMSFaceAreaRatio;	///< normalized V / A_rms^(3/2), 1 for the regular prism
+};
+
+inline void SnapshotPrismQuality(PrismQuality& q,
+								 const number* x, const number* y, const number* z,
+								 const int* c, unsigned int metrics = QM_ALL)
+{
+	static const PolyhedronTopology prism = {
+		5, {3, 3, 4, 4, 4},
+		{{0, 2, 1, -1}, {3, 4, 5, -1}, {0, 1, 4, 3}, {1, 2, 5, 4}, {2, 0, 3, 5}},
+		9, {{0, 1}, {1, 2}, {2, 0}, {3, 4}, {4, 5}, {5, 3}, {0, 3}, {1, 4}, {2, 5}},
+		   {{0, 2}, {0, 3}, {0, 4}, {1, 2}, {1, 3}, {1, 4}, {2, 4}, {2, 3}, {3, 4}}};
+
+	const bool bDihedrals = QualityMetricsNeedDihedrals(metrics);
+	const bool bAspectRatio = (metrics & QM_ASPECT_RATIO) != 0;
+
+	PolyhedronMeasures m;
+	SnapshotPolyhedronQuality(m, prism, x, y, z, c, bDihedrals, bAspectRatio);
+
+	q.volume = m.volume;
+	q.minDihedral = q.maxDihedral = bDihedrals ? m.dihedrals[0] : 0.0;
+	for(int e = 0; e < 9; ++e)
+	{
+		number dihedral = bDihedrals ? m.dihedrals[e] : 0.0;
+		if(e < 6)	q.triQuadDihedrals[e] = dihedral;
+		else		q.quadQuadDihedrals[e - 6] = dihedral;
+		if(dihedral < q.minDihedral) q.minDihedral = dihedral;
+		if(dihedral > q.maxDihedral) q.maxDihedral = dihedral;
+	}
+
+//	regular prism with edge length 1: V = sqrt(3)/4, A_rms^2 = 27/40
+	q.aspectRatio = 0.0;
+	if(bAspectRatio)
+		q.aspectRatio = 4.0 / sqrt(3.0) * m.volume / (m.maxEdgeLenSq * sqrt(m.maxEdgeLenSq));
+	q.volToRMSFaceAreaRatio = 0.0;
+	if(metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+		q.volToRMSFaceAreaRatio = pow(27.0/40.0, 0.75) * 4.0 / sqrt(3.0)
+								  * m.volume / pow(m.sumFaceAreaSq / 5.0, 0.75);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	PyramidQuality
+///	measures of one pyramid (corners 0, 1, 2, 3 at the base, corner 4 at the apex)
+/**	The regular pyramid (all edges of equal length) has dihedrals of atan(sqrt(2))
+ *	= 54.74 degrees at the 4 base edges and of 109.47 degrees at the 4 apex edges.*/
+struct PyramidQuality
+{
+	number volume;
+	number baseDihedrals[4];
+	number apexDihedrals[4];
+	number minDihedral;
+	number maxDihedral;
+	number aspectRatio;				///< normalized V / lmax^3, 1 for the regular pyramid
+	number volToRMSFaceAreaRatio;	///< normalized V / A_rms^(3/2), 1 for the regular pyramid
+};
+
+inline void SnapshotPyramidQuality(PyramidQuality& q,
+								   const number* x, const number* y, const number* z,
+								   const int* c, unsigned int metrics = QM_ALL)
+{
+	static const PolyhedronTopology pyramid = {
+		5, {4, 3, 3, 3, 3},
+		{{0, 3, 2, 1}, {0, 1, 4, -1}, {1, 2, 4, -1}, {2, 3, 4, -1}, {3, 0, 4, -1}},
+		8, {{0, 1}, {1, 2}, {2, 3}, {3, 0}, {0, 4}, {1, 4}, {2, 4}, {3, 4}, {-1, -1}},
+		   {{0, 1}, {0, 2}, {0, 3}, {0, 4}, {4, 1}, {1, 2}, {2, 3}, {3, 4}, {-1, -1}}};
+
+	const bool bDihedrals = QualityMetricsNeedDihedrals(metrics);
+	const bool bAspectRatio = (metrics & QM_ASPECT_RATIO) != 0;
+
+	PolyhedronMeasures m;
+	SnapshotPolyhedronQuality(m, pyramid, x, y, z, c, bDihedrals, bAspectRatio);
+
+	q.volume = m.volume;
+	q.minDihedral = q.maxDihedral = bDihedrals ? m.dihedrals[0] : 0.0;
+	for(int e = 0; e < 8; ++e)
+	{
+		number dihedral = bDihedrals ? m.dihedrals[e] : 0.0;
+		if(e < 4)	q.baseDihedrals[e] = dihedral;
+		else		q.apexDihedrals[e - 4] = dihedral;
+		if(dihedral < q.minDihedral) q.minDihedral = dihedral;
+		if(dihedral > q.maxDihedral) q.maxDihedral = dihedral;
+	}
+
+//	regular pyramid with edge length 1: V = sqrt(2)/6, A_rms^2 = 7/20
+	q.aspectRatio = 0.0;
+	if(bAspectRatio)
+		q.aspectRatio = 3.0 * sqrt(2.0) * m.volume / (m.maxEdgeLenSq * sqrt(m.maxEdgeLenSq));
+	q.volToRMSFaceAreaRatio = 0.0;
+	if(metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO)
+		q.volToRMSFaceAreaRatio = pow(7.0/20.0, 0.75) * 6.0 / sqrt(2.0)
+								  * m.volume / pow(m.sumFaceAreaSq / 5.0, 0.75);
+}
+
+
+}
+#endif  //__QUALITY_SNAPSHOT_KERNELS_H__
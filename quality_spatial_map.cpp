@@ -0,0 +1,405 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "quality_spatial_map.h"
+#include "element_quality_statistics.h"
+#include "common/util/table.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualitySpatialMap
+QualitySpatialMap::QualitySpatialMap(const vector3& boxMin, const vector3& boxMax,
+									 const int numCells[3], number threshold, int dim,
+									 unsigned int metric) :
+	m_boxMin(boxMin),
+	m_boxMax(boxMax),
+	m_threshold(threshold),
+	m_dim(dim),
+	m_metric(metric)
+{
+	UG_COND_THROW(dim != 2 && dim != 3, "QualitySpatialMap: only dimensions 2 or 3 supported.");
+	UG_COND_THROW(metric != QM_MIN_DIHEDRAL && metric != QM_ASPECT_RATIO,
+				  "QualitySpatialMap: only QM_MIN_DIHEDRAL and QM_ASPECT_RATIO supported.");
+
+	for(int d = 0; d < 3; ++d)
+	{
+		UG_COND_THROW(numCells[d] < 1, "QualitySpatialMap: at least one cell per direction required.");
+		m_numCells[d] = numCells[d];
+		m_cellSize[d] = (boxMax[d] - boxMin[d]) / numCells[d];
+	}
+
+	size_t num = (size_t)numCells[0] * numCells[1] * numCells[2];
+	m_count.resize(num, 0);
+	m_numBelow.resize(num, 0);
+	m_sum.resize(num, 0);
+	m_min.resize(num, numeric_limits<number>::max());
+}
+
+
+size_t QualitySpatialMap::cell_index(const vector3& p) const
+{
+	int ind[3];
+	for(int d = 0; d < 3; ++d)
+	{
+		ind[d] = 0;
+		if(m_cellSize[d] > 0)
+			ind[d] = (int)floor((p[d] - m_boxMin[d]) / m_cellSize[d]);
+		ind[d] = std::max(0, std::min(ind[d], m_numCells[d] - 1));
+	}
+	return cell_index(ind[0], ind[1], ind[2]);
+}
+
+
+vector3 QualitySpatialMap::cell_center(size_t cell) const
+{
+	size_t ind[3];
+	ind[0] = cell % m_numCells[0];
+	ind[1] = (cell / m_numCells[0]) % m_numCells[1];
+	ind[2] = cell / ((size_t)m_numCells[0] * m_numCells[1]);
+
+	vector3 c;
+	for(int d = 0; d < 3; ++d)
+		c[d] = m_boxMin[d] + (ind[d] + 0.5) * m_cellSize[d];
+	return c;
+}
+
+
+void QualitySpatialMap::clear()
+{
+	fill(m_count.begin(), m_count.end(), 0);
+	fill(m_numBelow.begin(), m_numBelow.end(), 0);
+	fill(m_sum.begin(), m_sum.end(), 0);
+	fill(m_min.begin(), m_min.end(), numeric_limits<number>::max());
+}
+
+
+void QualitySpatialMap::merge(const QualitySpatialMap& map)
+{
+	UG_COND_THROW(map.num_cells() != num_cells(), "QualitySpatialMap: can't merge maps with different cells.");
+
+	for(size_t i = 0; i < m_count.size(); ++i)
+	{
+		m_count[i] += map.m_count[i];
+		m_numBelow[i] += map.m_numBelow[i];
+		m_sum[i] += map.m_sum[i];
+		m_min[i] = std::min(m_min[i], map.m_min[i]);
+	}
+}
+
+
+void QualitySpatialMap::allreduce()
+{
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			const size_t num = m_count.size();
+			vector<number> sums, gSums, gMins;
+			sums.reserve(3 * num);
+			sums.insert(sums.end(), m_count.begin(), m_count.end());
+			sums.insert(sums.end(), m_numBelow.begin(), m_numBelow.end());
+			sums.insert(sums.end(), m_sum.begin(), m_sum.end());
+
+			pcl::ProcessCommunicator pc;
+			pc.allreduce(sums, gSums, PCL_RO_SUM);
+			pc.allreduce(m_min, gMins, PCL_RO_MIN);
+
+			copy(gSums.begin(), gSums.begin() + num, m_count.begin());
+			copy(gSums.begin() + num, gSums.begin() + 2 * num, m_numBelow.begin());
+			copy(gSums.begin() + 2 * num, gSums.end(), m_sum.begin());
+			m_min.swap(gMins);
+		}
+	#endif
+}
+
+
+void QualitySpatialMap::sorted_cells(std::vector<size_t>& cellsOut) const
+{
+	cellsOut.clear();
+	for(size_t i = 0; i < m_count.size(); ++i)
+		if(m_count[i] > 0)
+			cellsOut.push_back(i);
+
+	sort(cellsOut.begin(), cellsOut.end(),
+		[this](size_t a, size_t b)
+		{
+			if(m_numBelow[a] != m_numBelow[b])
+				return m_numBelow[a] > m_numBelow[b];
+			return m_min[a] < m_min[b];
+		});
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Output
+void QualitySpatialMap::write_vtk(const char* filename) const
+{
+	int procRank = 0;
+	#ifdef UG_PARALLEL
+		procRank = pcl::ProcRank();
+	#endif
+	if(procRank != 0)
+		return;
+
+	ofstream out(filename);
+	UG_COND_THROW(!out, "QualitySpatialMap: Couldn't open file " << filename);
+	out.precision(9);
+
+	out << "# vtk DataFile Version 3.0" << endl;
+	out << "element quality map, threshold " << m_threshold << endl;
+	out << "ASCII" << endl;
+	out << "DATASET STRUCTURED_POINTS" << endl;
+	out << "DIMENSIONS " << m_numCells[0] + 1 << " " << m_numCells[1] + 1 << " "
+		<< m_numCells[2] + 1 << endl;
+	out << "ORIGIN " << m_boxMin[0] << " " << m_boxMin[1] << " " << m_boxMin[2] << endl;
+	out << "SPACING " << m_cellSize[0] << " " << m_cellSize[1] << " " << m_cellSize[2] << endl;
+	out << "CELL_DATA " << num_cells() << endl;
+
+	out << "SCALARS count double 1" << endl << "LOOKUP_TABLE default" << endl;
+	for(size_t i = 0; i < num_cells(); ++i)
+		out << m_count[i] << "\n";
+
+	out << "SCALARS num_below double 1" << endl << "LOOKUP_TABLE default" << endl;
+	for(size_t i = 0; i < num_cells(); ++i)
+		out << m_numBelow[i] << "\n";
+
+	out << "SCALARS min double 1" << endl << "LOOKUP_TABLE default" << endl;
+	for(size_t i = 0; i < num_cells(); ++i)
+		out << min(i) << "\n";
+
+	out << "SCALARS mean double 1" << endl << "LOOKUP_TABLE default" << endl;
+	for(size_t i = 0; i < num_cells(); ++i)
+		out << mean(i) << "\n";
+}
+
+
+void QualitySpatialMap::write_table(const char* filename) const
+{
+	int procRank = 0;
+	#ifdef UG_PARALLEL
+		procRank = pcl::ProcRank();
+	#endif
+	if(procRank != 0)
+		return;
+
+	ofstream out(filename);
+	UG_COND_THROW(!out, "QualitySpatialMap: Couldn't open file " << filename);
+	out.precision(9);
+
+	vector<size_t> cells;
+	sorted_cells(cells);
+
+	out << "cell;center_x;center_y;center_z;count;num_below;min;mean" << endl;
+	for(size_t i = 0; i < cells.size(); ++i)
+	{
+		size_t c = cells[i];
+		vector3 center = cell_center(c);
+		out << c << ";" << center[0] << ";" << center[1] << ";" << center[2] << ";"
+			<< count(c) << ";" << num_below(c) << ";" << min(c) << ";" << mean(c) << endl;
+	}
+}
+
+
+void QualitySpatialMap::print(size_t numCells) const
+{
+	vector<size_t> cells;
+	sorted_cells(cells);
+	if(cells.size() > numCells)
+		cells.resize(numCells);
+
+	UG_LOG(endl << "Cells with the most elements below " << m_threshold << " (of "
+		   << m_numCells[0] << " x " << m_numCells[1] << " x " << m_numCells[2] << " cells):" << endl);
+
+	ug::Table<std::stringstream> table(cells.size() + 1, 5);
+	table(0, 0) << "Cell center";	table(0, 1) << "Elements";	table(0, 2) << "Below threshold";
+	table(0, 3) << "Min";			table(0, 4) << "Mean";
+
+	for(size_t i = 0; i < cells.size(); ++i)
+	{
+		size_t c = cells[i];
+		table(i+1, 0) << cell_center(c);
+		table(i+1, 1) << count(c);
+		table(i+1, 2) << num_below(c);
+		table(i+1, 3) << min(c);
+		table(i+1, 4) << mean(c);
+	}
+
+	UG_LOG(table);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CreateQualitySpatialMap
+template <class TAAPosVRT>
+static SmartPtr<QualitySpatialMap>
+CreateQualitySpatialMap(GridObjectCollection goc, int dim, int lvl, TAAPosVRT& aaPos,
+						const char* measure, number threshold, int resolution)
+{
+	bool bMinAngle = (strcmp(measure, "min_angle") == 0);
+	UG_COND_THROW(!bMinAngle && strcmp(measure, "aspect_ratio") != 0,
+				  "CreateQualitySpatialMap: only 'min_angle' and 'aspect_ratio' supported.");
+	UG_COND_THROW(resolution < 1, "CreateQualitySpatialMap: resolution has to be positive.");
+	UG_COND_THROW(lvl < 0 || lvl >= (int)goc.num_levels(), "Invalid level " << lvl << ".");
+
+//	bounding box of the level on all processes. The maxima are stored negated,
+//	so that both are reduced by one PCL_RO_MIN.
+	vector<number> minNegMax(6, numeric_limits<number>::max());
+	for(VertexIterator iter = goc.begin<Vertex>(lvl); iter != goc.end<Vertex>(lvl); ++iter)
+	{
+		vector3 p = QualitySpatialMap::position(aaPos[*iter]);
+		for(int d = 0; d < 3; ++d)
+		{
+			minNegMax[d] = std::min(minNegMax[d], p[d]);
+			minNegMax[3 + d] = std::min(minNegMax[3 + d], -p[d]);
+		}
+	}
+
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			vector<number> gMinNegMax;
+			pcl::ProcessCommunicator pc;
+			pc.allreduce(minNegMax, gMinNegMax, PCL_RO_MIN);
+			minNegMax.swap(gMinNegMax);
+		}
+	#endif
+
+	vector3 boxMin(0, 0, 0), boxMax(0, 0, 0);
+	if(minNegMax[0] <= -minNegMax[3])
+	{
+		for(int d = 0; d < 3; ++d)
+		{
+			boxMin[d] = minNegMax[d];
+			boxMax[d] = -minNegMax[3 + d];
+		}
+	}
+
+//	cells of about the same size in all directions
+	number maxExtent = 0;
+	for(int d = 0; d < 3; ++d)
+		maxExtent = std::max(maxExtent, boxMax[d] - boxMin[d]);
+
+	int numCells[3];
+	for(int d = 0; d < 3; ++d)
+	{
+		numCells[d] = 1;
+		if(maxExtent > 0)
+			numCells[d] = std::max(1, (int)ceil(resolution * (boxMax[d] - boxMin[d]) / maxExtent - 1e-9));
+	}
+
+	return make_sp(new QualitySpatialMap(boxMin, boxMax, numCells, threshold, dim,
+										 bMinAngle ? QM_MIN_DIHEDRAL : QM_ASPECT_RATIO));
+}
+
+static SmartPtr<QualitySpatialMap>
+CreateQualitySpatialMap(Grid& grid, GridObjectCollection goc, int dim, int lvl,
+						const char* measure, number threshold, int resolution)
+{
+	if(dim == 2)
+	{
+		Grid::VertexAttachmentAccessor<APosition2> aaPos(grid, aPosition2);
+		return CreateQualitySpatialMap(goc, dim, lvl, aaPos, measure, threshold, resolution);
+	}
+	else if(dim == 3)
+	{
+		Grid::VertexAttachmentAccessor<APosition> aaPos(grid, aPosition);
+		return CreateQualitySpatialMap(goc, dim, lvl, aaPos, measure, threshold, resolution);
+	}
+
+	UG_THROW("Only dimensions 2 or 3 supported.");
+}
+
+SmartPtr<QualitySpatialMap>
+CreateQualitySpatialMap(MultiGrid& mg, int dim, int lvl, const char* measure,
+						number threshold, int resolution)
+{
+	return CreateQualitySpatialMap(mg, mg.get_grid_objects(), dim, lvl, measure,
+								   threshold, resolution);
+}
+
+SmartPtr<QualitySpatialMap>
+CreateQualitySpatialMap(Grid& grid, int dim, const char* measure,
+						number threshold, int resolution)
+{
+	return CreateQualitySpatialMap(grid, grid.get_grid_objects(), dim, 0, measure,
+								   threshold, resolution);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeQualitySpatialMap
+static SmartPtr<QualitySpatialMap>
+ComputeQualitySpatialMap(Grid& grid, GridObjectCollection goc, int dim, int lvl,
+						 const char* measure, number threshold, int resolution)
+{
+	SmartPtr<QualitySpatialMap> map = CreateQualitySpatialMap(grid, goc, dim, lvl, measure,
+															  threshold, resolution);
+
+//	only the measure of the map is evaluated, no worst elements are tracked
+	ElementQualityData data;
+	data.metrics = map->metric();
+	data.set_num_worst_elements(0);
+	EvaluateElementQualityLevel(data, grid, goc, dim, lvl, NULL, map.get());
+	return map;
+}
+
+SmartPtr<QualitySpatialMap>
+ComputeQualitySpatialMap(MultiGrid& mg, int dim, int lvl, const char* measure,
+						 number threshold, int resolution)
+{
+	return ComputeQualitySpatialMap(mg, mg.get_grid_objects(), dim, lvl, measure,
+									threshold, resolution);
+}
+
+SmartPtr<QualitySpatialMap>
+ComputeQualitySpatialMap(Grid& grid, int dim, const char* measure,
+						 number threshold, int resolution)
+{
+	return ComputeQualitySpatialMap(grid, grid.get_grid_objects(), dim, 0, measure,
+									threshold, resolution);
+}
+
+}
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __QUALITY_SPATIAL_MAP_H__
+#define __QUALITY_SPATIAL_MAP_H__
+
+/* system includes */
+#include <stddef.h>
+#include <functional>
+#include <vector>
+
+#include "lib_grid/lib_grid.h"
+#include "quality_metrics.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	QualitySpatialMap
+///	Element quality aggregated on a uniform grid of cells over a bounding box
+/**	Every element is binned by its center. Each cell holds the number of elements,
+ *	the number of elements whose value is below a threshold, the minimum and the mean
+ *	value. The cells are small enough to be reduced over all processes by a single
+ *	allreduce and to be exported as a VTK image or a table, which shows where bad
+ *	elements cluster.
+ *
+ *	The map bins one measure, given by metric(): QM_MIN_DIHEDRAL (min angles of faces
+ *	resp. min dihedrals of volumes) or QM_ASPECT_RATIO. Only elements of the dimension
+ *	dim() of the map are binned, i.e. faces for dim 2 and volumes for dim 3, even if
+ *	the faces of a 3d grid are evaluated, too (QM_LOWER_DIM). It is fed by the
+ *	evaluation of the statistics (see ElementQualityData::spatialMap), so that the
+ *	elements are evaluated only once for the statistics and the map.
+ *
+ *	Centers outside of the box are assigned to the closest cell.*/
+class QualitySpatialMap
+{
+	public:
+	///	creates a map of the elements of dimension dim with numCells[i] cells in direction i
+		QualitySpatialMap(const vector3& boxMin, const vector3& boxMax,
+						  const int numCells[3], number threshold, int dim,
+						  unsigned int metric = QM_MIN_DIHEDRAL);
+
+		size_t num_cells() const						{return m_count.size();}
+		int num_cells(int dir) const					{return m_numCells[dir];}
+		number threshold() const						{return m_threshold;}
+	///	dimension of the binned elements (2: faces, 3: volumes)
+		int dim() const									{return m_dim;}
+	///	the binned measure (QM_MIN_DIHEDRAL or QM_ASPECT_RATIO)
+		unsigned int metric() const						{return m_metric;}
+		const vector3& box_min() const					{return m_boxMin;}
+		const vector3& box_max() const					{return m_boxMax;}
+
+	///	index of the cell (i, j, k)
+		size_t cell_index(int i, int j, int k) const
+		{return ((size_t)k * m_numCells[1] + j) * m_numCells[0] + i;}
+
+	///	index of the cell containing the given point
+		size_t cell_index(const vector3& p) const;
+
+	///	center of a cell
+		vector3 cell_center(size_t cell) const;
+
+	///	adds the value of an element with the given center
+		inline void add(const vector3& center, number value)
+		{
+			size_t c = cell_index(center);
+			m_count[c] += 1;
+			m_sum[c] += value;
+			if(value < m_threshold)
+				m_numBelow[c] += 1;
+			if(value < m_min[c])
+				m_min[c] = value;
+		}
+
+	///	position of a point in the map (z = 0 for 2d positions)
+		static inline vector3 position(const vector3& p)		{return p;}
+		static inline vector3 position(const vector2& p)		{return vector3(p.x(), p.y(), 0.0);}
+
+	///	sets the vertex positions from which the centers of added elements are computed
+		template <class TAAPosVRT>
+		void set_element_positions(TAAPosVRT aaPos)
+		{
+			m_elemCenter = [aaPos](GridObject* elem) mutable
+				{return position(CalculateCenter(elem, aaPos));};
+		}
+
+	///	adds the value of an element (see set_element_positions)
+		inline void add(GridObject* elem, number value)
+		{
+			add(m_elemCenter(elem), value);
+		}
+
+	///	removes the values of all cells
+		void clear();
+
+	///	adds the values of another map with the same cells
+		void merge(const QualitySpatialMap& map);
+
+	///	sums up and reduces the cells of all processes (collective)
+		void allreduce();
+
+		size_t count(size_t cell) const					{return (size_t)m_count[cell];}
+		size_t num_below(size_t cell) const				{return (size_t)m_numBelow[cell];}
+	///	smallest value of a cell (-1 for empty cells)
+		number min(size_t cell) const					{return m_count[cell] > 0 ? m_min[cell] : -1;}
+	///	mean value of a cell (-1 for empty cells)
+		number mean(size_t cell) const					{return m_count[cell] > 0 ? m_sum[cell] / m_count[cell] : -1;}
+
+	///	writes the cells as a legacy VTK image (STRUCTURED_POINTS with cell data, process 0 only)
+	/**	Contains the arrays count, num_below, min and mean. min and mean are -1 for
+	 *	empty cells.*/
+		void write_vtk(const char* filename) const;
+
+	///	writes all non-empty cells as csv table, most elements below the threshold first (process 0 only)
+		void write_table(const char* filename) const;
+
+	///	logs the numCells cells with the most elements below the threshold
+		void print(size_t numCells) const;
+
+	protected:
+	///	indices of the non-empty cells, most elements below the threshold (then smallest min) first
+		void sorted_cells(std::vector<size_t>& cellsOut) const;
+
+	protected:
+		vector3 m_boxMin;
+		vector3 m_boxMax;
+		int m_numCells[3];
+		number m_cellSize[3];
+		number m_threshold;
+		int m_dim;
+		unsigned int m_metric;
+		std::function<vector3 (GridObject*)> m_elemCenter;
+
+	//	counts are stored as numbers, so that all arrays can be reduced alike
+		std::vector<number> m_count;
+		std::vector<number> m_numBelow;
+		std::vector<number> m_sum;
+		std::vector<number> m_min;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeQualitySpatialMap
+///	creates an empty map of a quality measure over the bounding box of a level (collective)
+/**	measure is "min_angle" (min angles of faces for dim 2, min dihedrals of volumes for
+ *	dim 3) or "aspect_ratio". The box is the bounding box of all vertices of the level
+ *	on all processes. It is divided into 'resolution' cells along its longest side and
+ *	into cells of about the same size along the other sides.
+ *
+ *	The map is filled by ComputeQualityReport(mg, dim, lvl, map) in the same pass as
+ *	the statistics.*/
+SmartPtr<QualitySpatialMap>
+CreateQualitySpatialMap(MultiGrid& mg, int dim, int lvl, const char* measure,
+						number threshold, int resolution);
+
+SmartPtr<QualitySpatialMap>
+CreateQualitySpatialMap(Grid& grid, int dim, const char* measure,
+						number threshold, int resolution);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeQualitySpatialMap
+///	bins a quality measure of the elements of a level into a map over the bounding box
+/**	Creates the map by CreateQualitySpatialMap and evaluates only the measure of the
+ *	map by the kernels of the statistics. In parallel ghosts and horizontal slaves
+ *	are skipped and the map is reduced over all processes. If the statistics are
+ *	needed, too, use ComputeQualityReport(mg, dim, lvl, map) instead, which evaluates
+ *	the elements only once.*/
+SmartPtr<QualitySpatialMap>
+ComputeQualitySpatialMap(MultiGrid& mg, int dim, int lvl, const char* measure,
+						 number threshold, int resolution);
+
+SmartPtr<QualitySpatialMap>
+ComputeQualitySpatialMap(Grid& grid, int dim, const char* measure,
+						 number threshold, int resolution);
+
+}
+#endif  //__QUALITY_SPATIAL_MAP_H__
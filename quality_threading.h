@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __QUALITY_THREADING_H__
+#define __QUALITY_THREADING_H__
+
+/* system includes */
+#include <stddef.h>
+#include <vector>
+#include <thread>
+#include <exception>
+
+#include "common/types.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Thread count of the quality evaluations
+///	sets the number of threads used per process by the quality statistics and subset measures
+/**	0 selects the number of hardware threads, 1 (default) evaluates serially.*/
+void SetQualityStatisticsNumThreads(int numThreads);
+
+///	returns the number of threads used per process (always >= 1)
+size_t GetQualityStatisticsNumThreads();
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	NumQualityThreadsFor
+///	returns the number of threads worth starting for the given number of elements
+/**	Every thread gets at least minChunkSize elements, so that small levels are
+ *	evaluated serially.*/
+inline size_t NumQualityThreadsFor(size_t numElems, size_t minChunkSize = 4096)
+{
+	size_t numThreads = GetQualityStatisticsNumThreads();
+	size_t maxThreads = numElems / minChunkSize;
+	if(maxThreads < numThreads)
+		numThreads = maxThreads;
+	if(numThreads < 1)
+		numThreads = 1;
+	return numThreads;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	CollectElementPointers
+///	copies the elements of an iterator range to a vector, so that it can be split into chunks
+template <class TElem, class TIterator>
+void CollectElementPointers(std::vector<TElem*>& elemsOut, TIterator begin, TIterator end,
+							size_t numElems = 0)
+{
+	elemsOut.clear();
+	elemsOut.reserve(numElems);
+	for(TIterator iter = begin; iter != end; ++iter)
+		elemsOut.push_back(*iter);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ParallelForChunks
+///	splits [0, num) into numThreads contiguous chunks and calls func(thread, from, to) for each
+/**	The chunk of thread 0 is processed by the calling thread. The partition only
+ *	depends on num and numThreads, so that merging per-thread results in thread
+ *	order gives deterministic results. An exception thrown in any chunk is rethrown
+ *	in the calling thread after all threads have finished. If a thread cannot be
+ *	started, the threads started so far are joined before the error is rethrown.*/
+template <class TFunc>
+void ParallelForChunks(size_t num, size_t numThreads, TFunc func)
+{
+	if(numThreads <= 1 || num < 2)
+	{
+		func(0, 0, num);
+		return;
+	}
+
+	if(numThreads > num)
+		numThreads = num;
+
+	std::vector<std::thread> threads;
+	std::vector<std::exception_ptr> exceptions(numThreads);
+
+//	if starting a thread fails, the threads started so far have to be joined
+//	before the exception leaves this function, since destroying a joinable
+//	std::thread calls std::terminate.
+	try{
+		threads.reserve(numThreads - 1);
+		for(size_t t = 1; t < numThreads; ++t)
+		{
+			size_t from = num * t / numThreads;
+			size_t to = num * (t+1) / numThreads;
+			threads.push_back(std::thread([&func, &exceptions, t, from, to]()
+			{
+				try{
+					func(t, from, to);
+				}
+				catch(...){
+					exceptions[t] = std::current_exception();
+				}
+			}));
+		}
+	}
+	catch(...){
+		for(size_t t = 0; t < threads.size(); ++t)
+			threads[t].join();
+		throw;
+	}
+
+	try{
+		func(0, 0, num / numThreads);
+	}
+	catch(...){
+		exceptions[0] = std::current_exception();
+	}
+
+	for(size_t t = 0; t < threads.size(); ++t)
+		threads[t].join();
+
+	for(size_t t = 0; t < numThreads; ++t)
+		if(exceptions[t])
+			std::rethrow_exception(exceptions[t]);
+}
+
+
+}
+#endif  //__QUALITY_THREADING_H__
@@ -0,0 +1,1147 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "quality_ugx_stream.h"
+#include "quality_snapshot_kernels.h"
+#include "quality_threading.h"
+#include "tet_kernels.h"
+#include "lib_grid/algorithms/element_angles.h"
+#include "lib_grid/algorithms/element_aspect_ratios.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	UGXStreamReader
+////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string UGXStreamReader::Tag::
+attribute(const char* attribName) const
+{
+	string key = string(attribName) + "=\"";
+	size_t pos = 0;
+	while((pos = attribs.find(key, pos)) != string::npos)
+	{
+	//	make sure that we didn't find the end of another attribute name
+		if(pos == 0 || isspace(attribs[pos - 1]))
+		{
+			size_t start = pos + key.size();
+			size_t end = attribs.find('"', start);
+			if(end == string::npos)
+				return string();
+			return attribs.substr(start, end - start);
+		}
+		pos += key.size();
+	}
+	return string();
+}
+
+
+UGXStreamReader::
+UGXStreamReader(const char* filename, size_t bufferSize) :
+	m_filename(filename),
+	m_buf(std::max<size_t>(bufferSize, 1)),
+	m_bufOffset(0),
+	m_pos(0),
+	m_end(0)
+{
+	m_in.open(filename, ios::binary);
+	UG_COND_THROW(!m_in, "UGXStreamReader: Couldn't open file " << filename);
+}
+
+
+bool UGXStreamReader::
+fill()
+{
+	m_bufOffset += m_end;
+	m_in.read(&m_buf.front(), m_buf.size());
+	m_pos = 0;
+	m_end = m_in.gcount();
+	return m_end > 0;
+}
+
+
+void UGXStreamReader::
+skip_until(const char* endSeq)
+{
+	const size_t len = strlen(endSeq);
+	string window;
+	int c;
+	while((c = get()) != -1)
+	{
+		window += (char)c;
+		if(window.size() > len)
+			window.erase(0, 1);
+		if(window == endSeq)
+			return;
+	}
+	UG_THROW("UGXStreamReader: Unexpected end of file " << m_filename
+			 << " (missing '" << endSeq << "').");
+}
+
+
+bool UGXStreamReader::
+next_tag(Tag& tagOut)
+{
+	while(true)
+	{
+		int c;
+		do{
+			c = get();
+		}while(c != -1 && c != '<');
+
+		if(c == -1)
+			return false;
+
+		tagOut.begin = position() - 1;
+
+	//	declarations and comments
+		c = peek();
+		if(c == '?'){
+			skip_until("?>");
+			continue;
+		}
+		if(c == '!'){
+			get();
+			if(peek() == '-')
+				skip_until("-->");
+			else
+				skip_until(">");
+			continue;
+		}
+
+		tagOut.type = TAG_OPEN;
+		if(c == '/'){
+			get();
+			tagOut.type = TAG_CLOSE;
+		}
+
+		tagOut.name.clear();
+		tagOut.attribs.clear();
+		while((c = peek()) != -1 && !isspace(c) && c != '>' && c != '/'){
+			tagOut.name += (char)c;
+			++m_pos;
+		}
+
+		while((c = get()) != -1 && c != '>')
+			tagOut.attribs += (char)c;
+
+		UG_COND_THROW(c == -1, "UGXStreamReader: Unterminated tag '" << tagOut.name
+					  << "' in file " << m_filename);
+		tagOut.end = position();
+
+		if(!tagOut.attribs.empty() && tagOut.attribs[tagOut.attribs.size() - 1] == '/'){
+			tagOut.type = TAG_EMPTY;
+			tagOut.attribs.resize(tagOut.attribs.size() - 1);
+		}
+		return true;
+	}
+}
+
+
+void UGXStreamReader::
+skip_element(const Tag& openTag)
+{
+	if(openTag.type != TAG_OPEN)
+		return;
+
+	Tag tag;
+	int depth = 1;
+	while(next_tag(tag))
+	{
+		if(tag.type == TAG_OPEN)
+			++depth;
+		else if(tag.type == TAG_CLOSE && --depth == 0)
+			return;
+	}
+	UG_THROW("UGXStreamReader: Unexpected end of file " << m_filename
+			 << " in element '" << openTag.name << "'.");
+}
+
+
+bool UGXStreamReader::
+read_token(std::string& tokenOut)
+{
+	int c;
+	while((c = peek()) != -1 && isspace(c))
+		++m_pos;
+
+	if(c == -1 || c == '<')
+		return false;
+
+	tokenOut.clear();
+	while(c != -1 && !isspace(c) && c != '<'){
+		tokenOut += (char)c;
+		++m_pos;
+		c = peek();
+	}
+	return true;
+}
+
+
+static inline bool ParseUGXValue(const char* str, number& valOut)
+{
+	char* end;
+	valOut = strtod(str, &end);
+	return *end == 0 && end != str;
+}
+
+static inline bool ParseUGXValue(const char* str, int& valOut)
+{
+	char* end;
+	valOut = (int)strtol(str, &end, 10);
+	return *end == 0 && end != str;
+}
+
+
+template <class TValue>
+size_t UGXStreamReader::
+read_values_impl(TValue* valsOut, size_t maxNum)
+{
+	size_t num = 0;
+	while(num < maxNum && read_token(m_token))
+	{
+		UG_COND_THROW(!ParseUGXValue(m_token.c_str(), valsOut[num]),
+					  "UGXStreamReader: Invalid value '" << m_token << "' in file " << m_filename);
+		++num;
+	}
+	return num;
+}
+
+size_t UGXStreamReader::
+read_values(number* valsOut, size_t maxNum)
+{
+	return read_values_impl(valsOut, maxNum);
+}
+
+size_t UGXStreamReader::
+read_values(int* valsOut, size_t maxNum)
+{
+	return read_values_impl(valsOut, maxNum);
+}
+
+
+size_t UGXStreamReader::
+skip_values(size_t num)
+{
+	size_t numSkipped = 0;
+	int c;
+	while(numSkipped < num)
+	{
+		while((c = peek()) != -1 && isspace(c))
+			++m_pos;
+		if(c == -1 || c == '<')
+			break;
+		skip_value_chars();
+		++numSkipped;
+	}
+	return numSkipped;
+}
+
+
+size_t UGXStreamReader::
+count_values(size_t end)
+{
+	size_t num = 0;
+	int c;
+	while(true)
+	{
+		while((c = peek()) != -1 && isspace(c))
+			++m_pos;
+		if(c == -1 || c == '<' || position() >= end)
+			return num;
+		skip_value_chars();
+		++num;
+	}
+}
+
+
+size_t UGXStreamReader::
+file_size()
+{
+	const size_t pos = position();
+	m_in.clear();
+	m_in.seekg(0, ios::end);
+	const size_t size = (size_t)m_in.tellg();
+	seek(pos);
+	return size;
+}
+
+
+void UGXStreamReader::
+seek(size_t offset)
+{
+	m_in.clear();
+	m_in.seekg(offset);
+	UG_COND_THROW(!m_in, "UGXStreamReader: Couldn't seek to offset " << offset
+				  << " in file " << m_filename);
+	m_bufOffset = offset;
+	m_pos = 0;
+	m_end = 0;
+}
+
+
+void UGXStreamReader::
+seek_values(size_t textBegin, size_t offset)
+{
+	if(offset <= textBegin){
+		seek(textBegin);
+		return;
+	}
+
+//	a value which started in front of offset belongs to the preceding range
+	seek(offset - 1);
+	int c = get();
+	if(c != -1 && !isspace(c))
+		skip_value_chars();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Streaming evaluation
+////////////////////////////////////////////////////////////////////////////////////////////
+
+///	element lists of a .ugx file which are evaluated
+struct UGXElementType
+{
+	const char* tagName;
+	ReferenceObjectID roid;
+	size_t numCorners;
+};
+
+static const UGXElementType ugxElementTypes[] = {
+	{"edges", ROID_EDGE, 2},
+	{"triangles", ROID_TRIANGLE, 3},
+	{"quadrilaterals", ROID_QUADRILATERAL, 4},
+	{"tetrahedrons", ROID_TETRAHEDRON, 4},
+	{"hexahedrons", ROID_HEXAHEDRON, 8},
+	{"prisms", ROID_PRISM, 6},
+	{"pyramids", ROID_PYRAMID, 5},
+	{"octahedrons", ROID_OCTAHEDRON, 6}
+};
+
+static const UGXElementType* FindUGXElementType(const string& tagName)
+{
+	for(size_t i = 0; i < sizeof(ugxElementTypes) / sizeof(ugxElementTypes[0]); ++i)
+		if(tagName == ugxElementTypes[i].tagName)
+			return &ugxElementTypes[i];
+	return NULL;
+}
+
+
+static inline void SetStreamPosition(vector3& posOut, number x, number y, number z)
+{
+	posOut = vector3(x, y, z);
+}
+
+static inline void SetStreamPosition(vector2& posOut, number x, number y, number)
+{
+	posOut = vector2(x, y);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	UGXChunkEvaluator
+///	evaluates chunks of elements given by vertex indices into the packed coordinates
+/**	Edges, triangles, tetrahedra, prisms and pyramids are evaluated by their coordinate
+ *	kernels. Elements without a coordinate kernel (quadrilaterals, hexahedra and
+ *	octahedra) are created in a temporary grid, which is cleared for every chunk.*/
+template <class TAPos>
+class UGXChunkEvaluator
+{
+	public:
+		UGXChunkEvaluator(ElementQualityData& data, TAPos& aPos,
+						  const vector<number>& x, const vector<number>& y,
+						  const vector<number>& z) :
+			m_data(data), m_aPos(aPos), m_x(x), m_y(y), m_z(z),
+			m_grid(GRIDOPT_STANDARD_INTERCONNECTION | GRIDOPT_AUTOGENERATE_SIDES)
+		{
+			m_grid.attach_to_vertices(m_aPos);
+			m_aaPos.access(m_grid, m_aPos);
+		}
+
+		void evaluate(ReferenceObjectID roid, const int* corners, size_t num, size_t numCorners)
+		{
+			const number* x = &m_x.front();
+			const number* y = &m_y.front();
+			const number* z = &m_z.front();
+
+			switch(roid)
+			{
+				case ROID_EDGE:
+					AccumulateElementQualityInChunks(m_data, num, NumQualityThreadsFor(num),
+						[&](ElementQualityData& d, size_t from, size_t to)
+						{
+							for(size_t i = from; i < to; ++i)
+								d.add_edge(SnapshotEdgeLength(x, y, z, corners + 2 * i));
+						});
+					break;
+
+				case ROID_TRIANGLE:
+					AccumulateElementQualityInChunks(m_data, num, NumQualityThreadsFor(num),
+						[&](ElementQualityData& d, size_t from, size_t to)
+						{
+							TriangleQuality q;
+							for(size_t i = from; i < to; ++i)
+							{
+								SnapshotTriangleQuality(q, x, y, z, corners + 3 * i);
+								d.add_face(ROID_TRIANGLE, q.area, q.angles, 3, q.aspectRatio);
+							}
+						});
+					break;
+
+				case ROID_TETRAHEDRON:
+					AccumulateElementQualityInChunks(m_data, num, NumQualityThreadsFor(num),
+						[&](ElementQualityData& d, size_t from, size_t to)
+						{
+							const size_t batchSize = 512;
+							TetKernelResults res;
+							for(size_t i = from; i < to; i += batchSize)
+							{
+								res.evaluate_selected(x, y, z, corners + 4 * i, std::min(batchSize, to - i),
+													  d.metrics);
+								d.add_tetrahedra(res);
+							}
+						});
+					break;
+
+				case ROID_PRISM:
+					AccumulateElementQualityInChunks(m_data, num, NumQualityThreadsFor(num),
+						[&](ElementQualityData& d, size_t from, size_t to)
+						{
+							PrismQuality q;
+							for(size_t i = from; i < to; ++i)
+							{
+								SnapshotPrismQuality(q, x, y, z, corners + 6 * i, d.metrics);
+								d.add_prism(q);
+							}
+						});
+					break;
+
+				case ROID_PYRAMID:
+					AccumulateElementQualityInChunks(m_data, num, NumQualityThreadsFor(num),
+						[&](ElementQualityData& d, size_t from, size_t to)
+						{
+							PyramidQuality q;
+							for(size_t i = from; i < to; ++i)
+							{
+								SnapshotPyramidQuality(q, x, y, z, corners + 5 * i, d.metrics);
+								d.add_pyramid(q);
+							}
+						});
+					break;
+
+				default:
+					evaluate_in_grid(roid, corners, num, numCorners);
+					break;
+			}
+		}
+
+	private:
+		void evaluate_in_grid(ReferenceObjectID roid, const int* corners,
+							  size_t num, size_t numCorners)
+		{
+		//	create the vertices referenced by the chunk
+			m_inds.assign(corners, corners + num * numCorners);
+			sort(m_inds.begin(), m_inds.end());
+			m_inds.erase(unique(m_inds.begin(), m_inds.end()), m_inds.end());
+
+			m_grid.clear_geometry();
+			m_vrts.resize(m_inds.size());
+			for(size_t i = 0; i < m_inds.size(); ++i)
+			{
+				Vertex* vrt = *m_grid.template create<RegularVertex>();
+				int ind = m_inds[i];
+				SetStreamPosition(m_aaPos[vrt], m_x[ind], m_y[ind], m_z[ind]);
+				m_vrts[i] = vrt;
+			}
+
+			Vertex* v[8];
+			for(size_t i = 0; i < num; ++i)
+			{
+				const int* c = corners + i * numCorners;
+				for(size_t k = 0; k < numCorners; ++k)
+					v[k] = m_vrts[lower_bound(m_inds.begin(), m_inds.end(), c[k]) - m_inds.begin()];
+
+				switch(roid)
+				{
+					case ROID_QUADRILATERAL:
+						AddFaceQuality(m_data, m_grid, *m_grid.template create<Quadrilateral>(
+										QuadrilateralDescriptor(v[0], v[1], v[2], v[3])),
+									   ROID_QUADRILATERAL, m_aaPos, m_vAngles);
+						break;
+					case ROID_HEXAHEDRON:
+						AddVolumeQuality(m_data, m_grid, *m_grid.template create<Hexahedron>(
+										HexahedronDescriptor(v[0], v[1], v[2], v[3],
+															 v[4], v[5], v[6], v[7])),
+										 ROID_HEXAHEDRON, m_aaPos, m_vAngles);
+						break;
+					case ROID_OCTAHEDRON:
+						AddVolumeQuality(m_data, m_grid, *m_grid.template create<Octahedron>(
+										OctahedronDescriptor(v[0], v[1], v[2], v[3], v[4], v[5])),
+										 ROID_OCTAHEDRON, m_aaPos, m_vAngles);
+						break;
+					default:
+						UG_THROW("UGXChunkEvaluator: Unsupported element type " << roid);
+				}
+			}
+		}
+
+	private:
+		ElementQualityData&				m_data;
+		TAPos&							m_aPos;
+		const vector<number>&			m_x;
+		const vector<number>&			m_y;
+		const vector<number>&			m_z;
+
+		Grid							m_grid;
+		Grid::VertexAttachmentAccessor<TAPos>	m_aaPos;
+		vector<int>						m_inds;
+		vector<Vertex*>					m_vrts;
+		vector<number>					m_vAngles;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Distributed reading of .ugx files
+///	codes of the tags exchanged between the processes
+/**	Element lists are coded by ugxTagElemTypes + the index in ugxElementTypes.*/
+enum UGXTagCode
+{
+	UGX_TAG_OTHER = 0,
+	UGX_TAG_CONSTRAINED,
+	UGX_TAG_GRID,
+	UGX_TAG_VERTICES,
+	UGX_TAG_ELEM_TYPES
+};
+
+///	a tag is exchanged as code, type, begin, end and number of coordinates
+static const size_t ugxTagRecordSize = 5;
+
+static int GetUGXTagCode(const string& tagName)
+{
+	if(tagName == "grid")
+		return UGX_TAG_GRID;
+	if(tagName == "vertices")
+		return UGX_TAG_VERTICES;
+	if(tagName.compare(0, 11, "constrained") == 0 || tagName.compare(0, 12, "constraining") == 0)
+		return UGX_TAG_CONSTRAINED;
+	const UGXElementType* type = FindUGXElementType(tagName);
+	if(type)
+		return UGX_TAG_ELEM_TYPES + (int)(type - ugxElementTypes);
+	return UGX_TAG_OTHER;
+}
+
+
+///	text of the grid of a .ugx file, which holds vertex coordinates or element corners
+struct UGXTextSection
+{
+	const UGXElementType* type;	///< NULL for vertex coordinates
+	size_t valsPerEntry;		///< coordinates per vertex or corners per element
+	size_t begin;				///< byte offset of the text
+	size_t end;					///< byte offset of the closing tag
+};
+
+
+///	collects the tags of the file on all processes
+/**	Every process scans the tags which start in its byte range of the file. The tags
+ *	are gathered on all processes in the order of the file.*/
+static void CollectUGXTags(vector<number>& tagsOut, UGXStreamReader& in,
+						   int procRank, int numProcs)
+{
+	const size_t fileSize = in.file_size();
+	const size_t rangeBegin = (size_t)((unsigned long long)fileSize * procRank / numProcs);
+	const size_t rangeEnd = (size_t)((unsigned long long)fileSize * (procRank + 1) / numProcs);
+
+	vector<number> locTags;
+	UGXStreamReader::Tag tag;
+	in.seek(rangeBegin);
+	while(in.next_tag(tag) && tag.begin < rangeEnd)
+	{
+		const int code = GetUGXTagCode(tag.name);
+		locTags.push_back(code);
+		locTags.push_back(tag.type);
+		locTags.push_back(tag.begin);
+		locTags.push_back(tag.end);
+		locTags.push_back(code == UGX_TAG_VERTICES ? atoi(tag.attribute("coords").c_str()) : 0);
+	}
+
+	#ifdef UG_PARALLEL
+		if(numProcs > 1){
+			pcl::ProcessCommunicator pc;
+			pc.allgatherv(tagsOut, locTags);
+			return;
+		}
+	#endif
+
+	tagsOut.swap(locTags);
+}
+
+
+///	finds the texts of the vertex coordinates and of the evaluated element lists
+static void FindUGXTextSections(vector<UGXTextSection>& sectionsOut, const vector<number>& tags,
+								int dim, const char* filename)
+{
+	const size_t numTags = tags.size() / ugxTagRecordSize;
+	auto tagCode = [&](size_t i) {return (int)tags[i * ugxTagRecordSize];};
+	auto tagType = [&](size_t i) {return (int)tags[i * ugxTagRecordSize + 1];};
+
+//	the grid is the root element of a .ugx file
+	size_t i = 0;
+	while(i < numTags && (tagCode(i) != UGX_TAG_GRID || tagType(i) != UGXStreamReader::TAG_OPEN))
+		++i;
+	UG_COND_THROW(i == numTags, "EvaluateUGXFile: No grid found in file " << filename);
+
+	int depth = 0;
+	for(++i; i < numTags; ++i)
+	{
+		const int code = tagCode(i);
+		const int type = tagType(i);
+
+	//	elements nested in other elements of the grid, e.g. in subset handlers
+		if(depth > 0){
+			if(type == UGXStreamReader::TAG_OPEN)
+				++depth;
+			else if(type == UGXStreamReader::TAG_CLOSE)
+				--depth;
+			continue;
+		}
+
+		if(type == UGXStreamReader::TAG_CLOSE)
+		{
+			UG_COND_THROW(code != UGX_TAG_GRID, "EvaluateUGXFile: Unexpected closing tag in file "
+						  << filename);
+			return;
+		}
+
+		if(type == UGXStreamReader::TAG_EMPTY)
+			continue;
+
+		UG_COND_THROW(code == UGX_TAG_CONSTRAINED,
+					  "EvaluateUGXFile: Constrained elements are not supported by the "
+					  "streaming evaluation.");
+
+		UGXTextSection sec;
+		sec.type = NULL;
+		if(code == UGX_TAG_VERTICES){
+			sec.valsPerEntry = (size_t)tags[i * ugxTagRecordSize + 4];
+			UG_COND_THROW(sec.valsPerEntry < 1 || sec.valsPerEntry > 3,
+						  "EvaluateUGXFile: Invalid number of coordinates in file " << filename);
+		}
+		else if(code >= UGX_TAG_ELEM_TYPES
+				&& !(dim == 2 && ugxElementTypes[code - UGX_TAG_ELEM_TYPES].roid >= ROID_TETRAHEDRON))
+		{
+			sec.type = &ugxElementTypes[code - UGX_TAG_ELEM_TYPES];
+			sec.valsPerEntry = sec.type->numCorners;
+		}
+		else{
+			++depth;
+			continue;
+		}
+
+		UG_COND_THROW(i + 1 == numTags || tagCode(i + 1) != code
+					  || tagType(i + 1) != UGXStreamReader::TAG_CLOSE,
+					  "EvaluateUGXFile: Missing closing tag of '"
+					  << (sec.type ? sec.type->tagName : "vertices") << "' in file " << filename);
+
+		sec.begin = (size_t)tags[i * ugxTagRecordSize + 3];
+		sec.end = (size_t)tags[(i + 1) * ugxTagRecordSize + 2];
+		sectionsOut.push_back(sec);
+		++i;
+	}
+
+	UG_THROW("EvaluateUGXFile: Unexpected end of file " << filename);
+}
+
+
+///	distribution of the entries of the text sections over the processes
+/**	A process reads the entries (vertices or elements) whose first value starts in
+ *	its byte range of a section. The values of each section are counted by all
+ *	processes in their ranges and gathered, so that every process knows the first
+ *	entry of every process in every section.*/
+class UGXSectionLayout
+{
+	public:
+		UGXSectionLayout(const vector<UGXTextSection>& sections, UGXStreamReader& in,
+						 int procRank, int numProcs, const char* filename) :
+			m_numProcs(numProcs),
+			m_firstEntries(sections.size() * (numProcs + 1), 0)
+		{
+			const size_t numSecs = sections.size();
+			vector<unsigned long long> locCounts(numSecs, 0);
+			for(size_t i = 0; i < numSecs; ++i)
+			{
+				in.seek_values(sections[i].begin, range_begin(sections[i], procRank));
+				locCounts[i] = in.count_values(range_begin(sections[i], procRank + 1));
+			}
+
+			vector<unsigned long long> counts(numSecs * numProcs, 0);
+			#ifdef UG_PARALLEL
+				if(numProcs > 1 && numSecs > 0){
+					pcl::ProcessCommunicator pc;
+					pc.allgather(&locCounts.front(), (int)numSecs, PCL_DT_UNSIGNED_LONG_LONG,
+								 &counts.front(), (int)numSecs, PCL_DT_UNSIGNED_LONG_LONG);
+				}
+				else
+					counts = locCounts;
+			#else
+				counts = locCounts;
+			#endif
+
+			m_firstValues.resize(numSecs * (numProcs + 1), 0);
+			for(size_t i = 0; i < numSecs; ++i)
+			{
+				const size_t valsPerEntry = sections[i].valsPerEntry;
+				unsigned long long numVals = 0;
+				for(int p = 0; p <= numProcs; ++p)
+				{
+					m_firstValues[i * (numProcs + 1) + p] = numVals;
+					m_firstEntries[i * (numProcs + 1) + p] = (numVals + valsPerEntry - 1) / valsPerEntry;
+					if(p < numProcs)
+						numVals += counts[p * numSecs + i];
+				}
+
+				UG_COND_THROW(numVals % valsPerEntry != 0, "EvaluateUGXFile: Incomplete list of '"
+							  << (sections[i].type ? sections[i].type->tagName : "vertices")
+							  << "' in file " << filename);
+			}
+		}
+
+	///	byte offset at which the range of the given process starts in the section
+		size_t range_begin(const UGXTextSection& sec, int proc) const
+		{
+			return sec.begin + (size_t)((unsigned long long)(sec.end - sec.begin) * proc / m_numProcs);
+		}
+
+	///	index of the first entry of the given process in section i
+		size_t first_entry(size_t i, int proc) const
+		{
+			return m_firstEntries[i * (m_numProcs + 1) + proc];
+		}
+
+	///	number of entries of the given process in section i
+		size_t num_entries(size_t i, int proc) const
+		{
+			return first_entry(i, proc + 1) - first_entry(i, proc);
+		}
+
+	///	number of entries in section i
+		size_t num_entries(size_t i) const
+		{
+			return first_entry(i, m_numProcs);
+		}
+
+	///	positions the reader at the first value of the first entry of the process in section i
+		void seek_entries(UGXStreamReader& in, const UGXTextSection& sec, size_t i, int proc) const
+		{
+			in.seek_values(sec.begin, range_begin(sec, proc));
+			const size_t numSkip = first_entry(i, proc) * sec.valsPerEntry
+								   - m_firstValues[i * (m_numProcs + 1) + proc];
+			in.skip_values(numSkip);
+		}
+
+	private:
+		int								m_numProcs;
+		vector<size_t>					m_firstEntries;
+		vector<unsigned long long>		m_firstValues;
+};
+
+
+///	vertex coordinates of a .ugx file, distributed over the processes
+/**	Each process holds the coordinates of the vertices it read (see UGXSectionLayout).
+ *	fetch returns the coordinates of arbitrary vertices by requesting them from the
+ *	processes holding them.*/
+class UGXVertexCoordinates
+{
+	public:
+		UGXVertexCoordinates(const vector<UGXTextSection>& sections,
+							 const UGXSectionLayout& layout, UGXStreamReader& in,
+							 int dim, size_t chunkSize, int procRank, int numProcs,
+							 const char* filename) :
+			m_numProcs(numProcs),
+			m_numVertices(0)
+		{
+		//	the vertex lists are numbered consecutively
+			for(size_t i = 0; i < sections.size(); ++i)
+			{
+				if(sections[i].type)
+					continue;
+				m_secs.push_back(i);
+				m_secBegins.push_back(m_numVertices);
+				m_numVertices += layout.num_entries(i);
+				for(int p = 0; p <= numProcs; ++p)
+					m_firstEntries.push_back(layout.first_entry(i, p));
+			}
+			m_secBegins.push_back(m_numVertices);
+
+		//	z is 0 for 2d evaluations, as for the 2d positions of a QualityGeometrySnapshot
+			vector<number> coords;
+			for(size_t j = 0; j < m_secs.size(); ++j)
+			{
+				const UGXTextSection& sec = sections[m_secs[j]];
+				const size_t numCoords = sec.valsPerEntry;
+				size_t numLeft = layout.num_entries(m_secs[j], procRank);
+				layout.seek_entries(in, sec, m_secs[j], procRank);
+
+				coords.resize(std::min(numLeft, chunkSize) * numCoords);
+				while(numLeft > 0)
+				{
+					const size_t num = std::min(numLeft, chunkSize);
+					UG_COND_THROW(in.read_values(&coords.front(), num * numCoords) != num * numCoords,
+								  "EvaluateUGXFile: Incomplete vertex coordinates in file " << filename);
+					for(size_t i = 0; i < num * numCoords; i += numCoords)
+					{
+						m_x.push_back(coords[i]);
+						m_y.push_back(numCoords > 1 ? coords[i + 1] : 0);
+						m_z.push_back((numCoords > 2 && dim == 3) ? coords[i + 2] : 0);
+					}
+					numLeft -= num;
+				}
+			}
+		}
+
+		size_t num_vertices() const		{return m_numVertices;}
+		size_t num_local_vertices() const	{return m_x.size();}
+
+	///	writes the coordinates of the given vertices to x, y and z
+	/**	This method is collective, i.e. it has to be called by all processes the
+	 *	same number of times.*/
+		void fetch(vector<number>& xOut, vector<number>& yOut, vector<number>& zOut,
+				   const vector<int>& inds)
+		{
+			xOut.resize(inds.size());
+			yOut.resize(inds.size());
+			zOut.resize(inds.size());
+
+			#ifdef UG_PARALLEL
+				if(m_numProcs > 1){
+					fetch_parallel(xOut, yOut, zOut, inds);
+					return;
+				}
+			#endif
+
+			for(size_t i = 0; i < inds.size(); ++i)
+			{
+				int proc;
+				size_t locInd;
+				locate(proc, locInd, inds[i]);
+				xOut[i] = m_x[locInd];
+				yOut[i] = m_y[locInd];
+				zOut[i] = m_z[locInd];
+			}
+		}
+
+	private:
+	///	returns the process holding the vertex and its index on this process
+		void locate(int& procOut, size_t& locIndOut, size_t vrt) const
+		{
+			const size_t j = upper_bound(m_secBegins.begin(), m_secBegins.end(), vrt)
+							 - m_secBegins.begin() - 1;
+			const size_t* first = &m_firstEntries[j * (m_numProcs + 1)];
+			const size_t entry = vrt - m_secBegins[j];
+			procOut = (int)(upper_bound(first, first + m_numProcs + 1, entry) - first) - 1;
+
+			locIndOut = entry - first[procOut];
+			for(size_t k = 0; k < j; ++k)
+			{
+				const size_t* f = &m_firstEntries[k * (m_numProcs + 1)];
+				locIndOut += f[procOut + 1] - f[procOut];
+			}
+		}
+
+		#ifdef UG_PARALLEL
+		void fetch_parallel(vector<number>& xOut, vector<number>& yOut, vector<number>& zOut,
+							const vector<int>& inds)
+		{
+			pcl::ProcessCommunicator pc;
+			MPI_Comm comm = pc.get_mpi_communicator();
+
+		//	sort the requests by the processes holding the vertices
+			vector<int> procs(inds.size());
+			vector<unsigned long long> locInds(inds.size());
+			vector<int> sendCounts(m_numProcs, 0);
+			for(size_t i = 0; i < inds.size(); ++i)
+			{
+				size_t locInd;
+				locate(procs[i], locInd, inds[i]);
+				locInds[i] = locInd;
+				++sendCounts[procs[i]];
+			}
+
+			vector<int> sendOffsets(m_numProcs, 0);
+			for(int p = 1; p < m_numProcs; ++p)
+				sendOffsets[p] = sendOffsets[p - 1] + sendCounts[p - 1];
+
+			vector<int> reqPos(inds.size());
+			vector<unsigned long long> sendReqs(inds.size());
+			{
+				vector<int> fill(sendOffsets);
+				for(size_t i = 0; i < inds.size(); ++i)
+				{
+					const int pos = fill[procs[i]]++;
+					sendReqs[pos] = locInds[i];
+					reqPos[pos] = (int)i;
+				}
+			}
+
+			vector<int> recvCounts(m_numProcs);
+			MPI_Alltoall(&sendCounts.front(), 1, MPI_INT, &recvCounts.front(), 1, MPI_INT, comm);
+
+			vector<int> recvOffsets(m_numProcs, 0);
+			for(int p = 1; p < m_numProcs; ++p)
+				recvOffsets[p] = recvOffsets[p - 1] + recvCounts[p - 1];
+			const size_t numRecv = recvOffsets.back() + recvCounts.back();
+
+			vector<unsigned long long> recvReqs(std::max<size_t>(numRecv, 1));
+			MPI_Alltoallv(sendReqs.empty() ? NULL : &sendReqs.front(), &sendCounts.front(),
+						  &sendOffsets.front(), MPI_UNSIGNED_LONG_LONG, &recvReqs.front(),
+						  &recvCounts.front(), &recvOffsets.front(), MPI_UNSIGNED_LONG_LONG, comm);
+
+		//	answer with 3 coordinates per requested vertex
+			vector<number> answers(std::max<size_t>(3 * numRecv, 1));
+			for(size_t i = 0; i < numRecv; ++i)
+			{
+				const size_t locInd = (size_t)recvReqs[i];
+				answers[3 * i] = m_x[locInd];
+				answers[3 * i + 1] = m_y[locInd];
+				answers[3 * i + 2] = m_z[locInd];
+			}
+
+			const int entrySize = 3 * (int)sizeof(number);
+			for(int p = 0; p < m_numProcs; ++p)
+			{
+				sendCounts[p] *= entrySize;
+				sendOffsets[p] *= entrySize;
+				recvCounts[p] *= entrySize;
+				recvOffsets[p] *= entrySize;
+			}
+
+			vector<number> coords(std::max<size_t>(3 * inds.size(), 1));
+			MPI_Alltoallv(&answers.front(), &recvCounts.front(), &recvOffsets.front(), MPI_BYTE,
+						  &coords.front(), &sendCounts.front(), &sendOffsets.front(), MPI_BYTE, comm);
+
+			for(size_t i = 0; i < inds.size(); ++i)
+			{
+				const int pos = reqPos[i];
+				xOut[pos] = coords[3 * i];
+				yOut[pos] = coords[3 * i + 1];
+				zOut[pos] = coords[3 * i + 2];
+			}
+		}
+		#endif
+
+	private:
+		int					m_numProcs;
+		size_t				m_numVertices;
+		vector<size_t>		m_secs;			///< indices of the vertex sections
+		vector<size_t>		m_secBegins;	///< index of the first vertex of each vertex section
+		vector<size_t>		m_firstEntries;	///< first entry of each process in each vertex section
+		vector<number>		m_x;
+		vector<number>		m_y;
+		vector<number>		m_z;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	EvaluateUGXFile
+///	streams the elements of the grid of a .ugx file into data
+/**	Collective: every process evaluates the vertices and elements of its byte range
+ *	of the file (see ComputeQualityReportFromFile).*/
+template <class TAPos>
+static void EvaluateUGXFile(ElementQualityData& data, const char* filename, int dim,
+							size_t chunkSize, TAPos& aPos)
+{
+	UG_COND_THROW(chunkSize == 0, "EvaluateUGXFile: chunkSize has to be positive.");
+
+	int procRank = 0;
+	int numProcs = 1;
+	#ifdef UG_PARALLEL
+		procRank = pcl::ProcRank();
+		numProcs = pcl::NumProcs();
+	#endif
+
+	UGXStreamReader in(filename);
+
+	vector<UGXTextSection> sections;
+	{
+		vector<number> tags;
+		CollectUGXTags(tags, in, procRank, numProcs);
+		FindUGXTextSections(sections, tags, dim, filename);
+	}
+
+	UGXSectionLayout layout(sections, in, procRank, numProcs, filename);
+	UGXVertexCoordinates vrtCoords(sections, layout, in, dim, chunkSize,
+								   procRank, numProcs, filename);
+	data.numVertices += vrtCoords.num_local_vertices();
+
+	vector<number> x, y, z;
+	vector<int> corners;
+	vector<int> inds;
+	UGXChunkEvaluator<TAPos> evaluator(data, aPos, x, y, z);
+
+	for(size_t i = 0; i < sections.size(); ++i)
+	{
+		const UGXTextSection& sec = sections[i];
+		if(!sec.type)
+			continue;
+
+	//	the coordinates are fetched collectively, so all processes take part in the
+	//	same number of rounds
+		size_t numRounds = 0;
+		for(int p = 0; p < numProcs; ++p)
+			numRounds = std::max(numRounds, (layout.num_entries(i, p) + chunkSize - 1) / chunkSize);
+
+		const size_t numCorners = sec.valsPerEntry;
+		size_t numLeft = layout.num_entries(i, procRank);
+		layout.seek_entries(in, sec, i, procRank);
+
+		for(size_t round = 0; round < numRounds; ++round)
+		{
+			const size_t num = std::min(numLeft, chunkSize);
+			numLeft -= num;
+
+			corners.resize(num * numCorners);
+			if(num > 0){
+				UG_COND_THROW(in.read_values(&corners.front(), corners.size()) != corners.size(),
+							  "EvaluateUGXFile: Incomplete list of '" << sec.type->tagName
+							  << "' in file " << filename);
+			}
+
+			for(size_t j = 0; j < corners.size(); ++j)
+			{
+				UG_COND_THROW(corners[j] < 0 || corners[j] >= (int)vrtCoords.num_vertices(),
+							  "EvaluateUGXFile: Invalid vertex index " << corners[j]
+							  << " in '" << sec.type->tagName << "' of file " << filename);
+			}
+
+		//	pack the coordinates of the referenced vertices and renumber the corners
+			inds = corners;
+			sort(inds.begin(), inds.end());
+			inds.erase(unique(inds.begin(), inds.end()), inds.end());
+			vrtCoords.fetch(x, y, z, inds);
+
+			if(num == 0)
+				continue;
+
+			for(size_t j = 0; j < corners.size(); ++j)
+				corners[j] = (int)(lower_bound(inds.begin(), inds.end(), corners[j]) - inds.begin());
+
+			evaluator.evaluate(sec.type->roid, &corners.front(), num, numCorners);
+		}
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeQualityReportFromFile
+static const size_t defaultUGXChunkSize = 1 << 16;
+
+SmartPtr<QualityReport>
+ComputeQualityReportFromFile(const char* filename, int dim, size_t chunkSize,
+							 number angleHistStepSize, number aspectRatioHistStepSize)
+{
+	UG_COND_THROW(dim != 2 && dim != 3, "Only dimensions 2 or 3 supported.");
+
+	SmartPtr<QualityReport> report = make_sp(new QualityReport(dim, angleHistStepSize,
+															   aspectRatioHistStepSize));
+	ElementQualityData& data = report->add_level(0);
+	data.set_num_worst_elements(0);
+
+	QualityProfile* profile = GetQualityStatisticsProfiling() ? &report->profile() : NULL;
+	if(profile)
+		profile->set_level(0);
+
+	{
+		QualityPhaseTimer timer(profile, "stream");
+		if(dim == 2)
+			EvaluateUGXFile(data, filename, dim, chunkSize, aPosition2);
+		else
+			EvaluateUGXFile(data, filename, dim, chunkSize, aPosition);
+		timer.set_num_elements(dim == 2 ? data.numFaces : data.numVolumes);
+	}
+
+	{
+		QualityPhaseTimer timer(profile, "reduce");
+		ReduceElementQualityData(data);
+	}
+
+	if(profile){
+		profile->set_level(-1);
+		profile->reduce();
+	}
+	return report;
+}
+
+SmartPtr<QualityReport>
+ComputeQualityReportFromFile(const char* filename, int dim)
+{
+	return ComputeQualityReportFromFile(filename, dim, defaultUGXChunkSize, 10.0, 0.1);
+}
+
+SmartPtr<QualityReport>
+ComputeQualityReportFromFile(const char* filename, int dim, size_t chunkSize)
+{
+	return ComputeQualityReportFromFile(filename, dim, chunkSize, 10.0, 0.1);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ElementQualityStatisticsFromFile
+void ElementQualityStatisticsFromFile(const char* filename, int dim, size_t chunkSize,
+									  number angleHistStepSize, number aspectRatioHistStepSize,
+									  bool bWriteHistograms)
+{
+	SmartPtr<QualityReport> report = ComputeQualityReportFromFile(filename, dim, chunkSize,
+											angleHistStepSize, aspectRatioHistStepSize);
+	PrintQualityReport(*report, bWriteHistograms);
+}
+
+void ElementQualityStatisticsFromFile(const char* filename, int dim)
+{
+	ElementQualityStatisticsFromFile(filename, dim, defaultUGXChunkSize, 10.0, 0.1, false);
+}
+
+}
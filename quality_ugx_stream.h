@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __QUALITY_UGX_STREAM_H__
+#define __QUALITY_UGX_STREAM_H__
+
+/* system includes */
+#include <stddef.h>
+#include <cctype>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "quality_report.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	UGXStreamReader
+///	Sequential reader for the tags and the numeric contents of a .ugx file
+/**	Reads the file through a fixed size buffer, i.e. the memory consumption does not
+ *	depend on the size of the file. Only the parts of xml used by .ugx files are
+ *	supported: tags with attributes, numeric texts, comments and declarations.
+ *
+ *	Usage: next_tag returns the tags in the order of the file. After an opening tag,
+ *	its numeric text can be read piecewise by read_values, while skip_element skips
+ *	the whole element including all nested elements.
+ *
+ *	The reader can be positioned at any byte offset by seek, so that several
+ *	processes can read disjoint byte ranges of the same file. seek_values positions
+ *	the reader at a value boundary inside of a text.*/
+class UGXStreamReader
+{
+	public:
+		enum TagType
+		{
+			TAG_OPEN,
+			TAG_CLOSE,
+			TAG_EMPTY	///< self closing tag, e.g. <edges/>
+		};
+
+		struct Tag
+		{
+			TagType type;
+			std::string name;
+			std::string attribs;
+			size_t begin;	///< byte offset of '<'
+			size_t end;		///< byte offset behind '>'
+
+		///	returns the value of the given attribute or an empty string
+			std::string attribute(const char* attribName) const;
+		};
+
+	public:
+		UGXStreamReader(const char* filename, size_t bufferSize = 1 << 20);
+
+	///	reads the next tag. Returns false at the end of the file.
+	/**	Text in front of the tag, comments and declarations are skipped.*/
+		bool next_tag(Tag& tagOut);
+
+	///	skips everything up to and including the closing tag of the given opening tag
+		void skip_element(const Tag& openTag);
+
+	///	reads up to maxNum values of the text in front of the next tag
+	/**	Returns the number of values read. 0 is returned, if the end of the text
+	 *	has been reached.*/
+		size_t read_values(number* valsOut, size_t maxNum);
+		size_t read_values(int* valsOut, size_t maxNum);
+
+	///	skips up to num values of the text in front of the next tag
+	/**	Returns the number of skipped values.*/
+		size_t skip_values(size_t num);
+
+	///	counts the values in front of the next tag, which start in front of the given offset
+		size_t count_values(size_t end);
+
+	///	returns the size of the file in bytes
+		size_t file_size();
+
+	///	continues reading at the given byte offset
+		void seek(size_t offset);
+
+	///	continues reading at the first value of a text, which starts at or behind offset
+	/**	textBegin is the byte offset of the text. A value which starts in front of
+	 *	offset and ends behind it is skipped.*/
+		void seek_values(size_t textBegin, size_t offset);
+
+	///	returns the byte offset of the next character
+		size_t position() const		{return m_bufOffset + m_pos;}
+
+	private:
+		inline int peek()
+		{
+			if(m_pos == m_end && !fill())
+				return -1;
+			return m_buf[m_pos];
+		}
+
+		inline int get()
+		{
+			int c = peek();
+			if(c != -1)
+				++m_pos;
+			return c;
+		}
+
+	///	skips the rest of the current value
+		inline void skip_value_chars()
+		{
+			int c;
+			while((c = peek()) != -1 && !isspace(c) && c != '<')
+				++m_pos;
+		}
+
+		bool fill();
+		void skip_until(const char* endSeq);
+		bool read_token(std::string& tokenOut);
+
+		template <class TValue>
+		size_t read_values_impl(TValue* valsOut, size_t maxNum);
+
+	private:
+		std::string		m_filename;
+		std::ifstream	m_in;
+		std::vector<char>	m_buf;
+		size_t			m_bufOffset;	///< byte offset of m_buf[0]
+		size_t			m_pos;
+		size_t			m_end;
+		std::string		m_token;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ComputeQualityReportFromFile
+///	Evaluates the element qualities of a .ugx file without loading its grid
+/**	The file is split into byte ranges of equal size, one per process. Each process
+ *	only reads its byte range of the vertex coordinates and of the element lists:
+ *	the vertices and elements whose first value starts in this range. Its elements
+ *	are read in chunks of at most chunkSize elements. The coordinates of the vertices
+ *	referenced by a chunk are requested from the processes which read them and are
+ *	packed (3 numbers per vertex) for the evaluation of the chunk. Each chunk is
+ *	evaluated and dropped before the next one is read, so that a process keeps the
+ *	coordinates of about 1/n-th of the vertices of the file and the data of one chunk.
+ *
+ *	Edges, triangles, tetrahedra, prisms and pyramids are evaluated on the packed
+ *	coordinates (see quality_snapshot_kernels.h and tet_kernels.h). Quadrilaterals,
+ *	hexahedra and octahedra are created in a small temporary grid per chunk and
+ *	evaluated through lib_grid, so that all measures are the same as for the loaded
+ *	grid. The result is a report with one level (level 0). Worst elements are not
+ *	tracked, since there are no grid elements they could refer to.
+ *
+ *	The data is reduced over all processes afterwards.
+ *
+ *	Grids with constrained (hanging) vertices or elements are not supported. Comments
+ *	must not contain tags.*/
+SmartPtr<QualityReport>
+ComputeQualityReportFromFile(const char* filename, int dim, size_t chunkSize,
+							 number angleHistStepSize, number aspectRatioHistStepSize);
+
+SmartPtr<QualityReport>
+ComputeQualityReportFromFile(const char* filename, int dim);
+
+SmartPtr<QualityReport>
+ComputeQualityReportFromFile(const char* filename, int dim, size_t chunkSize);
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	ElementQualityStatisticsFromFile
+///	prints the element quality statistics of a .ugx file (see ComputeQualityReportFromFile)
+void ElementQualityStatisticsFromFile(const char* filename, int dim, size_t chunkSize,
+									  number angleHistStepSize, number aspectRatioHistStepSize,
+									  bool bWriteHistograms);
+
+void ElementQualityStatisticsFromFile(const char* filename, int dim);
+
+}
+#endif  //__QUALITY_UGX_STREAM_H__
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include <sstream>
+
+#include "quality_valence.h"
+#include "quality_threading.h"
+#include "common/util/table.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#include "lib_grid/parallelization/parallelization_util.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	VertexValences
+VertexValences::VertexValences(Grid& grid, int dim) :
+	m_grid(grid),
+	m_lvl(0)
+{
+	compute(dim);
+}
+
+VertexValences::VertexValences(MultiGrid& mg, int dim, int lvl) :
+	m_grid(mg),
+	m_lvl(lvl)
+{
+	compute(dim);
+}
+
+VertexValences::~VertexValences()
+{
+	m_grid.detach_from_vertices(m_aValence);
+}
+
+void VertexValences::compute(int dim)
+{
+	UG_COND_THROW(dim != 2 && dim != 3, "VertexValences: Only dimensions 2 or 3 supported.");
+
+	GridObjectCollection goc = m_grid.get_grid_objects();
+	UG_COND_THROW(m_lvl < 0 || m_lvl >= (int)goc.num_levels(),
+				  "VertexValences: invalid level " << m_lvl << ".");
+
+	m_dim = dim;
+	m_maxValence = 0;
+
+	m_grid.attach_to_vertices_dv(m_aValence, 0);
+	m_aaValence.access(m_grid, m_aValence);
+
+	if(dim == 3)
+		count<Volume>(goc);
+	else
+		count<Face>(goc);
+
+	#ifdef UG_PARALLEL
+	//	vertices on process interfaces are shared by elements of several processes
+		AttachmentAllReduce<Vertex>(m_grid, m_aValence, PCL_RO_SUM);
+	#endif
+
+	for(VertexIterator iter = goc.begin<Vertex>(m_lvl); iter != goc.end<Vertex>(m_lvl); ++iter)
+		if(m_maxValence < m_aaValence[*iter])
+			m_maxValence = m_aaValence[*iter];
+
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			pcl::ProcessCommunicator pc;
+			m_maxValence = pc.allreduce(m_maxValence, PCL_RO_MAX);
+		}
+	#endif
+}
+
+template <class TElem>
+void VertexValences::count(GridObjectCollection& goc)
+{
+	typedef typename geometry_traits<TElem>::iterator TIterator;
+	DistributedGridManager* dgm = m_grid.distributed_grid_manager();
+
+//	the vertices of the level are numbered through the valence attachment, so that
+//	every thread can count into an array of its own
+	vector<Vertex*> vrts;
+	CollectElementPointers(vrts, goc.begin<Vertex>(m_lvl), goc.end<Vertex>(m_lvl),
+						   goc.num<Vertex>(m_lvl));
+	for(size_t i = 0; i < vrts.size(); ++i)
+		m_aaValence[vrts[i]] = (int)i;
+
+	vector<TElem*> elems;
+	elems.reserve(goc.num<TElem>(m_lvl));
+	for(TIterator iter = goc.begin<TElem>(m_lvl); iter != goc.end<TElem>(m_lvl); ++iter)
+	{
+		#ifdef UG_PARALLEL
+		//	ghosts (vertical masters) as well as horizontal slaves have to be ignored,
+		//	since they have a copy on another process and
+		//	since we already consider that copy...
+			if(dgm->is_ghost(*iter) || dgm->contains_status(*iter, ES_H_SLAVE))
+				continue;
+		#endif
+		elems.push_back(*iter);
+	}
+
+	size_t numThreads = NumQualityThreadsFor(elems.size());
+	vector<vector<int> > counts(numThreads);
+
+	ParallelForChunks(elems.size(), numThreads,
+		[&](size_t t, size_t from, size_t to)
+		{
+			vector<int>& cnt = counts[t];
+			cnt.assign(vrts.size(), 0);
+			for(size_t i = from; i < to; ++i)
+			{
+				TElem* elem = elems[i];
+				for(size_t j = 0; j < elem->num_vertices(); ++j)
+					++cnt[m_aaValence[elem->vertex(j)]];
+			}
+		});
+
+//	the counters of all threads replace the vertex numbers
+	ParallelForChunks(vrts.size(), numThreads,
+		[&](size_t, size_t from, size_t to)
+		{
+			for(size_t i = from; i < to; ++i)
+			{
+				int val = 0;
+				for(size_t t = 0; t < numThreads; ++t)
+					if(!counts[t].empty())
+						val += counts[t][i];
+				m_aaValence[vrts[i]] = val;
+			}
+		});
+}
+
+void VertexValences::histogram(vector<size_t>& histOut, ISubsetHandler* sh, int si) const
+{
+	DistributedGridManager* dgm = m_grid.distributed_grid_manager();
+	GridObjectCollection goc = m_grid.get_grid_objects();
+
+	vector<number> locHist(m_maxValence + 1, 0);
+	for(VertexIterator iter = goc.begin<Vertex>(m_lvl); iter != goc.end<Vertex>(m_lvl); ++iter)
+	{
+		Vertex* vrt = *iter;
+
+		#ifdef UG_PARALLEL
+		//	every copy holds the summed valence, the vertex is counted by its master
+			if(dgm->is_ghost(vrt) || dgm->contains_status(vrt, ES_H_SLAVE))
+				continue;
+		#endif
+
+		if(sh && sh->get_subset_index(vrt) != si)
+			continue;
+
+		++locHist[m_aaValence[vrt]];
+	}
+
+	vector<number> hist = locHist;
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1){
+			pcl::ProcessCommunicator pc;
+			pc.allreduce(locHist, hist, PCL_RO_SUM);
+		}
+	#endif
+
+	histOut.resize(hist.size());
+	for(size_t i = 0; i < hist.size(); ++i)
+		histOut[i] = (size_t)hist[i];
+}
+
+void VertexValences::print(ISubsetHandler* sh, int si) const
+{
+	vector<size_t> hist;
+	histogram(hist, sh, si);
+
+	size_t numVrts = 0;
+	size_t numRows = 1;
+	for(size_t i = 0; i < hist.size(); ++i)
+	{
+		numVrts += hist[i];
+		if(hist[i] > 0)
+			++numRows;
+	}
+
+	ug::Table<std::stringstream> table(numRows, 3);
+	table(0, 0) << "Valence";	table(0, 1) << "Vertices";	table(0, 2) << "Fraction";
+
+	size_t row = 1;
+	for(size_t i = 0; i < hist.size(); ++i)
+	{
+		if(hist[i] == 0)
+			continue;
+		table(row, 0) << i;
+		table(row, 1) << hist[i];
+		table(row, 2) << (number)hist[i] / (number)numVrts;
+		++row;
+	}
+
+	UG_LOG(endl << "Vertex-" << (m_dim == 3 ? "volume" : "face") << " valences on level " << m_lvl);
+	if(sh)
+		UG_LOG(" (vertices in subset " << si << ")");
+	UG_LOG(":" << endl);
+	UG_LOG("Number of vertices: " << numVrts << ", max valence: " << m_maxValence << endl);
+	UG_LOG(table);
+}
+
+
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+#ifndef __QUALITY_VALENCE_H__
+#define __QUALITY_VALENCE_H__
+
+/* system includes */
+#include <stddef.h>
+#include <vector>
+
+#include "lib_grid/lib_grid.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	VertexValences
+///	Numbers of volumes (dim 3) or faces (dim 2) adjacent to the vertices of a level
+/**	The valences are computed once on construction and stored in a vertex attachment,
+ *	which is detached again when the object is destroyed. The elements are counted in
+ *	chunks by the quality worker threads, each thread into its own counter array, so
+ *	that no atomic operations are required.
+ *
+ *	In parallel ghosts and horizontal slaves are not counted and the valences are summed
+ *	over the horizontal interfaces afterwards, so that every copy of a vertex holds the
+ *	valence of the whole distributed grid. The constructor, max_valence and histogram
+ *	are collective.*/
+class VertexValences
+{
+	public:
+	///	computes the valences of the vertices of a grid (level 0)
+		VertexValences(Grid& grid, int dim = 3);
+
+	///	computes the valences of the vertices on level lvl of a multigrid
+		VertexValences(MultiGrid& mg, int dim, int lvl);
+
+		~VertexValences();
+
+	///	valence of a vertex of the level
+		int valence(Vertex* vrt) const				{return m_aaValence[vrt];}
+
+	///	attachment holding the valences (0 for vertices of other levels)
+		const AInt& attachment() const				{return m_aValence;}
+
+	///	largest valence of all processes
+		int max_valence() const						{return m_maxValence;}
+
+	///	histOut[v] is the number of vertices with valence v of all processes
+	/**	If sh is given, only vertices in subset si are counted. Copies of vertices on
+	 *	several processes are counted once.*/
+		void histogram(std::vector<size_t>& histOut,
+					   ISubsetHandler* sh = NULL, int si = -1) const;
+
+	///	prints the valence histogram of all vertices or of those in subset si
+		void print(ISubsetHandler* sh = NULL, int si = -1) const;
+
+	private:
+		void compute(int dim);
+
+		template <class TElem>
+		void count(GridObjectCollection& goc);
+
+	//	the attachment is owned, copies are not supported
+		VertexValences(const VertexValences&);
+		VertexValences& operator=(const VertexValences&);
+
+	private:
+		Grid& m_grid;
+		int m_dim;
+		int m_lvl;
+		int m_maxValence;
+
+		AInt m_aValence;
+		Grid::VertexAttachmentAccessor<AInt> m_aaValence;
+};
+
+
+}
+#endif  //__QUALITY_VALENCE_H__
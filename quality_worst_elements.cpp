@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include "quality_worst_elements.h"
+#include "common/log.h"
+#include "common/error.h"
+#include "common/util/table.h"
+
+#ifdef UG_PARALLEL
+#include "pcl/pcl.h"
+#endif
+
+using namespace std;
+
+
+namespace ug
+{
+
+
+static size_t g_qualityNumWorstElements = 0;
+
+void SetQualityStatisticsNumWorstElements(int numWorstElements)
+{
+	UG_COND_THROW(numWorstElements < 0, "SetQualityStatisticsNumWorstElements: number has to be non-negative.");
+	g_qualityNumWorstElements = (size_t)numWorstElements;
+}
+
+size_t GetQualityStatisticsNumWorstElements()
+{
+	return g_qualityNumWorstElements;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	WorstElementTracker
+WorstElementTracker::WorstElementTracker(size_t k, bool bLargestIsWorst)
+{
+	init(k, bLargestIsWorst);
+}
+
+void WorstElementTracker::init(size_t k, bool bLargestIsWorst)
+{
+	m_k = k;
+	m_bLargestIsWorst = bLargestIsWorst;
+	m_entries.clear();
+	m_entries.reserve(k);
+	m_bSorted = true;
+}
+
+void WorstElementTracker::push(const Entry& e)
+{
+	if(m_bSorted){
+		make_heap(m_entries.begin(), m_entries.end(), WorseCmp(*this));
+		m_bSorted = false;
+	}
+
+	if(m_entries.size() < m_k){
+		m_entries.push_back(e);
+		push_heap(m_entries.begin(), m_entries.end(), WorseCmp(*this));
+	}
+	else{
+	//	replace the best entry
+		pop_heap(m_entries.begin(), m_entries.end(), WorseCmp(*this));
+		m_entries.back() = e;
+		push_heap(m_entries.begin(), m_entries.end(), WorseCmp(*this));
+	}
+}
+
+void WorstElementTracker::sort() const
+{
+	if(!m_bSorted){
+		sort_heap(m_entries.begin(), m_entries.end(), WorseCmp(*this));
+		m_bSorted = true;
+	}
+}
+
+void WorstElementTracker::merge(const WorstElementTracker& tracker)
+{
+	for(size_t i = 0; i < tracker.m_entries.size(); ++i)
+	{
+		const Entry& e = tracker.m_entries[i];
+		if(accepts(e))
+			push(e);
+	}
+}
+
+void WorstElementTracker::select(Selector& sel) const
+{
+	for(size_t i = 0; i < m_entries.size(); ++i)
+		if(m_entries[i].elem)
+			sel.select(m_entries[i].elem);
+}
+
+void WorstElementTracker::assign_subset(ISubsetHandler& sh, int si) const
+{
+	if(m_entries.empty())
+		return;
+
+	Selector sel(*sh.grid());
+	select(sel);
+	CloseSelection(sel);
+
+	sh.assign_subset(sel.begin<Vertex>(), sel.end<Vertex>(), si);
+	sh.assign_subset(sel.begin<Edge>(), sel.end<Edge>(), si);
+	sh.assign_subset(sel.begin<Face>(), sel.end<Face>(), si);
+	sh.assign_subset(sel.begin<Volume>(), sel.end<Volume>(), si);
+}
+
+void WorstElementTracker::print(const char* name) const
+{
+	if(m_entries.empty())
+		return;
+
+	ug::Table<std::stringstream> table(num() + 1, 4);
+	table(0, 0) << "#";	table(0, 1) << name;
+	table(0, 2) << "Center";	table(0, 3) << "Process";
+
+	for(size_t i = 0; i < num(); ++i)
+	{
+		const Entry& e = entry(i);
+		table(i + 1, 0) << i;
+		table(i + 1, 1) << e.value;
+		table(i + 1, 2) << e.center;
+		table(i + 1, 3) << e.rank;
+	}
+
+	UG_LOG(table);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	AllreduceWorstElements
+#ifdef UG_PARALLEL
+//	A tracker is packed into a slot [k, largestIsWorst, num, entry_0, ..., entry_k-1]
+//	with the entries (value, x, y, z, rank, local index), sorted worst first.
+static const size_t WORST_SLOT_HEADER = 3;
+static const size_t WORST_SLOT_ENTRY = 6;
+
+///	returns true if the packed entry a is worse than b (ties: lower rank, lower index)
+static inline bool PackedEntryIsWorse(const number* a, const number* b, bool bLargestIsWorst)
+{
+	if(a[0] != b[0])
+		return bLargestIsWorst ? (a[0] > b[0]) : (a[0] < b[0]);
+	if(a[4] != b[4])
+		return a[4] < b[4];
+	return a[5] < b[5];
+}
+
+///	MPI user operation: inoutvec[i] = k worst of invec[i] and inoutvec[i] for packed trackers
+/**	Both slots are sorted worst first, so that they are merged in O(k). Since ties are
+ *	resolved uniquely, the operation is commutative.*/
+static void MergePackedWorstElements(void* invec, void* inoutvec, int* len, MPI_Datatype* dtype)
+{
+	int slotBytes;
+	MPI_Type_size(*dtype, &slotBytes);
+	const size_t slotSize = (size_t)slotBytes / sizeof(number);
+
+	const number* in = static_cast<const number*>(invec);
+	number* inout = static_cast<number*>(inoutvec);
+	vector<number> merged(slotSize);
+
+	for(int s = 0; s < *len; ++s)
+	{
+		const number* a = in + s * slotSize;
+		number* b = inout + s * slotSize;
+
+		const size_t k = (size_t)b[0];
+		const bool bLargestIsWorst = (b[1] != 0);
+		const size_t numA = (size_t)a[2], numB = (size_t)b[2];
+		const number* ea = a + WORST_SLOT_HEADER;
+		const number* eb = b + WORST_SLOT_HEADER;
+
+		size_t i = 0, j = 0, num = 0;
+		number* out = &merged[WORST_SLOT_HEADER];
+		for(; num < k && (i < numA || j < numB); ++num, out += WORST_SLOT_ENTRY)
+		{
+			const number* next;
+			if(j >= numB || (i < numA && PackedEntryIsWorse(ea + i * WORST_SLOT_ENTRY,
+															eb + j * WORST_SLOT_ENTRY,
+															bLargestIsWorst)))
+				next = ea + (i++) * WORST_SLOT_ENTRY;
+			else
+				next = eb + (j++) * WORST_SLOT_ENTRY;
+			std::copy(next, next + WORST_SLOT_ENTRY, out);
+		}
+
+		merged[0] = b[0];
+		merged[1] = b[1];
+		merged[2] = (number)num;
+		std::copy(merged.begin(), merged.begin() + WORST_SLOT_HEADER + num * WORST_SLOT_ENTRY, b);
+	}
+}
+#endif
+
+
+void AllreduceWorstElements(WorstElementTracker** trackers, size_t numTrackers)
+{
+	#ifdef UG_PARALLEL
+		if(pcl::NumProcs() > 1 && numTrackers > 0){
+		//	The elements stay on their process, only value, center, rank and the local
+		//	position of an entry are exchanged.
+			const int myRank = pcl::ProcRank();
+			pcl::ProcessCommunicator pc;
+
+			size_t locCapacity = 0;
+			for(size_t k = 0; k < numTrackers; ++k)
+				locCapacity = std::max(locCapacity, trackers[k]->capacity());
+			const size_t capacity = (size_t)pc.allreduce((number)locCapacity, PCL_RO_MAX);
+			if(capacity == 0)
+				return;
+			const size_t slotSize = WORST_SLOT_HEADER + capacity * WORST_SLOT_ENTRY;
+
+			vector<number> loc(numTrackers * slotSize, 0.0), glob(numTrackers * slotSize);
+			for(size_t k = 0; k < numTrackers; ++k)
+			{
+				WorstElementTracker& t = *trackers[k];
+				t.sort();
+				number* slot = &loc[k * slotSize];
+				slot[0] = (number)t.m_k;
+				slot[1] = t.m_bLargestIsWorst ? 1.0 : 0.0;
+				slot[2] = (number)t.m_entries.size();
+				for(size_t i = 0; i < t.m_entries.size(); ++i)
+				{
+					WorstElementTracker::Entry& e = t.m_entries[i];
+					e.rank = myRank;
+					number* pe = slot + WORST_SLOT_HEADER + i * WORST_SLOT_ENTRY;
+					pe[0] = e.value;
+					pe[1] = e.center.x();
+					pe[2] = e.center.y();
+					pe[3] = e.center.z();
+					pe[4] = (number)myRank;
+					pe[5] = (number)i;
+				}
+			}
+
+			MPI_Datatype slotType;
+			MPI_Type_contiguous((int)slotSize,
+								(sizeof(number) == sizeof(double)) ? MPI_DOUBLE : MPI_FLOAT,
+								&slotType);
+			MPI_Type_commit(&slotType);
+
+			MPI_Op mergeOp;
+			MPI_Op_create(&MergePackedWorstElements, 1, &mergeOp);
+
+			pc.allreduce(&loc.front(), &glob.front(), (int)numTrackers, slotType, mergeOp);
+
+			MPI_Op_free(&mergeOp);
+			MPI_Type_free(&slotType);
+
+		//	rebuild the trackers from the global k worst. Own entries get their
+		//	elements back through their local position.
+			for(size_t k = 0; k < numTrackers; ++k)
+			{
+				WorstElementTracker& t = *trackers[k];
+				vector<WorstElementTracker::Entry> locEntries;
+				locEntries.swap(t.m_entries);
+
+				const number* slot = &glob[k * slotSize];
+				const size_t num = (size_t)slot[2];
+				for(size_t i = 0; i < num; ++i)
+				{
+					const number* pe = slot + WORST_SLOT_HEADER + i * WORST_SLOT_ENTRY;
+					WorstElementTracker::Entry e;
+					e.value = pe[0];
+					e.center = vector3(pe[1], pe[2], pe[3]);
+					e.rank = (int)pe[4];
+					if(e.rank == myRank)
+						e.elem = locEntries[(size_t)pe[5]].elem;
+					t.m_entries.push_back(e);
+				}
+				t.m_bSorted = true;
+			}
+		}
+	#endif
+}
+
+
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __QUALITY_WORST_ELEMENTS_H__
+#define __QUALITY_WORST_ELEMENTS_H__
+
+/* system includes */
+#include <stddef.h>
+#include <vector>
+#include <algorithm>
+
+#include "lib_grid/lib_grid.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Number of tracked elements
+///	sets the number of worst elements per measure tracked by the quality statistics
+/**	0 (default) disables the tracking.*/
+void SetQualityStatisticsNumWorstElements(int numWorstElements);
+
+///	returns the number of worst elements per measure tracked by the quality statistics
+size_t GetQualityStatisticsNumWorstElements();
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	WorstElementTracker
+///	Bounded heap of the k worst elements of one quality measure
+/**	Depending on the measure either the smallest (e.g. min angles, aspect ratios) or the
+ *	largest values (e.g. max angles) are the worst. Adding a value costs O(1) if it is not
+ *	among the k worst seen so far and O(log k) otherwise, so the tracker can run inside
+ *	the metric pass.
+ *
+ *	Trackers of different threads are merged with merge. Across processes
+ *	AllreduceWorstElements merges the k entries of the processes pairwise, after which
+ *	every process knows the global k worst values together with the centers and the
+ *	ranks of their elements. Only the
+ *	process owning an element holds its pointer, so that select and assign_subset work
+ *	on local elements. The centers have to be computed by compute_centers before the
+ *	trackers of different processes are merged.*/
+class WorstElementTracker
+{
+	public:
+		struct Entry
+		{
+			Entry() : value(0.0), center(0, 0, 0), rank(0), elem(NULL)	{}
+
+			number value;
+			vector3 center;
+			int rank;
+
+		///	the element (NULL if it lives on another process)
+			GridObject* elem;
+		};
+
+	public:
+		WorstElementTracker(size_t k = 0, bool bLargestIsWorst = false);
+
+	///	sets the number of tracked elements and whether large values are worst. Clears all entries.
+		void init(size_t k, bool bLargestIsWorst);
+
+		void clear()						{m_entries.clear(); m_bSorted = true;}
+
+	///	returns whether a value would currently enter the tracker
+		inline bool accepts(number val) const
+		{
+			if(m_entries.size() < m_k) return true;
+			if(m_k == 0) return false;
+			const Entry& best = m_bSorted ? m_entries.back() : m_entries.front();
+			return m_bLargestIsWorst ? (val > best.value) : (val < best.value);
+		}
+
+	///	adds the value of an element, if it is among the k worst
+		inline void add(number val, GridObject* elem)
+		{
+			if(!accepts(val))
+				return;
+
+			Entry e;
+			e.value = val;
+			e.elem = elem;
+			push(e);
+		}
+
+	///	adds the entries of another tracker (of the same measure)
+		void merge(const WorstElementTracker& tracker);
+
+	///	computes the centers of all local elements
+		template <class TAAPosVRT>
+		void compute_centers(TAAPosVRT& aaPos)
+		{
+			for(size_t i = 0; i < m_entries.size(); ++i)
+				if(m_entries[i].elem)
+					set_center(m_entries[i].center, CalculateCenter(m_entries[i].elem, aaPos));
+		}
+
+	///	merges the trackers of all processes (collective)
+	/**	The trackers are written to slots of k entries and reduced by a user defined
+	 *	MPI operation, which keeps the k worst of two slots at every step. Each message
+	 *	thus holds k entries per tracker, independent of the number of processes. Ties
+	 *	are resolved by rank and local position, so that the result is unique.*/
+		friend void AllreduceWorstElements(WorstElementTracker** trackers, size_t numTrackers);
+
+		size_t capacity() const				{return m_k;}
+		bool enabled() const				{return m_k > 0;}
+		bool largest_is_worst() const		{return m_bLargestIsWorst;}
+
+	///	number of entries (at most k)
+		size_t num() const					{return m_entries.size();}
+
+	///	the i-th worst entry (0: worst)
+		const Entry& entry(size_t i) const	{sort(); return m_entries[i];}
+
+		number value(size_t i) const		{return entry(i).value;}
+		const vector3& center(size_t i) const	{return entry(i).center;}
+		int rank(size_t i) const			{return entry(i).rank;}
+
+	///	selects the tracked elements of this process
+		void select(Selector& sel) const;
+
+	///	assigns the tracked elements of this process and their sides to a subset
+		void assign_subset(ISubsetHandler& sh, int si) const;
+
+	///	logs value, center and rank of all entries
+		void print(const char* name) const;
+
+	protected:
+	///	returns true if a is better than b. The best entry is on top of the heap.
+		inline bool better(const Entry& a, const Entry& b) const
+		{
+			if(a.value != b.value)
+				return m_bLargestIsWorst ? (a.value < b.value) : (a.value > b.value);
+			return a.rank > b.rank;
+		}
+
+	///	returns whether an entry would currently enter the tracker (ties resolved by rank)
+		inline bool accepts(const Entry& e) const
+		{
+			if(m_entries.size() < m_k) return true;
+			if(m_k == 0) return false;
+			return better(m_bSorted ? m_entries.back() : m_entries.front(), e);
+		}
+
+		void push(const Entry& e);
+		void sort() const;
+
+		static void set_center(vector3& centerOut, const vector3& c)	{centerOut = c;}
+		static void set_center(vector3& centerOut, const vector2& c)	{centerOut = vector3(c.x(), c.y(), 0);}
+
+	protected:
+	///	orders worse entries first, i.e. the heap has the best entry on top
+		struct WorseCmp
+		{
+			WorseCmp(const WorstElementTracker& t) : tracker(t)	{}
+			bool operator()(const Entry& a, const Entry& b) const	{return tracker.better(b, a);}
+			const WorstElementTracker& tracker;
+		};
+
+		size_t m_k;
+		bool m_bLargestIsWorst;
+
+	///	heap with the best of the tracked entries on top. Sorted worst first on demand,
+	///	in which case m_bSorted is set and the heap is rebuilt on the next push.
+		mutable std::vector<Entry> m_entries;
+		mutable bool m_bSorted;
+};
+
+void AllreduceWorstElements(WorstElementTracker** trackers, size_t numTrackers);
+
+
+}
+#endif  //__QUALITY_WORST_ELEMENTS_H__
@@ -0,0 +1,404 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#include <cmath>
+
+#include "tet_kernels.h"
+#include "quality_snapshot_kernels.h"
+#include "common/error.h"
+
+
+namespace ug
+{
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TetKernelOut
+TetKernelOut TetKernelOut::
+shifted(size_t offset) const
+{
+	TetKernelOut out;
+	out.volume = volume + offset;
+	out.minDihedral = minDihedral + offset;
+	out.maxDihedral = maxDihedral + offset;
+	out.sumDihedral = sumDihedral ? sumDihedral + offset : NULL;
+	out.m2Dihedral = m2Dihedral ? m2Dihedral + offset : NULL;
+	out.aspectRatio = aspectRatio + offset;
+	out.volToRMSFaceAreaRatio = volToRMSFaceAreaRatio + offset;
+	return out;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Scalar kernel
+///	scalar kernel specialized for the volume metrics 'metrics'
+/**	The operations are those of SnapshotTetrahedronQuality. If the dihedral sums are not
+ *	requested, the extremal dihedrals are taken from the extremal cosines, which only
+ *	needs one arccos each.*/
+template <unsigned int metrics>
+struct TetKernelScalar
+{
+	static const bool bMinDihedral = (metrics & (QM_MIN_DIHEDRAL | QM_DIHEDRAL_DEVIATION)) != 0;
+	static const bool bMaxDihedral = (metrics & (QM_MAX_DIHEDRAL | QM_DIHEDRAL_DEVIATION)) != 0;
+	static const bool bSums = (metrics & QM_DIHEDRAL_DEVIATION) != 0;
+	static const bool bAspectRatio = (metrics & QM_ASPECT_RATIO) != 0;
+	static const bool bRatio = (metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO) != 0;
+	static const bool bNormalLengths = bMinDihedral || bMaxDihedral || bAspectRatio;
+
+	static void apply(const number* x, const number* y, const number* z,
+					  const int* corners, size_t num, const TetKernelOut& out)
+	{
+	//	the dihedral at edge (i,j) lies between the faces opposite to the other two corners
+		static const int faceA[6] = {2, 1, 1, 0, 0, 0};
+		static const int faceB[6] = {3, 3, 2, 3, 2, 1};
+
+		for(size_t i = 0; i < num; ++i)
+		{
+			const int* c = corners + 4 * i;
+
+		//	edge vectors from corner 0
+			number ax = x[c[1]] - x[c[0]], ay = y[c[1]] - y[c[0]], az = z[c[1]] - z[c[0]];
+			number bx = x[c[2]] - x[c[0]], by = y[c[2]] - y[c[0]], bz = z[c[2]] - z[c[0]];
+			number cx = x[c[3]] - x[c[0]], cy = y[c[3]] - y[c[0]], cz = z[c[3]] - z[c[0]];
+
+		//	area normals of the faces opposite to each corner (see SnapshotTetrahedronQuality)
+			number nx[4], ny[4], nz[4];
+			nx[1] = cy*bz - cz*by;	ny[1] = cz*bx - cx*bz;	nz[1] = cx*by - cy*bx;
+			nx[2] = ay*cz - az*cy;	ny[2] = az*cx - ax*cz;	nz[2] = ax*cy - ay*cx;
+			nx[3] = by*az - bz*ay;	ny[3] = bz*ax - bx*az;	nz[3] = bx*ay - by*ax;
+			nx[0] = -(nx[1] + nx[2] + nx[3]);
+			ny[0] = -(ny[1] + ny[2] + ny[3]);
+			nz[0] = -(nz[1] + nz[2] + nz[3]);
+
+			number nLen[4];
+			number maxNLen = 0.0;
+			number sumNLenSq = 0.0;
+			if(bNormalLengths || bRatio)
+			{
+				for(int k = 0; k < 4; ++k)
+				{
+					number lenSq = nx[k]*nx[k] + ny[k]*ny[k] + nz[k]*nz[k];
+					sumNLenSq += lenSq;
+					if(bNormalLengths)
+					{
+						nLen[k] = sqrt(lenSq);
+						if(nLen[k] > maxNLen) maxNLen = nLen[k];
+					}
+				}
+			}
+
+			if(bSums)
+			{
+				number dihedrals[6];
+				for(int e = 0; e < 6; ++e)
+				{
+					int k = faceA[e], l = faceB[e];
+					number d = -(nx[k]*nx[l] + ny[k]*ny[l] + nz[k]*nz[l]);
+					dihedrals[e] = SnapshotAngleFromCos(d / (nLen[k] * nLen[l]));
+				}
+
+				number minDihedral = dihedrals[0];
+				number maxDihedral = dihedrals[0];
+				number sum = 0.0;
+				for(int e = 0; e < 6; ++e)
+				{
+					if(dihedrals[e] < minDihedral) minDihedral = dihedrals[e];
+					if(dihedrals[e] > maxDihedral) maxDihedral = dihedrals[e];
+					sum += dihedrals[e];
+				}
+
+			//	deviations from the element's own mean, in a second pass (see TetKernelOut)
+				number mean = sum / 6.0;
+				number m2 = 0.0;
+				for(int e = 0; e < 6; ++e)
+					m2 += (dihedrals[e] - mean) * (dihedrals[e] - mean);
+
+				out.minDihedral[i] = minDihedral;
+				out.maxDihedral[i] = maxDihedral;
+				out.sumDihedral[i] = sum;
+				out.m2Dihedral[i] = m2;
+			}
+			else if(bMinDihedral || bMaxDihedral)
+			{
+			//	arccos is decreasing: the smallest dihedral has the largest cosine
+				number minCos = 0.0, maxCos = 0.0;
+				for(int e = 0; e < 6; ++e)
+				{
+					int k = faceA[e], l = faceB[e];
+					number d = -(nx[k]*nx[l] + ny[k]*ny[l] + nz[k]*nz[l]);
+					number cosDihedral = d / (nLen[k] * nLen[l]);
+					if(e == 0 || cosDihedral < minCos) minCos = cosDihedral;
+					if(e == 0 || cosDihedral > maxCos) maxCos = cosDihedral;
+				}
+
+				if(bMinDihedral) out.minDihedral[i] = SnapshotAngleFromCos(maxCos);
+				if(bMaxDihedral) out.maxDihedral[i] = SnapshotAngleFromCos(minCos);
+			}
+
+			number absDet = fabs(ax*nx[1] + ay*ny[1] + az*nz[1]);
+			number volume = absDet / 6.0;
+			if(metrics & QM_VOLUME)
+				out.volume[i] = volume;
+
+			if(bAspectRatio)
+			{
+			//	longest edge
+				number dx, dy, dz;
+				number maxLenSq = ax*ax + ay*ay + az*az;
+				number lenSq = bx*bx + by*by + bz*bz;			if(lenSq > maxLenSq) maxLenSq = lenSq;
+				lenSq = cx*cx + cy*cy + cz*cz;					if(lenSq > maxLenSq) maxLenSq = lenSq;
+				dx = bx - ax; dy = by - ay; dz = bz - az;
+				lenSq = dx*dx + dy*dy + dz*dz;					if(lenSq > maxLenSq) maxLenSq = lenSq;
+				dx = cx - ax; dy = cy - ay; dz = cz - az;
+				lenSq = dx*dx + dy*dy + dz*dz;					if(lenSq > maxLenSq) maxLenSq = lenSq;
+				dx = cx - bx; dy = cy - by; dz = cz - bz;
+				lenSq = dx*dx + dy*dy + dz*dz;					if(lenSq > maxLenSq) maxLenSq = lenSq;
+
+			//	hmin = 3V / Amax = |det| / |n|max
+				out.aspectRatio[i] = sqrt(3.0/2.0) * absDet / (maxNLen * sqrt(maxLenSq));
+			}
+
+			if(bRatio)
+			{
+			//	A_rms = sqrt(sum(A_i^2) / 4) with A_i = |n_i| / 2
+				number rmsArea = sqrt(sumNLenSq / 16.0);
+				out.volToRMSFaceAreaRatio[i] = pow(3.0, 7.0/4.0) * sqrt(2.0) / 4.0
+											   * volume / pow(rmsArea, 1.5);
+			}
+		}
+	}
+};
+
+static TetKernelFunc TetKernelScalarVariant(unsigned int metrics)
+{
+	static const QualityMetricsTable<TetKernelFunc, TetKernelScalar> variants;
+	return variants[metrics];
+}
+
+void EvaluateTetrahedraScalar(const number* x, const number* y, const number* z,
+							  const int* corners, size_t num,
+							  const TetKernelOut& out, unsigned int metrics)
+{
+	TetKernelScalarVariant(metrics)(x, y, z, corners, num, out);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Kernel selection
+#ifdef QUALITY_TET_KERNELS_AVX2
+TetKernelFunc TetKernelAVX2Variant(unsigned int metrics);
+#endif
+
+#ifdef QUALITY_TET_KERNELS_AVX512
+TetKernelFunc TetKernelAVX512Variant(unsigned int metrics);
+#endif
+
+struct TetKernelEntry
+{
+	const char* name;
+	TetKernelFunc (*variant)(unsigned int metrics);
+};
+
+static bool CPUSupports(const std::string& name)
+{
+	if(name == "scalar")
+		return true;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	if(name == "avx2")
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+	if(name == "avx512")
+		return __builtin_cpu_supports("avx512f");
+#endif
+	return false;
+}
+
+///	available kernels, fastest first
+static const TetKernelEntry g_tetKernels[] = {
+#ifdef QUALITY_TET_KERNELS_AVX512
+	{"avx512", &TetKernelAVX512Variant},
+#endif
+#ifdef QUALITY_TET_KERNELS_AVX2
+	{"avx2", &TetKernelAVX2Variant},
+#endif
+	{"scalar", &TetKernelScalarVariant}
+};
+
+static const size_t g_numTetKernels = sizeof(g_tetKernels) / sizeof(g_tetKernels[0]);
+
+static const TetKernelEntry& BestTetKernel()
+{
+	for(size_t i = 0; i < g_numTetKernels; ++i)
+		if(CPUSupports(g_tetKernels[i].name))
+			return g_tetKernels[i];
+	return g_tetKernels[g_numTetKernels - 1];
+}
+
+static const TetKernelEntry*& CurrentTetKernel()
+{
+//	initialized on first use (thread safe)
+	static const TetKernelEntry* kernel = &BestTetKernel();
+	return kernel;
+}
+
+void SetQualityTetKernel(const std::string& name)
+{
+	if(name == "auto")
+	{
+		CurrentTetKernel() = &BestTetKernel();
+		return;
+	}
+
+	for(size_t i = 0; i < g_numTetKernels; ++i)
+	{
+		if(name == g_tetKernels[i].name)
+		{
+			if(!CPUSupports(name))
+				UG_THROW("SetQualityTetKernel: '" << name << "' is not supported by this CPU.");
+			CurrentTetKernel() = &g_tetKernels[i];
+			return;
+		}
+	}
+
+	UG_THROW("SetQualityTetKernel: '" << name << "' is not available. "
+			 "Valid are 'auto', 'scalar' and the SIMD variants compiled in.");
+}
+
+std::string GetQualityTetKernel()
+{
+	return CurrentTetKernel()->name;
+}
+
+void EvaluateTetrahedra(const number* x, const number* y, const number* z,
+						const int* corners, size_t num, const TetKernelOut& out)
+{
+	unsigned int metrics = QM_VOLUME_METRICS;
+	if(!out.sumDihedral)
+		metrics &= ~QM_DIHEDRAL_DEVIATION;
+	EvaluateTetrahedra(x, y, z, corners, num, out, metrics);
+}
+
+void EvaluateTetrahedra(const number* x, const number* y, const number* z,
+						const int* corners, size_t num,
+						const TetKernelOut& out, unsigned int metrics)
+{
+	CurrentTetKernel()->variant(metrics)(x, y, z, corners, num, out);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TetKernelResults
+void TetKernelResults::
+evaluate(const number* x, const number* y, const number* z,
+		 const int* corners, size_t numTets,
+		 bool bDihedralSums)
+{
+	unsigned int metrics = QM_VOLUME_METRICS;
+	if(!bDihedralSums)
+		metrics &= ~QM_DIHEDRAL_DEVIATION;
+	evaluate_selected(x, y, z, corners, numTets, metrics);
+}
+
+void TetKernelResults::
+evaluate_selected(const number* x, const number* y, const number* z,
+				  const int* corners, size_t numTets,
+				  unsigned int metrics)
+{
+	const bool bDihedralSums = (metrics & QM_DIHEDRAL_DEVIATION) != 0;
+
+	num = numTets;
+	if(volume.size() < num)
+	{
+		volume.resize(num);
+		minDihedral.resize(num);
+		maxDihedral.resize(num);
+		aspectRatio.resize(num);
+		volToRMSFaceAreaRatio.resize(num);
+	}
+	if(bDihedralSums && sumDihedral.size() < num)
+	{
+		sumDihedral.resize(num);
+		m2Dihedral.resize(num);
+	}
+
+	if(num == 0)
+		return;
+
+	TetKernelOut out;
+	out.volume = &volume.front();
+	out.minDihedral = &minDihedral.front();
+	out.maxDihedral = &maxDihedral.front();
+	out.sumDihedral = bDihedralSums ? &sumDihedral.front() : NULL;
+	out.m2Dihedral = bDihedralSums ? &m2Dihedral.front() : NULL;
+	out.aspectRatio = &aspectRatio.front();
+	out.volToRMSFaceAreaRatio = &volToRMSFaceAreaRatio.front();
+
+	EvaluateTetrahedra(x, y, z, corners, num, out, metrics);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TetBatch
+TetBatch::
+TetBatch(size_t capacity) :
+	m_capacity(capacity),
+	m_num(0),
+	m_corners(4 * capacity)
+{
+	m_x.reserve(4 * capacity);
+	m_y.reserve(4 * capacity);
+	m_z.reserve(4 * capacity);
+	m_elems.reserve(capacity);
+
+//	the coordinates of each tetrahedron are stored consecutively
+	for(size_t i = 0; i < m_corners.size(); ++i)
+		m_corners[i] = (int)i;
+}
+
+const TetKernelResults& TetBatch::
+evaluate(bool bDihedralSums)
+{
+	m_results.evaluate(m_x.data(), m_y.data(), m_z.data(), m_corners.data(), m_num,
+					   bDihedralSums);
+	return m_results;
+}
+
+const TetKernelResults& TetBatch::
+evaluate_selected(unsigned int metrics)
+{
+	m_results.evaluate_selected(m_x.data(), m_y.data(), m_z.data(), m_corners.data(), m_num,
+								metrics);
+	return m_results;
+}
+
+
+}
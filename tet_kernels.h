@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __TET_KERNELS_H__
+#define __TET_KERNELS_H__
+
+/* system includes */
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "lib_grid/lib_grid.h"
+#include "quality_metrics.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	Batched tetrahedron kernels
+/*	The kernels evaluate the quality measures of many tetrahedra given by packed
+ *	coordinates (x, y, z) and 4 vertex indices per tetrahedron. Besides the scalar
+ *	kernel, AVX2 (4 tetrahedra per instruction stream) and AVX-512 (8 tetrahedra)
+ *	variants are compiled if the compiler supports them. The fastest variant supported
+ *	by the CPU is selected at runtime.
+ *
+ *	Tolerance: The kernels evaluate the same geometric quantities as the lib_grid
+ *	functions CalculateVolume, CalculateMinDihedral, CalculateMaxDihedral,
+ *	CalculateAspectRatio and CalculateVolToRMSFaceAreaRatio, but in a different order
+ *	of operations, and the SIMD variants evaluate arccos by a series. For tetrahedra
+ *	whose dihedrals lie in [1, 179] degrees, volume, aspect ratio and
+ *	vol-to-rms-face-area ratio agree up to a relative deviation of 1e-10 and the
+ *	dihedrals up to 1e-10 degrees. For nearly flat tetrahedra the dihedrals may deviate
+ *	by up to 1e-6 degrees, since arccos is ill-conditioned close to 0 and 180 degrees.
+ *
+ *	Every kernel is compiled once per combination of the volume metrics (see
+ *	QualityMetric). A specialization only computes the intermediate values needed for
+ *	its metrics, e.g. the variant for QM_MIN_DIHEDRAL evaluates a single arccos and no
+ *	edge lengths.*/
+
+///	output arrays of the tetrahedron kernels, one entry per tetrahedron
+/**	Only the outputs of the evaluated metrics are written, all others may be NULL:
+ *	volume (QM_VOLUME), minDihedral (QM_MIN_DIHEDRAL or QM_DIHEDRAL_DEVIATION),
+ *	maxDihedral (QM_MAX_DIHEDRAL or QM_DIHEDRAL_DEVIATION), sumDihedral and
+ *	m2Dihedral (QM_DIHEDRAL_DEVIATION), aspectRatio (QM_ASPECT_RATIO) and
+ *	volToRMSFaceAreaRatio (QM_VOL_TO_RMS_FACE_AREA_RATIO). Without the dihedral sums,
+ *	only the arccos of the extremal dihedrals is evaluated instead of all 6, which is
+ *	considerably cheaper. m2Dihedral is computed from the deviations of the element's
+ *	own mean in a second pass, so that it can be merged into a MomentAccumulator
+ *	without the cancellation of sum(d^2) - n mean^2.*/
+struct TetKernelOut
+{
+	number* volume;
+	number* minDihedral;			///< in degrees
+	number* maxDihedral;			///< in degrees
+	number* sumDihedral;			///< sum of the 6 dihedrals
+	number* m2Dihedral;				///< sum of the squared deviations of the 6 dihedrals from their mean
+	number* aspectRatio;			///< sqrt(3/2) * hmin / lmax, 1 for the regular tetrahedron
+	number* volToRMSFaceAreaRatio;	///< normalized V / A_rms^(3/2), 1 for the regular tetrahedron
+
+///	returns the output shifted by 'offset' tetrahedra
+	TetKernelOut shifted(size_t offset) const;
+};
+
+typedef void (*TetKernelFunc)(const number* x, const number* y, const number* z,
+							  const int* corners, size_t num, const TetKernelOut& out);
+
+///	evaluates 'num' tetrahedra with the currently selected kernel
+/**	'corners' holds 4 indices into x, y, z per tetrahedron. All metrics are evaluated,
+ *	the dihedral sums only if out.sumDihedral is set.*/
+void EvaluateTetrahedra(const number* x, const number* y, const number* z,
+						const int* corners, size_t num, const TetKernelOut& out);
+
+///	evaluates the volume metrics in 'metrics' of 'num' tetrahedra with the currently selected kernel
+void EvaluateTetrahedra(const number* x, const number* y, const number* z,
+						const int* corners, size_t num,
+						const TetKernelOut& out, unsigned int metrics);
+
+///	the scalar kernel, which is also used for the remainders of the SIMD kernels
+void EvaluateTetrahedraScalar(const number* x, const number* y, const number* z,
+							  const int* corners, size_t num,
+							  const TetKernelOut& out, unsigned int metrics = QM_VOLUME_METRICS);
+
+///	selects the tetrahedron kernel: "auto" (default), "scalar", "avx2" or "avx512"
+/**	Throws if the kernel is not compiled in or not supported by the CPU.*/
+void SetQualityTetKernel(const std::string& name);
+
+///	returns the name of the selected tetrahedron kernel
+std::string GetQualityTetKernel();
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TetKernelResults
+///	result storage of the tetrahedron kernels
+struct TetKernelResults
+{
+	TetKernelResults() : num(0)	{}
+
+///	evaluates 'num' tetrahedra. The dihedral sums are only evaluated if bDihedralSums is set.
+	void evaluate(const number* x, const number* y, const number* z,
+				  const int* corners, size_t num,
+				  bool bDihedralSums);
+
+///	evaluates the volume metrics in 'metrics' of 'num' tetrahedra
+/**	Only the arrays of the evaluated metrics are filled (see TetKernelOut).*/
+	void evaluate_selected(const number* x, const number* y, const number* z,
+						   const int* corners, size_t num,
+						   unsigned int metrics);
+
+	size_t num;
+	std::vector<number> volume;
+	std::vector<number> minDihedral;
+	std::vector<number> maxDihedral;
+	std::vector<number> sumDihedral;
+	std::vector<number> m2Dihedral;
+	std::vector<number> aspectRatio;
+	std::vector<number> volToRMSFaceAreaRatio;
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	TetBatch
+///	Collects the coordinates of up to 'capacity' tetrahedra, which are then evaluated at once
+/**	Used to feed the kernels from elements which are not stored in a
+ *	QualityGeometrySnapshot.*/
+class TetBatch
+{
+	public:
+		TetBatch(size_t capacity = 512);
+
+		template <class TAAPosVRT>
+		void push_back(Volume* tet, TAAPosVRT& aaPos)
+		{
+			for(size_t i = 0; i < 4; ++i)
+				push_coordinates(aaPos[tet->vertex(i)]);
+			m_elems.push_back(tet);
+			++m_num;
+		}
+
+		size_t size() const		{return m_num;}
+		bool empty() const		{return m_num == 0;}
+		bool full() const		{return m_num == m_capacity;}
+
+		void clear()			{m_num = 0; m_x.clear(); m_y.clear(); m_z.clear(); m_elems.clear();}
+
+	///	the stored tetrahedra, in the order of the results
+		GridObject* const* elements() const	{return m_elems.data();}
+
+	///	evaluates the stored tetrahedra, see TetKernelResults::evaluate
+		const TetKernelResults& evaluate(bool bDihedralSums);
+
+	///	evaluates the volume metrics in 'metrics' of the stored tetrahedra
+		const TetKernelResults& evaluate_selected(unsigned int metrics);
+
+		const TetKernelResults& results() const	{return m_results;}
+
+	protected:
+		void push_coordinates(const vector2& p)	{m_x.push_back(p.x()); m_y.push_back(p.y()); m_z.push_back(0.0);}
+		void push_coordinates(const vector3& p)	{m_x.push_back(p.x()); m_y.push_back(p.y()); m_z.push_back(p.z());}
+
+	protected:
+		size_t m_capacity;
+		size_t m_num;
+		std::vector<number> m_x;
+		std::vector<number> m_y;
+		std::vector<number> m_z;
+		std::vector<int> m_corners;
+		std::vector<GridObject*> m_elems;
+		TetKernelResults m_results;
+};
+
+}
+#endif  //__TET_KERNELS_H__
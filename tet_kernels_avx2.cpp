@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+/*	Compiled with -mavx2 -mfma (see CMakeLists.txt). Only called if the CPU supports
+ *	AVX2 and FMA (see SetQualityTetKernel).*/
+
+#include <immintrin.h>
+
+#include "tet_kernels_simd.h"
+
+
+namespace ug
+{
+
+
+///	4 doubles per register
+struct SimdAVX2
+{
+	typedef __m256d vec;
+	typedef __m256d mask;
+	static const size_t width = 4;
+
+	static vec set1(number a)			{return _mm256_set1_pd(a);}
+	static vec gather(const number* base, const int* c)
+	{
+		return _mm256_i32gather_pd(base, _mm_setr_epi32(c[0], c[4], c[8], c[12]), 8);
+	}
+
+	static vec add(vec a, vec b)		{return _mm256_add_pd(a, b);}
+	static vec sub(vec a, vec b)		{return _mm256_sub_pd(a, b);}
+	static vec mul(vec a, vec b)		{return _mm256_mul_pd(a, b);}
+	static vec div(vec a, vec b)		{return _mm256_div_pd(a, b);}
+	static vec min(vec a, vec b)		{return _mm256_min_pd(a, b);}
+	static vec max(vec a, vec b)		{return _mm256_max_pd(a, b);}
+	static vec sqrt(vec a)				{return _mm256_sqrt_pd(a);}
+	static vec abs(vec a)				{return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);}
+
+	static mask less(vec a, vec b)		{return _mm256_cmp_pd(a, b, _CMP_LT_OQ);}
+	static vec select(mask m, vec ifTrue, vec ifFalse)	{return _mm256_blendv_pd(ifFalse, ifTrue, m);}
+
+	static void store(number* p, vec a)	{_mm256_storeu_pd(p, a);}
+};
+
+
+///	the AVX2 kernel specialized for the volume metrics 'metrics'
+template <unsigned int metrics>
+struct TetKernelAVX2
+{
+	static void apply(const number* x, const number* y, const number* z,
+					  const int* corners, size_t num, const TetKernelOut& out)
+	{
+		EvaluateTetrahedraSIMD<SimdAVX2, metrics>(x, y, z, corners, num, out);
+	}
+};
+
+TetKernelFunc TetKernelAVX2Variant(unsigned int metrics)
+{
+	static const QualityMetricsTable<TetKernelFunc, TetKernelAVX2> variants;
+	return variants[metrics];
+}
+
+
+}
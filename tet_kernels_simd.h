@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2013-2021:  G-CSC, Goethe University Frankfurt
+ * Author: Martin Stepniewski
+ *
+ * This file is part of UG4.
+ *
+ * UG4 is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License version 3 (as published by the
+ * Free Software Foundation) with the following additional attribution
+ * requirements (according to LGPL/GPL v3 §7):
+ *
+ * (1) The following notice must be displayed in the Appropriate Legal Notices
+ * of covered and combined works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (2) The following notice must be displayed at a prominent place in the
+ * terminal output of covered works: "Based on UG4 (www.ug4.org/license)".
+ *
+ * (3) The following bibliography is recommended for citation and must be
+ * preserved in all covered files:
+ * "Reiter, S., Vogel, A., Heppner, I., Rupp, M., and Wittum, G. A massively
+ *   parallel geometric multigrid solver on hierarchically distributed grids.
+ *   Computing and visualization in science 16, 4 (2013), 151-164"
+ * "Vogel, A., Reiter, S., Rupp, M., Nägel, A., and Wittum, G. UG4 -- a novel
+ *   flexible software system for simulating pde based models on high performance
+ *   computers. Computing and visualization in science 16, 4 (2013), 165-179"
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ */
+
+
+#ifndef __TET_KERNELS_SIMD_H__
+#define __TET_KERNELS_SIMD_H__
+
+/* system includes */
+#include <stddef.h>
+#include <cmath>
+
+#include "tet_kernels.h"
+
+
+namespace ug {
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//	EvaluateTetrahedraSIMD
+/*	Common implementation of the SIMD tetrahedron kernels. It is only included by the
+ *	translation units which are compiled with the corresponding instruction set
+ *	(tet_kernels_avx2.cpp, tet_kernels_avx512.cpp). TSimd wraps the intrinsics:
+ *
+ *		typedef ... vec, mask;
+ *		static const size_t width;
+ *		vec set1(number), gather(const number* base, const int* corners)
+ *		vec add, sub, mul, div, min, max (vec, vec), sqrt(vec), abs(vec)
+ *		mask less(vec, vec)
+ *		vec select(mask, vec ifTrue, vec ifFalse)
+ *		void store(number*, vec)
+ *
+ *	gather loads base[corners[4*l]] into lane l.
+ *
+ *	'metrics' are the evaluated volume metrics (see QualityMetric), the remainder is
+ *	evaluated by the scalar kernel for the same metrics.*/
+
+static const number TET_KERNELS_PI = 3.14159265358979323846;
+
+///	coefficients c_n of the series asin(t) = sum c_n t^(2n+1)
+static const size_t NUM_ASIN_COEFFS = 23;
+
+//	internal linkage: this header is compiled with different instruction sets, so
+//	the linker must not pick one translation unit's copy for all of them.
+static inline void AsinSeriesCoefficients(number coeffsOut[NUM_ASIN_COEFFS])
+{
+	coeffsOut[0] = 1.0;
+	for(size_t n = 0; n + 1 < NUM_ASIN_COEFFS; ++n)
+		coeffsOut[n+1] = coeffsOut[n] * (number)((2*n+1)*(2*n+1))
+						 / (number)((2*n+2)*(2*n+3));
+}
+
+///	arccos in degrees
+/**	|x| <= 0.5:	acos(x) = pi/2 - asin(x)
+ *	|x| > 0.5:	acos(|x|) = 2 asin(sqrt((1-|x|)/2)).
+ *	asin is evaluated by its series for arguments <= 0.5, which converges by at least
+ *	a factor of 4 per term. With 23 terms the truncation error is below 1e-16.*/
+template <class TSimd>
+inline typename TSimd::vec
+SimdAcosDeg(typename TSimd::vec x, const number* asinCoeffs)
+{
+	typedef typename TSimd::vec vec;
+	const vec zero = TSimd::set1(0.0);
+	const vec half = TSimd::set1(0.5);
+	const vec one = TSimd::set1(1.0);
+	const vec halfPi = TSimd::set1(0.5 * TET_KERNELS_PI);
+	const vec pi = TSimd::set1(TET_KERNELS_PI);
+
+	vec a = TSimd::min(TSimd::abs(x), one);
+	typename TSimd::mask big = TSimd::less(half, a);
+	vec t = TSimd::select(big, TSimd::sqrt(TSimd::mul(TSimd::sub(one, a), half)), a);
+
+	vec u = TSimd::mul(t, t);
+	vec s = TSimd::set1(asinCoeffs[NUM_ASIN_COEFFS - 1]);
+	for(size_t n = NUM_ASIN_COEFFS - 1; n > 0; --n)
+		s = TSimd::add(TSimd::mul(s, u), TSimd::set1(asinCoeffs[n-1]));
+	s = TSimd::mul(s, t);
+
+	vec r = TSimd::select(big, TSimd::add(s, s), TSimd::sub(halfPi, s));
+	r = TSimd::select(TSimd::less(x, zero), TSimd::sub(pi, r), r);
+	return TSimd::mul(r, TSimd::set1(180.0 / TET_KERNELS_PI));
+}
+
+template <class TSimd, unsigned int metrics>
+void EvaluateTetrahedraSIMD(const number* x, const number* y, const number* z,
+							const int* corners, size_t num, const TetKernelOut& out)
+{
+	typedef typename TSimd::vec vec;
+	const size_t W = TSimd::width;
+
+	number asinCoeffs[NUM_ASIN_COEFFS];
+	AsinSeriesCoefficients(asinCoeffs);
+
+//	the dihedral at edge (i,j) lies between the faces opposite to the other two corners
+	static const int faceA[6] = {2, 1, 1, 0, 0, 0};
+	static const int faceB[6] = {3, 3, 2, 3, 2, 1};
+
+	const bool bMinDihedral = (metrics & (QM_MIN_DIHEDRAL | QM_DIHEDRAL_DEVIATION)) != 0;
+	const bool bMaxDihedral = (metrics & (QM_MAX_DIHEDRAL | QM_DIHEDRAL_DEVIATION)) != 0;
+	const bool bSums = (metrics & QM_DIHEDRAL_DEVIATION) != 0;
+	const bool bAspectRatio = (metrics & QM_ASPECT_RATIO) != 0;
+	const bool bRatio = (metrics & QM_VOL_TO_RMS_FACE_AREA_RATIO) != 0;
+	const bool bNormalLengths = bMinDihedral || bMaxDihedral || bAspectRatio;
+	const size_t numFull = num - num % W;
+
+	for(size_t i = 0; i < numFull; i += W)
+	{
+		const int* c = corners + 4 * i;
+
+	//	edge vectors from corner 0
+		vec x0 = TSimd::gather(x, c), y0 = TSimd::gather(y, c), z0 = TSimd::gather(z, c);
+		vec ax = TSimd::sub(TSimd::gather(x, c+1), x0);
+		vec ay = TSimd::sub(TSimd::gather(y, c+1), y0);
+		vec az = TSimd::sub(TSimd::gather(z, c+1), z0);
+		vec bx = TSimd::sub(TSimd::gather(x, c+2), x0);
+		vec by = TSimd::sub(TSimd::gather(y, c+2), y0);
+		vec bz = TSimd::sub(TSimd::gather(z, c+2), z0);
+		vec cx = TSimd::sub(TSimd::gather(x, c+3), x0);
+		vec cy = TSimd::sub(TSimd::gather(y, c+3), y0);
+		vec cz = TSimd::sub(TSimd::gather(z, c+3), z0);
+
+	//	area normals of the faces opposite to each corner (see SnapshotTetrahedronQuality)
+		vec nx[4], ny[4], nz[4];
+		nx[1] = TSimd::sub(TSimd::mul(cy, bz), TSimd::mul(cz, by));
+		ny[1] = TSimd::sub(TSimd::mul(cz, bx), TSimd::mul(cx, bz));
+		nz[1] = TSimd::sub(TSimd::mul(cx, by), TSimd::mul(cy, bx));
+		nx[2] = TSimd::sub(TSimd::mul(ay, cz), TSimd::mul(az, cy));
+		ny[2] = TSimd::sub(TSimd::mul(az, cx), TSimd::mul(ax, cz));
+		nz[2] = TSimd::sub(TSimd::mul(ax, cy), TSimd::mul(ay, cx));
+		nx[3] = TSimd::sub(TSimd::mul(by, az), TSimd::mul(bz, ay));
+		ny[3] = TSimd::sub(TSimd::mul(bz, ax), TSimd::mul(bx, az));
+		nz[3] = TSimd::sub(TSimd::mul(bx, ay), TSimd::mul(by, ax));
+		nx[0] = TSimd::sub(TSimd::set1(0.0), TSimd::add(TSimd::add(nx[1], nx[2]), nx[3]));
+		ny[0] = TSimd::sub(TSimd::set1(0.0), TSimd::add(TSimd::add(ny[1], ny[2]), ny[3]));
+		nz[0] = TSimd::sub(TSimd::set1(0.0), TSimd::add(TSimd::add(nz[1], nz[2]), nz[3]));
+
+		vec nLen[4];
+		vec maxNLen = TSimd::set1(0.0);
+		vec sumNLenSq = TSimd::set1(0.0);
+		if(bNormalLengths || bRatio)
+		{
+			for(int k = 0; k < 4; ++k)
+			{
+				vec lenSq = TSimd::add(TSimd::add(TSimd::mul(nx[k], nx[k]), TSimd::mul(ny[k], ny[k])),
+									   TSimd::mul(nz[k], nz[k]));
+				sumNLenSq = TSimd::add(sumNLenSq, lenSq);
+				if(bNormalLengths)
+				{
+					nLen[k] = TSimd::sqrt(lenSq);
+					maxNLen = TSimd::max(maxNLen, nLen[k]);
+				}
+			}
+		}
+
+	//	cosines of the dihedrals
+		vec cosDihedral[6];
+		if(bMinDihedral || bMaxDihedral)
+		{
+			vec minCos = TSimd::set1(1.0);
+			vec maxCos = TSimd::set1(-1.0);
+			for(int e = 0; e < 6; ++e)
+			{
+				int k = faceA[e], l = faceB[e];
+				vec d = TSimd::add(TSimd::add(TSimd::mul(nx[k], nx[l]), TSimd::mul(ny[k], ny[l])),
+								   TSimd::mul(nz[k], nz[l]));
+				cosDihedral[e] = TSimd::div(TSimd::sub(TSimd::set1(0.0), d),
+											TSimd::mul(nLen[k], nLen[l]));
+				minCos = TSimd::min(minCos, cosDihedral[e]);
+				maxCos = TSimd::max(maxCos, cosDihedral[e]);
+			}
+
+		//	arccos is decreasing: the smallest dihedral has the largest cosine
+			if(bMinDihedral)
+				TSimd::store(out.minDihedral + i, SimdAcosDeg<TSimd>(maxCos, asinCoeffs));
+			if(bMaxDihedral)
+				TSimd::store(out.maxDihedral + i, SimdAcosDeg<TSimd>(minCos, asinCoeffs));
+		}
+
+		if(bSums)
+		{
+			vec dihedrals[6];
+			vec sum = TSimd::set1(0.0);
+			for(int e = 0; e < 6; ++e)
+			{
+				dihedrals[e] = SimdAcosDeg<TSimd>(cosDihedral[e], asinCoeffs);
+				sum = TSimd::add(sum, dihedrals[e]);
+			}
+
+			vec mean = TSimd::div(sum, TSimd::set1(6.0));
+			vec m2 = TSimd::set1(0.0);
+			for(int e = 0; e < 6; ++e)
+			{
+				vec dev = TSimd::sub(dihedrals[e], mean);
+				m2 = TSimd::add(m2, TSimd::mul(dev, dev));
+			}
+			TSimd::store(out.sumDihedral + i, sum);
+			TSimd::store(out.m2Dihedral + i, m2);
+		}
+
+	//	volume
+		vec det = TSimd::add(TSimd::add(TSimd::mul(ax, nx[1]), TSimd::mul(ay, ny[1])),
+							 TSimd::mul(az, nz[1]));
+		vec absDet = TSimd::abs(det);
+		vec volume = TSimd::div(absDet, TSimd::set1(6.0));
+		if(metrics & QM_VOLUME)
+			TSimd::store(out.volume + i, volume);
+
+		if(bAspectRatio)
+		{
+		//	longest edge
+			vec maxLenSq = TSimd::add(TSimd::add(TSimd::mul(ax, ax), TSimd::mul(ay, ay)), TSimd::mul(az, az));
+			maxLenSq = TSimd::max(maxLenSq, TSimd::add(TSimd::add(TSimd::mul(bx, bx), TSimd::mul(by, by)), TSimd::mul(bz, bz)));
+			maxLenSq = TSimd::max(maxLenSq, TSimd::add(TSimd::add(TSimd::mul(cx, cx), TSimd::mul(cy, cy)), TSimd::mul(cz, cz)));
+			vec dx = TSimd::sub(bx, ax), dy = TSimd::sub(by, ay), dz = TSimd::sub(bz, az);
+			maxLenSq = TSimd::max(maxLenSq, TSimd::add(TSimd::add(TSimd::mul(dx, dx), TSimd::mul(dy, dy)), TSimd::mul(dz, dz)));
+			dx = TSimd::sub(cx, ax); dy = TSimd::sub(cy, ay); dz = TSimd::sub(cz, az);
+			maxLenSq = TSimd::max(maxLenSq, TSimd::add(TSimd::add(TSimd::mul(dx, dx), TSimd::mul(dy, dy)), TSimd::mul(dz, dz)));
+			dx = TSimd::sub(cx, bx); dy = TSimd::sub(cy, by); dz = TSimd::sub(cz, bz);
+			maxLenSq = TSimd::max(maxLenSq, TSimd::add(TSimd::add(TSimd::mul(dx, dx), TSimd::mul(dy, dy)), TSimd::mul(dz, dz)));
+
+		//	aspect ratio: sqrt(3/2) * hmin / lmax with hmin = |det| / |n|max
+			TSimd::store(out.aspectRatio + i,
+						 TSimd::div(TSimd::mul(TSimd::set1(sqrt(3.0/2.0)), absDet),
+									TSimd::mul(maxNLen, TSimd::sqrt(maxLenSq))));
+		}
+
+		if(bRatio)
+		{
+		//	vol to rms face area ratio with A_rms = sqrt(sum |n_i|^2 / 16)
+			vec rmsArea = TSimd::sqrt(TSimd::div(sumNLenSq, TSimd::set1(16.0)));
+			vec rmsArea15 = TSimd::mul(rmsArea, TSimd::sqrt(rmsArea));
+			TSimd::store(out.volToRMSFaceAreaRatio + i,
+						 TSimd::div(TSimd::mul(TSimd::set1(pow(3.0, 7.0/4.0) * sqrt(2.0) / 4.0), volume),
+									rmsArea15));
+		}
+	}
+
+//	remainder
+	if(numFull < num)
+		EvaluateTetrahedraScalar(x, y, z, corners + 4 * numFull, num - numFull,
+								 out.shifted(numFull), metrics);
+}
+
+
+}
+#endif  //__TET_KERNELS_SIMD_H__